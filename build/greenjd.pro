@@ -0,0 +1,36 @@
+# ----------------
+# Qt Project file of the headless daemon, controlled over JSON-RPC
+# ----------------
+
+TEMPLATE = app
+TARGET = greenjd
+QT = core network
+CONFIG += console
+CONFIG -= app_bundle
+DEFINES += GREENJ_HEADLESS
+
+include(greenj.pri)
+
+# keep the objects apart from the GUI build, they differ by GREENJ_HEADLESS
+OBJECTS_DIR = $$BUILDDIR/daemon
+MOC_DIR = $$SOURCEDIR/GeneratedFiles/daemon
+
+HEADERS += $$SOURCEDIR/daemon.h \
+    $$SOURCEDIR/json_rpc_server.h \
+    $$SOURCEDIR/codec_bench.h \
+    $$SOURCEDIR/call_table_bench.h \
+    $$SOURCEDIR/log_bench.h \
+    $$SOURCEDIR/log_query_bench.h \
+    $$SOURCEDIR/stand_in_registrar.h \
+    $$SOURCEDIR/load_test.h \
+    $$SOURCEDIR/signal_handler.h
+SOURCES += $$SOURCEDIR/main_daemon.cpp \
+    $$SOURCEDIR/daemon.cpp \
+    $$SOURCEDIR/json_rpc_server.cpp \
+    $$SOURCEDIR/codec_bench.cpp \
+    $$SOURCEDIR/call_table_bench.cpp \
+    $$SOURCEDIR/log_bench.cpp \
+    $$SOURCEDIR/log_query_bench.cpp \
+    $$SOURCEDIR/stand_in_registrar.cpp \
+    $$SOURCEDIR/load_test.cpp \
+    $$SOURCEDIR/signal_handler.cpp
@@ -31,7 +31,9 @@
  *      onUpdate            {}                                  after update()
  *      onRegisterUpdate    {}                                  after register() and first update()
  *      onUnregister        {}                                  after unregister() > unregisterFromServer
- *      onAccountState      { state: state }                    account state has changed
+ *      onAccountState      { state: state, id: account id }    account state has changed
+ *      onCallUserData      { id: call id, userData: Object }   user data of a call has changed
+ *      onReady             { ready: boolean, timeline: Array } the phone application finished its startup
  *      onOptionsChanged    {}                                  after setOptions() (use this.options to read options)
  *      onMakeCall          { outgoingCall: li.Phone.Call }     after makeCall()
  *      onSoundLevelChanged integer level
@@ -49,6 +51,7 @@
 li.Phone = function(options) {
     this.handler = new li.Phone.Handler(this);
     this.calls = [];
+    this._readyCallbacks = [];
 
     this.options = {
         qthandler:           null,
@@ -131,6 +134,9 @@ li.Phone.prototype = {
     account:        null,
     handler:        null,
     _registered:    false,
+    _callListVersion: -1,
+    _ready:         null,
+    _readyCallbacks: null,
 
     /**
      * Set phone options
@@ -149,6 +155,7 @@ li.Phone.prototype = {
     setOptions: function(options) {
         options = this.defaults(options, {});
         jQuery.extend(this.options, options);
+        this.handler.connectQtHandler(this.options.qthandler);
         this.trigger('onOptionsChanged');
         return this;
     },
@@ -227,6 +234,41 @@ li.Phone.prototype = {
         this.trigger('onUnregister');
         return this.isRegistered() ? false : true;
     },
+    /**
+     * Register an additional account, e.g. another extension of a shared line.
+     *  The registration result arrives by 'onAccountState' with the account id.
+     * @param {Object} account { host: string, name: string, secret: string, maxCalls: integer }
+     *  maxCalls: incoming calls get rejected as busy if the account has this many calls (default: 0, no limit)
+     * @return {integer} id of the account, -1 on error
+     */
+    registerAccount: function(account) {
+        account = this.defaults(account, {});
+        return this.getQtHandler().registerAccount(account.host, account.name, account.secret,
+                                                   this.defaults(account.maxCalls, 0));
+    },
+    /**
+     * Unregister an account and hang up its calls
+     * @param {integer} id      account id
+     * @return {boolean} false, if there is no such account
+     */
+    unregisterAccount: function(id) {
+        return this.getQtHandler().unregisterAccount(id);
+    },
+    /**
+     * Set the account used for calls without accountId
+     * @param {integer} id      account id
+     * @return {boolean} false, if there is no such account
+     */
+    setDefaultAccount: function(id) {
+        return this.getQtHandler().setDefaultAccount(id);
+    },
+    /**
+     * Get all registered accounts
+     * @return {Array} list of { id, userName, host, address, status, registered, statusCode, expires, default, calls, maxCalls, rejectedCalls, ... }
+     */
+    getAccountList: function() {
+        return this.getQtHandler().getAccountList();
+    },
     /**
      * Is account registered? Checks account status on the phone application.
      * @return {boolean} true, if account is registered
@@ -235,6 +277,53 @@ li.Phone.prototype = {
         this._registered = (this.getQtHandler().checkAccountStatus() ? true : false);
         return this._registered;
     },
+    /**
+     * Has the phone application finished its startup?
+     *  Calls to the phone application made before fail, use {@link li.Phone#whenReady}.
+     * @return {boolean} true, if the phone is ready
+     */
+    isReady: function() {
+        if (null === this._ready) {
+            var qthandler = this.getQtHandler();
+            if (!qthandler.isPhoneReady) {
+                this._ready = true;     // phone application without startup events
+            } else if (qthandler.isPhoneReady()) {
+                this._ready = true;
+            }
+        }
+        return this._ready === true;
+    },
+    /**
+     * Call a function as soon as the phone application is ready, right away if it already is.
+     * @param {Function} callback   called with the phone as this
+     * @return this
+     */
+    whenReady: function(callback) {
+        if (this.isReady()) {
+            callback.call(this);
+        } else {
+            this._readyCallbacks.push(callback);
+        }
+        return this;
+    },
+    /**
+     * Get the startup phases of the phone application.
+     * @return {Array} list of { phase: string, time: integer ms since start, duration: integer ms since the phase before }
+     */
+    getStartupTimeline: function() {
+        var qthandler = this.getQtHandler();
+        return qthandler.getStartupTimeline ? qthandler.getStartupTimeline() : [];
+    },
+    /**
+     * Get the audio quality of a call.
+     * @param {integer} call_id
+     * @return {Object} { poor: boolean, last: sample, history: Array of samples }, a sample is
+     *  { time, rtt, rx: { packets, loss, jitter, discarded, mos }, tx: { ... } }
+     */
+    getCallQuality: function(call_id) {
+        var qthandler = this.getQtHandler();
+        return qthandler.getCallQuality ? qthandler.getCallQuality(call_id) : {};
+    },
     /**
      * Get current mode.
      * @return li.Phone.MODE_IO, .MODE_OUT or .MODE_IN
@@ -254,7 +343,24 @@ li.Phone.prototype = {
         this.account.status       = info.status;
         this.account.onlineStatus = info.online_status;
 
-        var i, calllist = this.getQtHandler().getActiveCallList();
+        if (this.getQtHandler().getCallListChanges) {
+            this.updateCalls(this.getQtHandler().getCallListChanges(this._callListVersion));
+        } else {
+            this.updateCalls({ calls: this.getQtHandler().getActiveCallList() });
+        }
+        this.trigger('onUpdate');
+        return this;
+    },
+    /**
+     * Updates the calls from a list of changed calls.
+     * @param {Object} changes  { version: call list version, calls: list of call data (see {@link li.Phone.Call#update}) }
+     * @return this
+     */
+    updateCalls: function(changes) {
+        var i, calllist = changes.calls;
+        if (typeof changes.version !== 'undefined') {
+            this._callListVersion = changes.version;
+        }
         for (i in calllist) {
             if (calllist.hasOwnProperty(i)) {
                 var opt = {
@@ -266,18 +372,22 @@ li.Phone.prototype = {
                 } else {
                     var call = new li.Phone.Call(opt, calllist[i]);
                     try {
-                        var str = this.getQtHandler().getCallUserData(calllist[i].id);
-                        if (str !== "") {
-                            var data = jQuery.parseJSON(str);
+                        var data = (typeof calllist[i].userData !== 'undefined')
+                                ? calllist[i].userData
+                                : this.getQtHandler().getCallUserData(calllist[i].id);
+                        if (typeof data === 'string') {
+                            // phone application without structured user data
+                            data = (data !== "") ? jQuery.parseJSON(data) : null;
+                        }
+                        if (data && !jQuery.isEmptyObject(data)) {
                             call.setUserData(data, false, false);
                         }
                     } catch (ex) {
-                        li.errorHandler.log("phone.update(): could not parse user data.");
+                        li.errorHandler.log("phone.updateCalls(): could not parse user data.");
                     }
                 }
             }
         }
-        this.trigger('onUpdate');
         return this;
     },
     /**
@@ -421,6 +531,7 @@ li.Phone.prototype = {
      *      number: string       number to call
      *      protocol: string     defaults to 'sip:'
      *      userdata: mixed      some user data
+     *      accountId: integer   [optional] account to call from, see {@link li.Phone#registerAccount}
      *  } </pre>
      * @return {li.Phone.Call|boolean} Call that has been created or false, if no call has been created.
      * @throws {li.errorType}.PHONE_MAKECALL_NUMBERREQUIRED, .PHONE_MAKECALL_FAILED
@@ -435,17 +546,24 @@ li.Phone.prototype = {
         var opt = {
             number:     null,
             protocol:   'sip:',
-            userdata:   null
+            userdata:   null,
+            accountId:  null
         };
         jQuery.extend(opt, options);
         if (null === opt.number) {
             throw li.errorType.PHONE_MAKECALL_NUMBERREQUIRED;
         }
-        var number = opt.protocol + opt.number + '@' + this.account.host + ':' + this.account.port;
+        var host = this.account.host;
+        if (null !== opt.accountId) {
+            host = this.getQtHandler().getAccountInformationById(opt.accountId).host || host;
+        }
+        var number = opt.protocol + opt.number + '@' + host + ':' + this.account.port;
         if (false !== this.options.forceOutgoingNumber) {
             number = this.options.forceOutgoingNumber;
         }
-        var id = this.getQtHandler().makeCall(number);
+        var id = (null !== opt.accountId)
+               ? this.getQtHandler().makeCallFromAccount(number, opt.accountId)
+               : this.getQtHandler().makeCall(number);
         li.errorHandler.log("phone.makeCall("+number+"): id="+id);
         if (id < 0) {
             throw li.errorType.PHONE_MAKECALL_FAILED;
@@ -533,6 +651,69 @@ li.Phone.prototype = {
         return this.options.mutePhoneMicro;
     },
 
+    /**
+     * Get a page of finished calls, newest first
+     * @param {integer} offset  number of matching calls to skip
+     * @param {integer} limit   maximum number of calls to return
+     * @param {integer} type    [optional] only calls of this type (li.Phone.Call.TYPE_*)
+     * @param {integer} status  [optional] only calls with this status (li.Phone.Call.STATUS_*)
+     * @return {Object} { total: number of matching calls, offset: integer, calls: array of call data }
+     */
+    getCallHistory: function(offset, limit, type, status) {
+        return this.getQtHandler().getCallHistory(offset, limit, this.defaults(type, -1), this.defaults(status, -1));
+    },
+    /**
+     * Store the user data of a call in the phone application
+     * @param {integer} id      call id
+     * @param {mixed} data      user data, fields can only be set for an Object
+     * @param {boolean} extend  [optional] only set the fields of data, otherwise the user data gets replaced
+     */
+    setCallUserData: function(id, data, extend) {
+        var qt = this.getQtHandler(), key;
+        var isMap = (data === null || typeof data === 'undefined' || jQuery.isPlainObject(data));
+        if (!qt.setCallUserDataMap || !isMap) {
+            if (extend && this.hasCallById(id)) {
+                data = jQuery.extend({}, this.getCallById(id).getUserData(), data);
+            }
+            qt.setCallUserData(id, JSON.stringify(data));
+            return;
+        }
+        if (!extend) {
+            qt.setCallUserDataMap(id, data || {});
+            return;
+        }
+        for (key in data) {
+            if (data.hasOwnProperty(key)) {
+                qt.setCallUserDataField(id, key, data[key]);
+            }
+        }
+    },
+    /**
+     * Get one field of the user data of a call from the phone application
+     * @param {integer} id      call id
+     * @param {string} key      name of the field
+     * @return {mixed} the value, null if the field isn't set
+     */
+    getCallUserDataField: function(id, key) {
+        return this.getQtHandler().getCallUserDataField(id, key);
+    },
+    /**
+     * Set one field of the user data of a call in the phone application
+     * @param {integer} id      call id
+     * @param {string} key      name of the field
+     * @param {mixed} value     the value, null removes the field
+     */
+    setCallUserDataField: function(id, key, value) {
+        this.getQtHandler().setCallUserDataField(id, key, value);
+    },
+    /**
+     * Get the user data of many calls at once
+     * @param {Array} ids       [optional] call ids, all active calls if empty
+     * @return {Object} user data of each call by id
+     */
+    getCallsUserData: function(ids) {
+        return this.getQtHandler().getCallsUserData(this.defaults(ids, []));
+    },
     /**
      * Get applications error log data
      * @return {array} list of error log objects
@@ -553,6 +734,21 @@ li.Phone.prototype = {
     setLogLevel: function(level) {
         this.getQtHandler().setLogLevel(level);
     },
+    /**
+     * Sets log level of a single log domain, overriding the application log level
+     * @param {string} domain       the log domain, e.g. "pjsip", "account", "call", "phone", "js_handler"
+     * @param {integer} level       li.Phone.LOG_STATUS_*, -1 to use the application log level again
+     */
+    setLogDomainLevel: function(domain, level) {
+        this.getQtHandler().setLogDomainLevel(domain, level);
+    },
+    /**
+     * Retrieve the log levels of domains with their own log level
+     * @return {object} log level by domain name
+     */
+    getLogDomainLevels: function() {
+        return this.getQtHandler().getLogDomainLevels();
+    },
     /**
      * Retrieve list of log files
      * @return {array} array of log file names (strings)
@@ -568,6 +764,56 @@ li.Phone.prototype = {
     getLogFileContent: function(filename) {
         return this.getQtHandler().getLogFileContent(filename);
     },
+    /**
+     * Read a part of a log file, ending at a line end
+     * @param {string} filename     name of the log file
+     * @param {integer} offset      byte offset to start reading
+     * @param {integer} length      maximum number of bytes
+     * @return {object} data, offset, length, next (offset to continue) and size
+     */
+    readLogFile: function(filename, offset, length) {
+        return this.getQtHandler().readLogFile(filename, offset, length);
+    },
+    /**
+     * Read the last lines of a log file
+     * @param {string} filename     name of the log file
+     * @param {integer} count       maximum number of lines
+     * @return {object} lines, offset (see {@link li.Phone#readLogFileBackward}) and size
+     */
+    tailLogFile: function(filename, count) {
+        return this.getQtHandler().tailLogFile(filename, count);
+    },
+    /**
+     * Read the lines in front of an offset, to page backwards through a log file
+     * @param {string} filename     name of the log file
+     * @param {integer} offset      offset returned by the previous page
+     * @param {integer} count       maximum number of lines
+     * @return {object} lines, offset (for the page before) and size
+     */
+    readLogFileBackward: function(filename, offset, count) {
+        return this.getQtHandler().readLogFileBackward(filename, offset, count);
+    },
+    /**
+     * Read lines of a log file by line number
+     * @param {string} filename     name of the log file
+     * @param {integer} first       number of the first line, starting at 0
+     * @param {integer} count       maximum number of lines
+     * @return {object} lines, firstLine, next (line to continue with), offset and size
+     */
+    readLogLines: function(filename, first, count) {
+        return this.getQtHandler().readLogLines(filename, first, count);
+    },
+    /**
+     * Search the log files
+     * @param {object} query        all optional: status (li.Phone.LOG_STATUS_* or array of them),
+     *                              minStatus, domain, from and to (ms since epoch), text,
+     *                              limit (default 1000), files (default all log files)
+     * @return {object} matches (file, offset, time, status, domain, code, message),
+     *                  truncated, files, skippedFiles, blocks, skippedBlocks
+     */
+    queryLog: function(query) {
+        return this.getQtHandler().queryLog(query || {});
+    },
     /**
      * Delete log file (has to be in log file list, see {@link li.Phone#getLogFileList})
      * @param {string} filename  name of the log file
@@ -613,6 +859,7 @@ li.Phone.Call = function(options, data) {
 
         number:             null,        // number
         callee:             null,        // number/identifier, that has been dialed (if incoming)
+        accountId:          null,        // account of the call
         state:              0,           // call state
         stateText:          '',          // call state text
         lastStatus:         0,           // last received status code
@@ -862,8 +1109,7 @@ li.Phone.Call.prototype = {
         jQuery.extend(true, this.data, data);
 
         if (data.userdata) {
-            this.phone.getQtHandler().setCallUserData(this.id, JSON.stringify(this.data.userdata));
-            var getData = jQuery.parseJSON(this.phone.getQtHandler().getCallUserData(this.id));
+            this.phone.setCallUserData(this.id, this.data.userdata);
         }
         return this;
     },
@@ -947,8 +1193,7 @@ li.Phone.Call.prototype = {
             this.data.userdata = userdata;
         }
         if (qthandler) {
-            this.phone.getQtHandler().setCallUserData(this.id, JSON.stringify(this.data.userdata));
-            var data = jQuery.parseJSON(this.phone.getQtHandler().getCallUserData(this.id));
+            this.phone.setCallUserData(this.id, extend ? userdata : this.data.userdata, extend);
         }
     },
     /**
@@ -972,6 +1217,76 @@ li.Phone.Handler = function(phone) {
 };
 li.Phone.Handler.prototype = {
     phone: null,
+    qthandler: null,
+    _readyTriggered: false,
+
+    /**
+     * Receive the events of the phone application through its signals
+     *  instead of JavaScript calls (needs a phone application with signal support).
+     * @param {Object} qthandler    Qt handler object
+     * @return {boolean} true, if the signals have been connected
+     */
+    connectQtHandler: function(qthandler) {
+        var self = this;
+        if (!qthandler || !qthandler.signalCallState || this.qthandler === qthandler) {
+            return false;
+        }
+        this.qthandler = qthandler;
+        qthandler.signalAccountState.connect(function(event) {
+                self.accountStateChanged(event.state, event.id);
+            });
+        qthandler.signalCallState.connect(function(event) {
+                self.callStateChanged(event.id, event.state, event.lastStatus);
+            });
+        qthandler.signalIncomingCall.connect(function(event) {
+                self.incomingCall(event.id, event.url, event.name, event.accountId);
+            });
+        qthandler.signalLogMessage.connect(function(event) {
+                self.logMessage(event);
+            });
+        qthandler.signalSoundLevel.connect(function(event) {
+                self.soundLevel(event.level);
+            });
+        qthandler.signalMicrophoneLevel.connect(function(event) {
+                self.microphoneLevel(event.level);
+            });
+        qthandler.signalCallListChanged.connect(function(event) {
+                self.callListChanged(event);
+            });
+        if (qthandler.signalCallUserDataChanged) {
+            qthandler.signalCallUserDataChanged.connect(function(event) {
+                    self.callUserDataChanged(event.id, event.userData);
+                });
+        }
+        if (qthandler.signalCallQuality) {
+            qthandler.signalCallQuality.connect(function(event) {
+                    self.callQualityChanged(event.id, event.quality);
+                });
+        }
+        if (qthandler.signalPhoneReady) {
+            qthandler.signalPhoneReady.connect(function(event) {
+                    self.phoneReady(event.ready, event.timeline);
+                });
+        }
+        return true;
+    },
+
+    /**
+     * The phone application sends its events in batches.
+     *  Calls the handler method of each event in order;
+     *  triggers li.Phone.'onError' with { message: string, exception: e } if one fails.
+     * @param {Array} events        list of [ method name, [ arguments ] ]
+     */
+    dispatchEvents: function(events) {
+        var i;
+        for (i = 0; i < events.length; i++) {
+            try {
+                this[events[i][0]].apply(this, events[i][1]);
+            } catch(e) {
+                this.phone.trigger('onError', { message: "li.Phone.Handler.dispatchEvents(): "+events[i][0]+": exception: '"+e+"'", exception: e } );
+            }
+        }
+    },
 
     /**
      * An incoming call with id and number has been detected.
@@ -980,9 +1295,10 @@ li.Phone.Handler.prototype = {
      * @param {integer} call_id
      * @param {string} number       incoming number
      * @param {string} callee       the number/identifier, that has been called
+     * @param {integer} account_id  [optional] the account, that has been called
      * @return {boolean} true, if successful
      */
-    incomingCall: function(call_id, number, callee) {
+    incomingCall: function(call_id, number, callee, account_id) {
         li.errorHandler.log("phone.Handler.incomingCall("+call_id+",'"+number+"','"+callee+"')");
         var opt = {
                 id:     call_id,
@@ -991,7 +1307,8 @@ li.Phone.Handler.prototype = {
             data = {
                 type:   li.Phone.Call.TYPE_INCOMING,
                 number: number,
-                callee: callee
+                callee: callee,
+                accountId: account_id
             };
         try {
             var c = new li.Phone.Call(opt, data);
@@ -1008,6 +1325,59 @@ li.Phone.Handler.prototype = {
         }
         return true;
     },
+    /**
+     * The page has been reloaded, the phone application sends all active calls.
+     *  Triggers li.Phone.'onUpdate'.
+     * @param {Object} changes      see {@link li.Phone#updateCalls}
+     */
+    callListChanged: function(changes) {
+        this.phone.updateCalls(changes);
+        this.phone.trigger('onUpdate');
+    },
+    /**
+     * The user data of a call has been changed.
+     *  Triggers li.Phone.'onCallUserData' with { id: call_id, userData: userdata }.
+     * @param {integer} call_id
+     * @param {Object} userdata     the new user data
+     */
+    callUserDataChanged: function(call_id, userdata) {
+        if (this.phone.hasCallById(call_id)) {
+            this.phone.getCallById(call_id).setUserData(userdata, false, false);
+        }
+        this.phone.trigger('onCallUserData', { id: call_id, userData: userdata });
+    },
+    /**
+     * The audio quality of a call got poor or good again.
+     *  Triggers li.Phone.'onCallQuality' with { id: call_id, quality: sample }.
+     * @param {integer} call_id
+     * @param {Object} quality      the last sample with poor, see {@link li.Phone#getCallQuality}
+     */
+    callQualityChanged: function(call_id, quality) {
+        this.phone.trigger('onCallQuality', { id: call_id, quality: quality });
+    },
+    /**
+     * The phone application finished its startup.
+     *  Triggers li.Phone.'onReady' with { ready: boolean, timeline: Array } once;
+     *  runs the functions given to {@link li.Phone#whenReady} if the phone is ready.
+     * @param {boolean} ready       false, if the phone application failed to start
+     * @param {Array} timeline      see {@link li.Phone#getStartupTimeline}
+     */
+    phoneReady: function(ready, timeline) {
+        var callbacks = this.phone._readyCallbacks, i;
+        this.phone._ready = ready ? true : false;
+        if (this._readyTriggered) {
+            return;
+        }
+        this._readyTriggered = true;
+        this.phone.trigger('onReady', { ready: this.phone._ready, timeline: timeline });
+        if (!ready) {
+            return;
+        }
+        this.phone._readyCallbacks = [];
+        for (i = 0; i < callbacks.length; i++) {
+            callbacks[i].call(this.phone);
+        }
+    },
     /**
      * A log object/message has been sent.
      *  Triggers li.Phone.'onLogMessage' with obj.
@@ -1048,11 +1418,12 @@ li.Phone.Handler.prototype = {
     },
     /**
      * The account state has been updated.
-     *  Triggers li.Phone.'onAccountState' with { state: state };
+     *  Triggers li.Phone.'onAccountState' with { state: state, id: account_id };
      * @param {integer} state
+     * @param {integer} account_id  [optional] the account
      */
-    accountStateChanged: function(state) {
-        this.phone.trigger('onAccountState', { state: state } );
+    accountStateChanged: function(state, account_id) {
+        this.phone.trigger('onAccountState', { state: state, id: account_id } );
     },
     /**
      * The sound level has changed
@@ -137,6 +137,33 @@ window.qt_handler = {
     setCallUserData: function(id, data) {
         if (typeof this.calls[id] === 'undefined') { return; }
         this.calls[id].data = data;
+    },
+    getCallUserDataMap: function(id) {
+        var data = this.getCallUserData(id);
+        return data ? jQuery.parseJSON(data) : {};
+    },
+    setCallUserDataMap: function(id, data) {
+        this.setCallUserData(id, JSON.stringify(data));
+    },
+    getCallUserDataField: function(id, key) {
+        var data = this.getCallUserDataMap(id);
+        return data.hasOwnProperty(key) ? data[key] : null;
+    },
+    setCallUserDataField: function(id, key, value) {
+        var data = this.getCallUserDataMap(id);
+        if (value === null) {
+            delete data[key];
+        } else {
+            data[key] = value;
+        }
+        this.setCallUserDataMap(id, data);
+    },
+    getCallsUserData: function(ids) {
+        var result = {}, i;
+        for (i = 0; i < ids.length; i++) {
+            result[ids[i]] = this.getCallUserDataMap(ids[i]);
+        }
+        return result;
     },    
     muteSound: function(mute) {
         this.sound = (mute ? 0 : 1);
@@ -146,6 +173,15 @@ window.qt_handler = {
         this.micro = (mute ? 0 : 1);
         this.triggerMicrophoneLevel(this.micro);
     },
+    isPhoneReady: function() {
+        return true;
+    },
+    getStartupTimeline: function() {
+        return [];
+    },
+    getCallQuality: function(call_id) {
+        return {};
+    },
     getSignalInformation: function() {
         return { sound: this.sound, micro: this.micro };
     },
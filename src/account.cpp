@@ -11,15 +11,13 @@
 
 #include "account.h"
 
-#include <QtGui/QApplication>
 #include <QDir>
 #include <QFile>
-#include <QMessageBox>
 #include <QTextStream>
 
 
 //----------------------------------------------------------------------
-Account::Account() : user_name_(""), password_(""), host_("")
+Account::Account() : user_name_(""), password_(""), host_(""), max_calls_(0)
 {
 }
 
@@ -46,6 +44,12 @@ void Account::setHost(const QString &host)
   host_ = host;
 }
 
+//----------------------------------------------------------------------
+void Account::setMaxCalls(const int &max_calls)
+{
+  max_calls_ = max_calls;
+}
+
 //----------------------------------------------------------------------
 const QString &Account::getUserName() const
 {
@@ -63,3 +67,9 @@ const QString &Account::getHost() const
 {
   return host_;
 }
+
+//----------------------------------------------------------------------
+const int &Account::getMaxCalls() const
+{
+  return max_calls_;
+}
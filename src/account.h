@@ -24,6 +24,7 @@ class Account
     QString user_name_;
     QString password_;
     QString host_;
+    int max_calls_;
 
 public:
     Account();
@@ -47,6 +48,13 @@ public:
      */
     void setHost(const QString &host);
 
+    /**
+     * set the maximum number of simultaneous calls, further incoming
+     * calls get rejected as busy
+     * @param max_calls int, the maximum, 0 for no limit
+     */
+    void setMaxCalls(const int &max_calls);
+
     /**
      * get the user_name
      * @return QString, the user_name
@@ -64,6 +72,12 @@ public:
      * @return QString, the host
      */
     const QString &getHost() const;
+
+    /**
+     * get the maximum number of simultaneous calls
+     * @return int, the maximum, 0 for no limit
+     */
+    const int &getMaxCalls() const;
 };
 
 #endif // ACCOUNT_H
@@ -0,0 +1,227 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "account_table.h"
+
+//----------------------------------------------------------------------
+AccountTable::AccountTable(const int &capacity, const int &call_capacity) :
+    capacity_(capacity), count_(0), default_id_(-1),
+    call_capacity_(call_capacity)
+{
+    entries_ = new Entry[capacity_];
+    for (int i = 0; i < capacity_; ++i)
+    {
+        entries_[i].used_ = false;
+        entries_[i].reg_status_ = 0;
+        entries_[i].reg_count_ = 0;
+    }
+    call_accounts_ = new QAtomicInt[call_capacity_];
+}
+
+//----------------------------------------------------------------------
+AccountTable::~AccountTable()
+{
+    delete[] entries_;
+    delete[] call_accounts_;
+}
+
+//----------------------------------------------------------------------
+bool AccountTable::insert(const int &acc_id, const Account &acc)
+{
+    if (acc_id < 0 || acc_id >= capacity_)
+        return false;
+
+    Entry &entry = entries_[acc_id];
+    if (!entry.used_)
+        ++count_;
+    entry.used_ = true;
+    entry.account_ = acc;
+    entry.reg_status_ = 0;
+    entry.reg_time_ = QDateTime();
+    entry.reg_count_ = 0;
+    entry.max_calls_ = acc.getMaxCalls();
+    entry.rejected_ = 0;
+
+    if (default_id_ < 0)
+        default_id_ = acc_id;
+    return true;
+}
+
+//----------------------------------------------------------------------
+void AccountTable::remove(const int &acc_id)
+{
+    if (!contains(acc_id))
+        return;
+
+    entries_[acc_id].used_ = false;
+    entries_[acc_id].max_calls_ = 0;
+    --count_;
+
+    if (default_id_ == acc_id)
+    {
+        QList<int> ids = getIds();
+        default_id_ = ids.isEmpty() ? -1 : ids.first();
+    }
+}
+
+//----------------------------------------------------------------------
+bool AccountTable::contains(const int &acc_id) const
+{
+    return acc_id >= 0 && acc_id < capacity_ && entries_[acc_id].used_;
+}
+
+//----------------------------------------------------------------------
+int AccountTable::findId(const Account &acc) const
+{
+    for (int i = 0; i < capacity_; ++i)
+    {
+        const Entry &entry = entries_[i];
+        if (entry.used_
+            && entry.account_.getUserName() == acc.getUserName()
+            && entry.account_.getHost() == acc.getHost())
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+bool AccountTable::getAccount(const int &acc_id, Account &acc) const
+{
+    if (!contains(acc_id))
+        return false;
+    acc = entries_[acc_id].account_;
+    return true;
+}
+
+//----------------------------------------------------------------------
+QList<int> AccountTable::getIds() const
+{
+    QList<int> ids;
+    for (int i = 0; i < capacity_; ++i)
+    {
+        if (entries_[i].used_)
+            ids << i;
+    }
+    return ids;
+}
+
+//----------------------------------------------------------------------
+int AccountTable::getCount() const
+{
+    return count_;
+}
+
+//----------------------------------------------------------------------
+int AccountTable::getCapacity() const
+{
+    return capacity_;
+}
+
+//----------------------------------------------------------------------
+int AccountTable::getDefault() const
+{
+    return default_id_;
+}
+
+//----------------------------------------------------------------------
+bool AccountTable::setDefault(const int &acc_id)
+{
+    if (!contains(acc_id))
+        return false;
+    default_id_ = acc_id;
+    return true;
+}
+
+//----------------------------------------------------------------------
+void AccountTable::setRegState(const int &acc_id, const int &status)
+{
+    if (!contains(acc_id))
+        return;
+
+    Entry &entry = entries_[acc_id];
+    entry.reg_status_ = status;
+    ++entry.reg_count_;
+    if (status / 100 == 2)
+        entry.reg_time_ = QDateTime::currentDateTime();
+}
+
+//----------------------------------------------------------------------
+bool AccountTable::addCall(const int &acc_id, const int &call_id,
+                           const bool &check_limit)
+{
+    if (acc_id < 0 || acc_id >= capacity_
+        || call_id < 0 || call_id >= call_capacity_)
+    {
+        return true;
+    }
+
+    Entry &entry = entries_[acc_id];
+    int max_calls = entry.max_calls_;
+    while (true)
+    {
+        int count = entry.call_count_;
+        if (check_limit && max_calls > 0 && count >= max_calls)
+        {
+            entry.rejected_.ref();
+            return false;
+        }
+        if (entry.call_count_.testAndSetOrdered(count, count + 1))
+            break;
+    }
+
+    // a call id which is still counted belongs to an ended call
+    // whose disconnect got lost
+    int old_acc = call_accounts_[call_id].fetchAndStoreOrdered(acc_id + 1);
+    if (old_acc > 0)
+        entries_[old_acc - 1].call_count_.deref();
+    return true;
+}
+
+//----------------------------------------------------------------------
+void AccountTable::removeCall(const int &call_id)
+{
+    if (call_id < 0 || call_id >= call_capacity_)
+        return;
+
+    int acc = call_accounts_[call_id].fetchAndStoreOrdered(0);
+    if (acc > 0)
+        entries_[acc - 1].call_count_.deref();
+}
+
+//----------------------------------------------------------------------
+int AccountTable::getCallCount(const int &acc_id) const
+{
+    if (acc_id < 0 || acc_id >= capacity_)
+        return 0;
+    return entries_[acc_id].call_count_;
+}
+
+//----------------------------------------------------------------------
+void AccountTable::getInfo(const int &acc_id, QVariantMap &info) const
+{
+    if (!contains(acc_id))
+        return;
+
+    const Entry &entry = entries_[acc_id];
+    info.insert("id", acc_id);
+    info.insert("userName", entry.account_.getUserName());
+    info.insert("host", entry.account_.getHost());
+    info.insert("default", acc_id == default_id_);
+    info.insert("statusCode", entry.reg_status_);
+    info.insert("registerTime", entry.reg_time_.isValid()
+                                ? entry.reg_time_.toMSecsSinceEpoch() : 0);
+    info.insert("registerCount", entry.reg_count_);
+    info.insert("calls", (int)entry.call_count_);
+    info.insert("maxCalls", (int)entry.max_calls_);
+    info.insert("rejectedCalls", (int)entry.rejected_);
+}
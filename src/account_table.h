@@ -0,0 +1,182 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef ACCOUNT_TABLE_H
+#define ACCOUNT_TABLE_H
+
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QList>
+#include <QVariantMap>
+
+#include "account.h"
+
+/**
+ * All accounts registered by the voip-api, indexed by account id.
+ * Besides the login data it keeps the registration state and counts
+ * the calls of each account. Counting calls and checking the call limit
+ * is lock-free, so it can be done from the callbacks of the voip-api
+ * threads, everything else belongs to the gui thread.
+ */
+class AccountTable
+{
+    struct Entry
+    {
+        bool used_;
+        Account account_;
+        int reg_status_;
+        QDateTime reg_time_;
+        int reg_count_;
+
+        /**
+         * read by the voip-api threads
+         */
+        QAtomicInt max_calls_;
+        QAtomicInt call_count_;
+        QAtomicInt rejected_;
+    };
+
+    Entry *entries_;
+    int capacity_;
+    int count_;
+    int default_id_;
+
+    /**
+     * Account id + 1 of each counted call, indexed by call_id, 0 if
+     * the call isn't counted
+     */
+    QAtomicInt *call_accounts_;
+    int call_capacity_;
+
+    AccountTable(const AccountTable&);
+    AccountTable &operator=(const AccountTable&);
+
+public:
+    /**
+     * Constructor
+     * @param capacity int, the number of account ids of the voip-api
+     * @param call_capacity int, the number of call ids of the voip-api
+     */
+    AccountTable(const int &capacity, const int &call_capacity);
+    ~AccountTable();
+
+    /**
+     * Add a registered account. The first account becomes the default
+     * account.
+     * @param acc_id int, the id the voip-api gave the account
+     * @param acc Account, the login data
+     * @return bool false if the id is invalid
+     */
+    bool insert(const int &acc_id, const Account &acc);
+
+    /**
+     * Remove an account, if it was the default account the account
+     * with the lowest id becomes the default account
+     * @param acc_id int, the id of the account
+     */
+    void remove(const int &acc_id);
+
+    /**
+     * Check if an account is in the table
+     * @param acc_id int, the id of the account
+     * @return bool true if the account is in the table
+     */
+    bool contains(const int &acc_id) const;
+
+    /**
+     * Find an account by its login data
+     * @param acc Account, the login data, user name and host are compared
+     * @return int the id of the account or -1
+     */
+    int findId(const Account &acc) const;
+
+    /**
+     * Get the login data of an account
+     * @param acc_id int, the id of the account
+     * @param acc Account, gets the login data
+     * @return bool false if the account isn't in the table
+     */
+    bool getAccount(const int &acc_id, Account &acc) const;
+
+    /**
+     * Get the ids of all accounts
+     * @return QList<int> the ids in ascending order
+     */
+    QList<int> getIds() const;
+
+    /**
+     * Get the number of accounts
+     * @return int the number of accounts
+     */
+    int getCount() const;
+
+    /**
+     * Get the number of account ids
+     * @return int no account id is equal or greater than this
+     */
+    int getCapacity() const;
+
+    /**
+     * Get the default account, used when no account is given
+     * @return int the id of the account, -1 if there is none
+     */
+    int getDefault() const;
+
+    /**
+     * Set the default account
+     * @param acc_id int, the id of the account
+     * @return bool false if the account isn't in the table
+     */
+    bool setDefault(const int &acc_id);
+
+    /**
+     * Store a registration response of an account
+     * @param acc_id int, the id of the account
+     * @param status int, the sip status code
+     */
+    void setRegState(const int &acc_id, const int &status);
+
+    /**
+     * Count a new call of an account. Incoming calls are only counted if
+     * the account has less calls than its limit, so they can be rejected.
+     * Thread-safe.
+     * @param acc_id int, the id of the account
+     * @param call_id int, the id of the call
+     * @param check_limit bool, true for incoming calls
+     * @return bool false if the limit is reached, the call isn't counted
+     */
+    bool addCall(const int &acc_id, const int &call_id, const bool &check_limit);
+
+    /**
+     * A call ended, stop counting it. Calls which aren't counted get
+     * ignored. Thread-safe.
+     * @param call_id int, the id of the call
+     */
+    void removeCall(const int &call_id);
+
+    /**
+     * Get the number of calls of an account
+     * @param acc_id int, the id of the account
+     * @return int the number of active calls
+     */
+    int getCallCount(const int &acc_id) const;
+
+    /**
+     * Get the state of an account
+     * @param acc_id int, the id of the account
+     * @param info QVariantMap, gets id, userName, host, default,
+     *        statusCode, registerTime, registerCount, calls, maxCalls
+     *        and rejectedCalls
+     */
+    void getInfo(const int &acc_id, QVariantMap &info) const;
+};
+
+#endif // ACCOUNT_TABLE_H
@@ -0,0 +1,204 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "bridge_bench.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QStringList>
+#include <QTextStream>
+#include <QWebFrame>
+
+#include "json.h"
+#include "process_stats.h"
+
+const int BridgeBench::WAY_SOURCE = 0;
+const int BridgeBench::WAY_BATCH = 1;
+const int BridgeBench::WAY_SIGNAL = 2;
+const int BridgeBench::EVENT_RATE = 1000;
+const int BridgeBench::INTERVAL = 10;
+
+/**
+ * the handlers of the page, like those of phone-lib.js they only take
+ * the values over
+ */
+static const char *BENCH_PAGE =
+    "<html><head><script>"
+    "var received = 0;"
+    "var last = null;"
+    "var handler = {"
+    "  callStateChanged: function(id, state, last_status) { last = state; received++; },"
+    "  logMessage: function(log) { last = log.message; received++; },"
+    "  dispatchEvents: function(events) {"
+    "    for (var i = 0; i < events.length; i++)"
+    "      this[events[i][0]].apply(this, events[i][1]);"
+    "  }"
+    "};"
+    "function connectSignals() {"
+    "  bench.signalCallState.connect(function(event) { last = event.state; received++; });"
+    "  bench.signalLogMessage.connect(function(event) { last = event.message; received++; });"
+    "}"
+    "</script></head><body></body></html>";
+
+//----------------------------------------------------------------------
+BridgeBench::BridgeBench(const int &seconds) :
+    seconds_(seconds > 0 ? seconds : 10), way_(WAY_SOURCE), sent_(0), dispatch_ns_(0)
+{
+    connect(&timer_, SIGNAL(timeout()), this, SLOT(sendEvents()));
+}
+
+//----------------------------------------------------------------------
+QVariant BridgeBench::evaluate(const QString &source)
+{
+    return page_.mainFrame()->evaluateJavaScript(source);
+}
+
+//----------------------------------------------------------------------
+void BridgeBench::sendEvents()
+{
+    int count = EVENT_RATE * INTERVAL / 1000;
+    QElapsedTimer timer;
+    timer.start();
+
+    // the events are built the way JavascriptHandler builds them
+    QVariantList batch;
+    for (int i = 0; i < count; ++i, ++sent_)
+    {
+        QVariantMap event;
+        QString func;
+        if (sent_ % 2)
+        {
+            event.insert("time", QDateTime::currentDateTime().toString("dd.MM.yyyy hh:mm:ss"));
+            event.insert("status", 1);
+            event.insert("domain", "pjsip");
+            event.insert("code", 0);
+            event.insert("message", "Call-state from call " + QString::number(sent_ % 32)
+                                    + ": \"O'Brien\" <sip:100@example.org>");
+            func = "logMessage";
+        }
+        else
+        {
+            event.insert("id", sent_ % 32);
+            event.insert("state", sent_ % 7);
+            event.insert("lastStatus", 200);
+            func = "callStateChanged";
+        }
+
+        if (way_ == WAY_SIGNAL)
+        {
+            if (sent_ % 2)
+                signalLogMessage(event);
+            else
+                signalCallState(event);
+            continue;
+        }
+
+        QVariantList args;
+        if (sent_ % 2)
+            args << QVariant(event);
+        else
+            args << event.value("id") << event.value("state") << event.value("lastStatus");
+
+        if (way_ == WAY_BATCH)
+        {
+            QVariantList batch_event;
+            batch_event << func << QVariant(args);
+            batch << QVariant(batch_event);
+            continue;
+        }
+
+        QStringList arg_list;
+        for (int j = 0; j < args.size(); ++j)
+            arg_list << Json::stringify(args[j]);
+        evaluate("handler." + func + "(" + arg_list.join(",") + ")");
+    }
+    if (way_ == WAY_BATCH)
+        evaluate("handler.dispatchEvents(" + Json::stringify(batch) + ")");
+
+    dispatch_ns_ += timer.nsecsElapsed();
+}
+
+//----------------------------------------------------------------------
+void BridgeBench::benchWay(const int &way, QVariantMap &result)
+{
+    way_ = way;
+    sent_ = 0;
+    dispatch_ns_ = 0;
+    evaluate("received = 0;");
+    if (way == WAY_SIGNAL)
+        evaluate("connectSignals();");
+
+    QEventLoop loop;
+    QTimer::singleShot(seconds_ * 1000, &loop, SLOT(quit()));
+    qint64 cpu_start = ProcessStats::getCpuTime();
+    timer_.start(INTERVAL);
+    loop.exec();
+    timer_.stop();
+    qint64 cpu = ProcessStats::getCpuTime();
+
+    static const char *names[] = { "source per event", "source per batch", "signals" };
+    result.insert("way", names[way]);
+    result.insert("events", sent_);
+    result.insert("received", evaluate("received").toInt());
+    result.insert("dispatchUs", sent_ > 0 ? dispatch_ns_ / 1000.0 / sent_ : 0.0);
+    result.insert("cpuPercent", cpu >= 0 ? (cpu - cpu_start) / (seconds_ * 10000.0) : -1.0);
+}
+
+//----------------------------------------------------------------------
+void BridgeBench::printResults(const QVariantList &results)
+{
+    QTextStream out(stdout);
+    out << QString("way").leftJustified(18)
+        << QString("events").rightJustified(8)
+        << QString("received").rightJustified(10)
+        << QString("us/event").rightJustified(10)
+        << QString("cpu %").rightJustified(8) << "\n";
+
+    for (int i = 0; i < results.size(); ++i)
+    {
+        QVariantMap r = results[i].toMap();
+        out << r.value("way").toString().leftJustified(18)
+            << QString::number(r.value("events").toInt()).rightJustified(8)
+            << QString::number(r.value("received").toInt()).rightJustified(10)
+            << QString::number(r.value("dispatchUs").toDouble(), 'f', 1).rightJustified(10)
+            << QString::number(r.value("cpuPercent").toDouble(), 'f', 1).rightJustified(8)
+            << "\n";
+    }
+    out << EVENT_RATE << " events/s, us/event includes building the event,"
+        << " cpu % of one core for the whole process\n";
+}
+
+//----------------------------------------------------------------------
+bool BridgeBench::run(QVariantList &results)
+{
+    page_.mainFrame()->setHtml(BENCH_PAGE);
+    QElapsedTimer wait;
+    wait.start();
+    while (evaluate("typeof handler").toString() != "object" && wait.elapsed() < 5000)
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
+    page_.mainFrame()->addToJavaScriptWindowObject("bench", this);
+
+    // the signals stay connected once the page connected them, so they come last
+    bool ok = true;
+    const int ways[] = { WAY_SOURCE, WAY_BATCH, WAY_SIGNAL };
+    for (int i = 0; i < 3; ++i)
+    {
+        QVariantMap result;
+        benchWay(ways[i], result);
+        ok = ok && result.value("received").toInt() == result.value("events").toInt();
+        results << QVariant(result);
+    }
+
+    printResults(results);
+    return ok;
+}
@@ -0,0 +1,113 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef BRIDGE_BENCH_H
+#define BRIDGE_BENCH_H
+
+#include <QObject>
+#include <QTimer>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QWebPage>
+
+/**
+ * Sends call state and log events to a web page at EVENT_RATE events
+ * per second, the ways JavascriptHandler can: as JavaScript source per
+ * event, as JavaScript source per batch, and as typed signals. Reports
+ * the time spent per event and the cpu load. Needs WebKit, so GreenJ
+ * runs it with --bridge-bench [seconds].
+ */
+class BridgeBench : public QObject
+{
+    Q_OBJECT
+
+    int seconds_;
+    int way_;
+    int sent_;
+    qint64 dispatch_ns_;
+    QWebPage page_;
+    QTimer timer_;
+
+    /**
+     * Evaluate JavaScript in the page
+     * @param source QString, the source
+     * @return QVariant the result
+     */
+    QVariant evaluate(const QString &source);
+
+    /**
+     * Send events one way for seconds_
+     * @param way int, see the WAY_* constants
+     * @param result QVariantMap, gets way, events, received (by the
+     *        page), dispatchUs (time per event) and cpuPercent
+     */
+    void benchWay(const int &way, QVariantMap &result);
+
+    /**
+     * Print the results as table
+     * @param results QVariantList, a map per way
+     */
+    static void printResults(const QVariantList &results);
+
+private slots:
+    /**
+     * Send the events of one timer interval
+     */
+    void sendEvents();
+
+signals:
+    /**
+     * The signals of JavascriptHandler
+     */
+    void signalCallState(const QVariantMap &event);
+    void signalLogMessage(const QVariantMap &event);
+
+public:
+    /**
+     * JavaScript source for every event, see js_event_interval -1
+     */
+    static const int WAY_SOURCE;
+
+    /**
+     * JavaScript source for the events of one interval
+     */
+    static const int WAY_BATCH;
+
+    /**
+     * A signal for every event
+     */
+    static const int WAY_SIGNAL;
+
+    /**
+     * Events per second
+     */
+    static const int EVENT_RATE;
+
+    /**
+     * Interval of sending events, and of the batches, in ms
+     */
+    static const int INTERVAL;
+
+    /**
+     * Constructor
+     * @param seconds int, how long each way gets measured
+     */
+    BridgeBench(const int &seconds);
+
+    /**
+     * Run the benchmark and print the results to stdout
+     * @param results QVariantList, gets a map per way (see benchWay())
+     * @return bool false if the page didn't receive all events
+     */
+    bool run(QVariantList &results);
+};
+
+#endif // BRIDGE_BENCH_H
@@ -0,0 +1,178 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "bridge_profiler.h"
+
+#include <QDateTime>
+#include <QMultiMap>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QVariantList>
+
+#include "config_file_handler.h"
+#include "log_handler.h"
+
+const int BridgeProfiler::SLOW_CALL_HISTORY = 50;
+
+//----------------------------------------------------------------------
+BridgeProfiler::Scope::Scope(Method *method) :
+    method_(method), active_(method && ConfigFileHandler::getInstance().getJsProfile())
+{
+    if (active_)
+        timer_.start();
+}
+
+//----------------------------------------------------------------------
+BridgeProfiler::Scope::~Scope()
+{
+    if (active_)
+        BridgeProfiler::getInstance().record(method_, timer_.nsecsElapsed() / 1000);
+}
+
+//----------------------------------------------------------------------
+BridgeProfiler::BridgeProfiler() :
+    logging_(false)
+{
+}
+
+//----------------------------------------------------------------------
+BridgeProfiler &BridgeProfiler::getInstance()
+{
+    static BridgeProfiler instance;
+    return instance;
+}
+
+//----------------------------------------------------------------------
+BridgeProfiler::Method *BridgeProfiler::getMethod(const QString &name)
+{
+    int scope = name.lastIndexOf("::");
+    QString short_name = scope >= 0 ? name.mid(scope + 2) : name;
+
+    QMutexLocker locker(&mutex_);
+    Method *method = method_names_.value(short_name);
+    if (!method)
+    {
+        method = new Method;
+        method->name_ = short_name;
+        method->slow_ = 0;
+        methods_ << method;
+        method_names_.insert(short_name, method);
+    }
+    return method;
+}
+
+//----------------------------------------------------------------------
+void BridgeProfiler::record(Method *method, const qint64 &us)
+{
+    bool slow = us >= ConfigFileHandler::getInstance().getJsSlowCall() * (qint64)1000;
+    {
+        QMutexLocker locker(&mutex_);
+        method->histogram_.add(us);
+        if (!slow)
+            return;
+
+        ++method->slow_;
+        SlowCall call;
+        call.time_ = QDateTime::currentDateTime().toMSecsSinceEpoch();
+        call.name_ = method->name_;
+        call.duration_ = us / 1000.0;
+        slow_calls_ << call;
+        while (slow_calls_.size() > SLOW_CALL_HISTORY)
+            slow_calls_.removeFirst();
+    }
+
+    // logging may reach the page again, which must not log a second time
+    if (logging_)
+        return;
+    logging_ = true;
+    LOG_WARNING("profiler", 0, "Slow call " + method->name_ + " took "
+                + QString::number(us / 1000.0, 'f', 1) + " ms");
+    logging_ = false;
+}
+
+//----------------------------------------------------------------------
+void BridgeProfiler::getProfile(QVariantMap &profile) const
+{
+    QMutexLocker locker(&mutex_);
+    QVariantMap methods;
+    for (int i = 0; i < methods_.size(); ++i)
+    {
+        const Method *method = methods_[i];
+        if (!method->histogram_.getCount())
+            continue;
+        QVariantMap summary;
+        method->histogram_.getSummary(summary);
+        summary.insert("total", method->histogram_.getSum() / 1000.0);
+        summary.insert("slow", method->slow_);
+        methods.insert(method->name_, summary);
+    }
+
+    QVariantList slow_calls;
+    for (int i = 0; i < slow_calls_.size(); ++i)
+    {
+        QVariantMap call;
+        call.insert("time", slow_calls_[i].time_);
+        call.insert("name", slow_calls_[i].name_);
+        call.insert("duration", slow_calls_[i].duration_);
+        slow_calls << QVariant(call);
+    }
+
+    profile.insert("methods", methods);
+    profile.insert("slowCalls", slow_calls);
+}
+
+//----------------------------------------------------------------------
+void BridgeProfiler::logProfile() const
+{
+    QStringList lines;
+    {
+        QMutexLocker locker(&mutex_);
+        QMultiMap<qint64, const Method*> by_total;
+        for (int i = 0; i < methods_.size(); ++i)
+        {
+            if (methods_[i]->histogram_.getCount())
+                by_total.insert(methods_[i]->histogram_.getSum(), methods_[i]);
+        }
+
+        QMapIterator<qint64, const Method*> i(by_total);
+        i.toBack();
+        while (i.hasPrevious())
+        {
+            const Method *method = i.previous().value();
+            const LatencyHistogram &histogram = method->histogram_;
+            lines << method->name_ + ": " + QString::number(histogram.getCount())
+                     + " calls, total " + QString::number(histogram.getSum() / 1000.0, 'f', 1)
+                     + " ms, p50 " + QString::number(histogram.percentile(50) / 1000.0, 'f', 2)
+                     + " ms, p99 " + QString::number(histogram.percentile(99) / 1000.0, 'f', 2)
+                     + " ms, slow " + QString::number(method->slow_);
+        }
+    }
+
+    if (lines.isEmpty())
+    {
+        LOG_MESSAGE("profiler", 0, "No profiled calls");
+        return;
+    }
+    for (int i = 0; i < lines.size(); ++i)
+        LOG_MESSAGE("profiler", 0, lines[i]);
+}
+
+//----------------------------------------------------------------------
+void BridgeProfiler::clear()
+{
+    QMutexLocker locker(&mutex_);
+    for (int i = 0; i < methods_.size(); ++i)
+    {
+        methods_[i]->histogram_.clear();
+        methods_[i]->slow_ = 0;
+    }
+    slow_calls_.clear();
+}
@@ -0,0 +1,144 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef BRIDGE_PROFILER_H
+#define BRIDGE_PROFILER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QVariantMap>
+#include "latency_histogram.h"
+
+/**
+ * \name Bridge Profiling
+ * Put PROFILE_BRIDGE_CALL() first into a slot the web page calls, it times
+ * the slot while the js_profile option is on. Each statement looks up its
+ * method once and keeps it, like the log macros do.
+ * \{
+ */
+#define PROFILE_BRIDGE_CALL() \
+    static BridgeProfiler::Method *bridge_profile_method = \
+        BridgeProfiler::getInstance().getMethod(__FUNCTION__); \
+    BridgeProfiler::Scope bridge_profile_scope(bridge_profile_method)
+/**
+ * \}
+ */
+
+/**
+ * This class is implemented as singleton.
+ * Times the calls between the web page and the phone, both ways: the slots
+ * of the JavascriptHandler and the JavaScript the phone evaluates. Both run
+ * on the gui thread, a slow one stalls the user interface. Nested calls are
+ * part of the time of the outer call.
+ */
+class BridgeProfiler
+{
+public:
+    /**
+     * Durations of one method
+     */
+    struct Method
+    {
+        QString name_;
+        LatencyHistogram histogram_;
+        qint64 slow_;
+    };
+
+    /**
+     * Times a method from its construction to its destruction
+     */
+    class Scope
+    {
+        Method *method_;
+        QElapsedTimer timer_;
+        bool active_;
+
+    public:
+        /**
+         * Start the timer if the profiler is on
+         * @param method Method*, the method, see getMethod(), 0 times nothing
+         */
+        Scope(Method *method);
+        ~Scope();
+    };
+
+private:
+    struct SlowCall
+    {
+        qint64 time_;       // ms since epoch
+        QString name_;
+        double duration_;   // ms
+    };
+
+    mutable QMutex mutex_;
+    QList<Method*> methods_;
+    QHash<QString, Method*> method_names_;
+    QList<SlowCall> slow_calls_;
+
+    /**
+     * Set while a slow call gets logged, the log may call into the page
+     */
+    bool logging_;
+
+    /**
+     * Number of slow calls kept
+     */
+    static const int SLOW_CALL_HISTORY;
+
+    BridgeProfiler();
+    BridgeProfiler(const BridgeProfiler&);
+
+public:
+    /**
+     * Get instance of Singelton class
+     * @return BridgeProfiler the instance to this class
+     */
+    static BridgeProfiler &getInstance();
+
+    /**
+     * Get the entry of a method, it is created by the first lookup
+     * and never deleted
+     * @param name QString, the name, a class name in front is removed
+     * @return Method* the method
+     */
+    Method *getMethod(const QString &name);
+
+    /**
+     * Add a duration, a slow one gets logged
+     * @param method Method*, the method
+     * @param us qint64, the duration in us
+     */
+    void record(Method *method, const qint64 &us);
+
+    /**
+     * Get the durations
+     * @param profile QVariantMap, gets methods, a summary in ms by method
+     *        name (see LatencyHistogram::getSummary()) with total and slow,
+     *        and slowCalls, the last slow calls with time, name and duration
+     */
+    void getProfile(QVariantMap &profile) const;
+
+    /**
+     * Write the summary of every method into the log, the one with the
+     * most time first
+     */
+    void logProfile() const;
+
+    /**
+     * Remove all durations and slow calls
+     */
+    void clear();
+};
+
+#endif // BRIDGE_PROFILER_H
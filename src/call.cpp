@@ -17,6 +17,7 @@
 #include "sound.h"
 
 #include "log_handler.h"
+#include "json.h"
 
 const int Call::TYPE_UNKNOWN = -1;
 const int Call::TYPE_INCOMING = 0x00;
@@ -28,10 +29,15 @@ const int Call::STATUS_ACCEPTED = 0x01;
 const int Call::STATUS_CLOSED = 0x02;
 const int Call::STATUS_ERROR = 0x03;
 
+// "grj" and the format version, old records start with the call type
+const int Call::STREAM_MARKER = 0x67726a01;
+
+const QString Call::USER_DATA_STRING = "_userDataString";
+
 //----------------------------------------------------------------------
 Call::Call(PhoneApi *phone_api, const int &type, const int &status) :
-    phone_api_(phone_api), type_(type), status_(status), active_(false), 
-    call_id_(-1), call_state_(0), media_state_(0), speaker_level_(1.f),
+    duration_(0), phone_api_(phone_api), type_(type), status_(status), active_(false), 
+    call_id_(-1), acc_id_(-1), call_state_(0), media_state_(0), speaker_level_(1.f),
     mic_level_(1.f)
 {
     start_time_ = QDateTime::currentDateTime();
@@ -42,7 +48,7 @@ int Call::makeCall()
 {
     Sound::getInstance().startDialRing();
 
-    int call_id = phone_api_->makeCall(url_);
+    int call_id = phone_api_->makeCall(url_, acc_id_);
     active_ = true;
 
     if (call_id < 0)
@@ -112,11 +118,14 @@ void Call::getCallInfo(QVariantMap &call_info)
     if (phone_api_)
     {
         phone_api_->getCallInfo(call_id_, call_info);
+        // calls made from the default account learn their account here
+        acc_id_ = call_info.value("accountId", acc_id_).toInt();
     }
     else
     {
         call_info.insert("number", url_);
         call_info.insert("duration", duration_);
+        call_info.insert("accountId", acc_id_);
     }
     call_info.insert("name", name_);
     call_info.insert("type", (int)type_);
@@ -124,8 +133,9 @@ void Call::getCallInfo(QVariantMap &call_info)
     call_info.insert("callTime", start_time_.toMSecsSinceEpoch());
     call_info.insert("acceptTime", accept_time_.toMSecsSinceEpoch());
     call_info.insert("closeTime", close_time_.toMSecsSinceEpoch());
-    call_info.insert("userData", user_data_);
-    
+    // pages read the string of the old api, the map is new
+    call_info.insert("userData", userDataToString(user_data_));
+    call_info.insert("userDataMap", user_data_);
 }
 
 //----------------------------------------------------------------------
@@ -170,6 +180,18 @@ void Call::setStartTime(const QDateTime &start_time)
     start_time_ = start_time;
 }
 
+//----------------------------------------------------------------------
+const int &Call::getAccountId() const
+{
+    return acc_id_;
+}
+
+//----------------------------------------------------------------------
+void Call::setAccountId(const int &acc_id)
+{
+    acc_id_ = acc_id;
+}
+
 //----------------------------------------------------------------------
 void Call::setAcceptTime(const QDateTime &accept_time)
 {
@@ -189,21 +211,64 @@ void Call::setDuration(const int &duration)
 }
 
 //----------------------------------------------------------------------
-QString Call::getUserData() const
+const QVariantMap &Call::getUserData() const
 {
     return user_data_;
 }
 
 //----------------------------------------------------------------------
-void Call::setUserData(const QString &data)
+void Call::setUserData(const QVariantMap &data)
 {
     user_data_ = data;
 }
 
+//----------------------------------------------------------------------
+QVariant Call::getUserDataField(const QString &key) const
+{
+    return user_data_.value(key);
+}
+
+//----------------------------------------------------------------------
+bool Call::setUserDataField(const QString &key, const QVariant &value)
+{
+    if (!value.isValid())
+        return user_data_.remove(key) > 0;
+
+    QVariantMap::iterator i = user_data_.find(key);
+    if (i != user_data_.end() && i.value() == value)
+        return false;
+    user_data_.insert(key, value);
+    return true;
+}
+
+//----------------------------------------------------------------------
+QVariantMap Call::userDataFromString(const QString &data)
+{
+    QVariantMap user_data;
+    if (data.isEmpty())
+        return user_data;
+
+    QVariant value = Json::parse(data);
+    if (value.type() == QVariant::Map)
+        return value.toMap();
+    user_data.insert(USER_DATA_STRING, data);
+    return user_data;
+}
+
+//----------------------------------------------------------------------
+QString Call::userDataToString(const QVariantMap &data)
+{
+    if (data.isEmpty())
+        return "";
+    if (data.size() == 1 && data.contains(USER_DATA_STRING))
+        return data.value(USER_DATA_STRING).toString();
+    return Json::stringify(data);
+}
+
 //----------------------------------------------------------------------
 void Call::clearUserData()
 {
-    user_data_ = "";
+    user_data_.clear();
 }
 
 //----------------------------------------------------------------------
@@ -245,8 +310,7 @@ void Call::setCallActive()
 //----------------------------------------------------------------------
 void Call::setCallInactive()
 {
-    LogInfo info(LogInfo::STATUS_DEBUG, "call", 0, "set call inactive");
-    LogHandler::getInstance().logData(info);
+    LOG_DEBUG("call", 0, "set call inactive");
 
     active_ = false;
     close_time_ = QDateTime::currentDateTime();
@@ -322,7 +386,7 @@ void Call::getSignalInformation(QVariantMap &signal_info)
 
 QDataStream &operator<<(QDataStream &out, const Call &call)
 {
-    out << call.getType() << call.getCallId() << call.getCallUrl()
+    out << Call::STREAM_MARKER << call.getType() << call.getCallId() << call.getCallUrl()
         << call.getStatus() << call.getStartTime() << call.getAcceptTime()
         << call.getCloseTime() << call.getDuration() << call.getUserData();
     return out;
@@ -331,6 +395,7 @@ QDataStream &operator<<(QDataStream &out, const Call &call)
 //----------------------------------------------------------------------
 QDataStream &operator>>(QDataStream &in, Call &call)
 {
+    int marker;
     int type;
     int call_id;
     QString call_url;
@@ -339,9 +404,22 @@ QDataStream &operator>>(QDataStream &in, Call &call)
     QDateTime close_time;
     int duration;
     int status;
-    QString user_data;
-    in >> type >> call_id >> call_url >> status >> start_time >> accept_time
-       >> close_time >> duration >> user_data;
+    QVariantMap user_data;
+    in >> marker;
+    if (marker == Call::STREAM_MARKER)
+    {
+        in >> type >> call_id >> call_url >> status >> start_time >> accept_time
+           >> close_time >> duration >> user_data;
+    }
+    else
+    {
+        // record written before the user data became structured
+        QString user_data_json;
+        type = marker;
+        in >> call_id >> call_url >> status >> start_time >> accept_time
+           >> close_time >> duration >> user_data_json;
+        user_data = Call::userDataFromString(user_data_json);
+    }
     call = Call(0, type,status);
     call.setCallId(call_id);
     call.setUrl(call_url);
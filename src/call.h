@@ -37,6 +37,7 @@ class Call
     int status_;
     bool active_;
     int call_id_;
+    int acc_id_;
     int call_state_;
     int media_state_;
     float speaker_level_;
@@ -44,7 +45,7 @@ class Call
 
     QString url_;
     QString name_;
-    QString user_data_;
+    QVariantMap user_data_;
 
 public:
     /**
@@ -117,6 +118,33 @@ public:
     /**
      * \}
      */
+    /**
+     * First value of a call written to a QDataStream, tells the format
+     */
+    static const int STREAM_MARKER;
+
+    /**
+     * Key of the user data which keeps a string set by the string api
+     * that isn't a JSON object
+     */
+    static const QString USER_DATA_STRING;
+
+    /**
+     * Convert user data set by the string api
+     * @param data QString, a JSON object, or any other string which is
+     *        kept as it is under USER_DATA_STRING
+     * @return QVariantMap the user data
+     */
+    static QVariantMap userDataFromString(const QString &data);
+
+    /**
+     * Convert user data for the string api
+     * @param data QVariantMap, the user data
+     * @return QString the string set, a JSON object otherwise, empty
+     *         if there is no user data
+     */
+    static QString userDataToString(const QVariantMap &data);
+
     /**
      * Starting a SIP-Call to the stored address
      * @return The CallId of the started call
@@ -220,6 +248,18 @@ public:
      */
     void setStartTime(const QDateTime &start_time);
 
+    /**
+     * Get the account of the call
+     * @return int the id of the account, -1 for the default account
+     */
+    const int &getAccountId() const;
+
+    /**
+     * Set the account of the call, outgoing calls are made from it
+     * @param acc_id int, the id of the account, -1 for the default account
+     */
+    void setAccountId(const int &acc_id);
+
     /**
      * Set the accept time, only needed for error logging
      * @param accept_time QDateTime, time_obj to set
@@ -240,15 +280,30 @@ public:
 
     /**
      * Get custom user data
-     * @return QString the user_data
+     * @return QVariantMap the user_data
+     */
+    const QVariantMap &getUserData() const;
+
+    /**
+     * Save custom user data, replacing the current one
+     * @param data QVariantMap the user_data
+     */
+    void setUserData(const QVariantMap &data);
+
+    /**
+     * Get one field of the custom user data
+     * @param key QString, the name of the field
+     * @return QVariant the value, invalid if the field isn't set
      */
-    QString getUserData() const;
+    QVariant getUserDataField(const QString &key) const;
 
     /**
-     * Save custom user data
-     * @param data QString the user_data
+     * Set one field of the custom user data
+     * @param key QString, the name of the field
+     * @param value QVariant, the value, an invalid value removes the field
+     * @return bool true if the user data changed
      */
-    void setUserData(const QString &data);
+    bool setUserDataField(const QString &key, const QVariant &value);
 
     /**
      * Delete user_data
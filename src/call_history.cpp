@@ -0,0 +1,173 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "call_history.h"
+
+#include <QDateTime>
+
+#include "call.h"
+#include "json.h"
+
+//----------------------------------------------------------------------
+CallHistory::CallHistory(const int &max_count, const qint64 &max_bytes) :
+    next_seq_(0), bytes_(0), evicted_(0), max_count_(max_count),
+    max_bytes_(max_bytes)
+{
+}
+
+//----------------------------------------------------------------------
+void CallHistory::setLimits(const int &max_count, const qint64 &max_bytes)
+{
+    max_count_ = max_count;
+    max_bytes_ = max_bytes;
+    evict();
+}
+
+//----------------------------------------------------------------------
+qint64 CallHistory::getRecordSize(const CallRecord &record)
+{
+    // the record itself, the list node and the string data
+    return sizeof(CallRecord) + sizeof(void*)
+           + (record.url_.size() + record.name_.size()
+              + record.user_data_size_) * sizeof(QChar);
+}
+
+//----------------------------------------------------------------------
+void CallHistory::add(const Call &call)
+{
+    CallRecord record;
+    QDateTime close_time = call.getCloseTime();
+    int duration = call.getDuration();
+    if (!close_time.isValid())
+    {
+        // remote hangup, the call didn't get closed locally
+        close_time = QDateTime::currentDateTime();
+        duration = call.getStartTime().secsTo(close_time);
+    }
+
+    record.seq_ = next_seq_++;
+    record.call_id_ = call.getCallId();
+    record.acc_id_ = call.getAccountId();
+    record.type_ = call.getType();
+    record.status_ = call.getStatus();
+    record.duration_ = duration;
+    record.start_time_ = call.getStartTime().toMSecsSinceEpoch();
+    record.accept_time_ = call.getAcceptTime().isValid()
+                          ? call.getAcceptTime().toMSecsSinceEpoch() : 0;
+    record.close_time_ = close_time.toMSecsSinceEpoch();
+    record.url_ = call.getCallUrl();
+    record.name_ = call.getCallName();
+    record.user_data_ = call.getUserData();
+    record.user_data_size_ = record.user_data_.isEmpty()
+                             ? 0 : Json::stringify(record.user_data_).size();
+
+    bytes_ += getRecordSize(record);
+    records_.append(record);
+    last_seq_.insert(record.call_id_, record.seq_);
+
+    evict();
+}
+
+//----------------------------------------------------------------------
+void CallHistory::evict()
+{
+    while (!records_.isEmpty()
+           && (records_.size() > max_count_ || bytes_ > max_bytes_))
+    {
+        const CallRecord &oldest = records_.first();
+        bytes_ -= getRecordSize(oldest);
+        if (last_seq_.value(oldest.call_id_, -1) == oldest.seq_)
+            last_seq_.remove(oldest.call_id_);
+        records_.removeFirst();
+        ++evicted_;
+    }
+}
+
+//----------------------------------------------------------------------
+CallRecord *CallHistory::findLatest(const int &call_id)
+{
+    qint64 seq = last_seq_.value(call_id, -1);
+    if (seq < 0 || records_.isEmpty())
+        return 0;
+
+    // sequence numbers are contiguous, so the index follows from the
+    // sequence number of the oldest record
+    int idx = (int)(seq - records_.first().seq_);
+    if (idx < 0 || idx >= records_.size())
+        return 0;
+    return &records_[idx];
+}
+
+//----------------------------------------------------------------------
+void CallHistory::setUserData(CallRecord *record, const QVariantMap &data)
+{
+    bytes_ -= getRecordSize(*record);
+    record->user_data_ = data;
+    record->user_data_size_ = data.isEmpty() ? 0 : Json::stringify(data).size();
+    bytes_ += getRecordSize(*record);
+    evict();
+}
+
+//----------------------------------------------------------------------
+void CallHistory::toVariantMap(const CallRecord &record, QVariantMap &map)
+{
+    map.insert("id", record.call_id_);
+    map.insert("accountId", record.acc_id_);
+    map.insert("address", record.url_);
+    map.insert("name", record.name_);
+    map.insert("type", record.type_);
+    map.insert("status", record.status_);
+    map.insert("duration", record.duration_);
+    map.insert("callTime", record.start_time_);
+    map.insert("acceptTime", record.accept_time_);
+    map.insert("closeTime", record.close_time_);
+    map.insert("userData", Call::userDataToString(record.user_data_));
+    map.insert("userDataMap", record.user_data_);
+}
+
+//----------------------------------------------------------------------
+void CallHistory::query(const int &offset, const int &limit, const int &type,
+                        const int &status, QVariantMap &result) const
+{
+    QVariantList calls;
+    int total = 0;
+    for (int i = records_.size() - 1; i >= 0; --i)
+    {
+        const CallRecord &record = records_[i];
+        if ((type != -1 && record.type_ != type)
+            || (status != -1 && record.status_ != status))
+        {
+            continue;
+        }
+
+        if (total >= offset && calls.size() < limit)
+        {
+            QVariantMap current;
+            toVariantMap(record, current);
+            calls << current;
+        }
+        ++total;
+    }
+
+    result.insert("total", total);
+    result.insert("offset", offset);
+    result.insert("calls", calls);
+}
+
+//----------------------------------------------------------------------
+void CallHistory::getStatistics(QVariantMap &stats) const
+{
+    stats.insert("count", records_.size());
+    stats.insert("bytes", bytes_);
+    stats.insert("maxCount", max_count_);
+    stats.insert("maxBytes", max_bytes_);
+    stats.insert("evicted", evicted_);
+}
@@ -0,0 +1,140 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef CALL_HISTORY_H
+#define CALL_HISTORY_H
+
+#include <QList>
+#include <QHash>
+#include <QString>
+#include <QVariantMap>
+
+class Call;
+
+/**
+ * Compact record of a finished call
+ */
+struct CallRecord
+{
+    qint64 seq_;
+    int call_id_;
+    int acc_id_;
+    int type_;
+    int status_;
+    int duration_;
+    qint64 start_time_;
+    qint64 accept_time_;
+    qint64 close_time_;
+    QString url_;
+    QString name_;
+    QVariantMap user_data_;
+
+    /**
+     * length of user_data_ as JSON, to estimate its memory use
+     */
+    int user_data_size_;
+};
+
+/**
+ * Keeps the records of finished calls in memory.
+ * The history is bounded by number of records and by bytes,
+ * when a limit is reached the oldest records get evicted.
+ */
+class CallHistory
+{
+    QList<CallRecord> records_;
+
+    /**
+     * sequence number of the most recent record for each call_id
+     */
+    QHash<int, qint64> last_seq_;
+
+    qint64 next_seq_;
+    qint64 bytes_;
+    int evicted_;
+
+    int max_count_;
+    qint64 max_bytes_;
+
+    /**
+     * Estimate the memory used by a record
+     * @param record CallRecord, the record
+     * @return qint64 the size in bytes
+     */
+    static qint64 getRecordSize(const CallRecord &record);
+
+    /**
+     * Drop the oldest records until both limits are met
+     */
+    void evict();
+
+    /**
+     * Convert a record to the format used by the js api
+     * @param record CallRecord, the record
+     * @param map QVariantMap, the map to write to
+     */
+    static void toVariantMap(const CallRecord &record, QVariantMap &map);
+
+public:
+    /**
+     * Constructor
+     * @param max_count int, maximum number of records
+     * @param max_bytes qint64, maximum memory used by the records
+     */
+    CallHistory(const int &max_count = 1000, const qint64 &max_bytes = 1048576);
+
+    /**
+     * Change the limits, evicts records if necessary
+     * @param max_count int, maximum number of records
+     * @param max_bytes qint64, maximum memory used by the records
+     */
+    void setLimits(const int &max_count, const qint64 &max_bytes);
+
+    /**
+     * Store a record of a finished call
+     * @param call Call, the finished call
+     */
+    void add(const Call &call);
+
+    /**
+     * Find the most recent record of a call_id
+     * @param call_id int, the id of the call
+     * @return CallRecord* the record or 0 if it's not (or no longer) stored
+     */
+    CallRecord *findLatest(const int &call_id);
+
+    /**
+     * Update the user data of a record, keeping the byte count right
+     * @param record CallRecord*, the record
+     * @param data QVariantMap, the new user data
+     */
+    void setUserData(CallRecord *record, const QVariantMap &data);
+
+    /**
+     * Get a page of records, newest first
+     * @param offset int, number of matching records to skip
+     * @param limit int, maximum number of records to return
+     * @param type int, only records of this call type, -1 for all
+     * @param status int, only records with this status, -1 for all
+     * @param result QVariantMap, gets "total" (number of matching records),
+     *        "offset" and "calls" (list of records)
+     */
+    void query(const int &offset, const int &limit, const int &type,
+               const int &status, QVariantMap &result) const;
+
+    /**
+     * Get size and limits of the history
+     * @param stats QVariantMap, gets count, bytes, maxCount, maxBytes, evicted
+     */
+    void getStatistics(QVariantMap &stats) const;
+};
+
+#endif // CALL_HISTORY_H
@@ -0,0 +1,136 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "call_quality.h"
+
+#include <QDateTime>
+#include <QVariantList>
+
+const int CallQuality::HISTORY_SIZE = 12;
+
+//----------------------------------------------------------------------
+CallQuality::CallQuality() :
+    has_last_stat_(false), poor_(false)
+{
+}
+
+//----------------------------------------------------------------------
+double CallQuality::estimateMos(const double &loss, const double &delay)
+{
+    // delay impairment
+    double id = 0.024 * delay;
+    if (delay > 177.3)
+        id += 0.11 * (delay - 177.3);
+
+    // loss impairment of G.711 with plc (Ie 0, Bpl 4.3), random loss
+    double ie_eff = 95.0 * loss / (loss + 4.3);
+
+    double r = qBound(0.0, 93.2 - id - ie_eff, 100.0);
+    double mos = 1 + 0.035 * r + 0.000007 * r * (r - 60) * (100 - r);
+    return qBound(1.0, mos, 4.5);
+}
+
+//----------------------------------------------------------------------
+void CallQuality::computeDirection(const pjmedia_rtcp_stream_stat &now,
+                                   const pjmedia_rtcp_stream_stat *before,
+                                   const bool &received, const double &delay,
+                                   Direction &direction)
+{
+    int packets = now.pkt - (before ? before->pkt : 0);
+    int lost = now.loss - (before ? before->loss : 0);
+    int expected = received ? packets + lost : packets;
+
+    direction.packets_ = packets;
+    direction.loss_ = expected > 0 ? qBound(0.0, 100.0 * lost / expected, 100.0) : 0.0;
+    direction.jitter_ = now.jitter.last / 1000.0;
+    direction.discarded_ = now.discard - (before ? before->discard : 0);
+    direction.mos_ = estimateMos(direction.loss_, delay);
+}
+
+//----------------------------------------------------------------------
+bool CallQuality::update(const pjmedia_rtcp_stat &stat, const double &mos_threshold)
+{
+    Sample sample;
+    sample.time_ = QDateTime::currentDateTime().toMSecsSinceEpoch();
+    sample.rtt_ = stat.rtt.n > 0 ? stat.rtt.last / 1000.0 : -1;
+
+    // half the round trip plus packetization and jitter buffer
+    double delay = (sample.rtt_ > 0 ? sample.rtt_ / 2 : 0) + 40;
+
+    const pjmedia_rtcp_stat *before = has_last_stat_ ? &last_stat_ : 0;
+    computeDirection(stat.rx, before ? &before->rx : 0, true, delay, sample.rx_);
+    computeDirection(stat.tx, before ? &before->tx : 0, false, delay, sample.tx_);
+    last_stat_ = stat;
+    has_last_stat_ = true;
+
+    history_ << sample;
+    while (history_.size() > HISTORY_SIZE)
+        history_.removeFirst();
+
+    // a direction without packets has nothing to judge
+    bool poor = (sample.rx_.packets_ > 0 && sample.rx_.mos_ < mos_threshold)
+                || (sample.tx_.packets_ > 0 && sample.tx_.mos_ < mos_threshold);
+    bool crossed = poor != poor_;
+    poor_ = poor;
+    return crossed;
+}
+
+//----------------------------------------------------------------------
+bool CallQuality::isPoor() const
+{
+    return poor_;
+}
+
+//----------------------------------------------------------------------
+void CallQuality::toVariant(const Sample &sample, QVariantMap &result)
+{
+    const Direction *directions[2] = { &sample.rx_, &sample.tx_ };
+    const char *names[2] = { "rx", "tx" };
+    for (int i = 0; i < 2; ++i)
+    {
+        QVariantMap direction;
+        direction.insert("packets", directions[i]->packets_);
+        direction.insert("loss", directions[i]->loss_);
+        direction.insert("jitter", directions[i]->jitter_);
+        direction.insert("discarded", directions[i]->discarded_);
+        direction.insert("mos", directions[i]->mos_);
+        result.insert(names[i], direction);
+    }
+    result.insert("time", sample.time_);
+    result.insert("rtt", sample.rtt_);
+}
+
+//----------------------------------------------------------------------
+void CallQuality::getLast(QVariantMap &result) const
+{
+    if (!history_.isEmpty())
+        toVariant(history_.last(), result);
+    result.insert("poor", poor_);
+}
+
+//----------------------------------------------------------------------
+void CallQuality::getQuality(QVariantMap &result) const
+{
+    QVariantList history;
+    for (int i = 0; i < history_.size(); ++i)
+    {
+        QVariantMap sample;
+        toVariant(history_[i], sample);
+        history << QVariant(sample);
+    }
+    QVariantMap last;
+    if (!history_.isEmpty())
+        toVariant(history_.last(), last);
+
+    result.insert("poor", poor_);
+    result.insert("last", last);
+    result.insert("history", history);
+}
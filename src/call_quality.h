@@ -0,0 +1,117 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef CALL_QUALITY_H
+#define CALL_QUALITY_H
+
+#include <pjsua-lib/pjsua.h>
+
+#include <QList>
+#include <QVariantMap>
+
+/**
+ * Audio quality of a call, computed from the rtp/rtcp statistics of its
+ * stream. Each sample covers the time since the one before, the last
+ * HISTORY_SIZE samples are kept.
+ */
+class CallQuality
+{
+    struct Direction
+    {
+        int packets_;
+        double loss_;       // % of the packets of the sample
+        double jitter_;     // ms
+        int discarded_;
+        double mos_;
+    };
+
+    struct Sample
+    {
+        qint64 time_;       // ms since epoch
+        Direction rx_;
+        Direction tx_;
+        double rtt_;        // ms, -1 if unknown
+    };
+
+    QList<Sample> history_;
+    pjmedia_rtcp_stat last_stat_;
+    bool has_last_stat_;
+    bool poor_;
+
+    /**
+     * Compute a direction from the difference of two counters
+     * @param now pjmedia_rtcp_stream_stat, the current counters
+     * @param before pjmedia_rtcp_stream_stat, the counters of the sample
+     *        before, 0 for the first sample
+     * @param received bool, true for the received packets, pkt counts
+     *        the packets which arrived then, else the ones sent
+     * @param delay double, estimated one-way delay in ms
+     * @param direction Direction, gets the values
+     */
+    static void computeDirection(const pjmedia_rtcp_stream_stat &now,
+                                 const pjmedia_rtcp_stream_stat *before,
+                                 const bool &received, const double &delay,
+                                 Direction &direction);
+
+    /**
+     * Convert a sample to a map
+     * @param sample Sample, the sample
+     * @param result QVariantMap, gets time, rtt, rx and tx, each with
+     *        packets, loss, jitter, discarded and mos
+     */
+    static void toVariant(const Sample &sample, QVariantMap &result);
+
+public:
+    /**
+     * Number of samples kept
+     */
+    static const int HISTORY_SIZE;
+
+    CallQuality();
+
+    /**
+     * Add a sample
+     * @param stat pjmedia_rtcp_stat, the current statistics of the stream
+     * @param mos_threshold double, a mos below counts as poor quality
+     * @return bool true if the quality crossed the threshold, in either way
+     */
+    bool update(const pjmedia_rtcp_stat &stat, const double &mos_threshold);
+
+    /**
+     * Check if the quality of the last sample is poor
+     * @return bool true if the mos of a direction is below the threshold
+     */
+    bool isPoor() const;
+
+    /**
+     * Get the last sample and the history
+     * @param result QVariantMap, gets poor, last (see toVariant()) and
+     *        history, the samples oldest first
+     */
+    void getQuality(QVariantMap &result) const;
+
+    /**
+     * Get the last sample
+     * @param result QVariantMap, gets the sample (see toVariant()) and poor
+     */
+    void getLast(QVariantMap &result) const;
+
+    /**
+     * Estimate the mean opinion score with the E-model (ITU-T G.107),
+     * for a codec with packet loss concealment
+     * @param loss double, packet loss in %
+     * @param delay double, one-way delay in ms
+     * @return double the score, 1 to 4.5
+     */
+    static double estimateMos(const double &loss, const double &delay);
+};
+
+#endif // CALL_QUALITY_H
@@ -0,0 +1,136 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "call_snapshot.h"
+
+#include <QList>
+#include <QtAlgorithms>
+
+const int CallSnapshot::MAX_REMOVED = 64;
+
+//----------------------------------------------------------------------
+CallSnapshot::CallSnapshot() :
+    version_(0), min_version_(0), removed_count_(0)
+{
+}
+
+//----------------------------------------------------------------------
+void CallSnapshot::update(const int &call_id, const QVariantMap &info,
+                          const QDateTime &accept_time)
+{
+    QMap<int, Entry>::iterator i = entries_.find(call_id);
+    if (i == entries_.end())
+        i = entries_.insert(call_id, Entry());
+    else if (i.value().removed_)
+        --removed_count_;
+
+    Entry &entry = i.value();
+    entry.version_ = ++version_;
+    entry.removed_ = false;
+    entry.info_ = info;
+    entry.accept_time_ = accept_time;
+}
+
+//----------------------------------------------------------------------
+void CallSnapshot::remove(const int &call_id)
+{
+    QMap<int, Entry>::iterator i = entries_.find(call_id);
+    if (i == entries_.end() || i.value().removed_)
+        return;
+
+    i.value().version_ = ++version_;
+    i.value().removed_ = true;
+    i.value().info_.clear();
+    ++removed_count_;
+    prune();
+}
+
+//----------------------------------------------------------------------
+void CallSnapshot::prune()
+{
+    if (removed_count_ <= MAX_REMOVED)
+        return;
+
+    QList<qint64> versions;
+    QMap<int, Entry>::const_iterator i;
+    for (i = entries_.constBegin(); i != entries_.constEnd(); ++i)
+    {
+        if (i.value().removed_)
+            versions << i.value().version_;
+    }
+    qSort(versions);
+    min_version_ = versions[versions.size() / 2];
+
+    QMap<int, Entry>::iterator j = entries_.begin();
+    while (j != entries_.end())
+    {
+        if (j.value().removed_ && j.value().version_ <= min_version_)
+        {
+            j = entries_.erase(j);
+            --removed_count_;
+        }
+        else
+        {
+            ++j;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+qint64 CallSnapshot::getVersion() const
+{
+    return version_;
+}
+
+//----------------------------------------------------------------------
+QVariant CallSnapshot::toVariant(const Entry &entry)
+{
+    QVariantMap info = entry.info_;
+    if (entry.accept_time_.isValid())
+        info.insert("duration", entry.accept_time_.secsTo(QDateTime::currentDateTime()));
+    return info;
+}
+
+//----------------------------------------------------------------------
+void CallSnapshot::getChanges(const qint64 &since, QVariantMap &result) const
+{
+    bool full = since < min_version_;
+    QVariantList calls;
+    QVariantList removed;
+    QMap<int, Entry>::const_iterator i;
+    for (i = entries_.constBegin(); i != entries_.constEnd(); ++i)
+    {
+        const Entry &entry = i.value();
+        if (!full && entry.version_ <= since)
+            continue;
+
+        if (!entry.removed_)
+            calls << toVariant(entry);
+        else if (!full)
+            removed << i.key();
+    }
+
+    result.insert("version", version_);
+    result.insert("full", full);
+    result.insert("calls", calls);
+    result.insert("removed", removed);
+}
+
+//----------------------------------------------------------------------
+void CallSnapshot::getCalls(QVariantList &calls) const
+{
+    QMap<int, Entry>::const_iterator i;
+    for (i = entries_.constBegin(); i != entries_.constEnd(); ++i)
+    {
+        if (!i.value().removed_)
+            calls << toVariant(i.value());
+    }
+}
@@ -0,0 +1,105 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef CALL_SNAPSHOT_H
+#define CALL_SNAPSHOT_H
+
+#include <QMap>
+#include <QDateTime>
+#include <QVariantMap>
+
+/**
+ * Versioned copy of the information about all active calls.
+ * It gets updated when a call changes, so the web page can poll it
+ * without asking the voip-api, and fetch only the calls changed since
+ * the version it has seen last.
+ */
+class CallSnapshot
+{
+    struct Entry
+    {
+        qint64 version_;
+        bool removed_;
+        QVariantMap info_;
+        QDateTime accept_time_;
+    };
+
+    /**
+     * Active calls and recently removed ones, by call_id
+     */
+    QMap<int, Entry> entries_;
+    qint64 version_;
+
+    /**
+     * Removals up to this version are forgotten, older versions can
+     * only get a full snapshot
+     */
+    qint64 min_version_;
+    int removed_count_;
+
+    /**
+     * Forget the older half of the removed calls if there are too many
+     */
+    void prune();
+
+    /**
+     * Get the information of a call with the current duration
+     * @param entry Entry, the call
+     * @return QVariant the information as map
+     */
+    static QVariant toVariant(const Entry &entry);
+
+public:
+    /**
+     * number of removed calls remembered for getChanges()
+     */
+    static const int MAX_REMOVED;
+
+    CallSnapshot();
+
+    /**
+     * Set the information of an active call
+     * @param call_id int, the id of the call
+     * @param info QVariantMap, the call information (see Call::getCallInfo())
+     * @param accept_time QDateTime, when the call got accepted, to keep
+     *        the duration up to date
+     */
+    void update(const int &call_id, const QVariantMap &info, const QDateTime &accept_time);
+
+    /**
+     * Remove a call which isn't active anymore
+     * @param call_id int, the id of the call
+     */
+    void remove(const int &call_id);
+
+    /**
+     * Get the current version
+     * @return qint64 the version, it grows with every change
+     */
+    qint64 getVersion() const;
+
+    /**
+     * Get the changes since a version
+     * @param since qint64, the version seen last, -1 for a full snapshot
+     * @param result QVariantMap, gets version, full (true if all active
+     *        calls are included, because since is too old), calls (the
+     *        changed calls) and removed (ids of removed calls)
+     */
+    void getChanges(const qint64 &since, QVariantMap &result) const;
+
+    /**
+     * Get all active calls
+     * @param calls QVariantList, gets the information of each call
+     */
+    void getCalls(QVariantList &calls) const;
+};
+
+#endif // CALL_SNAPSHOT_H
@@ -0,0 +1,102 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "call_table.h"
+
+#include "call.h"
+
+//----------------------------------------------------------------------
+CallTable::CallTable() : live_count_(0)
+{
+}
+
+//----------------------------------------------------------------------
+CallTable::~CallTable()
+{
+    for (int i = 0; i < live_.size(); ++i)
+        delete live_[i];
+    for (int i = 0; i < pool_.size(); ++i)
+        delete pool_[i];
+}
+
+//----------------------------------------------------------------------
+Call *CallTable::acquire(PhoneApi *phone_api, const int &type)
+{
+    if (pool_.isEmpty())
+        return new Call(phone_api, type);
+
+    Call *call = pool_.last();
+    pool_.pop_back();
+    *call = Call(phone_api, type);
+    return call;
+}
+
+//----------------------------------------------------------------------
+void CallTable::release(Call *call)
+{
+    // a finished call may still be inserted under its id
+    int call_id = call->getCallId();
+    if (find(call_id) == call)
+        remove(call_id);
+    pool_.push_back(call);
+}
+
+//----------------------------------------------------------------------
+bool CallTable::insert(Call *call)
+{
+    int call_id = call->getCallId();
+    if (call_id < 0)
+        return false;
+
+    if (call_id >= live_.size())
+        live_.resize(call_id + 1);
+
+    if (live_[call_id] == call)
+        return true;
+    if (live_[call_id])
+        return false;
+
+    live_[call_id] = call;
+    ++live_count_;
+    return true;
+}
+
+//----------------------------------------------------------------------
+Call *CallTable::find(const int &call_id) const
+{
+    if (call_id < 0 || call_id >= live_.size())
+        return 0;
+    return live_[call_id];
+}
+
+//----------------------------------------------------------------------
+Call *CallTable::remove(const int &call_id)
+{
+    Call *call = find(call_id);
+    if (!call)
+        return 0;
+
+    live_[call_id] = 0;
+    --live_count_;
+    return call;
+}
+
+//----------------------------------------------------------------------
+int CallTable::getIdLimit() const
+{
+    return live_.size();
+}
+
+//----------------------------------------------------------------------
+int CallTable::getLiveCount() const
+{
+    return live_count_;
+}
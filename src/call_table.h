@@ -0,0 +1,97 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef CALL_TABLE_H
+#define CALL_TABLE_H
+
+#include <QVector>
+
+class Call;
+class PhoneApi;
+
+/**
+ * Owns all Call objects of the phone.
+ * Live calls are indexed by their call_id, so lookups don't depend on the
+ * number of calls made so far. Call objects get recycled through a pool.
+ */
+class CallTable
+{
+    /**
+     * Live calls, indexed by call_id, empty slots are 0
+     */
+    QVector<Call*> live_;
+
+    /**
+     * Unused Call objects ready for reuse
+     */
+    QVector<Call*> pool_;
+
+    int live_count_;
+
+    CallTable(const CallTable&);
+    CallTable &operator=(const CallTable&);
+
+public:
+    CallTable();
+    ~CallTable();
+
+    /**
+     * Get a fresh Call object, recycled from the pool if possible.
+     * The call isn't part of the table until it gets inserted.
+     * @param phone_api PhoneApi*, a reference to the phone_api
+     * @param type int, the call type (see Call::TYPE_*)
+     * @return Call* the call
+     */
+    Call *acquire(PhoneApi *phone_api, const int &type);
+
+    /**
+     * Give a Call object back to the pool, a finished call which is still
+     * inserted gets removed first. The call must not be used afterwards.
+     * @param call Call*, the call to recycle
+     */
+    void release(Call *call);
+
+    /**
+     * Insert a call as live call under its call_id.
+     * @param call Call*, the call to insert, needs a valid call_id
+     * @return bool false if the call_id is invalid or already taken
+     *         by an other call
+     */
+    bool insert(Call *call);
+
+    /**
+     * Find a live call
+     * @param call_id int, the id of the call
+     * @return Call* the call or 0 if there is no live call with this id
+     */
+    Call *find(const int &call_id) const;
+
+    /**
+     * Take a call out of the table, the caller has to release it
+     * @param call_id int, the id of the call
+     * @return Call* the removed call or 0 if there is no live call with this id
+     */
+    Call *remove(const int &call_id);
+
+    /**
+     * Get the upper bound of live call ids, for iterating with find()
+     * @return int all live call ids are smaller than this
+     */
+    int getIdLimit() const;
+
+    /**
+     * Get the number of live calls
+     * @return int the number of live calls
+     */
+    int getLiveCount() const;
+};
+
+#endif // CALL_TABLE_H
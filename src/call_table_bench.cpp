@@ -0,0 +1,140 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "call_table_bench.h"
+
+#include <pjsua-lib/pjsua.h>
+
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QVariantMap>
+#include <QVector>
+
+#include "call.h"
+#include "call_table.h"
+#include "log_handler.h"
+
+const int CallTableBench::LIVE_CALLS = 8;
+
+//----------------------------------------------------------------------
+CallTableBench::CallTableBench(const int &lookups) :
+    lookups_(lookups > 0 ? lookups : 1000000)
+{
+}
+
+//----------------------------------------------------------------------
+bool CallTableBench::benchCount(const int &ended_calls, QVariantMap &result) const
+{
+    // the table recycles the ended calls and only keeps the live ones
+    CallTable table;
+    for (int i = 0; i < ended_calls; ++i)
+    {
+        Call *call = table.acquire(0, Call::TYPE_INCOMING);
+        call->setCallId(i % PJSUA_MAX_CALLS);
+        table.insert(call);
+        table.release(table.remove(call->getCallId()));
+    }
+
+    // the old list kept every call, the ended ones in front of the live
+    // ones, and none of them matches the id of a live call
+    QVector<Call*> list;
+    for (int i = 0; i < ended_calls; ++i)
+        list.push_back(new Call(0, Call::TYPE_INCOMING));
+
+    for (int i = 0; i < LIVE_CALLS; ++i)
+    {
+        Call *call = table.acquire(0, Call::TYPE_INCOMING);
+        call->setCallId(i);
+        table.insert(call);
+
+        call = new Call(0, Call::TYPE_INCOMING);
+        call->setCallId(i);
+        list.push_back(call);
+    }
+
+    // the counts keep the lookups from getting optimized away
+    QElapsedTimer timer;
+    int table_found = 0;
+    timer.start();
+    for (int i = 0; i < lookups_; ++i)
+    {
+        if (table.find(i % LIVE_CALLS))
+            ++table_found;
+    }
+    qint64 table_ns = timer.nsecsElapsed();
+
+    // the list gets fewer lookups, it would take minutes otherwise
+    int list_lookups = qMax((int)(lookups_ * 100LL / (ended_calls + 100)), 1000);
+    int list_found = 0;
+    timer.restart();
+    for (int i = 0; i < list_lookups; ++i)
+    {
+        int call_id = i % LIVE_CALLS;
+        for (int j = 0; j < list.size(); ++j)
+        {
+            if (list[j]->getCallId() == call_id)
+            {
+                ++list_found;
+                break;
+            }
+        }
+    }
+    qint64 list_ns = timer.nsecsElapsed();
+    qDeleteAll(list);
+
+    result.insert("endedCalls", ended_calls);
+    result.insert("tableNs", (double)table_ns / lookups_);
+    result.insert("listNs", (double)list_ns / list_lookups);
+
+    if (table_found != lookups_ || list_found != list_lookups)
+    {
+        LOG_ERROR("bench", 0, "A live call wasn't found after "
+                  + QString::number(ended_calls) + " ended calls");
+        return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+void CallTableBench::printResults(const QVariantList &results)
+{
+    QTextStream out(stdout);
+    out << QString("ended calls").leftJustified(12)
+        << QString("table ns").rightJustified(10)
+        << QString("list ns").rightJustified(12) << "\n";
+
+    for (int i = 0; i < results.size(); ++i)
+    {
+        QVariantMap r = results[i].toMap();
+        out << QString::number(r.value("endedCalls").toInt()).leftJustified(12)
+            << QString::number(r.value("tableNs").toDouble(), 'f', 1).rightJustified(10)
+            << QString::number(r.value("listNs").toDouble(), 'f', 1).rightJustified(12)
+            << "\n";
+    }
+    out << "time per lookup of one of " << LIVE_CALLS << " live calls\n";
+}
+
+//----------------------------------------------------------------------
+bool CallTableBench::run(QVariantList &results)
+{
+    static const int ended_calls[] = { 0, 10, 100, 1000, 10000 };
+
+    bool ok = true;
+    for (unsigned i = 0; i < sizeof(ended_calls) / sizeof(ended_calls[0]); ++i)
+    {
+        QVariantMap result;
+        ok = benchCount(ended_calls[i], result) && ok;
+        results << QVariant(result);
+    }
+
+    printResults(results);
+    return ok;
+}
@@ -0,0 +1,63 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef CALL_TABLE_BENCH_H
+#define CALL_TABLE_BENCH_H
+
+#include <QVariantList>
+
+/**
+ * Compares looking up live calls in the CallTable with the linear call
+ * list it replaced, after more and more calls have ended during a shift.
+ * Needs neither pjsua nor network, greenjd runs it with
+ * --call-table-bench [lookups].
+ */
+class CallTableBench
+{
+    int lookups_;
+
+    /**
+     * Look up the live calls after some calls have ended, both ways
+     * @param ended_calls int, the number of calls which have ended
+     * @param result QVariantMap, gets endedCalls, tableNs and listNs
+     *        (time per lookup)
+     * @return bool false if a live call wasn't found
+     */
+    bool benchCount(const int &ended_calls, QVariantMap &result) const;
+
+    /**
+     * Print the results as table
+     * @param results QVariantList, a map per number of ended calls
+     */
+    static void printResults(const QVariantList &results);
+
+public:
+    /**
+     * Number of calls up at the same time
+     */
+    static const int LIVE_CALLS;
+
+    /**
+     * Constructor
+     * @param lookups int, lookups per number of ended calls
+     */
+    CallTableBench(const int &lookups);
+
+    /**
+     * Run the benchmark and print the results to stdout
+     * @param results QVariantList, gets a map per number of ended calls
+     *        (see benchCount())
+     * @return bool false if a live call wasn't found
+     */
+    bool run(QVariantList &results);
+};
+
+#endif // CALL_TABLE_BENCH_H
@@ -0,0 +1,173 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "call_timeline.h"
+
+#include <QMutexLocker>
+
+const char *CallTimeline::STAGE_NAMES[STAGE_COUNT] = {
+    "makeCall", "inviteSent", "trying", "ringing", "progress", "answered",
+    "mediaActive", "firstRtp", "inviteReceived", "notified", "disconnected"
+};
+
+//----------------------------------------------------------------------
+CallTimeline::CallTimeline() :
+    histograms_(STAGE_COUNT)
+{
+    timer_.start();
+}
+
+//----------------------------------------------------------------------
+CallTimeline &CallTimeline::getInstance()
+{
+    static CallTimeline instance;
+    return instance;
+}
+
+//----------------------------------------------------------------------
+qint64 CallTimeline::now() const
+{
+    return timer_.nsecsElapsed() / 1000;
+}
+
+//----------------------------------------------------------------------
+CallTimeline::Entry &CallTimeline::openEntry(const int &call_id)
+{
+    if (call_id >= entries_.size())
+    {
+        Entry closed;
+        for (int i = 0; i < STAGE_COUNT; ++i)
+            closed.times_[i] = -1;
+        closed.start_stage_ = -1;
+        closed.open_ = false;
+        int old_size = entries_.size();
+        entries_.resize(call_id + 1);
+        for (int i = old_size; i < entries_.size(); ++i)
+            entries_[i] = closed;
+    }
+
+    Entry &entry = entries_[call_id];
+    if (!entry.open_)
+    {
+        for (int i = 0; i < STAGE_COUNT; ++i)
+            entry.times_[i] = -1;
+        entry.start_stage_ = -1;
+        entry.open_ = true;
+    }
+    return entry;
+}
+
+//----------------------------------------------------------------------
+void CallTimeline::begin(const int &call_id, const Stage &stage, const qint64 &time)
+{
+    if (call_id < 0)
+        return;
+
+    QMutexLocker locker(&mutex_);
+    // a call can end before its start is known, e.g. if make_call
+    // returns late, its entry is closed already and must stay closed
+    bool ended = call_id < entries_.size() && !entries_[call_id].open_
+                 && entries_[call_id].times_[STAGE_DISCONNECTED] >= time;
+    Entry &entry = ended ? entries_[call_id] : openEntry(call_id);
+    if (entry.start_stage_ >= 0)
+        return;
+    entry.start_stage_ = stage;
+    entry.times_[stage] = time;
+
+    // the stages pjsip reported before the start was known
+    for (int i = 0; i < STAGE_COUNT; ++i)
+    {
+        if (i != stage && i != STAGE_DISCONNECTED && entry.times_[i] >= 0)
+            histograms_[i].add(entry.times_[i] - time);
+    }
+}
+
+//----------------------------------------------------------------------
+bool CallTimeline::mark(const int &call_id, const Stage &stage)
+{
+    if (call_id < 0)
+        return false;
+
+    qint64 time = now();
+    QMutexLocker locker(&mutex_);
+    Entry &entry = openEntry(call_id);
+    if (entry.times_[stage] >= 0)
+        return false;
+
+    entry.times_[stage] = time;
+    if (stage == STAGE_DISCONNECTED)
+        entry.open_ = false;
+    else if (entry.start_stage_ >= 0)
+        histograms_[stage].add(time - entry.times_[entry.start_stage_]);
+    return true;
+}
+
+//----------------------------------------------------------------------
+void CallTimeline::getCallsWaitingForRtp(QList<int> &call_ids) const
+{
+    QMutexLocker locker(&mutex_);
+    for (int i = 0; i < entries_.size(); ++i)
+    {
+        const Entry &entry = entries_[i];
+        if (entry.open_ && entry.times_[STAGE_MEDIA_ACTIVE] >= 0
+            && entry.times_[STAGE_FIRST_RTP] < 0)
+        {
+            call_ids << i;
+        }
+    }
+}
+
+//----------------------------------------------------------------------
+void CallTimeline::getCall(const int &call_id, QVariantMap &timeline) const
+{
+    QMutexLocker locker(&mutex_);
+    if (call_id < 0 || call_id >= entries_.size())
+        return;
+
+    const Entry &entry = entries_[call_id];
+    if (entry.start_stage_ < 0)
+        return;
+    qint64 start = entry.times_[entry.start_stage_];
+    for (int i = 0; i < STAGE_COUNT; ++i)
+    {
+        if (entry.times_[i] >= 0)
+            timeline.insert(STAGE_NAMES[i], (entry.times_[i] - start) / 1000.0);
+    }
+}
+
+//----------------------------------------------------------------------
+void CallTimeline::getStatistics(QVariantMap &stats) const
+{
+    QMutexLocker locker(&mutex_);
+    for (int i = 0; i < STAGE_COUNT; ++i)
+    {
+        if (!histograms_[i].getCount())
+            continue;
+        QVariantMap summary;
+        histograms_[i].getSummary(summary);
+        stats.insert(STAGE_NAMES[i], summary);
+    }
+}
+
+//----------------------------------------------------------------------
+LatencyHistogram CallTimeline::getHistogram(const Stage &stage) const
+{
+    QMutexLocker locker(&mutex_);
+    return histograms_[stage];
+}
+
+//----------------------------------------------------------------------
+void CallTimeline::clearStatistics()
+{
+    QMutexLocker locker(&mutex_);
+    for (int i = 0; i < STAGE_COUNT; ++i)
+        histograms_[i].clear();
+}
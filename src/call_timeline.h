@@ -0,0 +1,156 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef CALL_TIMELINE_H
+#define CALL_TIMELINE_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QVector>
+#include <QList>
+#include <QVariantMap>
+#include "latency_histogram.h"
+
+/**
+ * This class is implemented as singleton.
+ * It records when each call reaches the stages of its setup, with a
+ * monotonic clock in microseconds, and collects the time from the start
+ * of the call to each stage in a histogram for the whole session.
+ * Stages can be marked from any thread, the pjsip callbacks do most.
+ */
+class CallTimeline
+{
+public:
+    /**
+     * \name Stages
+     * \{
+     */
+    enum Stage
+    {
+        STAGE_MAKE_CALL,        // outgoing call started
+        STAGE_INVITE_SENT,
+        STAGE_TRYING,           // 100
+        STAGE_RINGING,          // 180
+        STAGE_PROGRESS,         // other provisional responses, 183
+        STAGE_ANSWERED,         // 2xx
+        STAGE_MEDIA_ACTIVE,
+        STAGE_FIRST_RTP,
+        STAGE_INVITE_RECEIVED,  // incoming call started
+        STAGE_NOTIFIED,         // incoming call passed to the web page
+        STAGE_DISCONNECTED,
+        STAGE_COUNT
+    };
+    /**
+     * \}
+     */
+
+private:
+    struct Entry
+    {
+        /**
+         * Time of each stage, -1 if it isn't reached
+         */
+        qint64 times_[STAGE_COUNT];
+        int start_stage_;
+
+        /**
+         * False after the call ended, the next mark starts a new call
+         */
+        bool open_;
+    };
+
+    mutable QMutex mutex_;
+    QElapsedTimer timer_;
+    QVector<Entry> entries_;
+    QVector<LatencyHistogram> histograms_;
+
+    CallTimeline();
+    CallTimeline(const CallTimeline&);
+
+    /**
+     * Get the entry of a call, a closed one gets reset for the next call.
+     * The mutex has to be locked.
+     * @param call_id int, the id of the call
+     * @return Entry the entry
+     */
+    Entry &openEntry(const int &call_id);
+
+public:
+    /**
+     * Names of the stages, as used by getCall() and getStatistics()
+     */
+    static const char *STAGE_NAMES[STAGE_COUNT];
+
+    /**
+     * Get instance of Singelton class
+     * @return CallTimeline the instance to this class
+     */
+    static CallTimeline &getInstance();
+
+    /**
+     * Get the current time of the clock the stages use
+     * @return qint64 monotonic time in us
+     */
+    qint64 now() const;
+
+    /**
+     * Set the start of a call, stages marked before belong to it too,
+     * even if the call got disconnected already
+     * @param call_id int, the id of the call
+     * @param stage Stage, STAGE_MAKE_CALL or STAGE_INVITE_RECEIVED
+     * @param time qint64, when the call started, see now()
+     */
+    void begin(const int &call_id, const Stage &stage, const qint64 &time);
+
+    /**
+     * Record that a call reached a stage, only the first time counts.
+     * STAGE_DISCONNECTED closes the call.
+     * @param call_id int, the id of the call
+     * @param stage Stage, the stage
+     * @return bool false if the stage was reached before
+     */
+    bool mark(const int &call_id, const Stage &stage);
+
+    /**
+     * Get the calls which have active media but got no rtp yet
+     * @param call_ids QList<int>, gets the ids
+     */
+    void getCallsWaitingForRtp(QList<int> &call_ids) const;
+
+    /**
+     * Get the stages of a call
+     * @param call_id int, the id of the call
+     * @param timeline QVariantMap, gets the ms since the start of the call
+     *        by stage name, for the reached stages
+     */
+    void getCall(const int &call_id, QVariantMap &timeline) const;
+
+    /**
+     * Get the histograms of the session
+     * @param stats QVariantMap, gets a summary in ms by stage name (see
+     *        LatencyHistogram::getSummary()), for the stages reached once
+     */
+    void getStatistics(QVariantMap &stats) const;
+
+    /**
+     * Get the histogram of a stage
+     * @param stage Stage, the stage
+     * @return LatencyHistogram a copy of the histogram
+     */
+    LatencyHistogram getHistogram(const Stage &stage) const;
+
+    /**
+     * Clear the histograms of the session
+     */
+    void clearStatistics();
+};
+
+#endif // CALL_TIMELINE_H
@@ -0,0 +1,273 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "codec_bench.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QTextStream>
+#include <QVariantMap>
+
+#include <math.h>
+#include <time.h>
+
+#include "config_file_handler.h"
+#include "log_handler.h"
+#include "sip_phone.h"
+
+const int CodecBench::HEADER_SIZE = 12 + 8 + 20;
+
+//----------------------------------------------------------------------
+CodecBench::CodecBench(const int &seconds) :
+    seconds_(seconds > 0 ? seconds : 20)
+{
+}
+
+//----------------------------------------------------------------------
+void CodecBench::generateSignal(const unsigned &clock_rate, const unsigned &channels,
+                                QVector<pj_int16_t> &samples) const
+{
+    const double pi = 3.14159265358979;
+    unsigned count = clock_rate * seconds_;
+    samples.resize(count * channels);
+
+    // the same signal for every codec
+    qsrand(1);
+    double phase = 0;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        double t = (double)i / clock_rate;
+        double noise = (qrand() % 2001 - 1000) / 1000.0;
+
+        // 1.5 s talking, 0.5 s pause
+        double value = noise * 30;
+        if (fmod(t, 2.0) < 1.5)
+        {
+            // syllables at 4 Hz, pitch between 100 and 160 Hz
+            double envelope = 0.5 - 0.5 * cos(2 * pi * 4 * t);
+            double pitch = 130 + 30 * sin(2 * pi * 0.7 * t);
+            phase += 2 * pi * pitch / clock_rate;
+
+            double voice = 0;
+            for (int k = 1; k <= 20 && k * pitch < clock_rate / 2; ++k)
+                voice += sin(k * phase) / k;
+            value += envelope * (6000 * voice + 300 * noise);
+        }
+
+        pj_int16_t sample = (pj_int16_t)qBound(-32768.0, value, 32767.0);
+        for (unsigned c = 0; c < channels; ++c)
+            samples[i * channels + c] = sample;
+    }
+}
+
+//----------------------------------------------------------------------
+bool CodecBench::benchCodec(pjmedia_codec_mgr *mgr, const pjmedia_codec_info &info,
+                            QVariantMap &result) const
+{
+    ConfigFileHandler &config = ConfigFileHandler::getInstance();
+    QString id = QString::fromLatin1(info.encoding_name.ptr, info.encoding_name.slen)
+                 + "/" + QString::number(info.clock_rate)
+                 + "/" + QString::number(info.channel_cnt);
+
+    pjmedia_codec_param param;
+    if (pjmedia_codec_mgr_get_default_param(mgr, &info, &param) != PJ_SUCCESS)
+        return false;
+
+    // the settings calls get, see SipPhone::applyCodecSettings()
+    param.setting.vad = config.getVad() ? 1 : 0;
+    param.setting.cng = config.getCng() ? 1 : 0;
+    int index = SipPhone::matchCodec(config.getCodecPtimes().keys(), id);
+    if (index >= 0 && param.info.frm_ptime > 0)
+    {
+        int ptime = config.getCodecPtimes().values()[index];
+        param.setting.frm_per_pkt = (pj_uint8_t)qMax(ptime / param.info.frm_ptime, 1);
+    }
+
+    pjmedia_codec *codec;
+    if (pjmedia_codec_mgr_alloc_codec(mgr, &info, &codec) != PJ_SUCCESS)
+        return false;
+
+    pj_pool_t *pool = pjsua_pool_create("bench", 4000, 4000);
+    pj_status_t status = codec->op->init(codec, pool);
+    if (status == PJ_SUCCESS)
+        status = codec->op->open(codec, &param);
+    if (status != PJ_SUCCESS)
+    {
+        LOG_WARNING("bench", status, "Error opening codec " + id);
+        pjmedia_codec_mgr_dealloc_codec(mgr, codec);
+        pj_pool_release(pool);
+        return false;
+    }
+
+    unsigned frame_samples = param.info.clock_rate * param.info.frm_ptime / 1000
+                             * param.info.channel_cnt;
+    unsigned packet_samples = frame_samples * param.setting.frm_per_pkt;
+    unsigned max_packet = param.info.max_bps * param.info.frm_ptime
+                          * param.setting.frm_per_pkt / 8000 + 64;
+
+    QVector<pj_int16_t> signal;
+    generateSignal(param.info.clock_rate, param.info.channel_cnt, signal);
+
+    // encode everything first and decode afterwards, timing whole
+    // passes is more exact than timing single packets
+    QList<QByteArray> packets;
+    QByteArray buffer(max_packet, 0);
+    qint64 bytes = 0;
+    int packet_count = 0;
+    clock_t start = clock();
+    for (int offset = 0; offset + (int)packet_samples <= signal.size(); offset += packet_samples)
+    {
+        pjmedia_frame in;
+        pj_bzero(&in, sizeof(in));
+        in.type = PJMEDIA_FRAME_TYPE_AUDIO;
+        in.buf = signal.data() + offset;
+        in.size = packet_samples * sizeof(pj_int16_t);
+        in.timestamp.u64 = offset;
+
+        pjmedia_frame out;
+        pj_bzero(&out, sizeof(out));
+        out.buf = buffer.data();
+        out.size = buffer.size();
+        if (codec->op->encode(codec, &in, buffer.size(), &out) != PJ_SUCCESS)
+            break;
+
+        ++packet_count;
+        // silence suppressed by vad isn't sent
+        if (out.type == PJMEDIA_FRAME_TYPE_AUDIO && out.size > 0)
+            packets << QByteArray((const char*)out.buf, (int)out.size);
+    }
+    clock_t encode_time = clock() - start;
+
+    QVector<pj_int16_t> decoded(frame_samples);
+    QVector<pjmedia_frame> frames(param.setting.frm_per_pkt * 2 + 1);
+    start = clock();
+    for (int i = 0; i < packets.size(); ++i)
+    {
+        bytes += packets[i].size();
+
+        pj_timestamp ts;
+        ts.u64 = 0;
+        unsigned count = frames.size();
+        if (codec->op->parse(codec, packets[i].data(), packets[i].size(), &ts,
+                             &count, frames.data()) != PJ_SUCCESS)
+            continue;
+
+        for (unsigned j = 0; j < count; ++j)
+        {
+            pjmedia_frame pcm;
+            pj_bzero(&pcm, sizeof(pcm));
+            pcm.buf = decoded.data();
+            pcm.size = decoded.size() * sizeof(pj_int16_t);
+            codec->op->decode(codec, &frames[j], pcm.size, &pcm);
+        }
+    }
+    clock_t decode_time = clock() - start;
+
+    codec->op->close(codec);
+    pjmedia_codec_mgr_dealloc_codec(mgr, codec);
+    pj_pool_release(pool);
+
+    if (!packet_count)
+        return false;
+
+    // a call encodes the local and decodes the remote audio
+    double encode_us = encode_time * 1000000.0 / CLOCKS_PER_SEC;
+    double decode_us = decode_time * 1000000.0 / CLOCKS_PER_SEC;
+    double cpu = (encode_us + decode_us) / (seconds_ * 10000.0);
+
+    result.insert("id", id);
+    result.insert("clockRate", param.info.clock_rate);
+    result.insert("ptime", param.info.frm_ptime * param.setting.frm_per_pkt);
+    result.insert("bitrate", param.info.avg_bps);
+    result.insert("payloadBitrate", bytes * 8 / seconds_);
+    result.insert("wireBitrate", (bytes + packets.size() * HEADER_SIZE) * 8 / seconds_);
+    result.insert("encodeUs", encode_us / packet_count);
+    result.insert("decodeUs", packets.isEmpty() ? 0.0 : decode_us / packets.size());
+    result.insert("cpuPerCall", cpu);
+    return true;
+}
+
+//----------------------------------------------------------------------
+void CodecBench::printResults(const QVariantList &results)
+{
+    QTextStream out(stdout);
+    out << QString("codec").leftJustified(20)
+        << QString("ptime").rightJustified(6)
+        << QString("nominal").rightJustified(9)
+        << QString("payload").rightJustified(9)
+        << QString("wire").rightJustified(9)
+        << QString("enc us").rightJustified(9)
+        << QString("dec us").rightJustified(9)
+        << QString("cpu %").rightJustified(8)
+        << QString("calls/core").rightJustified(11) << "\n";
+
+    for (int i = 0; i < results.size(); ++i)
+    {
+        QVariantMap r = results[i].toMap();
+        double cpu = r.value("cpuPerCall").toDouble();
+        out << r.value("id").toString().leftJustified(20)
+            << QString::number(r.value("ptime").toInt()).rightJustified(6)
+            << QString::number(r.value("bitrate").toInt()).rightJustified(9)
+            << QString::number(r.value("payloadBitrate").toLongLong()).rightJustified(9)
+            << QString::number(r.value("wireBitrate").toLongLong()).rightJustified(9)
+            << QString::number(r.value("encodeUs").toDouble(), 'f', 1).rightJustified(9)
+            << QString::number(r.value("decodeUs").toDouble(), 'f', 1).rightJustified(9)
+            << QString::number(cpu, 'f', 3).rightJustified(8)
+            << (cpu > 0 ? QString::number((int)(100 / cpu)) : QString("-")).rightJustified(11)
+            << "\n";
+    }
+    out << "bitrates in bit/s, cpu % of one core per call (encode and decode)\n";
+}
+
+//----------------------------------------------------------------------
+bool CodecBench::run(QVariantList &results)
+{
+    pj_status_t status = pjsua_create();
+    if (status != PJ_SUCCESS)
+    {
+        LOG_FATAL_ERROR("bench", status, "Error in pjsua_create()");
+        return false;
+    }
+
+    // only the codecs are needed, pjsua_init registers them
+    pjsua_config cfg;
+    pjsua_logging_config log_cfg;
+    pjsua_media_config media_cfg;
+    pjsua_config_default(&cfg);
+    pjsua_logging_config_default(&log_cfg);
+    log_cfg.console_level = 1;
+    pjsua_media_config_default(&media_cfg);
+    status = pjsua_init(&cfg, &log_cfg, &media_cfg);
+    if (status != PJ_SUCCESS)
+    {
+        LOG_FATAL_ERROR("bench", status, "Error in pjsua_init()");
+        pjsua_destroy();
+        return false;
+    }
+
+    pjmedia_codec_mgr *mgr = pjmedia_endpt_get_codec_mgr(pjsua_get_pjmedia_endpt());
+    pjmedia_codec_info info[PJMEDIA_CODEC_MGR_MAX_CODECS];
+    unsigned count = PJMEDIA_CODEC_MGR_MAX_CODECS;
+    status = pjmedia_codec_mgr_enum_codecs(mgr, &count, info, NULL);
+    if (status == PJ_SUCCESS)
+    {
+        for (unsigned i = 0; i < count; ++i)
+        {
+            QVariantMap result;
+            if (benchCodec(mgr, info[i], result))
+                results << QVariant(result);
+        }
+    }
+    pjsua_destroy();
+
+    printResults(results);
+    return status == PJ_SUCCESS;
+}
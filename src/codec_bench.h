@@ -0,0 +1,79 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef CODEC_BENCH_H
+#define CODEC_BENCH_H
+
+#include <pjsua-lib/pjsua.h>
+
+#include <QVector>
+#include <QVariantList>
+
+/**
+ * Encodes and decodes a speech-like reference signal with every codec
+ * pjmedia offers, with the ptime and vad of the config, and reports the
+ * cpu time per call and the bitrate. Needs neither sound device nor
+ * network, greenjd runs it with --codec-bench [seconds].
+ */
+class CodecBench
+{
+    int seconds_;
+
+    /**
+     * Create the reference signal: voiced parts with a varying pitch
+     * and pauses with some noise, so vad has something to detect
+     * @param clock_rate unsigned, samples per second
+     * @param channels unsigned, number of channels
+     * @param samples QVector<pj_int16_t>, gets the signal
+     */
+    void generateSignal(const unsigned &clock_rate, const unsigned &channels,
+                        QVector<pj_int16_t> &samples) const;
+
+    /**
+     * Encode and decode the reference signal with one codec
+     * @param mgr pjmedia_codec_mgr*, the codec manager
+     * @param info pjmedia_codec_info, the codec
+     * @param result QVariantMap, gets id, clockRate, ptime, bitrate
+     *        (nominal), payloadBitrate and wireBitrate (measured, with
+     *        RTP/UDP/IP headers), encodeUs and decodeUs (cpu time per
+     *        packet) and cpuPerCall (% of one core)
+     * @return bool false if the codec couldn't be used
+     */
+    bool benchCodec(pjmedia_codec_mgr *mgr, const pjmedia_codec_info &info,
+                    QVariantMap &result) const;
+
+    /**
+     * Print the results as table
+     * @param results QVariantList, a map per codec
+     */
+    static void printResults(const QVariantList &results);
+
+public:
+    /**
+     * Size of the RTP, UDP and IPv4 headers of a packet
+     */
+    static const int HEADER_SIZE;
+
+    /**
+     * Constructor
+     * @param seconds int, length of the reference signal
+     */
+    CodecBench(const int &seconds);
+
+    /**
+     * Run the benchmark and print the results to stdout
+     * @param results QVariantList, gets a map per codec (see benchCodec())
+     * @return bool false if pjmedia couldn't be initialized
+     */
+    bool run(QVariantList &results);
+};
+
+#endif // CODEC_BENCH_H
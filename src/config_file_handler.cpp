@@ -11,13 +11,36 @@
 
 #include "config_file_handler.h"
 
-#include <QMessageBox>
 #include <QDir>
+#include <QStringList>
 #include "log_info.h"
 
+const char *ConfigFileHandler::MEDIA_KEYS[] = {
+    "clock_rate", "audio_frame_ptime", "snd_rec_latency", "snd_play_latency",
+    "jb_init", "jb_min_pre", "jb_max_pre", "jb_max", "quality", "ec_tail_len",
+    "plc", 0
+};
+
+// short frames and sound buffers, a jitter buffer which stays small
+const int ConfigFileHandler::LOW_LATENCY_PRESET[] = {
+    -1, 10, 40, 60,
+    20, 10, 60, 200, 4, 100,
+    1
+};
+
+// larger buffers for lossy links and busy machines
+const int ConfigFileHandler::ROBUST_PRESET[] = {
+    -1, 20, 100, 140,
+    80, 40, 240, 500, 6, 200,
+    1
+};
+
 //----------------------------------------------------------------------
 ConfigFileHandler::ConfigFileHandler() :
-    file_name_(QDir::homePath()+"/.greenj/settings.conf"), url_(""),
+    log_level_(LogInfo::STATUS_WARNING), file_name_(QDir::homePath()+"/.greenj/settings.conf"), url_(""),
+    // the log may be set up before init(), it gets the defaults
+    log_queue_size_(10000), log_flush_size_(4096), log_flush_interval_(1000),
+    log_fsync_policy_(0), log_max_size_(10485760), log_compress_(true),
     my_settings_(file_name_,QSettings::IniFormat)
 {
 }
@@ -52,6 +75,17 @@ void ConfigFileHandler::init()
         my_settings_.setValue("app_resizeable", "true");
         my_settings_.setValue("app_state", "2");
         my_settings_.setValue("log_level", LogInfo::STATUS_WARNING);
+        my_settings_.setValue("log_queue_size", 10000);
+        my_settings_.setValue("log_flush_size", 4096);
+        my_settings_.setValue("log_flush_interval", 1000);
+        my_settings_.setValue("log_fsync", 0);
+        my_settings_.setValue("log_max_size", 10485760);
+        my_settings_.setValue("log_compress", "true");
+        my_settings_.setValue("history_max_count", 1000);
+        my_settings_.setValue("history_max_bytes", 1048576);
+        my_settings_.setValue("js_event_interval", 0);
+        my_settings_.setValue("js_profile", "false");
+        my_settings_.setValue("js_slow_call", 50);
         my_settings_.endGroup();
 
         my_settings_.beginGroup("gui");
@@ -63,22 +97,161 @@ void ConfigFileHandler::init()
         my_settings_.beginGroup("server");
         my_settings_.setValue("url", "phone/index.html");
         my_settings_.setValue("stun", "");
+        my_settings_.setValue("rpc_socket", "greenj");
+        my_settings_.setValue("metrics_port", 0);
+        my_settings_.endGroup();
+
+        my_settings_.beginGroup("sip");
+        my_settings_.setValue("transports", QStringList() << "udp");
+        my_settings_.setValue("account_transport", "");
+        my_settings_.setValue("bind_address", "");
+        my_settings_.setValue("port", 5060);
+        my_settings_.setValue("port_range", 0);
+        my_settings_.setValue("tls_port", 5061);
+        my_settings_.setValue("outbound_proxy", "");
+        my_settings_.setValue("keep_alive", 15);
+        my_settings_.setValue("registrars", QStringList());
+        my_settings_.setValue("reg_expires", 300);
+        my_settings_.setValue("reg_failover_timeout", 4);
+        my_settings_.setValue("reg_retry_interval", 2);
+        my_settings_.setValue("reg_retry_max", 60);
+        my_settings_.endGroup();
+
+        my_settings_.beginGroup("media");
+        my_settings_.setValue("codecs", QStringList());
+        my_settings_.setValue("codecs_exclusive", "false");
+        my_settings_.setValue("codec_ptime", QStringList());
+        my_settings_.setValue("vad", "true");
+        my_settings_.setValue("cng", "false");
+        my_settings_.setValue("profile", "default");
+        my_settings_.setValue("null_audio", "false");
+        my_settings_.setValue("play_file", "");
+        my_settings_.setValue("record_dir", "");
+        my_settings_.setValue("quality_interval", 5);
+        my_settings_.setValue("mos_threshold", 3.5);
         my_settings_.endGroup();
     }
 
     my_settings_.beginGroup("application");
     log_level_ = my_settings_.value("log_level").toUInt();
+    log_queue_size_ = my_settings_.value("log_queue_size", 10000).toInt();
+    log_flush_size_ = my_settings_.value("log_flush_size", 4096).toInt();
+    log_flush_interval_ = my_settings_.value("log_flush_interval", 1000).toInt();
+    log_fsync_policy_ = my_settings_.value("log_fsync", 0).toInt();
+    log_max_size_ = my_settings_.value("log_max_size", 10485760).toLongLong();
+    log_compress_ = my_settings_.value("log_compress", true).toBool();
+    history_max_count_ = my_settings_.value("history_max_count", 1000).toInt();
+    history_max_bytes_ = my_settings_.value("history_max_bytes", 1048576).toLongLong();
+    js_event_interval_ = my_settings_.value("js_event_interval", 0).toInt();
+    js_profile_ = my_settings_.value("js_profile", false).toBool();
+    js_slow_call_ = my_settings_.value("js_slow_call", 50).toInt();
+    my_settings_.endGroup();
+
+    log_domain_levels_.clear();
+    my_settings_.beginGroup("log_levels");
+    QStringList domains = my_settings_.childKeys();
+    for (int i = 0; i < domains.size(); ++i)
+        log_domain_levels_.insert(domains[i], my_settings_.value(domains[i]).toInt());
     my_settings_.endGroup();
 
     my_settings_.beginGroup("server");
     url_ = my_settings_.value("url").toUrl();
     stun_ = my_settings_.value("stun").toString();
+    rpc_socket_ = my_settings_.value("rpc_socket", "greenj").toString();
+    metrics_port_ = qBound(0, my_settings_.value("metrics_port", 0).toInt(), 65535);
+    my_settings_.endGroup();
+
+    my_settings_.beginGroup("sip");
+    sip_transports_.clear();
+    QStringList transports = my_settings_.value("transports", "udp").toStringList();
+    for (int i = 0; i < transports.size(); ++i)
+    {
+        QString transport = transports[i].trimmed().toLower();
+        if (transport != "udp" && transport != "tcp" && transport != "tls")
+            continue;
+        if (!sip_transports_.contains(transport))
+            sip_transports_ << transport;
+    }
+    if (sip_transports_.isEmpty())
+        sip_transports_ << "udp";
+    sip_account_transport_ = my_settings_.value("account_transport").toString().trimmed().toLower();
+    if (!sip_transports_.contains(sip_account_transport_))
+        sip_account_transport_ = sip_transports_.first();
+    sip_bind_address_ = my_settings_.value("bind_address").toString();
+    sip_port_ = my_settings_.value("port", 5060).toInt();
+    sip_port_range_ = my_settings_.value("port_range", 0).toInt();
+    sip_tls_port_ = my_settings_.value("tls_port", 5061).toInt();
+    sip_outbound_proxy_ = my_settings_.value("outbound_proxy").toString();
+    sip_keep_alive_ = my_settings_.value("keep_alive", 15).toInt();
+    sip_registrars_.clear();
+    QStringList registrars = my_settings_.value("registrars").toStringList();
+    for (int i = 0; i < registrars.size(); ++i)
+    {
+        if (!registrars[i].trimmed().isEmpty())
+            sip_registrars_ << registrars[i].trimmed();
+    }
+    sip_reg_expires_ = qMax(my_settings_.value("reg_expires", 300).toInt(), 1);
+    sip_reg_failover_timeout_ = qMax(my_settings_.value("reg_failover_timeout", 4).toInt(), 1);
+    sip_reg_retry_interval_ = qMax(my_settings_.value("reg_retry_interval", 2).toInt(), 1);
+    sip_reg_retry_max_ = qMax(my_settings_.value("reg_retry_max", 60).toInt(),
+                              sip_reg_retry_interval_);
+    sip_tls_ca_file_ = my_settings_.value("tls_ca_file").toString();
+    sip_tls_cert_file_ = my_settings_.value("tls_cert_file").toString();
+    sip_tls_key_file_ = my_settings_.value("tls_key_file").toString();
+    my_settings_.endGroup();
+
+    my_settings_.beginGroup("media");
+    codec_priority_.clear();
+    QStringList codecs = my_settings_.value("codecs").toStringList();
+    for (int i = 0; i < codecs.size(); ++i)
+    {
+        if (!codecs[i].trimmed().isEmpty())
+            codec_priority_ << codecs[i].trimmed();
+    }
+    codecs_exclusive_ = my_settings_.value("codecs_exclusive", false).toBool();
+    // entries like "speex/16000:40", QSettings keys can't hold a '/'
+    codec_ptimes_.clear();
+    QStringList ptimes = my_settings_.value("codec_ptime").toStringList();
+    for (int i = 0; i < ptimes.size(); ++i)
+    {
+        int pos = ptimes[i].lastIndexOf(':');
+        int ptime = ptimes[i].mid(pos + 1).toInt();
+        if (pos > 0 && ptime > 0)
+            codec_ptimes_.insert(ptimes[i].left(pos).trimmed(), ptime);
+    }
+    vad_ = my_settings_.value("vad", true).toBool();
+    cng_ = my_settings_.value("cng", false).toBool();
+    null_audio_ = my_settings_.value("null_audio", false).toBool();
+    play_file_ = my_settings_.value("play_file", "").toString();
+    record_dir_ = my_settings_.value("record_dir", "").toString();
+    quality_interval_ = my_settings_.value("quality_interval", 5).toInt();
+    mos_threshold_ = my_settings_.value("mos_threshold", 3.5).toDouble();
+
+    // the preset first, then the single settings of the config
+    media_profile_ = my_settings_.value("profile", "default").toString();
+    media_settings_.clear();
+    const int *preset = 0;
+    if (media_profile_ == "low_latency")
+        preset = LOW_LATENCY_PRESET;
+    else if (media_profile_ == "robust")
+        preset = ROBUST_PRESET;
+    else
+        media_profile_ = "default";
+    for (int i = 0; MEDIA_KEYS[i]; ++i)
+    {
+        if (preset && preset[i] >= 0)
+            media_settings_.insert(MEDIA_KEYS[i], preset[i]);
+        if (my_settings_.contains(MEDIA_KEYS[i]))
+            media_settings_.insert(MEDIA_KEYS[i], my_settings_.value(MEDIA_KEYS[i]).toInt());
+    }
     my_settings_.endGroup();
 
     my_settings_.beginGroup("gui");
     sound_file_name_ = my_settings_.value("soundfile").toString();
     sound_dial_file_name_ = my_settings_.value("sounddialfile").toString();
     my_settings_.endGroup();
+
+    signalLogLevelChanged();
 }
 
 //----------------------------------------------------------------------
@@ -93,6 +266,18 @@ const QString &ConfigFileHandler::getStunServer() const
     return stun_;
 }
 
+//----------------------------------------------------------------------
+const QString &ConfigFileHandler::getRpcSocketName() const
+{
+    return rpc_socket_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getMetricsPort() const
+{
+    return metrics_port_;
+}
+
 //----------------------------------------------------------------------
 const QString &ConfigFileHandler::getSoundFilename() const
 {
@@ -111,6 +296,264 @@ unsigned ConfigFileHandler::getLogLevel() const
     return log_level_;
 }
 
+//----------------------------------------------------------------------
+const QMap<QString, int> &ConfigFileHandler::getLogDomainLevels() const
+{
+    return log_domain_levels_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getLogQueueSize() const
+{
+    return log_queue_size_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getLogFlushSize() const
+{
+    return log_flush_size_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getLogFlushInterval() const
+{
+    return log_flush_interval_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getLogFsyncPolicy() const
+{
+    return log_fsync_policy_;
+}
+
+//----------------------------------------------------------------------
+qint64 ConfigFileHandler::getLogMaxSize() const
+{
+    return log_max_size_;
+}
+
+//----------------------------------------------------------------------
+bool ConfigFileHandler::getLogCompress() const
+{
+    return log_compress_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getHistoryMaxCount() const
+{
+    return history_max_count_;
+}
+
+//----------------------------------------------------------------------
+qint64 ConfigFileHandler::getHistoryMaxBytes() const
+{
+    return history_max_bytes_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getJsEventInterval() const
+{
+    return js_event_interval_;
+}
+
+//----------------------------------------------------------------------
+bool ConfigFileHandler::getJsProfile() const
+{
+    return js_profile_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getJsSlowCall() const
+{
+    return js_slow_call_;
+}
+
+//----------------------------------------------------------------------
+const QStringList &ConfigFileHandler::getSipTransports() const
+{
+    return sip_transports_;
+}
+
+//----------------------------------------------------------------------
+const QString &ConfigFileHandler::getSipAccountTransport() const
+{
+    return sip_account_transport_;
+}
+
+//----------------------------------------------------------------------
+const QString &ConfigFileHandler::getSipBindAddress() const
+{
+    return sip_bind_address_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getSipPort() const
+{
+    return sip_port_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getSipPortRange() const
+{
+    return sip_port_range_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getSipTlsPort() const
+{
+    return sip_tls_port_;
+}
+
+//----------------------------------------------------------------------
+const QString &ConfigFileHandler::getSipOutboundProxy() const
+{
+    return sip_outbound_proxy_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getSipKeepAlive() const
+{
+    return sip_keep_alive_;
+}
+
+//----------------------------------------------------------------------
+const QStringList &ConfigFileHandler::getSipRegistrars() const
+{
+    return sip_registrars_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getSipRegExpires() const
+{
+    return sip_reg_expires_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getSipRegFailoverTimeout() const
+{
+    return sip_reg_failover_timeout_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getSipRegRetryInterval() const
+{
+    return sip_reg_retry_interval_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getSipRegRetryMax() const
+{
+    return sip_reg_retry_max_;
+}
+
+//----------------------------------------------------------------------
+const QString &ConfigFileHandler::getSipTlsCaFile() const
+{
+    return sip_tls_ca_file_;
+}
+
+//----------------------------------------------------------------------
+const QString &ConfigFileHandler::getSipTlsCertFile() const
+{
+    return sip_tls_cert_file_;
+}
+
+//----------------------------------------------------------------------
+const QString &ConfigFileHandler::getSipTlsKeyFile() const
+{
+    return sip_tls_key_file_;
+}
+
+//----------------------------------------------------------------------
+const QStringList &ConfigFileHandler::getCodecPriority() const
+{
+    return codec_priority_;
+}
+
+//----------------------------------------------------------------------
+bool ConfigFileHandler::getCodecsExclusive() const
+{
+    return codecs_exclusive_;
+}
+
+//----------------------------------------------------------------------
+const QMap<QString, int> &ConfigFileHandler::getCodecPtimes() const
+{
+    return codec_ptimes_;
+}
+
+//----------------------------------------------------------------------
+bool ConfigFileHandler::getVad() const
+{
+    return vad_;
+}
+
+//----------------------------------------------------------------------
+bool ConfigFileHandler::getCng() const
+{
+    return cng_;
+}
+
+//----------------------------------------------------------------------
+const QString &ConfigFileHandler::getMediaProfile() const
+{
+    return media_profile_;
+}
+
+//----------------------------------------------------------------------
+const QMap<QString, int> &ConfigFileHandler::getMediaSettings() const
+{
+    return media_settings_;
+}
+
+//----------------------------------------------------------------------
+bool ConfigFileHandler::getNullAudio() const
+{
+    return null_audio_;
+}
+
+//----------------------------------------------------------------------
+const QString &ConfigFileHandler::getPlayFile() const
+{
+    return play_file_;
+}
+
+//----------------------------------------------------------------------
+const QString &ConfigFileHandler::getRecordDir() const
+{
+    return record_dir_;
+}
+
+//----------------------------------------------------------------------
+int ConfigFileHandler::getQualityInterval() const
+{
+    return quality_interval_;
+}
+
+//----------------------------------------------------------------------
+double ConfigFileHandler::getMosThreshold() const
+{
+    return mos_threshold_;
+}
+
+//----------------------------------------------------------------------
+void ConfigFileHandler::saveCodecSettings()
+{
+    QStringList ptimes;
+    QMap<QString, int>::const_iterator i;
+    for (i = codec_ptimes_.constBegin(); i != codec_ptimes_.constEnd(); ++i)
+        ptimes << i.key() + ":" + QString::number(i.value());
+
+    my_settings_.beginGroup("media");
+    my_settings_.setValue("codecs", codec_priority_);
+    my_settings_.setValue("codecs_exclusive", codecs_exclusive_);
+    my_settings_.setValue("codec_ptime", ptimes);
+    my_settings_.setValue("vad", vad_);
+    my_settings_.setValue("cng", cng_);
+    my_settings_.endGroup();
+    signalCodecsChanged();
+}
+
 //-----------------------------------------------------------------------
 int ConfigFileHandler::getConfigVersion()
 {
@@ -235,6 +678,39 @@ void ConfigFileHandler::setLogLevel(const unsigned &val)
     my_settings_.beginGroup("application");
     my_settings_.setValue("log_level", val);
     my_settings_.endGroup();
+    signalLogLevelChanged();
+}
+
+//----------------------------------------------------------------------
+void ConfigFileHandler::setLogDomainLevel(const QString &domain, const int &val)
+{
+    my_settings_.beginGroup("log_levels");
+    if (val < 0)
+    {
+        log_domain_levels_.remove(domain);
+        my_settings_.remove(domain);
+    }
+    else
+    {
+        log_domain_levels_.insert(domain, val);
+        my_settings_.setValue(domain, val);
+    }
+    my_settings_.endGroup();
+    signalLogLevelChanged();
+}
+
+//-----------------------------------------------------------------------
+void ConfigFileHandler::setSipAccountTransport(const QString &transport)
+{
+    sip_account_transport_ = transport;
+    if (!sip_transports_.contains(transport))
+        sip_transports_ << transport;
+}
+
+//-----------------------------------------------------------------------
+void ConfigFileHandler::setSipRegExpires(const int &seconds)
+{
+    sip_reg_expires_ = qMax(seconds, 1);
 }
 
 //-----------------------------------------------------------------------
@@ -315,6 +791,57 @@ QVariant ConfigFileHandler::getOption(const QString &name)
     if (name == "log_level")
         result.setValue(log_level_);
 
+    if (name == "history_max_count")
+        result.setValue(history_max_count_);
+
+    if (name == "history_max_bytes")
+        result.setValue(history_max_bytes_);
+
+    if (name == "js_event_interval")
+        result.setValue(js_event_interval_);
+
+    if (name == "js_profile")
+        result.setValue(js_profile_);
+
+    if (name == "js_slow_call")
+        result.setValue(js_slow_call_);
+
+    if (name == "codecs")
+        result.setValue(codec_priority_);
+
+    if (name == "codecs_exclusive")
+        result.setValue(codecs_exclusive_);
+
+    if (name == "codec_ptime")
+    {
+        QVariantMap ptimes;
+        QMap<QString, int>::const_iterator i;
+        for (i = codec_ptimes_.constBegin(); i != codec_ptimes_.constEnd(); ++i)
+            ptimes.insert(i.key(), i.value());
+        result.setValue(ptimes);
+    }
+
+    if (name == "vad")
+        result.setValue(vad_);
+
+    if (name == "cng")
+        result.setValue(cng_);
+
+    if (name == "null_audio")
+        result.setValue(null_audio_);
+
+    if (name == "play_file")
+        result.setValue(play_file_);
+
+    if (name == "record_dir")
+        result.setValue(record_dir_);
+
+    if (name == "quality_interval")
+        result.setValue(quality_interval_);
+
+    if (name == "mos_threshold")
+        result.setValue(mos_threshold_);
+
     return result;
 }
 
@@ -342,5 +869,99 @@ void ConfigFileHandler::setOption(const QString &name, const QVariant &option)
         my_settings_.beginGroup("application");
         my_settings_.setValue("log_level",log_level_);
         my_settings_.endGroup();
+        signalLogLevelChanged();
+    }
+    if (name == "history_max_count")
+    {
+        history_max_count_ = option.toInt();
+        my_settings_.beginGroup("application");
+        my_settings_.setValue("history_max_count",history_max_count_);
+        my_settings_.endGroup();
+        signalHistoryLimitsChanged();
+    }
+    if (name == "history_max_bytes")
+    {
+        history_max_bytes_ = option.toLongLong();
+        my_settings_.beginGroup("application");
+        my_settings_.setValue("history_max_bytes",history_max_bytes_);
+        my_settings_.endGroup();
+        signalHistoryLimitsChanged();
+    }
+    if (name == "js_event_interval")
+    {
+        js_event_interval_ = option.toInt();
+        my_settings_.beginGroup("application");
+        my_settings_.setValue("js_event_interval",js_event_interval_);
+        my_settings_.endGroup();
+    }
+    if (name == "js_profile")
+    {
+        js_profile_ = option.toBool();
+        my_settings_.beginGroup("application");
+        my_settings_.setValue("js_profile",js_profile_);
+        my_settings_.endGroup();
+    }
+    if (name == "js_slow_call")
+    {
+        js_slow_call_ = qMax(option.toInt(), 0);
+        my_settings_.beginGroup("application");
+        my_settings_.setValue("js_slow_call",js_slow_call_);
+        my_settings_.endGroup();
+    }
+    if (name == "codecs")
+    {
+        codec_priority_ = option.toStringList();
+        saveCodecSettings();
+    }
+    if (name == "codecs_exclusive")
+    {
+        codecs_exclusive_ = option.toBool();
+        saveCodecSettings();
+    }
+    if (name == "codec_ptime")
+    {
+        // a map of codec and ptime, ptime 0 removes the codec
+        QVariantMap ptimes = option.toMap();
+        QVariantMap::const_iterator i;
+        for (i = ptimes.constBegin(); i != ptimes.constEnd(); ++i)
+        {
+            if (i.value().toInt() > 0)
+                codec_ptimes_.insert(i.key(), i.value().toInt());
+            else
+                codec_ptimes_.remove(i.key());
+        }
+        saveCodecSettings();
+    }
+    if (name == "vad")
+    {
+        vad_ = option.toBool();
+        saveCodecSettings();
+    }
+    if (name == "cng")
+    {
+        cng_ = option.toBool();
+        saveCodecSettings();
+    }
+    if (name == "play_file" || name == "record_dir")
+    {
+        if (name == "play_file")
+            play_file_ = option.toString();
+        else
+            record_dir_ = option.toString();
+        my_settings_.beginGroup("media");
+        my_settings_.setValue(name, option.toString());
+        my_settings_.endGroup();
+        signalMediaFilesChanged();
+    }
+    if (name == "quality_interval" || name == "mos_threshold")
+    {
+        if (name == "quality_interval")
+            quality_interval_ = option.toInt();
+        else
+            mos_threshold_ = option.toDouble();
+        my_settings_.beginGroup("media");
+        my_settings_.setValue(name, option);
+        my_settings_.endGroup();
+        signalQualitySettingsChanged();
     }
 }
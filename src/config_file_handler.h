@@ -17,6 +17,8 @@
 #include <QString>
 #include <QUrl>
 #include <QSettings>
+#include <QMap>
+#include <QStringList>
 
 /**
  * This class is implemented as singleton.
@@ -28,12 +30,70 @@ class ConfigFileHandler : public QObject
 
 private:
     int log_level_;
+    QMap<QString, int> log_domain_levels_;
 
     QString file_name_;
     QUrl url_;
     QString stun_;
+    QString rpc_socket_;
+    int metrics_port_;
     QString sound_file_name_;
     QString sound_dial_file_name_;
+    int history_max_count_;
+    int log_queue_size_;
+    int log_flush_size_;
+    int log_flush_interval_;
+    int log_fsync_policy_;
+    qint64 log_max_size_;
+    bool log_compress_;
+    qint64 history_max_bytes_;
+    int js_event_interval_;
+    bool js_profile_;
+    int js_slow_call_;
+
+    QStringList sip_transports_;
+    QString sip_account_transport_;
+    QString sip_bind_address_;
+    int sip_port_;
+    int sip_port_range_;
+    int sip_tls_port_;
+    QString sip_outbound_proxy_;
+    int sip_keep_alive_;
+    QStringList sip_registrars_;
+    int sip_reg_expires_;
+    int sip_reg_failover_timeout_;
+    int sip_reg_retry_interval_;
+    int sip_reg_retry_max_;
+    QString sip_tls_ca_file_;
+    QString sip_tls_cert_file_;
+    QString sip_tls_key_file_;
+
+    QStringList codec_priority_;
+    bool codecs_exclusive_;
+    QMap<QString, int> codec_ptimes_;
+    bool vad_;
+    bool cng_;
+
+    bool null_audio_;
+    QString play_file_;
+    QString record_dir_;
+    int quality_interval_;
+    double mos_threshold_;
+
+    QString media_profile_;
+    QMap<QString, int> media_settings_;
+
+    /**
+     * Media settings of the presets
+     */
+    static const char *MEDIA_KEYS[];
+    static const int LOW_LATENCY_PRESET[];
+    static const int ROBUST_PRESET[];
+
+    /**
+     * Store the codec settings in the settings file
+     */
+    void saveCodecSettings();
 
     QSettings my_settings_;
 
@@ -67,6 +127,19 @@ public:
      */
     const QString &getStunServer() const;
 
+    /**
+     * Get the name of the local socket the headless build listens on
+     * for JSON-RPC clients
+     * @return QString the socket name (a path on unix, a pipe name on windows)
+     */
+    const QString &getRpcSocketName() const;
+
+    /**
+     * Get the localhost tcp port the metrics are served on
+     * @return int the port, 0 if the metrics aren't served
+     */
+    int getMetricsPort() const;
+
     /**
      * Get filename of ringing sound
      * @return QString the ring-filename
@@ -85,6 +158,274 @@ public:
      */
     unsigned getLogLevel() const;
 
+    /**
+     * get the log levels which override the log level for single domains
+     * @return QMap<QString,int> the log level of each overridden domain
+     */
+    const QMap<QString, int> &getLogDomainLevels() const;
+
+    /**
+     * get maximum number of log messages waiting to be written
+     * @return int the number of messages
+     */
+    int getLogQueueSize() const;
+
+    /**
+     * get number of collected bytes after which the log gets written
+     * @return int the size in bytes
+     */
+    int getLogFlushSize() const;
+
+    /**
+     * get time after which collected log messages get written at the latest
+     * @return int the interval in ms
+     */
+    int getLogFlushInterval() const;
+
+    /**
+     * get the fsync policy of the log file (see LogWriter::FSYNC_*)
+     * @return int the policy
+     */
+    int getLogFsyncPolicy() const;
+
+    /**
+     * get the size at which the log file gets rotated
+     * @return qint64 the size in bytes, 0 to only rotate monthly
+     */
+    qint64 getLogMaxSize() const;
+
+    /**
+     * get if rotated log files get compressed
+     * @return bool true if they get compressed
+     */
+    bool getLogCompress() const;
+
+    /**
+     * get maximum number of finished calls kept in the call history
+     * @return int the number of calls
+     */
+    int getHistoryMaxCount() const;
+
+    /**
+     * get maximum memory used by the call history
+     * @return qint64 the size in bytes
+     */
+    qint64 getHistoryMaxBytes() const;
+
+    /**
+     * get how long events for the web page get collected before they
+     * are sent in one batch
+     * @return int the interval in ms, -1 to send every event on its own
+     */
+    int getJsEventInterval() const;
+
+    /**
+     * check if the calls between the web page and the phone get timed,
+     * see BridgeProfiler
+     * @return bool true if the profiler is on
+     */
+    bool getJsProfile() const;
+
+    /**
+     * get the duration from which a call between the web page and the
+     * phone gets reported as slow
+     * @return int the threshold in ms
+     */
+    int getJsSlowCall() const;
+
+    /**
+     * \name SIP transports, they are read at the start only
+     * \{
+     */
+    /**
+     * get the transports to create
+     * @return QStringList "udp", "tcp" and/or "tls"
+     */
+    const QStringList &getSipTransports() const;
+
+    /**
+     * get the transport used by the accounts for registration and calls
+     * @return QString "udp", "tcp" or "tls", the first transport if
+     *         it isn't set
+     */
+    const QString &getSipAccountTransport() const;
+
+    /**
+     * get the local address the transports are bound to
+     * @return QString the address, empty for all interfaces
+     */
+    const QString &getSipBindAddress() const;
+
+    /**
+     * get the port of the udp and tcp transport
+     * @return int the port, 0 for any port
+     */
+    int getSipPort() const;
+
+    /**
+     * get the number of ports tried after getSipPort() if it's in use
+     * @return int the number of ports, 0 to only try getSipPort()
+     */
+    int getSipPortRange() const;
+
+    /**
+     * get the port of the tls transport
+     * @return int the port, 0 for any port
+     */
+    int getSipTlsPort() const;
+
+    /**
+     * get the outbound proxy all requests are sent through
+     * @return QString the proxy host or sip uri, empty for none
+     */
+    const QString &getSipOutboundProxy() const;
+
+    /**
+     * get the interval of the keep-alive packets of the accounts
+     * @return int the interval in seconds, 0 to disable them
+     */
+    int getSipKeepAlive() const;
+
+    /**
+     * get the registrars of the accounts, in the order they get tried
+     * @return QStringList host[:port] of each registrar, empty to register
+     *         at the host of the account
+     */
+    const QStringList &getSipRegistrars() const;
+
+    /**
+     * get the expiry the accounts ask the registrar for
+     * @return int the expiry in seconds
+     */
+    int getSipRegExpires() const;
+
+    /**
+     * get how long a registration may stay unanswered before the next
+     * registrar is tried
+     * @return int the timeout in seconds
+     */
+    int getSipRegFailoverTimeout() const;
+
+    /**
+     * get the wait before registering again after every registrar failed,
+     * it doubles with each round up to getSipRegRetryMax()
+     * @return int the wait in seconds
+     */
+    int getSipRegRetryInterval() const;
+
+    /**
+     * get the longest wait before registering again
+     * @return int the wait in seconds
+     */
+    int getSipRegRetryMax() const;
+
+    /**
+     * get the certificate authorities of the tls transport
+     * @return QString the file name, empty for none
+     */
+    const QString &getSipTlsCaFile() const;
+
+    /**
+     * get the certificate of the tls transport
+     * @return QString the file name, empty for none
+     */
+    const QString &getSipTlsCertFile() const;
+
+    /**
+     * get the private key of the tls transport
+     * @return QString the file name, empty for none
+     */
+    const QString &getSipTlsKeyFile() const;
+    /**
+     * \}
+     */
+
+    /**
+     * \name Codecs, changes get applied to new calls
+     * \{
+     */
+    /**
+     * get the preferred codecs, best first
+     * @return QStringList codec ids or their beginning, e.g. "speex/16000"
+     *         or "PCMU", empty to keep the default order
+     */
+    const QStringList &getCodecPriority() const;
+
+    /**
+     * check if only the codecs of getCodecPriority() may be used
+     * @return bool true if the other codecs are disabled
+     */
+    bool getCodecsExclusive() const;
+
+    /**
+     * get the ptime of single codecs
+     * @return QMap<QString,int> the ptime in ms by codec id (or its beginning)
+     */
+    const QMap<QString, int> &getCodecPtimes() const;
+
+    /**
+     * check if voice activity detection is used, silence isn't sent then
+     * @return bool true if vad is enabled
+     */
+    bool getVad() const;
+
+    /**
+     * check if comfort noise is generated for silence
+     * @return bool true if cng is enabled
+     */
+    bool getCng() const;
+    /**
+     * \}
+     */
+
+    /**
+     * get the media profile, "default", "low_latency" or "robust"
+     * @return QString the name of the profile
+     */
+    const QString &getMediaProfile() const;
+
+    /**
+     * get the media settings of the profile with the overrides of the
+     * config, they are read at the start only. Settings which aren't
+     * there keep the default of pjsip.
+     * @return QMap<QString,int> values by name: clock_rate,
+     *         audio_frame_ptime, snd_rec_latency, snd_play_latency,
+     *         jb_init, jb_min_pre, jb_max_pre, jb_max (all in ms),
+     *         quality, ec_tail_len and plc
+     */
+    const QMap<QString, int> &getMediaSettings() const;
+
+    /**
+     * check if the null sound device is used instead of the real one,
+     * read at the start only
+     * @return bool true for no sound device
+     */
+    bool getNullAudio() const;
+
+    /**
+     * get the wav file played to every call, mixed in with the microphone
+     * @return QString the file name, empty to play none
+     */
+    const QString &getPlayFile() const;
+
+    /**
+     * get the directory the received audio of every call is recorded to
+     * @return QString the directory, empty to record nothing
+     */
+    const QString &getRecordDir() const;
+
+    /**
+     * get how often the quality of active calls gets sampled
+     * @return int the interval in seconds, 0 for never
+     */
+    int getQualityInterval() const;
+
+    /**
+     * get the mean opinion score below which a call has poor quality
+     * @return double the score, 1 to 4.5
+     */
+    double getMosThreshold() const;
+
     /**
      * get config version
      * @return int the config version
@@ -169,6 +510,28 @@ public:
      */
     void setLogLevel(const unsigned &val);
 
+    /**
+     * Set the log level of a single domain
+     * @param domain QString, the log domain, e.g. "pjsip"
+     * @param val int, the log level, -1 to use the default log level again
+     */
+    void setLogDomainLevel(const QString &domain, const int &val);
+
+    /**
+     * Use another transport for the accounts, for this run only, it
+     * doesn't get saved and has to be set before the phone starts
+     * @param transport QString, "udp", "tcp" or "tls", gets added to the
+     *        transports to create
+     */
+    void setSipAccountTransport(const QString &transport);
+
+    /**
+     * Use another registration interval, for this run only, it doesn't
+     * get saved and is used by the accounts registered afterwards
+     * @param seconds int, the expires of the registrations
+     */
+    void setSipRegExpires(const int &seconds);
+
     /**
      * Set position left of window
      * @param val int, the position in pixel
@@ -236,6 +599,31 @@ signals:
      * signals when weppage-url changesp
      */
     void signalWebPageChanged();
+
+    /**
+     * signals when the limits of the call history change
+     */
+    void signalHistoryLimitsChanged();
+
+    /**
+     * signals when the log level or a domain log level changes
+     */
+    void signalLogLevelChanged();
+
+    /**
+     * signals when the codec settings change
+     */
+    void signalCodecsChanged();
+
+    /**
+     * signals when play_file or record_dir change
+     */
+    void signalMediaFilesChanged();
+
+    /**
+     * signals when quality_interval or mos_threshold change
+     */
+    void signalQualitySettingsChanged();
 };
 
 #endif // CONFIG_FILE_HANDLER_H
@@ -0,0 +1,49 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "daemon.h"
+
+#include "sip_phone.h"
+#include "log_handler.h"
+#include "log_info.h"
+
+//----------------------------------------------------------------------
+Daemon::Daemon(QObject *parent)
+    : QObject(parent), phone_(new SipPhone), js_handler_(phone_),
+      rpc_server_(&js_handler_)
+{
+    qRegisterMetaType<LogInfo>("LogInfo");
+
+    connect(&LogHandler::getInstance(),
+            SIGNAL(signalLogMessage(const LogInfo&)),
+            &js_handler_,
+            SLOT(logMessageSlot(const LogInfo&)));
+
+    connect(&js_handler_,
+            SIGNAL(signalEventBatch(const QVariantList&)),
+            &rpc_server_,
+            SLOT(sendEvents(const QVariantList&)));
+
+    // clients get the phoneReady event when the startup is done
+    phone_.init(&js_handler_);
+}
+
+//----------------------------------------------------------------------
+Daemon::~Daemon()
+{
+    phone_.unregister();
+}
+
+//----------------------------------------------------------------------
+bool Daemon::listen(const QString &socket_name)
+{
+    return rpc_server_.listen(socket_name);
+}
@@ -0,0 +1,49 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <QObject>
+
+#include "phone.h"
+#include "javascript_handler.h"
+#include "json_rpc_server.h"
+
+/**
+ * Headless counterpart of the Gui: runs the phone without a web page
+ * and lets local clients control it over JSON-RPC instead.
+ */
+class Daemon : public QObject
+{
+    Q_OBJECT
+
+    Phone phone_;
+    JavascriptHandler js_handler_;
+    JsonRpcServer rpc_server_;
+
+public:
+    /**
+     * Constructor, initializes the phone
+     * @param parent QObject*
+     */
+    Daemon(QObject *parent = 0);
+    ~Daemon();
+
+    /**
+     * Start accepting clients
+     * @param socket_name QString, name of the local socket
+     * @return bool false if the socket can't be used
+     */
+    bool listen(const QString &socket_name);
+};
+
+#endif // DAEMON_H
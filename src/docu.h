@@ -10,6 +10,7 @@ important callstates are:
 - 403 for login data are wrong
 - 408 for timeout, maybe hostname is wrong
 @param state int, the new state of account
+@param account int, the id of the account (see registerAccount)
 \section bsec2 callStateChanged
 Callstates are codes that tells the current status of the call, like calling, 
 confirmed or disconnect. This function gets called every time a callstate gets changed
@@ -22,6 +23,8 @@ the call. The call_id is needed to handle this call in future, like answering it
 or hanging up.
 @param call int, the id of the new call
 @param sip_url string, the number of the new call
+@param name string, the name of the caller
+@param account int, the id of the account which got called
 \section bsec6 getPrintUrl
 This function is called to ask the webapplication for an url to a printable page
 @return string the url
@@ -40,6 +43,15 @@ This function gets called when sound volume gets changed
 \section bsec9 microphoneLevel
 This function gets called when microphone volume gets changed
 @param level int, the current microphone level
+
+GreenJ --bridge-bench [seconds] sends call state and log events to a test
+page at 1000 events/s: as JavaScript source per event, as batches (see
+js_event_interval in \ref pageconfig) and as the signals of
+JavascriptHandler. It prints the time per event and the cpu load of each way.
+
+GreenJ --startup-report starts normally, waits until the phone is ready
+and the page is loaded, then prints when each startup phase got reached
+(see getStartupTimeline()) and the peak resident memory, and quits.
  */
 
 //----------------------------------------------------------------------
@@ -69,12 +81,76 @@ The config file can be found at $HOME"/.lorifon/settings.conf"
 
 The following vars can be interessting:
 - log_level, tells the level needed for logging messages
+- [log_levels] group, the level needed for logging messages of a single
+  domain (e.g. pjsip=0), overrides log_level for that domain
+- log_max_size, the log file gets rotated when it grows beyond this size
+- log_compress, compress rotated log files
+- js_event_interval, events for the web page get collected this many ms
+  and sent in one batch, -1 sends every event on its own; pages without
+  a dispatchEvents() function always get every event on its own
+- js_profile, time every call from the web page into the phone and every
+  JavaScript evaluation of the phone, see getBridgeProfile()
+- js_slow_call, a profiled call taking this many ms or longer gets logged
+  as slow, default 50
+- history_max_count, maximum number of finished calls kept in memory
+- history_max_bytes, maximum memory used by the call history
 - app_minimizeable, allows window to get minimized
 - app_maximizeable, allows window to get maximized
 - app_fullscreenable, allows window to get fullscreen
 - app_resizeable, allows window to get resized
 
 - url, location of the web-page
+- rpc_socket, name of the local socket the daemon (greenjd) listens on,
+  can be overridden with --socket <name>
+- metrics_port, localhost tcp port serving the metrics in the Prometheus
+  text format on /metrics, read at the start only, 0 (default) turns it off
+- [sip] group, read at the start only:
+  - transports, the transports to create (udp, tcp, tls), e.g. "udp, tcp"
+  - account_transport, the transport used for registrations and calls,
+    the first of transports by default
+  - bind_address, local address of the transports, all interfaces if empty
+  - port and port_range, the port of udp and tcp and the number of ports
+    tried after it if it's in use; tls_port for tls
+  - outbound_proxy, host or sip uri every request is sent through
+  - keep_alive, seconds between keep-alive packets of udp accounts
+  - registrars, host[:port] of the registrars in the order they get tried,
+    e.g. "sbc1.example.com, sbc2.example.com"; empty registers at the host
+    of the account. Requests of an account go through its registrar.
+  - reg_expires, seconds of the registration asked for, default 300
+  - reg_failover_timeout, seconds a registrar may leave a registration
+    unanswered before the next one is tried, default 4. An account stays
+    with the registrar which took it.
+  - reg_retry_interval and reg_retry_max, seconds to wait after every
+    registrar failed, doubling from the interval up to the maximum,
+    default 2 and 60
+  - tls_ca_file, tls_cert_file and tls_key_file for tls, the server gets
+    verified if a ca file is given
+- [media] group, also options of getOption()/setOption():
+  - codecs, the preferred codecs, best first, e.g. "speex/16000, PCMU";
+    a codec matches if its id starts with the entry (see getCodecList())
+  - codecs_exclusive, disables the codecs not in codecs
+  - codec_ptime, ptime per codec, e.g. "PCMU:40, speex:20"
+    (a map codec -> ms for setOption())
+  - vad, voice activity detection, silence isn't sent
+  - cng, comfort noise generation
+- [media] group, read at the start only (see getMediaInformation()):
+  - profile, "default" keeps the defaults of pjsip, "low_latency" uses
+    10ms frames, small sound buffers and a small jitter buffer, "robust"
+    larger buffers for lossy links and busy machines
+  - clock_rate, audio_frame_ptime, snd_rec_latency, snd_play_latency,
+    jb_init, jb_min_pre, jb_max_pre, jb_max (ms), quality (1-10),
+    ec_tail_len (ms, 0 disables echo cancellation) and plc (0 or 1)
+    override the value of the profile
+  - null_audio, use no sound device, e.g. for tests on servers
+- [media] group, also options of getOption()/setOption():
+  - play_file, a wav file played to every call, mixed in with the
+    microphone (silent with null_audio)
+  - record_dir, the received audio of every call is recorded to
+    call-<id>-<time>.wav in this directory
+  - quality_interval, seconds between two quality samples of the active
+    calls (see getCallQuality()), 0 to sample never
+  - mos_threshold, the web page gets callQualityChanged when the
+    estimated mos of a call falls below or rises above it
 
 \section Default Config
 In config_file_handler.cpp you can find the default config.
@@ -109,3 +185,67 @@ if (!QFile::exists(file_name_))
 This creates the config-file the first time you start the application. It can be very 
 useful to change to the url to the location of your web-page.
  */
+
+//----------------------------------------------------------------------
+
+/**
+\page pagedaemon The Daemon
+build/greenjd.pro builds greenjd, the phone without GUI and web page. It
+only needs QtCore and QtNetwork and is controlled over a local socket
+(see rpc_socket in \ref pageconfig) with JSON-RPC 2.0, one message per
+line. The methods are the public slots of JavascriptHandler, the events
+of the web page are sent to every client as notifications:
+\code
+--> {"jsonrpc":"2.0","id":1,"method":"makeCall","params":["sip:100@example.org"]}
+<-- {"id":1,"jsonrpc":"2.0","result":0}
+<-- {"jsonrpc":"2.0","method":"callStateChanged","params":[0,1,0]}
+\endcode
+SIGINT and SIGTERM shut greenjd down like a regular exit: the accounts
+get unregistered and the log gets written. A second signal ends it at once.
+
+greenjd --startup-report starts normally, waits until it listens and
+the phone is ready, then prints the startup phases and the peak resident
+memory like GreenJ --startup-report, and quits.
+
+greenjd --codec-bench [seconds] encodes and decodes a reference signal
+with every codec, using the ptime and vad of the config, and prints the
+cpu time per call and the bitrate with and without packet headers.
+
+greenjd --call-table-bench [lookups] looks up live calls after 0 to
+10000 calls have ended, in the call table and in a list of all calls
+like the phone had before, and prints the time per lookup.
+
+greenjd --log-bench [calls] times a filtered out LOG_DEBUG statement
+against building the LogInfo first and passing it to LogHandler::logData().
+It raises the level of the log domain "bench" for the run.
+
+greenjd --log-query-bench [megabytes] writes that much log (300 MB by
+default) into the temp directory and runs queries by status, domain,
+time and text with the block index and as linear scan over every line,
+then prints the time of both and the share of skipped blocks.
+
+greenjd --load-test registers many accounts and makes calls to an echo,
+talks and hangs up, then prints calls per second, setup latency
+percentiles (answer time, including the event interval of the phone),
+cpu and memory:
+\code
+greenjd --load-test [--target host:port] [--accounts 10] [--concurrency 10]
+        [--rate 5] [--calls 100] [--talk 5] [--stand-in-port 5070]
+        [--transport udp|tcp|tls]
+\endcode
+Without --target it starts greenjd --stand-in on loopback, a registrar
+which accepts every account and answers every call with an echo. It
+listens on udp and tcp on the stand-in port, and on tls one port above
+if tls_cert_file and tls_key_file are set. --transport overrides
+account_transport for the run, so running the test once per transport
+compares their setup latency.
+
+greenjd --load-test --register-only [--duration 120] [--reg-expires 30]
+registers the accounts and keeps them registered for the duration, with
+short registration intervals so they get refreshed several times, then
+prints the refreshes, cpu load, cpu time per refresh, max rss and rss
+per account, e.g. with --accounts 500. --reg-expires works for calls too.
+
+Set null_audio (see \ref pageconfig) on
+machines without sound device.
+ */
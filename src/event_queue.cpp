@@ -0,0 +1,152 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "event_queue.h"
+
+#include <string.h>
+
+const int PhoneEvent::TYPE_INCOMING_CALL = 0x00;
+const int PhoneEvent::TYPE_CALL_STATE = 0x01;
+const int PhoneEvent::TYPE_CALL_MEDIA_STATE = 0x02;
+const int PhoneEvent::TYPE_REG_STATE = 0x03;
+const int PhoneEvent::TYPE_REG_STARTED = 0x04;
+
+//----------------------------------------------------------------------
+void PhoneEvent::copyText(char *dest, const char *src, int len)
+{
+    if (!src || len < 0)
+        len = 0;
+    if (len >= TEXT_SIZE)
+        len = TEXT_SIZE - 1;
+
+    if (len > 0)
+        memcpy(dest, src, len);
+    dest[len] = 0;
+}
+
+//----------------------------------------------------------------------
+// Positions are free running counters and may wrap around, so all
+// arithmetic on them is done unsigned.
+//----------------------------------------------------------------------
+static inline int diff(const int &a, const int &b)
+{
+    return (int)((unsigned)a - (unsigned)b);
+}
+
+//----------------------------------------------------------------------
+static inline int add(const int &a, const int &b)
+{
+    return (int)((unsigned)a + (unsigned)b);
+}
+
+//----------------------------------------------------------------------
+EventQueue::EventQueue(int capacity) :
+    dequeue_pos_(0), drained_(0), high_watermark_(0)
+{
+    int size = 2;
+    while (size < capacity)
+        size <<= 1;
+
+    cells_ = new Cell[size];
+    mask_ = size - 1;
+    for (int i = 0; i < size; ++i)
+        cells_[i].sequence_ = i;
+}
+
+//----------------------------------------------------------------------
+EventQueue::~EventQueue()
+{
+    delete[] cells_;
+}
+
+//----------------------------------------------------------------------
+bool EventQueue::push(const PhoneEvent &event)
+{
+    Cell *cell;
+    int pos = enqueue_pos_;
+    for (;;)
+    {
+        cell = &cells_[(unsigned)pos & mask_];
+        int seq = cell->sequence_.fetchAndAddAcquire(0);
+        int dif = diff(seq, pos);
+        if (dif == 0)
+        {
+            if (enqueue_pos_.testAndSetRelaxed(pos, add(pos, 1)))
+                break;
+        }
+        else if (dif < 0)
+        {
+            // the consumer is a full round behind us
+            dropped_.ref();
+            return false;
+        }
+        pos = enqueue_pos_;
+    }
+
+    cell->event_ = event;
+    cell->sequence_.fetchAndStoreRelease(add(pos, 1));
+    pushed_.ref();
+    return true;
+}
+
+//----------------------------------------------------------------------
+bool EventQueue::pop(PhoneEvent &event)
+{
+    Cell *cell = &cells_[(unsigned)dequeue_pos_ & mask_];
+    int seq = cell->sequence_.fetchAndAddAcquire(0);
+    if (diff(seq, add(dequeue_pos_, 1)) < 0)
+        return false;
+
+    int current_depth = depth();
+    if (current_depth > high_watermark_)
+        high_watermark_ = current_depth;
+
+    event = cell->event_;
+    cell->sequence_.fetchAndStoreRelease(add(dequeue_pos_, mask_ + 1));
+    dequeue_pos_ = add(dequeue_pos_, 1);
+    ++drained_;
+    return true;
+}
+
+//----------------------------------------------------------------------
+int EventQueue::depth() const
+{
+    int current_depth = diff(enqueue_pos_, dequeue_pos_);
+    if (current_depth < 0)
+        return 0;
+    if (current_depth > capacity())
+        return capacity();
+    return current_depth;
+}
+
+//----------------------------------------------------------------------
+int EventQueue::capacity() const
+{
+    return mask_ + 1;
+}
+
+//----------------------------------------------------------------------
+void EventQueue::addMerged(const int &count)
+{
+    merged_.fetchAndAddRelaxed(count);
+}
+
+//----------------------------------------------------------------------
+void EventQueue::getStatistics(QVariantMap &stats) const
+{
+    stats.insert("depth", depth());
+    stats.insert("capacity", capacity());
+    stats.insert("highWatermark", high_watermark_);
+    stats.insert("pushed", (int)pushed_);
+    stats.insert("drained", drained_);
+    stats.insert("dropped", (int)dropped_);
+    stats.insert("merged", (int)merged_);
+}
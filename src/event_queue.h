@@ -0,0 +1,140 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+#include <QAtomicInt>
+#include <QVariantMap>
+
+/**
+ * Compact event record passed from the voip-api threads to the gui thread.
+ * It is a plain struct, so pushing it never allocates.
+ */
+struct PhoneEvent
+{
+    /**
+     * \name Event Type
+     * \{
+     */
+    static const int TYPE_INCOMING_CALL;
+    static const int TYPE_CALL_STATE;
+    static const int TYPE_CALL_MEDIA_STATE;
+    static const int TYPE_REG_STATE;
+    static const int TYPE_REG_STARTED;  // a REGISTER went out, url_ has user@host
+    /**
+     * \}
+     */
+
+    /**
+     * maximum length of the text fields, including terminating 0
+     */
+    enum { TEXT_SIZE = 128 };
+
+    int type_;
+    int acc_id_;
+    int call_id_;
+    int state_;
+    int status_;
+    int media_status_;
+    char url_[TEXT_SIZE];
+    char name_[TEXT_SIZE];
+    char text_[TEXT_SIZE];
+
+    /**
+     * Copy a string that is not necessarily null-terminated into
+     * one of the text fields. Truncates if it doesn't fit.
+     * @param dest char*, one of url_, name_ or text_
+     * @param src const char*, the source string
+     * @param len int, length of src
+     */
+    static void copyText(char *dest, const char *src, int len);
+};
+
+/**
+ * Bounded lock-free multi-producer / single-consumer ring buffer for
+ * PhoneEvent records.
+ * Producers (pjsip worker threads) never block and never allocate,
+ * when the queue is full the event is dropped and counted.
+ * The consumer (gui thread) drains the queue in one pass.
+ */
+class EventQueue
+{
+    struct Cell
+    {
+        QAtomicInt sequence_;
+        PhoneEvent event_;
+    };
+
+    Cell *cells_;
+    int mask_;
+
+    QAtomicInt enqueue_pos_;
+    int dequeue_pos_;
+
+    QAtomicInt pushed_;
+    QAtomicInt dropped_;
+    QAtomicInt merged_;
+    int drained_;
+    int high_watermark_;
+
+    EventQueue(const EventQueue&);
+    EventQueue &operator=(const EventQueue&);
+
+public:
+    /**
+     * Constructor
+     * @param capacity int, number of slots, gets rounded up to a power of 2
+     */
+    EventQueue(int capacity = 512);
+    ~EventQueue();
+
+    /**
+     * Push an event into the queue. Safe to call from any thread.
+     * @param event PhoneEvent, the event to copy into the queue
+     * @return bool false if the queue was full and the event got dropped
+     */
+    bool push(const PhoneEvent &event);
+
+    /**
+     * Take the oldest event out of the queue. Only call from the consumer thread.
+     * @param event PhoneEvent, the record to write the event to
+     * @return bool false if the queue is empty
+     */
+    bool pop(PhoneEvent &event);
+
+    /**
+     * Get the number of events currently waiting in the queue
+     * @return int the queue depth
+     */
+    int depth() const;
+
+    /**
+     * Get the number of slots
+     * @return int the capacity
+     */
+    int capacity() const;
+
+    /**
+     * Count events that got merged into a later event while draining
+     * @param count int, the number of merged events
+     */
+    void addMerged(const int &count);
+
+    /**
+     * Get the queue counters (depth, capacity, highWatermark, pushed,
+     * drained, dropped, merged)
+     * @param stats QVariantMap, the map to write the counters to
+     */
+    void getStatistics(QVariantMap &stats) const;
+};
+
+#endif // EVENT_QUEUE_H
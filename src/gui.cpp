@@ -176,6 +176,7 @@ void Gui::slotCreateJSWinObject()
 {
     ui_.webview->page()->mainFrame()->
         addToJavaScriptWindowObject("qt_handler", &js_handler_);
+    js_handler_.windowObjectCleared();
 }
 
 //----------------------------------------------------------------------
@@ -11,22 +11,42 @@
 
 #include "javascript_handler.h"
 
-#include <QWebFrame>
 #include <QString>
-#include <QTextDocument>
+#include <QStringList>
+#include <QElapsedTimer>
+#ifndef GREENJ_HEADLESS
+#include <QWebView>
+#include <QWebFrame>
+
+#include "print_handler.h"
+#endif
 
 #include "call.h"
 #include "phone.h"
-#include "print_handler.h"
 #include "log_info.h"
 #include "log_handler.h"
 #include "account.h"
 #include "config_file_handler.h"
+#include "json.h"
+#include "startup_timeline.h"
+#include "call_timeline.h"
+#include "bridge_profiler.h"
 
 //----------------------------------------------------------------------
 JavascriptHandler::JavascriptHandler(Phone &phone) :
-    phone_(phone), web_view_(0), js_class_handler_("")
+    phone_(phone), print_handler_(0), web_view_(0), js_class_handler_(""),
+    send_call_list_(false), phone_state_(-1)
 {
+    checkPageBatches();
+
+    MetricsRegistry &metrics = MetricsRegistry::getInstance();
+    dispatch_time_ = metrics.histogram("greenj_js_dispatch_seconds",
+                                       "Time to hand a batch of events to the web page");
+    dispatched_events_ = metrics.counter("greenj_js_events_total",
+                                         "Events sent to the web page");
+
+    event_timer_.setSingleShot(true);
+    connect(&event_timer_, SIGNAL(timeout()), this, SLOT(flushEvents()));
 }
 
 //----------------------------------------------------------------------
@@ -34,12 +54,69 @@ void JavascriptHandler::init(QWebView *web_view, PrintHandler *print_handler)
 {
     web_view_ = web_view;
     print_handler_ = print_handler;
+#ifndef GREENJ_HEADLESS
+    connect(web_view_, SIGNAL(loadFinished(bool)), this, SLOT(loadFinishedSlot(bool)));
+#endif
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::windowObjectCleared()
+{
+    event_timer_.stop();
+    pending_events_.clear();
+    send_call_list_ = true;
+
+    // the scripts of the new page aren't loaded yet
+    page_batches_ = false;
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::loadFinishedSlot(bool ok)
+{
+    if (ok)
+    {
+        StartupTimeline::getInstance().mark("page_loaded");
+        checkPageBatches();
+    }
+    if (!ok || !send_call_list_)
+        return;
+    send_call_list_ = false;
+
+    QVariantMap call_list;
+    phone_.getCallListChanges(-1, call_list);
+    if (isConnected(SIGNAL(signalCallListChanged(const QVariantMap&))))
+    {
+        signalCallListChanged(call_list);
+    }
+    else
+    {
+        QVariantList args;
+        args << QVariant(call_list);
+        queueEvent("callListChanged", args);
+    }
+
+    // the page missed the end of the startup
+    if (phone_state_ >= 0)
+        phoneReady(phone_state_ == 1);
 }
 
 //----------------------------------------------------------------------
 QVariant JavascriptHandler::callJavascriptFunc(const QString &func)
 {
     QVariant ret;
+#ifndef GREENJ_HEADLESS
+    if (!web_view_)
+        return ret;
+
+    // named by the called function, e.g. js:dispatchEvents
+    BridgeProfiler::Method *profile_method = 0;
+    if (ConfigFileHandler::getInstance().getJsProfile())
+    {
+        profile_method = BridgeProfiler::getInstance()
+            .getMethod("js:" + func.left(func.indexOf('(')));
+    }
+    BridgeProfiler::Scope profile_scope(profile_method);
+
     if (js_class_handler_.isEmpty())
     {
         ret = web_view_->page()->mainFrame()->evaluateJavaScript(func);
@@ -48,49 +125,239 @@ QVariant JavascriptHandler::callJavascriptFunc(const QString &func)
     {
         ret = web_view_->page()->mainFrame()->evaluateJavaScript(js_class_handler_+"."+func);
     }
+#else
+    Q_UNUSED(func);
+#endif
 
     return ret;
 }
 
 //----------------------------------------------------------------------
-void JavascriptHandler::accountState(const int &state)
+void JavascriptHandler::checkPageBatches()
+{
+#ifndef GREENJ_HEADLESS
+    page_batches_ = false;
+    if (!web_view_)
+        return;
+
+    QString handler = js_class_handler_.isEmpty() ? QString("window") : js_class_handler_;
+    page_batches_ = web_view_->page()->mainFrame()
+        ->evaluateJavaScript("typeof " + handler + ".dispatchEvents == 'function'").toBool();
+#else
+    // no page, the rpc clients take the batches
+    page_batches_ = true;
+#endif
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::queueEvent(const QString &func, const QVariantList &args)
+{
+    int interval = ConfigFileHandler::getInstance().getJsEventInterval();
+    QVariantList event;
+    event << func << QVariant(args);
+
+    // pages without dispatchEvents() still get every event on its own
+    if (interval < 0 || !page_batches_)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        if (receivers(SIGNAL(signalEventBatch(const QVariantList&))) > 0)
+            signalEventBatch(QVariantList() << QVariant(event));
+
+        QStringList arg_list;
+        for (int i = 0; i < args.size(); ++i)
+            arg_list << Json::stringify(args[i]);
+        callJavascriptFunc(func+"("+arg_list.join(",")+")");
+        dispatch_time_->observe(timer.nsecsElapsed() / 1000);
+        dispatched_events_->increment();
+        markIncomingCalls(QVariantList() << QVariant(event));
+        return;
+    }
+
+    pending_events_ << QVariant(event);
+    if (!event_timer_.isActive())
+        event_timer_.start(interval);
+}
+
+//----------------------------------------------------------------------
+bool JavascriptHandler::isConnected(const char *signal)
+{
+    if (receivers(signal) <= 0)
+        return false;
+
+    // events sent the old way have to arrive first
+    if (!pending_events_.isEmpty())
+        flushEvents();
+    return true;
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::flushEvents()
+{
+    event_timer_.stop();
+    if (pending_events_.isEmpty())
+        return;
+
+    QVariantList events = pending_events_;
+    pending_events_.clear();
+    QElapsedTimer timer;
+    timer.start();
+    signalEventBatch(events);
+    callJavascriptFunc("dispatchEvents("+Json::stringify(events)+")");
+    dispatch_time_->observe(timer.nsecsElapsed() / 1000);
+    dispatched_events_->increment(events.size());
+    markIncomingCalls(events);
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::markIncomingCalls(const QVariantList &events)
 {
-    QString state_str(QString::number(state));
+    for (int i = 0; i < events.size(); ++i)
+    {
+        QVariantList event = events[i].toList();
+        if (event.value(0).toString() == "incomingCall")
+        {
+            int call_id = event.value(1).toList().value(0).toInt();
+            CallTimeline::getInstance().mark(call_id, CallTimeline::STAGE_NOTIFIED);
+        }
+    }
+}
 
-    callJavascriptFunc("accountStateChanged("+state_str+")");
+//----------------------------------------------------------------------
+void JavascriptHandler::accountState(const int &acc_id, const int &state)
+{
+    if (isConnected(SIGNAL(signalAccountState(const QVariantMap&))))
+    {
+        QVariantMap event;
+        event.insert("state", state);
+        event.insert("id", acc_id);
+        signalAccountState(event);
+        return;
+    }
+
+    QVariantList args;
+    args << state << acc_id;
+    queueEvent("accountStateChanged", args);
 }
 
 //----------------------------------------------------------------------
 void JavascriptHandler::callState(const int &call_id, const int &code, 
                                   const int &last_status)
 {
-    QString call_str(QString::number(call_id));
-    QString code_str(QString::number(code));
-    QString status_str(QString::number(last_status));
-    callJavascriptFunc("callStateChanged("+call_str+","+code_str+","+status_str+")");
+    if (isConnected(SIGNAL(signalCallState(const QVariantMap&))))
+    {
+        QVariantMap event;
+        event.insert("id", call_id);
+        event.insert("state", code);
+        event.insert("lastStatus", last_status);
+        signalCallState(event);
+        return;
+    }
+
+    QVariantList args;
+    args << call_id << code << last_status;
+    queueEvent("callStateChanged", args);
 }
 
 //----------------------------------------------------------------------
 void JavascriptHandler::incomingCall(const Call &call)
 {
-    QString call_str = QString::number(call.getCallId());
-    QString sip_url = call.getCallUrl();
-    QString name = call.getCallName();
+    if (isConnected(SIGNAL(signalIncomingCall(const QVariantMap&))))
+    {
+        QVariantMap event;
+        event.insert("id", call.getCallId());
+        event.insert("url", call.getCallUrl());
+        event.insert("name", call.getCallName());
+        event.insert("accountId", call.getAccountId());
+        signalIncomingCall(event);
+        CallTimeline::getInstance().mark(call.getCallId(), CallTimeline::STAGE_NOTIFIED);
+        return;
+    }
 
-    callJavascriptFunc("incomingCall("+call_str+",'"+sip_url+"','"+name+"')");
+    QVariantList args;
+    args << call.getCallId() << call.getCallUrl() << call.getCallName()
+         << call.getAccountId();
+    queueEvent("incomingCall", args);
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::callUserDataChanged(const int &call_id, const QVariantMap &user_data)
+{
+    // a string set by the string api reaches the page as the value it was
+    QVariant data = user_data;
+    if (user_data.size() == 1 && user_data.contains(Call::USER_DATA_STRING))
+    {
+        bool ok;
+        QString str = user_data.value(Call::USER_DATA_STRING).toString();
+        data = Json::parse(str, &ok);
+        if (!ok)
+            data = str;
+    }
+
+    if (isConnected(SIGNAL(signalCallUserDataChanged(const QVariantMap&))))
+    {
+        QVariantMap event;
+        event.insert("id", call_id);
+        event.insert("userData", data);
+        signalCallUserDataChanged(event);
+        return;
+    }
+
+    QVariantList args;
+    args << call_id << data;
+    queueEvent("callUserDataChanged", args);
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::callQualityChanged(const int &call_id, const QVariantMap &quality)
+{
+    if (isConnected(SIGNAL(signalCallQuality(const QVariantMap&))))
+    {
+        QVariantMap event;
+        event.insert("id", call_id);
+        event.insert("quality", quality);
+        signalCallQuality(event);
+        return;
+    }
+
+    QVariantList args;
+    args << call_id << quality;
+    queueEvent("callQualityChanged", args);
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::phoneReady(const bool &ok)
+{
+    phone_state_ = ok ? 1 : 0;
+
+    QVariantList timeline;
+    StartupTimeline::getInstance().getPhases(timeline);
+    if (isConnected(SIGNAL(signalPhoneReady(const QVariantMap&))))
+    {
+        QVariantMap event;
+        event.insert("ready", ok);
+        event.insert("timeline", timeline);
+        signalPhoneReady(event);
+        return;
+    }
+
+    QVariantList args;
+    args << ok << QVariant(timeline);
+    queueEvent("phoneReady", args);
 }
 
 //----------------------------------------------------------------------
 QUrl JavascriptHandler::getPrintPage()
 {
+    // events in front of the request have to arrive first
+    flushEvents();
     QVariant url = callJavascriptFunc("getPrintUrl();");
 
     if (!url.convert(QVariant::Url))
     {
         if (!url.isNull())
         {
-            LogInfo info(LogInfo::STATUS_ERROR, "print", 0, "Print Page: Wrong Url Format!");
-            LogHandler::getInstance().logData(info);
+            LOG_ERROR("print", 0, "Print Page: Wrong Url Format!");
         }
         return QUrl("about:blank");
     }
@@ -104,19 +371,23 @@ QUrl JavascriptHandler::getPrintPage()
 //----------------------------------------------------------------------
 int JavascriptHandler::registerJsCallbackHandler(const QString &class_name)
 {
+    PROFILE_BRIDGE_CALL();
     js_class_handler_ = class_name;
+    checkPageBatches();
     return 0;
 }
 
 //----------------------------------------------------------------------
 bool JavascriptHandler::checkAccountStatus()
 {
+    PROFILE_BRIDGE_CALL();
     return phone_.checkAccountStatus();
 }
 
 //----------------------------------------------------------------------
 QVariantMap JavascriptHandler::getAccountInformation()
 {
+    PROFILE_BRIDGE_CALL();
     QVariantMap account_info;
     phone_.getAccountInfo(account_info);
     return account_info;
@@ -126,8 +397,8 @@ QVariantMap JavascriptHandler::getAccountInformation()
 bool JavascriptHandler::registerToServer(QString host, QString user_name,
                                          QString password)
 {
-    LogInfo info(LogInfo::STATUS_DEBUG, "js_handler", 0, "registerToServer");
-    LogHandler::getInstance().logData(info);
+    PROFILE_BRIDGE_CALL();
+    LOG_DEBUG("js_handler", 0, "registerToServer");
 
     Account acc;
     acc.setUserName(user_name);
@@ -140,26 +411,87 @@ bool JavascriptHandler::registerToServer(QString host, QString user_name,
 //----------------------------------------------------------------------
 void JavascriptHandler::unregisterFromServer()
 {
-    LogInfo info(LogInfo::STATUS_DEBUG, "js_handler", 0, "unregisterFromServer");
-    LogHandler::getInstance().logData(info);
+    PROFILE_BRIDGE_CALL();
+    LOG_DEBUG("js_handler", 0, "unregisterFromServer");
 
     phone_.unregister();
 }
 
+//----------------------------------------------------------------------
+int JavascriptHandler::registerAccount(QString host, QString user_name,
+                                       QString password, const int &max_calls)
+{
+    PROFILE_BRIDGE_CALL();
+    LOG_DEBUG("js_handler", 0, "registerAccount");
+
+    Account acc;
+    acc.setUserName(user_name);
+    acc.setPassword(password);
+    acc.setHost(host);
+    acc.setMaxCalls(max_calls);
+
+    return phone_.registerAccount(acc);
+}
+
+//----------------------------------------------------------------------
+bool JavascriptHandler::unregisterAccount(const int &acc_id)
+{
+    PROFILE_BRIDGE_CALL();
+    LOG_DEBUG("js_handler", 0, "unregisterAccount " + QString::number(acc_id));
+
+    return phone_.unregisterAccount(acc_id);
+}
+
+//----------------------------------------------------------------------
+bool JavascriptHandler::setDefaultAccount(const int &acc_id)
+{
+    PROFILE_BRIDGE_CALL();
+    return phone_.setDefaultAccount(acc_id);
+}
+
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::getAccountInformationById(const int &acc_id)
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap account_info;
+    if (phone_.checkAccountStatus(acc_id))
+        phone_.getAccountInfo(account_info, acc_id);
+    return account_info;
+}
+
+//----------------------------------------------------------------------
+QVariantList JavascriptHandler::getAccountList()
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantList accounts;
+    phone_.getAccountList(accounts);
+    return accounts;
+}
+
 //----------------------------------------------------------------------
 int JavascriptHandler::makeCall(const QString &number)
 {
-    LogInfo info(LogInfo::STATUS_DEBUG, "js_handler", 0, "call "+number);
-    LogHandler::getInstance().logData(info);
+    PROFILE_BRIDGE_CALL();
+    LOG_DEBUG("js_handler", 0, "call "+number);
 
     return phone_.makeCall(number);
 }
 
+//----------------------------------------------------------------------
+int JavascriptHandler::makeCallFromAccount(const QString &number, const int &acc_id)
+{
+    PROFILE_BRIDGE_CALL();
+    LOG_DEBUG("js_handler", 0, "call " + number + " from account "
+              + QString::number(acc_id));
+
+    return phone_.makeCall(number, acc_id);
+}
+
 //----------------------------------------------------------------------
 void JavascriptHandler::callAccept(const int &call_id)
 {
-    LogInfo info(LogInfo::STATUS_DEBUG, "js_handler", 0, "accept call "+QString::number(call_id));
-    LogHandler::getInstance().logData(info);
+    PROFILE_BRIDGE_CALL();
+    LOG_DEBUG("js_handler", 0, "accept call "+QString::number(call_id));
 
     phone_.answerCall(call_id);
 }
@@ -167,20 +499,19 @@ void JavascriptHandler::callAccept(const int &call_id)
 //----------------------------------------------------------------------
 void JavascriptHandler::hangup(const int &call_id)
 {
-    LogInfo info(LogInfo::STATUS_DEBUG, "js_handler", 0, "hangup call "+QString::number(call_id));
-    LogHandler::getInstance().logData(info);
+    PROFILE_BRIDGE_CALL();
+    LOG_DEBUG("js_handler", 0, "hangup call "+QString::number(call_id));
 
     phone_.hangUp(call_id);
 
-    LogInfo info2(LogInfo::STATUS_DEBUG, "js_handler", 0, "hangup finished");
-    LogHandler::getInstance().logData(info2);
+    LOG_DEBUG("js_handler", 0, "hangup finished");
 }
 
 //----------------------------------------------------------------------
 void JavascriptHandler::hangupAll()
 {
-    LogInfo info(LogInfo::STATUS_DEBUG, "js_handler", 0, "hangup all ");
-    LogHandler::getInstance().logData(info);
+    PROFILE_BRIDGE_CALL();
+    LOG_DEBUG("js_handler", 0, "hangup all ");
 
     phone_.hangUpAll();
 }
@@ -188,14 +519,29 @@ void JavascriptHandler::hangupAll()
 //----------------------------------------------------------------------
 void JavascriptHandler::setLogLevel(const unsigned &log_level)
 {
+    PROFILE_BRIDGE_CALL();
     LogHandler::getInstance().setLogLevel(log_level);
 }
 
+//----------------------------------------------------------------------
+void JavascriptHandler::setLogDomainLevel(const QString &domain, const int &log_level)
+{
+    PROFILE_BRIDGE_CALL();
+    LogHandler::getInstance().setLogDomainLevel(domain, log_level);
+}
+
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::getLogDomainLevels()
+{
+    PROFILE_BRIDGE_CALL();
+    return LogHandler::getInstance().getLogDomainLevels();
+}
+
 //----------------------------------------------------------------------
 QString JavascriptHandler::getCallUserData(const int &call_id)
 {
-    LogInfo info(LogInfo::STATUS_DEBUG, "js_handler", 0, "Get user data "+QString::number(call_id));
-    LogHandler::getInstance().logData(info);
+    PROFILE_BRIDGE_CALL();
+    LOG_DEBUG("js_handler", 0, "Get user data "+QString::number(call_id));
 
     return phone_.getCallUserData(call_id);
 }
@@ -203,18 +549,65 @@ QString JavascriptHandler::getCallUserData(const int &call_id)
 //----------------------------------------------------------------------
 void JavascriptHandler::setCallUserData(const int &call_id, QString data)
 {
+    PROFILE_BRIDGE_CALL();
 
-    LogInfo info(LogInfo::STATUS_DEBUG, "js_handler", 0, "Set user data "+QString::number(call_id));
-    LogHandler::getInstance().logData(info);
+    LOG_DEBUG("js_handler", 0, "Set user data "+QString::number(call_id));
 
     phone_.setCallUserData(call_id, data);
 }
 
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::getCallUserDataMap(const int &call_id)
+{
+    PROFILE_BRIDGE_CALL();
+    return phone_.getCallUserDataMap(call_id);
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::setCallUserDataMap(const int &call_id, const QVariantMap &data)
+{
+    PROFILE_BRIDGE_CALL();
+    phone_.setCallUserDataMap(call_id, data);
+}
+
+//----------------------------------------------------------------------
+QVariant JavascriptHandler::getCallUserDataField(const int &call_id, const QString &key)
+{
+    PROFILE_BRIDGE_CALL();
+    return phone_.getCallUserDataField(call_id, key);
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::setCallUserDataField(const int &call_id, const QString &key,
+                                             const QVariant &value)
+{
+    PROFILE_BRIDGE_CALL();
+    phone_.setCallUserDataField(call_id, key, value);
+}
+
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::getCallsUserData(const QVariantList &call_ids)
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap result;
+    phone_.getCallsUserData(call_ids, result);
+    return result;
+}
+
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::getCallListChanges(const qint64 &since)
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap result;
+    phone_.getCallListChanges(since, result);
+    return result;
+}
+
 //----------------------------------------------------------------------
 QVariantList JavascriptHandler::getErrorLogData()
 {
-    LogInfo info(LogInfo::STATUS_DEBUG, "js_handler", 0, "Get error log data");
-    LogHandler::getInstance().logData(info);
+    PROFILE_BRIDGE_CALL();
+    LOG_DEBUG("js_handler", 0, "Get error log data");
 
     QVariantList log_data;
     QFile file("error.log");
@@ -235,8 +628,8 @@ QVariantList JavascriptHandler::getErrorLogData()
 //----------------------------------------------------------------------
 void JavascriptHandler::deleteErrorLogFile()
 {
-    LogInfo info(LogInfo::STATUS_DEBUG, "js_handler", 0, "Delete error log file");
-    LogHandler::getInstance().logData(info);
+    PROFILE_BRIDGE_CALL();
+    LOG_DEBUG("js_handler", 0, "Delete error log file");
 
     QFile::remove("error.log");
 }
@@ -244,71 +637,245 @@ void JavascriptHandler::deleteErrorLogFile()
 //----------------------------------------------------------------------
 bool JavascriptHandler::addToConference(const int &src_id, const int &dst_id)
 {
+    PROFILE_BRIDGE_CALL();
     return phone_.addCallToConference(src_id, dst_id);
 }
 
 //----------------------------------------------------------------------
 bool JavascriptHandler::removeFromConference(const int &src_id, const int &dst_id)
 {
+    PROFILE_BRIDGE_CALL();
     return phone_.removeCallFromConference(src_id, dst_id);
 }
 
 //----------------------------------------------------------------------
 int JavascriptHandler::redirectCall(const int &call_id, const QString dst_url)
 {
+    PROFILE_BRIDGE_CALL();
     return phone_.redirectCall(call_id, dst_url);
 }
 
 //----------------------------------------------------------------------
 QVariantList JavascriptHandler::getActiveCallList()
 {
+    PROFILE_BRIDGE_CALL();
     QVariantList call_list;
     phone_.getActiveCallList(call_list);
 
     return call_list;
 }
 
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::getCallHistory(const int &offset, const int &limit,
+                                              const int &type, const int &status)
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap result;
+    phone_.getCallHistory(offset, limit, type, status, result);
+    return result;
+}
+
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::getCallHistoryStatistics()
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap stats;
+    phone_.getCallHistoryStatistics(stats);
+    return stats;
+}
+
 //----------------------------------------------------------------------
 void JavascriptHandler::muteSound(const bool &mute, const int &call_id)
 {
+    PROFILE_BRIDGE_CALL();
   phone_.muteSound(mute, call_id);
 }
 
 //----------------------------------------------------------------------
 void JavascriptHandler::muteMicrophone(const bool &mute, const int &call_id)
 {
+    PROFILE_BRIDGE_CALL();
   phone_.muteMicrophone(mute, call_id);
 }
 
 //----------------------------------------------------------------------
 QVariantMap JavascriptHandler::getSignalInformation()
 {
+    PROFILE_BRIDGE_CALL();
     QVariantMap signal_info;
     phone_.getSignalInformation(signal_info);
     return signal_info;
 }
 
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::getEventQueueStatistics()
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap stats;
+    phone_.getEventStatistics(stats);
+    return stats;
+}
+
+//----------------------------------------------------------------------
+QString JavascriptHandler::getMetrics()
+{
+    PROFILE_BRIDGE_CALL();
+    return phone_.getMetrics();
+}
+
+//----------------------------------------------------------------------
+QVariantList JavascriptHandler::getCodecList()
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantList codecs;
+    phone_.getCodecList(codecs);
+    return codecs;
+}
+
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::getCallQuality(const int &call_id)
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap quality;
+    phone_.getCallQuality(call_id, quality);
+    return quality;
+}
+
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::getMediaInformation()
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap info;
+    phone_.getMediaInformation(info);
+    return info;
+}
+
+//----------------------------------------------------------------------
+bool JavascriptHandler::playFile(const int &call_id, const QString &file)
+{
+    PROFILE_BRIDGE_CALL();
+    return phone_.playFile(call_id, file);
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::stopPlayFile(const int &call_id)
+{
+    PROFILE_BRIDGE_CALL();
+    phone_.stopPlayFile(call_id);
+}
+
+//----------------------------------------------------------------------
+bool JavascriptHandler::recordCall(const int &call_id, const QString &file)
+{
+    PROFILE_BRIDGE_CALL();
+    return phone_.recordCall(call_id, file);
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::stopRecordCall(const int &call_id)
+{
+    PROFILE_BRIDGE_CALL();
+    phone_.stopRecordCall(call_id);
+}
+
+//----------------------------------------------------------------------
+bool JavascriptHandler::isPhoneReady()
+{
+    PROFILE_BRIDGE_CALL();
+    return phone_.isReady();
+}
+
+//----------------------------------------------------------------------
+QVariantList JavascriptHandler::getStartupTimeline()
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantList timeline;
+    StartupTimeline::getInstance().getPhases(timeline);
+    return timeline;
+}
+
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::getLatencyStatistics()
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap stats;
+    CallTimeline::getInstance().getStatistics(stats);
+    return stats;
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::clearLatencyStatistics()
+{
+    PROFILE_BRIDGE_CALL();
+    CallTimeline::getInstance().clearStatistics();
+}
+
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::getBridgeProfile()
+{
+    QVariantMap profile;
+    BridgeProfiler::getInstance().getProfile(profile);
+    return profile;
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::clearBridgeProfile()
+{
+    BridgeProfiler::getInstance().clear();
+}
+
+//----------------------------------------------------------------------
+void JavascriptHandler::logBridgeProfile()
+{
+    BridgeProfiler::getInstance().logProfile();
+}
+
 //----------------------------------------------------------------------
 QVariant JavascriptHandler::getOption(const QString &name)
 {
+    PROFILE_BRIDGE_CALL();
     return ConfigFileHandler::getInstance().getOption(name);
 }
 
 //----------------------------------------------------------------------
 void JavascriptHandler::setOption(const QString &name, const QVariant &option)
 {
+    PROFILE_BRIDGE_CALL();
     ConfigFileHandler::getInstance().setOption(name, option);
 }
 
 //----------------------------------------------------------------------
 void JavascriptHandler::printPage(const QString &url_str)
 {
+    PROFILE_BRIDGE_CALL();
+#ifndef GREENJ_HEADLESS
     QUrl url(url_str);
     print_handler_->loadPrintPage(url);
+#else
+    LOG_WARNING("print", 0, "Printing is not available: " + url_str);
+#endif
 }
 
 //----------------------------------------------------------------------
-bool JavascriptHandler::sendLogMessage(QVariantMap log)
+bool JavascriptHandler::sendLogMessage(const QVariant &log)
+{
+    PROFILE_BRIDGE_CALL();
+    if (log.type() == QVariant::List)
+    {
+        QVariantList list = log.toList();
+        bool result = true;
+        for (int i = 0; i < list.size(); ++i)
+        {
+            if (!sendLogObject(list[i].toMap()))
+                result = false;
+        }
+        return result;
+    }
+    return sendLogObject(log.toMap());
+}
+
+//----------------------------------------------------------------------
+bool JavascriptHandler::sendLogObject(const QVariantMap &log)
 {
     QVariant time = log["time"];
     QVariant status = log["status"];
@@ -333,6 +900,15 @@ bool JavascriptHandler::sendLogMessage(QVariantMap log)
     return true;
 }
 
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::getLogStatistics()
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap stats;
+    LogHandler::getInstance().getStatistics(stats);
+    return stats;
+}
+
 //----------------------------------------------------------------------
 void JavascriptHandler::incomingCallSlot(const Call &call)
 {
@@ -342,40 +918,122 @@ void JavascriptHandler::incomingCallSlot(const Call &call)
 //----------------------------------------------------------------------
 void JavascriptHandler::logMessageSlot(const LogInfo &info)
 {
-    QString json;
-    json.append("{'time':'"+info.time_.toString("dd.MM.yyyy hh:mm:ss")
-                + "','status':"+QString::number(info.status_)+",'domain':'"+info.domain_
-                +"','code':"+QString::number(info.code_)+",'message':'"+info.msg_+"'}");
+    QVariantMap log;
+    log.insert("time", info.time_.toString("dd.MM.yyyy hh:mm:ss"));
+    log.insert("status", info.status_);
+    log.insert("domain", info.domain_);
+    log.insert("code", info.code_);
+    log.insert("message", info.msg_);
+
+    if (isConnected(SIGNAL(signalLogMessage(const QVariantMap&))))
+    {
+        signalLogMessage(log);
+        return;
+    }
 
-    callJavascriptFunc("logMessage("+json+")");
+    QVariantList args;
+    args << QVariant(log);
+    queueEvent("logMessage", args);
 }
 
 //----------------------------------------------------------------------
 void JavascriptHandler::soundLevelSlot(int level)
 {
-    callJavascriptFunc("soundLevel("+QString::number(level)+")");
+    if (isConnected(SIGNAL(signalSoundLevel(const QVariantMap&))))
+    {
+        QVariantMap event;
+        event.insert("level", level);
+        signalSoundLevel(event);
+        return;
+    }
+
+    QVariantList args;
+    args << level;
+    queueEvent("soundLevel", args);
 }
 
 //----------------------------------------------------------------------
 void JavascriptHandler::microphoneLevelSlot(int level)
 {
-    callJavascriptFunc("microphoneLevel("+QString::number(level)+")");
+    if (isConnected(SIGNAL(signalMicrophoneLevel(const QVariantMap&))))
+    {
+        QVariantMap event;
+        event.insert("level", level);
+        signalMicrophoneLevel(event);
+        return;
+    }
+
+    QVariantList args;
+    args << level;
+    queueEvent("microphoneLevel", args);
 }
 
 //----------------------------------------------------------------------
 QStringList JavascriptHandler::getLogFileList()
 {
+    PROFILE_BRIDGE_CALL();
     return LogHandler::getInstance().getLogFileList();
 }
 
 //----------------------------------------------------------------------
 QString JavascriptHandler::getLogFileContent(const QString &file_name)
 {
+    PROFILE_BRIDGE_CALL();
     return LogHandler::getInstance().getLogFileContent(file_name);
 }
 
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::readLogFile(const QString &file_name, const qint64 &offset,
+                                           const qint64 &length)
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap result;
+    LogHandler::getInstance().readLogFile(file_name, offset, length, result);
+    return result;
+}
+
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::tailLogFile(const QString &file_name, const int &count)
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap result;
+    LogHandler::getInstance().readLogFileBackward(file_name, -1, count, result);
+    return result;
+}
+
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::readLogFileBackward(const QString &file_name,
+                                                   const qint64 &end_offset,
+                                                   const int &count)
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap result;
+    LogHandler::getInstance().readLogFileBackward(file_name, end_offset, count, result);
+    return result;
+}
+
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::readLogLines(const QString &file_name, const qint64 &first_line,
+                                            const int &count)
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap result;
+    LogHandler::getInstance().readLogLines(file_name, first_line, count, result);
+    return result;
+}
+
+//----------------------------------------------------------------------
+QVariantMap JavascriptHandler::queryLog(const QVariantMap &query)
+{
+    PROFILE_BRIDGE_CALL();
+    QVariantMap result;
+    LogHandler::getInstance().queryLog(query, result);
+    return result;
+}
+
 //----------------------------------------------------------------------
 void JavascriptHandler::deleteLogFile(const QString &file_name)
 {
+    PROFILE_BRIDGE_CALL();
     LogHandler::getInstance().deleteLogFile(file_name);
 }
@@ -15,16 +15,21 @@
 #include <QObject>
 #include <QString>
 #include <QVariant>
-#include <QWebView>
 #include <QUrl>
+#include <QTimer>
 
+#include "metrics_registry.h"
+
+class QWebView;
 class Phone;
 class PrintHandler;
 class LogInfo;
 class Call;
 
 /**
- * This class should be the bridge between Qt and website-javascript
+ * This class should be the bridge between Qt and website-javascript.
+ * The headless build (GREENJ_HEADLESS) has no web page, there its
+ * slots get called by JsonRpcServer, which also forwards the events.
  */
 class JavascriptHandler : public QObject
 {
@@ -36,12 +41,82 @@ class JavascriptHandler : public QObject
     QWebView *web_view_;
     QString js_class_handler_;
 
+    /**
+     * Events waiting to be sent to the web page, each one is a list
+     * with the name of the handler function and a list of arguments
+     */
+    QVariantList pending_events_;
+    QTimer event_timer_;
+
+    /**
+     * A new page got loaded, it gets the call list when it's ready
+     */
+    bool send_call_list_;
+
+    /**
+     * State of the phone startup, -1 while starting, 0 if it failed,
+     * 1 if the phone is ready
+     */
+    int phone_state_;
+
+    /**
+     * The page has a dispatchEvents() function and takes the events in
+     * batches, otherwise it gets every event on its own
+     */
+    bool page_batches_;
+
+    /**
+     * Time to hand a batch of events to the web page and the signal
+     * receivers, and the number of events sent
+     */
+    MetricsRegistry::Histogram *dispatch_time_;
+    MetricsRegistry::Counter *dispatched_events_;
+
     /**
      * this function do the communication with website-javascript
      * @param func QString, the name of the function to be called
      */
     QVariant callJavascriptFunc(const QString &func);
 
+    /**
+     * Look for dispatchEvents() in the callback handler of the page, or
+     * in the window if the page didn't register a handler
+     */
+    void checkPageBatches();
+
+    /**
+     * Send an event to the web page. Events get collected and sent in one
+     * batch to the dispatchEvents function of the handler, unless the
+     * js_event_interval option is -1 or the handler has no
+     * dispatchEvents function, then the handler function gets called
+     * directly.
+     * @param func QString, the name of the handler function
+     * @param args QVariantList, the arguments of the handler function
+     */
+    void queueEvent(const QString &func, const QVariantList &args);
+
+    /**
+     * Record in the CallTimeline that the incoming calls of some events
+     * reached the web page
+     * @param events QVariantList, events as collected by queueEvent()
+     */
+    static void markIncomingCalls(const QVariantList &events);
+
+    /**
+     * Check if the web page connected to a signal, then the event gets
+     * emitted instead of being sent as JavaScript
+     * @param signal char*, the signal, as given by SIGNAL()
+     * @return bool true if the signal is connected
+     */
+    bool isConnected(const char *signal);
+
+    /**
+     * Convert one log object from js and send it to the log_handler
+     * @param log QVariantMap, the log-object
+     * @return bool false if the object has a wrong format
+     */
+    bool sendLogObject(const QVariantMap &log);
+
 public:
     /**
      * Constructor
@@ -58,9 +133,10 @@ public:
 
     /**
      * Gets a status code by the Phone::callbackCallState
-     * @param call_id int, call ID
+     * @param acc_id int, account ID
+     * @param state int, sip status code of the registration
      */
-    void accountState(const int &state);
+    void accountState(const int &acc_id, const int &state);
 
     /**
      * Gets a status code by the Phone::callbackCallState
@@ -75,12 +151,123 @@ public:
      */
     void incomingCall(const Call &call);
 
+    /**
+     * The user data of a call changed
+     * @param call_id int, call ID
+     * @param user_data QVariantMap, the new user data
+     */
+    void callUserDataChanged(const int &call_id, const QVariantMap &user_data);
+
+    /**
+     * The audio quality of a call got poor or good again
+     * @param call_id int, call ID
+     * @param quality QVariantMap, the last sample (see getCallQuality())
+     */
+    void callQualityChanged(const int &call_id, const QVariantMap &quality);
+
+    /**
+     * The phone finished its startup, a page loaded later gets told
+     * too when it finished loading
+     * @param ok bool, false if the phone can't be used
+     */
+    void phoneReady(const bool &ok);
+
     /**
      * Ask Js for the url to the print page
      * @return QUrl the url to the print page
      */
     QUrl getPrintPage();
 
+    /**
+     * The web page got (re)loaded, drops the events for the old page and
+     * sends the full call list to the new one when it finished loading
+     */
+    void windowObjectCleared();
+
+signals:
+    /**
+     * \name Events for the web page
+     * The web page can connect to these signals, e.g.
+     * qt_handler.signalCallState.connect(function(event) { ... }).
+     * As long as a signal isn't connected its events get sent as
+     * JavaScript calls to the registered callback handler.
+     * \{
+     */
+    /**
+     * @param event QVariantMap, with state and id of the account
+     */
+    void signalAccountState(const QVariantMap &event);
+
+    /**
+     * @param event QVariantMap, with id, state and lastStatus
+     */
+    void signalCallState(const QVariantMap &event);
+
+    /**
+     * @param event QVariantMap, with id, url, name and accountId
+     */
+    void signalIncomingCall(const QVariantMap &event);
+
+    /**
+     * @param event QVariantMap, with time, status, domain, code and message
+     */
+    void signalLogMessage(const QVariantMap &event);
+
+    /**
+     * @param event QVariantMap, with level
+     */
+    void signalSoundLevel(const QVariantMap &event);
+
+    /**
+     * @param event QVariantMap, with level
+     */
+    void signalMicrophoneLevel(const QVariantMap &event);
+
+    /**
+     * @param event QVariantMap, the full call list after a reload of the
+     *        page, see getCallListChanges()
+     */
+    void signalCallListChanged(const QVariantMap &event);
+
+    /**
+     * @param event QVariantMap, with id and userData
+     */
+    void signalCallUserDataChanged(const QVariantMap &event);
+
+    /**
+     * @param event QVariantMap, with id and quality
+     */
+    void signalCallQuality(const QVariantMap &event);
+
+    /**
+     * @param event QVariantMap, with ready and timeline (see
+     *        getStartupTimeline())
+     */
+    void signalPhoneReady(const QVariantMap &event);
+    /**
+     * \}
+     */
+
+    /**
+     * All events sent the JavaScript way (see queueEvent()), for clients
+     * other than the web page
+     * @param events QVariantList, each event is a list with the name of
+     *        the handler function and a list of arguments
+     */
+    void signalEventBatch(const QVariantList &events);
+
+private slots:
+    /**
+     * Send all collected events to the web page
+     */
+    void flushEvents();
+
+    /**
+     * The web page finished loading
+     * @param ok bool, false if loading failed
+     */
+    void loadFinishedSlot(bool ok);
+
 public slots:
 
     /**
@@ -111,10 +298,50 @@ public slots:
     bool registerToServer(QString host, QString user_name, QString password);
 
     /**
-     * unregister client from server
+     * unregister client from server, all accounts get unregistered
      */
     void unregisterFromServer();
 
+    /**
+     * register an additional account
+     * @param host QString, address of server
+     * @param user_name QString, login name
+     * @param password QString, password to login
+     * @param max_calls int, incoming calls get rejected as busy if the
+     *        account has this many calls, 0 for no limit
+     * @return int the id of the account, -1 on error
+     */
+    int registerAccount(QString host, QString user_name, QString password,
+                        const int &max_calls);
+
+    /**
+     * hang up the calls of an account and unregister it
+     * @param acc_id int, the id of the account
+     * @return bool false if there is no such account
+     */
+    bool unregisterAccount(const int &acc_id);
+
+    /**
+     * set the account used when no account is given
+     * @param acc_id int, the id of the account
+     * @return bool false if there is no such account
+     */
+    bool setDefaultAccount(const int &acc_id);
+
+    /**
+     * get information about an account
+     * @param acc_id int, the id of the account
+     * @return QVariantMap object with information, empty if there is
+     *         no such account
+     */
+    QVariantMap getAccountInformationById(const int &acc_id);
+
+    /**
+     * get information about all registered accounts
+     * @return QVariantList object with information for each account
+     */
+    QVariantList getAccountList();
+
     /**
      * starts a call
      * @param number QString, Phonenumber or name to call
@@ -122,6 +349,14 @@ public slots:
      */
     int makeCall(const QString &number);
 
+    /**
+     * starts a call from an account
+     * @param number QString, Phonenumber or name to call
+     * @param acc_id int, the id of the account
+     * @return The ID of the call
+     */
+    int makeCallFromAccount(const QString &number, const int &acc_id);
+
     /**
      * accept the call with given id
      * @param call_id int, id of the call to accept
@@ -144,20 +379,81 @@ public slots:
      */
     void setLogLevel(const unsigned &log_level);
 
+    /**
+     * Set the LogLevel of a single log domain, e.g. "pjsip" or "account"
+     * @param domain QString, the log domain
+     * @param log_level int, the log level, -1 to use the default LogLevel again
+     */
+    void setLogDomainLevel(const QString &domain, const int &log_level);
+
+    /**
+     * Get the LogLevels set for single log domains
+     * @return QVariantMap the log level of each domain with its own level
+     */
+    QVariantMap getLogDomainLevels();
+
     /**
      * get stored data to specific call
      * @param call_id int, the id of the call
-     * @return QString the data
+     * @return QString the data as set, empty if there is none
      */
     QString getCallUserData(const int &call_id);
 
     /**
      * store data to a call
      * @param call_id int, the if of the call
-     * @param data QString, the data to store
+     * @param data QString, the data to store, any string
      */
     void setCallUserData(const int &call_id, QString data);
 
+    /**
+     * get stored data to specific call
+     * @param call_id int, the id of the call
+     * @return QVariantMap the data
+     */
+    QVariantMap getCallUserDataMap(const int &call_id);
+
+    /**
+     * store data to a call, replacing the current data
+     * @param call_id int, the id of the call
+     * @param data QVariantMap, the data to store
+     */
+    void setCallUserDataMap(const int &call_id, const QVariantMap &data);
+
+    /**
+     * get one field of the stored data of a call
+     * @param call_id int, the id of the call
+     * @param key QString, the name of the field
+     * @return QVariant the value, null if the field isn't set
+     */
+    QVariant getCallUserDataField(const int &call_id, const QString &key);
+
+    /**
+     * store one field of the data of a call
+     * @param call_id int, the id of the call
+     * @param key QString, the name of the field
+     * @param value QVariant, the value, null removes the field
+     */
+    void setCallUserDataField(const int &call_id, const QString &key,
+                              const QVariant &value);
+
+    /**
+     * get the stored data of many calls at once
+     * @param call_ids QVariantList, the ids of the calls, empty for all
+     *        active calls
+     * @return QVariantMap the data of each call by id
+     */
+    QVariantMap getCallsUserData(const QVariantList &call_ids);
+
+    /**
+     * Get the active calls which changed since a version of the call list
+     * @param since qint64, the version seen last, -1 for all active calls
+     * @return QVariantMap with version (pass it next time), full (true if
+     *         calls contains all active calls), calls (the changed calls,
+     *         like getActiveCallList) and removed (ids of ended calls)
+     */
+    QVariantMap getCallListChanges(const qint64 &since);
+
     /**
      * get a list of all open calls
      */
@@ -200,6 +496,23 @@ public slots:
      */
     QVariantList getActiveCallList();
 
+    /**
+     * Get a page of finished calls, newest first
+     * @param offset int, number of matching calls to skip
+     * @param limit int, maximum number of calls to return
+     * @param type int, only calls of this type (see Call::TYPE_*), -1 for all
+     * @param status int, only calls with this status (see Call::STATUS_*), -1 for all
+     * @return QVariantMap with total (number of matching calls), offset and calls
+     */
+    QVariantMap getCallHistory(const int &offset, const int &limit,
+                               const int &type = -1, const int &status = -1);
+
+    /**
+     * Get size, memory use and limits of the call history
+     * @return QVariantMap with count, bytes, maxCount, maxBytes and evicted
+     */
+    QVariantMap getCallHistoryStatistics();
+
     /**
      * Switch sound on/off
      * @param mute bool, true if call should be muted
@@ -218,6 +531,128 @@ public slots:
      */
     QVariantMap getSignalInformation();
 
+    /**
+     * Get counters of the event queue between pjsip and gui thread
+     * @return QVariantMap, depth, capacity, highWatermark, pushed, drained,
+     *         dropped and merged events
+     */
+    QVariantMap getEventQueueStatistics();
+
+    /**
+     * Get the metrics of the process, the same as served on metrics_port
+     * @return QString the metrics in the Prometheus text exposition format
+     */
+    QString getMetrics();
+
+    /**
+     * Get the available codecs, their order and settings can be changed
+     * with the options codecs, codecs_exclusive, codec_ptime, vad and cng
+     * @return QVariantList, a map per codec with id, priority, clockRate,
+     *         channels, ptime, bitrate, vad and cng, best first
+     */
+    QVariantList getCodecList();
+
+    /**
+     * Get the media settings in use, they come from the profile of the
+     * [media] group and its overrides
+     * @return QVariantMap, see SipPhone::getMediaInformation(), latencies
+     *         in ms; inputLatency and outputLatency only while the sound
+     *         device is open
+     */
+    QVariantMap getMediaInformation();
+
+    /**
+     * Get the audio quality of a call, sampled every quality_interval
+     * seconds from its rtp/rtcp statistics
+     * @param call_id int, the id of the call
+     * @return QVariantMap with poor (the mos of a direction is below
+     *         mos_threshold), last (the last sample) and history (the
+     *         recent samples, oldest first). A sample has time, rtt (ms,
+     *         -1 before the first rtcp report), rx and tx, each with
+     *         packets, loss (%), jitter (ms), discarded and mos.
+     */
+    QVariantMap getCallQuality(const int &call_id);
+
+    /**
+     * Play a wav file to a call in a loop, mixed in with the microphone
+     * (silent with null_audio). The option play_file does this for every
+     * call.
+     * @param call_id int, the id of the call
+     * @param file QString, the wav file
+     * @return bool false if the file couldn't be played
+     */
+    bool playFile(const int &call_id, const QString &file);
+
+    /**
+     * Stop playing a file to a call, the microphone stays connected
+     * @param call_id int, the id of the call
+     */
+    void stopPlayFile(const int &call_id);
+
+    /**
+     * Record the received audio of a call to a wav file, it's completed
+     * when the call ends. The option record_dir does this for every call.
+     * @param call_id int, the id of the call
+     * @param file QString, the wav file, it gets overwritten
+     * @return bool false if the file couldn't be created
+     */
+    bool recordCall(const int &call_id, const QString &file);
+
+    /**
+     * Stop recording a call
+     * @param call_id int, the id of the call
+     */
+    void stopRecordCall(const int &call_id);
+
+    /**
+     * Check if the phone finished its startup, calls made before
+     * get refused
+     * @return bool true if the phone is ready
+     */
+    bool isPhoneReady();
+
+    /**
+     * Get the phases of the startup reached so far
+     * @return QVariantList, a map per phase with phase, time (ms since
+     *         the start of the application) and duration (ms since the
+     *         phase before)
+     */
+    QVariantList getStartupTimeline();
+
+    /**
+     * Get the setup latency of all calls of this session, from the start
+     * of a call (makeCall or inviteReceived) to each stage: inviteSent,
+     * trying, ringing, progress, answered, mediaActive, firstRtp and for
+     * incoming calls notified. The stages of a single call are in the
+     * timeline of its information (see getActiveCallList()), as ms since
+     * its start.
+     * @return QVariantMap, by stage a map with count, min, max, mean,
+     *         p50, p90, p95 and p99 in ms
+     */
+    QVariantMap getLatencyStatistics();
+
+    /**
+     * Start collecting the latency statistics anew
+     */
+    void clearLatencyStatistics();
+
+    /**
+     * Get the durations of the calls between the web page and the phone,
+     * collected while the js_profile option is on
+     * @return QVariantMap methods and slowCalls, see BridgeProfiler::getProfile()
+     */
+    QVariantMap getBridgeProfile();
+
+    /**
+     * Start collecting the durations of the bridge calls anew
+     */
+    void clearBridgeProfile();
+
+    /**
+     * Write the durations of the bridge calls into the log
+     */
+    void logBridgeProfile();
+
     /**
      * get data of an option
      * @param name QString, the name of the option
@@ -240,9 +675,17 @@ public slots:
 
     /**
      * Get log message from js and send it to the log_handler
-     * @param QVariantMap log, the log-object
+     * @param log QVariant, the log-object or an array of log-objects
+     * @return bool false if (one of) the log-objects has a wrong format
+     */
+    bool sendLogMessage(const QVariant &log);
+
+    /**
+     * Get counters of the log writer
+     * @return QVariantMap, queueDepth, highWatermark, bytesWritten,
+     *         messagesWritten, flushes and dropped messages
      */
-    bool sendLogMessage(QVariantMap log);
+    QVariantMap getLogStatistics();
 
     /**
      * Slot to catch sended signals
@@ -271,6 +714,60 @@ public slots:
 
     QStringList getLogFileList();
     QString getLogFileContent(const QString &file_name);
+
+    /**
+     * Read a part of a log file, the end gets moved back to a line end
+     * @param file_name QString, the name of the log file
+     * @param offset qint64, the offset to start reading
+     * @param length qint64, the maximum number of bytes to read
+     * @return QVariantMap with data, offset, length, next (offset to
+     *         continue reading) and size (of the whole file)
+     */
+    QVariantMap readLogFile(const QString &file_name, const qint64 &offset,
+                            const qint64 &length);
+
+    /**
+     * Read the last lines of a log file
+     * @param file_name QString, the name of the log file
+     * @param count int, the maximum number of lines
+     * @return QVariantMap with lines, offset (to page backwards with
+     *         readLogFileBackward) and size
+     */
+    QVariantMap tailLogFile(const QString &file_name, const int &count);
+
+    /**
+     * Read the lines in front of an offset
+     * @param file_name QString, the name of the log file
+     * @param end_offset qint64, offset returned by the previous page
+     * @param count int, the maximum number of lines
+     * @return QVariantMap with lines, offset (for the page before) and size
+     */
+    QVariantMap readLogFileBackward(const QString &file_name, const qint64 &end_offset,
+                                    const int &count);
+
+    /**
+     * Read lines of a log file by line number
+     * @param file_name QString, the name of the log file
+     * @param first_line qint64, the number of the first line, starting at 0
+     * @param count int, the maximum number of lines
+     * @return QVariantMap with lines, firstLine, next (the line to continue
+     *         with), offset and size
+     */
+    QVariantMap readLogLines(const QString &file_name, const qint64 &first_line,
+                             const int &count);
+
+    /**
+     * Search the log files
+     * @param query QVariantMap, the filter, all keys are optional:
+     *        status (status code or list of status codes), minStatus,
+     *        domain, from and to (ms since epoch), text (part of the message),
+     *        limit (default 1000) and files (default all log files)
+     * @return QVariantMap with matches (each with file, offset, time, status,
+     *         domain, code and message, sorted by time), truncated, files,
+     *         skippedFiles, blocks and skippedBlocks
+     */
+    QVariantMap queryLog(const QVariantMap &query);
+
     void deleteLogFile(const QString &file_name);
 };
 
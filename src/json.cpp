@@ -0,0 +1,330 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "json.h"
+
+#include <QStringList>
+#include <QVariantList>
+#include <QVariantMap>
+#include <qnumeric.h>
+
+const int Json::MAX_DEPTH = 64;
+
+//----------------------------------------------------------------------
+QString Json::stringify(const QVariant &value)
+{
+    QString result;
+    appendValue(value, result);
+    return result;
+}
+
+//----------------------------------------------------------------------
+void Json::appendString(const QString &str, QString &result)
+{
+    result.reserve(result.size() + str.size() + 2);
+    result.append(QLatin1Char('"'));
+    for (int i = 0; i < str.size(); ++i)
+    {
+        const QChar c = str[i];
+        switch (c.unicode())
+        {
+        case '"':
+            result.append(QLatin1String("\\\""));
+            break;
+        case '\\':
+            result.append(QLatin1String("\\\\"));
+            break;
+        case '\n':
+            result.append(QLatin1String("\\n"));
+            break;
+        case '\r':
+            result.append(QLatin1String("\\r"));
+            break;
+        case '\t':
+            result.append(QLatin1String("\\t"));
+            break;
+        default:
+            // control characters and the line separators JavaScript
+            // doesn't allow in string literals
+            if (c.unicode() < 0x20 || c.unicode() == 0x2028 || c.unicode() == 0x2029)
+            {
+                result.append(QString("\\u%1").arg(c.unicode(), 4, 16, QLatin1Char('0')));
+            }
+            else
+            {
+                result.append(c);
+            }
+        }
+    }
+    result.append(QLatin1Char('"'));
+}
+
+//----------------------------------------------------------------------
+void Json::appendValue(const QVariant &value, QString &result)
+{
+    switch (value.type())
+    {
+    case QVariant::Invalid:
+        result.append(QLatin1String("null"));
+        break;
+    case QVariant::Bool:
+        result.append(QLatin1String(value.toBool() ? "true" : "false"));
+        break;
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+        result.append(value.toString());
+        break;
+    case QVariant::Double:
+        if (qIsFinite(value.toDouble()))
+            result.append(QString::number(value.toDouble(), 'g', 15));
+        else
+            result.append(QLatin1String("null"));
+        break;
+    case QVariant::List:
+    case QVariant::StringList:
+    {
+        QVariantList list = value.toList();
+        result.append(QLatin1Char('['));
+        for (int i = 0; i < list.size(); ++i)
+        {
+            if (i > 0)
+                result.append(QLatin1Char(','));
+            appendValue(list[i], result);
+        }
+        result.append(QLatin1Char(']'));
+        break;
+    }
+    case QVariant::Map:
+    {
+        QVariantMap map = value.toMap();
+        result.append(QLatin1Char('{'));
+        QVariantMap::const_iterator i;
+        for (i = map.constBegin(); i != map.constEnd(); ++i)
+        {
+            if (i != map.constBegin())
+                result.append(QLatin1Char(','));
+            appendString(i.key(), result);
+            result.append(QLatin1Char(':'));
+            appendValue(i.value(), result);
+        }
+        result.append(QLatin1Char('}'));
+        break;
+    }
+    default:
+        appendString(value.toString(), result);
+    }
+}
+
+//----------------------------------------------------------------------
+QVariant Json::parse(const QString &json, bool *ok)
+{
+    QVariant result;
+    int pos = 0;
+    bool success = parseValue(json, pos, 0, result);
+    if (success)
+    {
+        skipSpace(json, pos);
+        success = pos == json.size();
+    }
+    if (ok)
+        *ok = success;
+    return success ? result : QVariant();
+}
+
+//----------------------------------------------------------------------
+void Json::skipSpace(const QString &str, int &pos)
+{
+    while (pos < str.size())
+    {
+        ushort c = str[pos].unicode();
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r')
+            break;
+        ++pos;
+    }
+}
+
+//----------------------------------------------------------------------
+bool Json::parseString(const QString &str, int &pos, QString &result)
+{
+    ++pos;
+    int start = pos;
+    // copy plain runs at once, only escapes are handled char by char
+    while (pos < str.size())
+    {
+        ushort c = str[pos].unicode();
+        if (c == '"')
+        {
+            result.append(str.midRef(start, pos - start));
+            ++pos;
+            return true;
+        }
+        if (c != '\\')
+        {
+            ++pos;
+            continue;
+        }
+
+        result.append(str.midRef(start, pos - start));
+        if (++pos >= str.size())
+            return false;
+        switch (str[pos].unicode())
+        {
+        case '"':  result.append(QLatin1Char('"'));  break;
+        case '\\': result.append(QLatin1Char('\\')); break;
+        case '/':  result.append(QLatin1Char('/'));  break;
+        case 'b':  result.append(QLatin1Char('\b')); break;
+        case 'f':  result.append(QLatin1Char('\f')); break;
+        case 'n':  result.append(QLatin1Char('\n')); break;
+        case 'r':  result.append(QLatin1Char('\r')); break;
+        case 't':  result.append(QLatin1Char('\t')); break;
+        case 'u':
+        {
+            bool hex_ok = false;
+            ushort code = str.mid(pos + 1, 4).toUShort(&hex_ok, 16);
+            if (!hex_ok || pos + 4 >= str.size())
+                return false;
+            result.append(QChar(code));
+            pos += 4;
+            break;
+        }
+        default:
+            return false;
+        }
+        start = ++pos;
+    }
+    return false;
+}
+
+//----------------------------------------------------------------------
+bool Json::parseValue(const QString &str, int &pos, const int &depth,
+                      QVariant &result)
+{
+    skipSpace(str, pos);
+    if (pos >= str.size())
+        return false;
+
+    ushort c = str[pos].unicode();
+    if (c == '"')
+    {
+        QString value;
+        if (!parseString(str, pos, value))
+            return false;
+        result = value;
+        return true;
+    }
+    if (c == '{' || c == '[')
+    {
+        if (depth >= MAX_DEPTH)
+            return false;
+
+        bool is_object = c == '{';
+        ushort close = is_object ? '}' : ']';
+        QVariantMap map;
+        QVariantList list;
+        ++pos;
+        skipSpace(str, pos);
+        if (pos < str.size() && str[pos].unicode() == close)
+        {
+            ++pos;
+        }
+        else
+        {
+            while (true)
+            {
+                QString key;
+                if (is_object)
+                {
+                    skipSpace(str, pos);
+                    if (pos >= str.size() || str[pos].unicode() != '"'
+                        || !parseString(str, pos, key))
+                        return false;
+                    skipSpace(str, pos);
+                    if (pos >= str.size() || str[pos].unicode() != ':')
+                        return false;
+                    ++pos;
+                }
+
+                QVariant value;
+                if (!parseValue(str, pos, depth + 1, value))
+                    return false;
+                if (is_object)
+                    map.insert(key, value);
+                else
+                    list << value;
+
+                skipSpace(str, pos);
+                if (pos >= str.size())
+                    return false;
+                ushort next = str[pos++].unicode();
+                if (next == close)
+                    break;
+                if (next != ',')
+                    return false;
+            }
+        }
+        if (is_object)
+            result = map;
+        else
+            result = list;
+        return true;
+    }
+    if (str.midRef(pos, 4) == QLatin1String("true"))
+    {
+        pos += 4;
+        result = true;
+        return true;
+    }
+    if (str.midRef(pos, 5) == QLatin1String("false"))
+    {
+        pos += 5;
+        result = false;
+        return true;
+    }
+    if (str.midRef(pos, 4) == QLatin1String("null"))
+    {
+        pos += 4;
+        result = QVariant();
+        return true;
+    }
+
+    int start = pos;
+    bool integral = true;
+    while (pos < str.size())
+    {
+        ushort d = str[pos].unicode();
+        if (d == '.' || d == 'e' || d == 'E')
+            integral = false;
+        else if ((d < '0' || d > '9') && d != '-' && d != '+')
+            break;
+        ++pos;
+    }
+    if (pos == start)
+        return false;
+
+    QString number = str.mid(start, pos - start);
+    bool number_ok = false;
+    if (integral)
+    {
+        qlonglong value = number.toLongLong(&number_ok);
+        if (number_ok)
+        {
+            result = value;
+            return true;
+        }
+    }
+    double value = number.toDouble(&number_ok);
+    if (!number_ok)
+        return false;
+    result = value;
+    return true;
+}
@@ -0,0 +1,91 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef JSON_H
+#define JSON_H
+
+#include <QString>
+#include <QVariant>
+
+/**
+ * Converts QVariants to JSON and back, the result of stringify can be
+ * used as JavaScript literal too.
+ */
+class Json
+{
+    /**
+     * Append a string as quoted and escaped JSON string
+     * @param str QString, the string
+     * @param result QString, gets the JSON string appended
+     */
+    static void appendString(const QString &str, QString &result);
+
+    /**
+     * Append a value as JSON
+     * @param value QVariant, the value
+     * @param result QString, gets the JSON appended
+     */
+    static void appendValue(const QVariant &value, QString &result);
+
+    /**
+     * Skip white space
+     * @param str QString, the JSON text
+     * @param pos int, the position, gets moved behind the white space
+     */
+    static void skipSpace(const QString &str, int &pos);
+
+    /**
+     * Parse a quoted JSON string
+     * @param str QString, the JSON text
+     * @param pos int, the position of the opening quote, gets moved
+     *        behind the closing quote
+     * @param result QString, gets the unescaped string
+     * @return bool false on a syntax error
+     */
+    static bool parseString(const QString &str, int &pos, QString &result);
+
+    /**
+     * Parse a JSON value
+     * @param str QString, the JSON text
+     * @param pos int, the position of the value, gets moved behind it
+     * @param depth int, nesting depth of the value
+     * @param result QVariant, gets the value
+     * @return bool false on a syntax error
+     */
+    static bool parseValue(const QString &str, int &pos, const int &depth,
+                           QVariant &result);
+
+public:
+    /**
+     * Convert a value to JSON. Maps become objects, lists become arrays,
+     * invalid values become null, everything else becomes a string.
+     * @param value QVariant, the value
+     * @return QString the JSON text
+     */
+    static QString stringify(const QVariant &value);
+
+    /**
+     * Convert JSON to a value. Objects become QVariantMaps, arrays
+     * QVariantLists, numbers doubles (or qlonglongs if they are integral)
+     * and null an invalid QVariant.
+     * @param json QString, the JSON text
+     * @param ok bool*, if not 0 it gets false on a syntax error
+     * @return QVariant the value, invalid on a syntax error
+     */
+    static QVariant parse(const QString &json, bool *ok = 0);
+
+    /**
+     * Maximum nesting depth of arrays and objects parse() accepts
+     */
+    static const int MAX_DEPTH;
+};
+
+#endif // JSON_H
@@ -0,0 +1,335 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "json_rpc_server.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QMetaObject>
+#include <QStringList>
+
+#include "json.h"
+#include "log_handler.h"
+
+const int JsonRpcServer::MAX_MESSAGE_SIZE = 1048576;
+const int JsonRpcServer::MAX_WRITE_BUFFER = 4194304;
+const int JsonRpcServer::MAX_PARAMS = 10;
+
+const int JsonRpcServer::ERROR_PARSE = -32700;
+const int JsonRpcServer::ERROR_INVALID_REQUEST = -32600;
+const int JsonRpcServer::ERROR_METHOD_NOT_FOUND = -32601;
+const int JsonRpcServer::ERROR_INVALID_PARAMS = -32602;
+
+//----------------------------------------------------------------------
+JsonRpcServer::JsonRpcServer(QObject *target, QObject *parent) :
+    QObject(parent), target_(target)
+{
+    server_ = new QLocalServer(this);
+    connect(server_, SIGNAL(newConnection()), this, SLOT(newConnection()));
+    collectMethods();
+}
+
+//----------------------------------------------------------------------
+JsonRpcServer::~JsonRpcServer()
+{
+    server_->close();
+}
+
+//----------------------------------------------------------------------
+void JsonRpcServer::collectMethods()
+{
+    const QMetaObject *meta = target_->metaObject();
+    // the slots of QObject itself, like deleteLater(), aren't offered
+    for (int i = QObject::staticMetaObject.methodCount(); i < meta->methodCount(); ++i)
+    {
+        QMetaMethod method = meta->method(i);
+        if (method.methodType() != QMetaMethod::Slot
+            || method.access() != QMetaMethod::Public
+            || method.parameterTypes().size() > MAX_PARAMS)
+        {
+            continue;
+        }
+
+        QString name = QString::fromLatin1(method.signature());
+        name.truncate(name.indexOf('('));
+        // slots for the signals of the phone
+        if (name.endsWith("Slot"))
+            continue;
+        methods_.insert(name, method);
+    }
+}
+
+//----------------------------------------------------------------------
+bool JsonRpcServer::listen(const QString &name)
+{
+    if (server_->listen(name))
+    {
+        LOG_MESSAGE("rpc", 0, "Listening on " + server_->fullServerName());
+        return true;
+    }
+
+    // the socket may be left over by a crashed process,
+    // it's only removed if nobody answers on it
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    if (probe.waitForConnected(500))
+    {
+        LOG_ERROR("rpc", 0, "Socket " + name + " is used by an other process");
+        return false;
+    }
+
+    QLocalServer::removeServer(name);
+    if (!server_->listen(name))
+    {
+        LOG_ERROR("rpc", 0, "Can't listen on " + name + ": " + server_->errorString());
+        return false;
+    }
+    LOG_MESSAGE("rpc", 0, "Listening on " + server_->fullServerName());
+    return true;
+}
+
+//----------------------------------------------------------------------
+int JsonRpcServer::getClientCount() const
+{
+    return clients_.size();
+}
+
+//----------------------------------------------------------------------
+void JsonRpcServer::newConnection()
+{
+    while (server_->hasPendingConnections())
+    {
+        QLocalSocket *client = server_->nextPendingConnection();
+        clients_.insert(client, QByteArray());
+        connect(client, SIGNAL(readyRead()), this, SLOT(readClient()));
+        connect(client, SIGNAL(disconnected()), this, SLOT(clientDisconnected()));
+        LOG_DEBUG("rpc", 0, "Client connected, "
+                  + QString::number(clients_.size()) + " clients");
+    }
+}
+
+//----------------------------------------------------------------------
+void JsonRpcServer::clientDisconnected()
+{
+    QLocalSocket *client = qobject_cast<QLocalSocket*>(sender());
+    if (!client || !clients_.contains(client))
+        return;
+
+    clients_.remove(client);
+    client->deleteLater();
+    LOG_DEBUG("rpc", 0, "Client disconnected, "
+              + QString::number(clients_.size()) + " clients");
+}
+
+//----------------------------------------------------------------------
+void JsonRpcServer::readClient()
+{
+    QLocalSocket *client = qobject_cast<QLocalSocket*>(sender());
+    if (!client || !clients_.contains(client))
+        return;
+
+    QByteArray &buffer = clients_[client];
+    buffer.append(client->readAll());
+
+    int start = 0;
+    int end;
+    while ((end = buffer.indexOf('\n', start)) >= 0)
+    {
+        QString line = QString::fromUtf8(buffer.constData() + start, end - start).trimmed();
+        start = end + 1;
+        if (line.isEmpty())
+            continue;
+
+        bool ok = false;
+        QVariant message = Json::parse(line, &ok);
+        QVariant response = ok ? handleMessage(message)
+                               : errorResponse(QVariant(), ERROR_PARSE, "Parse error");
+        if (response.isValid())
+            send(client, response);
+
+        // the client may be gone, e.g. after unregister it hung up
+        if (!clients_.contains(client))
+            return;
+    }
+    buffer.remove(0, start);
+
+    if (buffer.size() > MAX_MESSAGE_SIZE)
+    {
+        LOG_WARNING("rpc", 0, "Message too long, closing connection");
+        clients_[client].clear();
+        client->disconnectFromServer();
+    }
+}
+
+//----------------------------------------------------------------------
+QVariant JsonRpcServer::handleMessage(const QVariant &message)
+{
+    if (message.type() == QVariant::Map)
+        return handleRequest(message.toMap());
+
+    if (message.type() != QVariant::List || message.toList().isEmpty())
+        return errorResponse(QVariant(), ERROR_INVALID_REQUEST, "Invalid Request");
+
+    QVariantList requests = message.toList();
+    QVariantList responses;
+    for (int i = 0; i < requests.size(); ++i)
+    {
+        QVariant response = requests[i].type() == QVariant::Map
+            ? handleRequest(requests[i].toMap())
+            : errorResponse(QVariant(), ERROR_INVALID_REQUEST, "Invalid Request");
+        if (response.isValid())
+            responses << response;
+    }
+    if (responses.isEmpty())
+        return QVariant();
+    return responses;
+}
+
+//----------------------------------------------------------------------
+QVariant JsonRpcServer::handleRequest(const QVariantMap &request)
+{
+    bool is_notification = !request.contains("id");
+    QVariant id = request.value("id");
+    QVariant params = request.value("params");
+
+    if (request.value("method").type() != QVariant::String)
+        return errorResponse(id, ERROR_INVALID_REQUEST, "Invalid Request");
+    if (params.isValid() && params.type() != QVariant::List)
+        return errorResponse(id, ERROR_INVALID_PARAMS, "Only positional params are supported");
+
+    QString method = request.value("method").toString();
+    QVariant result;
+    int error = invoke(method, params.toList(), result);
+    if (is_notification)
+        return QVariant();
+
+    if (error == ERROR_METHOD_NOT_FOUND)
+        return errorResponse(id, error, "Method not found: " + method);
+    if (error)
+        return errorResponse(id, error, "Invalid params for " + method);
+
+    QVariantMap response;
+    response.insert("jsonrpc", "2.0");
+    response.insert("id", id);
+    response.insert("result", result);
+    return response;
+}
+
+//----------------------------------------------------------------------
+int JsonRpcServer::invoke(const QString &name, const QVariantList &params,
+                          QVariant &result)
+{
+    QList<QMetaMethod> candidates = methods_.values(name);
+    if (candidates.isEmpty())
+        return ERROR_METHOD_NOT_FOUND;
+
+    for (int c = 0; c < candidates.size(); ++c)
+    {
+        const QMetaMethod &method = candidates[c];
+        QList<QByteArray> types = method.parameterTypes();
+        if (types.size() != params.size())
+            continue;
+
+        // convert the arguments to the parameter types of the slot
+        QVariantList args = params;
+        QGenericArgument generic[10];
+        bool ok = true;
+        for (int i = 0; i < types.size() && ok; ++i)
+        {
+            if (types[i] == "QVariant")
+            {
+                generic[i] = QGenericArgument("QVariant", &args[i]);
+                continue;
+            }
+            int type = QMetaType::type(types[i].constData());
+            ok = type != QMetaType::Void && args[i].convert((QVariant::Type)type);
+            if (ok)
+                generic[i] = QGenericArgument(types[i].constData(), args[i].constData());
+        }
+        if (!ok)
+            return ERROR_INVALID_PARAMS;
+
+        QByteArray return_type = method.typeName();
+        QGenericReturnArgument generic_return;
+        if (return_type == "QVariant")
+        {
+            generic_return = QGenericReturnArgument("QVariant", &result);
+        }
+        else if (!return_type.isEmpty())
+        {
+            result = QVariant(QMetaType::type(return_type.constData()), (const void*)0);
+            generic_return = QGenericReturnArgument(return_type.constData(), result.data());
+        }
+
+        if (!method.invoke(target_, Qt::DirectConnection, generic_return,
+                           generic[0], generic[1], generic[2], generic[3], generic[4],
+                           generic[5], generic[6], generic[7], generic[8], generic[9]))
+        {
+            return ERROR_INVALID_PARAMS;
+        }
+        return 0;
+    }
+    return ERROR_INVALID_PARAMS;
+}
+
+//----------------------------------------------------------------------
+QVariant JsonRpcServer::errorResponse(const QVariant &id, const int &code,
+                                      const QString &message)
+{
+    QVariantMap error;
+    error.insert("code", code);
+    error.insert("message", message);
+
+    QVariantMap response;
+    response.insert("jsonrpc", "2.0");
+    response.insert("id", id);
+    response.insert("error", error);
+    return response;
+}
+
+//----------------------------------------------------------------------
+void JsonRpcServer::send(QLocalSocket *client, const QVariant &message)
+{
+    client->write(Json::stringify(message).toUtf8() + '\n');
+}
+
+//----------------------------------------------------------------------
+void JsonRpcServer::sendEvents(const QVariantList &events)
+{
+    if (clients_.isEmpty())
+        return;
+
+    QByteArray data;
+    for (int i = 0; i < events.size(); ++i)
+    {
+        QVariantList event = events[i].toList();
+        QVariantMap notification;
+        notification.insert("jsonrpc", "2.0");
+        notification.insert("method", event.value(0));
+        notification.insert("params", event.value(1));
+        data.append(Json::stringify(notification).toUtf8());
+        data.append('\n');
+    }
+
+    QList<QLocalSocket*> clients = clients_.keys();
+    for (int i = 0; i < clients.size(); ++i)
+    {
+        // a client which doesn't read its events gets dropped instead
+        // of buffering them without limit
+        if (clients[i]->bytesToWrite() > MAX_WRITE_BUFFER)
+        {
+            LOG_WARNING("rpc", 0, "Client doesn't read its events, closing connection");
+            clients[i]->abort();
+            continue;
+        }
+        clients[i]->write(data);
+    }
+}
@@ -0,0 +1,167 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef JSON_RPC_SERVER_H
+#define JSON_RPC_SERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QMultiHash>
+#include <QMetaMethod>
+#include <QVariant>
+
+class QLocalServer;
+class QLocalSocket;
+
+/**
+ * JSON-RPC 2.0 server on a local socket (a unix domain socket or a
+ * windows named pipe). Every message is one line of JSON.
+ * Requests call the public slots of the target object, e.g. the
+ * JavascriptHandler, by name with positional params. Events get sent to
+ * all clients as notifications, with the name of the JavaScript handler
+ * function as method, e.g.
+ * {"jsonrpc":"2.0","method":"callStateChanged","params":[0,5,200]}
+ */
+class JsonRpcServer : public QObject
+{
+    Q_OBJECT
+
+    QObject *target_;
+    QLocalServer *server_;
+
+    /**
+     * Connected clients and the data received but not yet handled
+     */
+    QHash<QLocalSocket*, QByteArray> clients_;
+
+    /**
+     * Callable slots of the target by name, overloads differ in the
+     * number of parameters
+     */
+    QMultiHash<QString, QMetaMethod> methods_;
+
+    /**
+     * Maximum length of a message, longer ones close the connection
+     */
+    static const int MAX_MESSAGE_SIZE;
+
+    /**
+     * Maximum number of bytes waiting to be sent to a client
+     */
+    static const int MAX_WRITE_BUFFER;
+
+    /**
+     * Maximum number of parameters of a slot
+     */
+    static const int MAX_PARAMS;
+
+    /**
+     * JSON-RPC error codes
+     */
+    static const int ERROR_PARSE;
+    static const int ERROR_INVALID_REQUEST;
+    static const int ERROR_METHOD_NOT_FOUND;
+    static const int ERROR_INVALID_PARAMS;
+
+    /**
+     * Collect the public slots of the target which can be called
+     */
+    void collectMethods();
+
+    /**
+     * Handle one request or a batch of requests
+     * @param message QVariant, the parsed message
+     * @return QVariant the response, invalid if there is none
+     */
+    QVariant handleMessage(const QVariant &message);
+
+    /**
+     * Handle one request
+     * @param request QVariantMap, the request
+     * @return QVariant the response, invalid for notifications
+     */
+    QVariant handleRequest(const QVariantMap &request);
+
+    /**
+     * Call a slot of the target
+     * @param name QString, the name of the slot
+     * @param params QVariantList, the arguments
+     * @param result QVariant, gets the return value
+     * @return int 0 on success, else the JSON-RPC error code
+     */
+    int invoke(const QString &name, const QVariantList &params, QVariant &result);
+
+    /**
+     * Build an error response
+     * @param id QVariant, the id of the request
+     * @param code int, the JSON-RPC error code
+     * @param message QString, the error text
+     * @return QVariant the response
+     */
+    static QVariant errorResponse(const QVariant &id, const int &code,
+                                  const QString &message);
+
+    /**
+     * Send one message to a client
+     * @param client QLocalSocket*, the client
+     * @param message QVariant, the message
+     */
+    void send(QLocalSocket *client, const QVariant &message);
+
+public:
+    /**
+     * Constructor
+     * @param target QObject*, the object whose public slots get called
+     * @param parent QObject*, the parent
+     */
+    JsonRpcServer(QObject *target, QObject *parent = 0);
+    ~JsonRpcServer();
+
+    /**
+     * Start listening, a stale socket of a crashed process gets removed
+     * @param name QString, the name of the socket
+     * @return bool false if the socket can't be created
+     */
+    bool listen(const QString &name);
+
+    /**
+     * Get the number of connected clients
+     * @return int the number of clients
+     */
+    int getClientCount() const;
+
+public slots:
+    /**
+     * Send events as notifications to all clients
+     * @param events QVariantList, each event is a list with the name of
+     *        the handler function and a list of arguments
+     */
+    void sendEvents(const QVariantList &events);
+
+private slots:
+    /**
+     * A client connected
+     */
+    void newConnection();
+
+    /**
+     * A client sent data
+     */
+    void readClient();
+
+    /**
+     * A client disconnected
+     */
+    void clientDisconnected();
+};
+
+#endif // JSON_RPC_SERVER_H
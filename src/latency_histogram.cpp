@@ -0,0 +1,119 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "latency_histogram.h"
+
+#include <math.h>
+
+const int LatencyHistogram::BUCKETS_PER_OCTAVE = 4;
+const int LatencyHistogram::BUCKET_COUNT = 34 * 4 + 2;
+
+//----------------------------------------------------------------------
+LatencyHistogram::LatencyHistogram() :
+    buckets_(BUCKET_COUNT, 0), count_(0), sum_(0), min_(0), max_(0)
+{
+}
+
+//----------------------------------------------------------------------
+int LatencyHistogram::bucketIndex(const qint64 &value)
+{
+    // bucket i > 0 takes (2^((i-1)/4), 2^(i/4)]
+    if (value <= 1)
+        return 0;
+    int index = (int)ceil(log((double)value) / log(2.0) * BUCKETS_PER_OCTAVE);
+    return qBound(1, index, BUCKET_COUNT - 1);
+}
+
+//----------------------------------------------------------------------
+double LatencyHistogram::bucketLimit(const int &index)
+{
+    return pow(2.0, (double)index / BUCKETS_PER_OCTAVE);
+}
+
+//----------------------------------------------------------------------
+void LatencyHistogram::add(const qint64 &value)
+{
+    qint64 v = qMax(value, (qint64)0);
+    ++buckets_[bucketIndex(v)];
+    if (!count_ || v < min_)
+        min_ = v;
+    if (!count_ || v > max_)
+        max_ = v;
+    ++count_;
+    sum_ += v;
+}
+
+//----------------------------------------------------------------------
+void LatencyHistogram::clear()
+{
+    buckets_.fill(0);
+    count_ = 0;
+    sum_ = 0;
+    min_ = 0;
+    max_ = 0;
+}
+
+//----------------------------------------------------------------------
+qint64 LatencyHistogram::getCount() const
+{
+    return count_;
+}
+
+//----------------------------------------------------------------------
+qint64 LatencyHistogram::getSum() const
+{
+    return sum_;
+}
+
+//----------------------------------------------------------------------
+qint64 LatencyHistogram::countAtMost(const double &limit) const
+{
+    qint64 count = 0;
+    for (int i = 0; i < buckets_.size() && bucketLimit(i) <= limit; ++i)
+        count += buckets_[i];
+    return count;
+}
+
+//----------------------------------------------------------------------
+double LatencyHistogram::percentile(const double &percent) const
+{
+    if (!count_)
+        return 0;
+
+    double rank = qBound(0.0, percent, 100.0) / 100.0 * count_;
+    qint64 seen = 0;
+    for (int i = 0; i < buckets_.size(); ++i)
+    {
+        if (!buckets_[i] || seen + buckets_[i] < rank)
+        {
+            seen += buckets_[i];
+            continue;
+        }
+        double lower = i > 0 ? bucketLimit(i - 1) : 0;
+        double upper = bucketLimit(i);
+        double value = lower + (upper - lower) * (rank - seen) / buckets_[i];
+        return qBound((double)min_, value, (double)max_);
+    }
+    return max_;
+}
+
+//----------------------------------------------------------------------
+void LatencyHistogram::getSummary(QVariantMap &summary, const double &unit) const
+{
+    summary.insert("count", count_);
+    summary.insert("min", min_ / unit);
+    summary.insert("max", max_ / unit);
+    summary.insert("mean", count_ ? sum_ / unit / count_ : 0.0);
+    summary.insert("p50", percentile(50) / unit);
+    summary.insert("p90", percentile(90) / unit);
+    summary.insert("p95", percentile(95) / unit);
+    summary.insert("p99", percentile(99) / unit);
+}
@@ -0,0 +1,104 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <QVector>
+#include <QVariantMap>
+
+/**
+ * Histogram of durations in microseconds with logarithmic buckets,
+ * four per doubling, so percentiles are off by less than 19% whatever
+ * the range is, and adding a value never allocates.
+ */
+class LatencyHistogram
+{
+    QVector<qint64> buckets_;
+    qint64 count_;
+    qint64 sum_;
+    qint64 min_;
+    qint64 max_;
+
+    /**
+     * Get the bucket of a value
+     * @param value qint64, the duration in us
+     * @return int the index of the bucket
+     */
+    static int bucketIndex(const qint64 &value);
+
+    /**
+     * Get the upper limit of a bucket
+     * @param index int, the index of the bucket
+     * @return double the largest duration of the bucket in us
+     */
+    static double bucketLimit(const int &index);
+
+public:
+    /**
+     * Buckets per doubling of the duration
+     */
+    static const int BUCKETS_PER_OCTAVE;
+
+    /**
+     * Number of buckets, the last one takes everything above 2^34 us
+     */
+    static const int BUCKET_COUNT;
+
+    LatencyHistogram();
+
+    /**
+     * Add a duration
+     * @param value qint64, the duration in us, negative ones count as 0
+     */
+    void add(const qint64 &value);
+
+    /**
+     * Remove all durations
+     */
+    void clear();
+
+    /**
+     * Get the number of durations
+     * @return qint64 the count
+     */
+    qint64 getCount() const;
+
+    /**
+     * Get the sum of all durations
+     * @return qint64 the sum in us
+     */
+    qint64 getSum() const;
+
+    /**
+     * Count the durations of the buckets which end at or below a limit,
+     * the bucket holding the limit is left out
+     * @param limit double, the duration in us
+     * @return qint64 the count
+     */
+    qint64 countAtMost(const double &limit) const;
+
+    /**
+     * Get a percentile, interpolated within its bucket
+     * @param percent double, 0 to 100
+     * @return double the duration in us, 0 if there are none
+     */
+    double percentile(const double &percent) const;
+
+    /**
+     * Get count, min, max, mean, p50, p90, p95 and p99
+     * @param summary QVariantMap, gets the values
+     * @param unit double, the durations get divided by it, 1000 for ms
+     */
+    void getSummary(QVariantMap &summary, const double &unit = 1000.0) const;
+};
+
+#endif // LATENCY_HISTOGRAM_H
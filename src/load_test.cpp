@@ -0,0 +1,390 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "load_test.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QtAlgorithms>
+#include "sip_phone.h"
+#include "account.h"
+#include "config_file_handler.h"
+#include "log_handler.h"
+#include "process_stats.h"
+
+const int LoadTest::REGISTER_TIMEOUT = 30;
+const int LoadTest::SETUP_TIMEOUT = 32;
+const int LoadTest::HANGUP_TIMEOUT = 10;
+
+//----------------------------------------------------------------------
+LoadTest::LoadTest(const Options &options) :
+    options_(options), phone_api_(0), registered_(0), registration_failed_(0),
+    refreshes_(0), refresh_failed_(0), started_(0), completed_(0), failed_(0),
+    timed_out_(0), finished_(false), calls_start_(-1), cpu_start_(0), start_rss_(0), max_rss_(0)
+{
+    options_.accounts_ = qMax(options_.accounts_, 1);
+    options_.concurrency_ = qMax(options_.concurrency_, 1);
+    options_.rate_ = qMax(options_.rate_, 1);
+    options_.calls_ = qMax(options_.calls_, 1);
+    options_.duration_ = qMax(options_.duration_, 1);
+
+    connect(&call_timer_, SIGNAL(timeout()), this, SLOT(placeCall()));
+    connect(&check_timer_, SIGNAL(timeout()), this, SLOT(check()));
+}
+
+//----------------------------------------------------------------------
+LoadTest::~LoadTest()
+{
+    delete phone_api_;
+    if (stand_in_.state() != QProcess::NotRunning)
+    {
+        stand_in_.kill();
+        stand_in_.waitForFinished();
+    }
+}
+
+//----------------------------------------------------------------------
+bool LoadTest::startStandIn()
+{
+    QStringList args;
+    args << "--stand-in" << QString::number(options_.stand_in_port_);
+    stand_in_.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    stand_in_.start(QCoreApplication::applicationFilePath(), args);
+
+    // it prints a line once it listens
+    if (!stand_in_.waitForStarted() || !stand_in_.waitForReadyRead(10000))
+    {
+        LOG_ERROR("load_test", 0, "Error starting the stand-in registrar");
+        return false;
+    }
+    QTextStream(stdout) << stand_in_.readAll();
+    // the stand-in has tls one port above udp and tcp
+    int port = options_.stand_in_port_;
+    if (ConfigFileHandler::getInstance().getSipAccountTransport() == "tls")
+        ++port;
+    target_ = "127.0.0.1:" + QString::number(port);
+    return true;
+}
+
+//----------------------------------------------------------------------
+bool LoadTest::start()
+{
+    ConfigFileHandler &config = ConfigFileHandler::getInstance();
+    if (!options_.transport_.isEmpty())
+        config.setSipAccountTransport(options_.transport_);
+    if (options_.reg_expires_ > 0)
+        config.setSipRegExpires(options_.reg_expires_);
+
+    target_ = options_.target_;
+    if (target_.isEmpty() && !startStandIn())
+        return false;
+
+    if (!config.getNullAudio())
+        QTextStream(stdout) << "null_audio isn't set, the calls use the sound device\n";
+
+    phone_api_ = new SipPhone();
+    connect(phone_api_, SIGNAL(signalAccountRegState(const int&, const int&)),
+            this, SLOT(accountRegState(const int&, const int&)));
+    connect(phone_api_, SIGNAL(signalCallState(int, int, int)),
+            this, SLOT(callState(int, int, int)));
+    if (!phone_api_->init())
+        return false;
+    phone_api_->start();
+    start_rss_ = ProcessStats::getResidentSize();
+
+    time_.start();
+    for (int i = 0; i < options_.accounts_; ++i)
+    {
+        Account acc;
+        acc.setUserName("load" + QString::number(i));
+        acc.setPassword("load");
+        acc.setHost(target_);
+        int acc_id = phone_api_->registerUser(acc);
+        if (acc_id < 0)
+            ++registration_failed_;
+        else
+            accounts_ << acc_id;
+    }
+    if (accounts_.isEmpty())
+        return false;
+
+    check_timer_.start(100);
+    return true;
+}
+
+//----------------------------------------------------------------------
+void LoadTest::accountRegState(const int &acc_id, const int &state)
+{
+    if (!accounts_.contains(acc_id))
+        return;
+
+    // after the first round every result is a refresh
+    if (calls_start_ >= 0)
+    {
+        if (!options_.register_only_ || finished_)
+            return;
+        if (state < 300)
+            ++refreshes_;
+        else
+            ++refresh_failed_;
+        return;
+    }
+
+    if (state < 300)
+        ++registered_;
+    else
+        ++registration_failed_;
+
+    if (registered_ + registration_failed_ >= options_.accounts_)
+        startCalls();
+}
+
+//----------------------------------------------------------------------
+void LoadTest::startCalls()
+{
+    QTextStream(stdout) << "registered " << registered_ << " of " << options_.accounts_
+                        << " accounts in " << time_.elapsed() << " ms\n";
+
+    calls_start_ = time_.elapsed();
+    cpu_start_ = ProcessStats::getCpuTime();
+    if (options_.register_only_)
+    {
+        QTextStream(stdout) << "holding the registrations for " << options_.duration_
+                            << " s, expires " << ConfigFileHandler::getInstance().getSipRegExpires()
+                            << " s\n";
+        return;
+    }
+    call_timer_.start(qMax(1000 / options_.rate_, 1));
+}
+
+//----------------------------------------------------------------------
+void LoadTest::placeCall()
+{
+    if (started_ >= options_.calls_)
+    {
+        call_timer_.stop();
+        return;
+    }
+    if (calls_.size() >= options_.concurrency_)
+        return;
+
+    CallEntry entry;
+    entry.start_ = time_.elapsed();
+    entry.confirmed_ = -1;
+    entry.hangup_ = -1;
+    int acc_id = accounts_[started_ % accounts_.size()];
+    ++started_;
+
+    int call_id = phone_api_->makeCall("sip:echo@" + target_, acc_id);
+    if (call_id < 0)
+    {
+        ++failed_;
+        if (completed_ + failed_ >= options_.calls_)
+            finish();
+        return;
+    }
+    calls_.insert(call_id, entry);
+}
+
+//----------------------------------------------------------------------
+void LoadTest::callState(int call_id, int state, int last_status)
+{
+    Q_UNUSED(last_status);
+
+    QMap<int, CallEntry>::iterator i = calls_.find(call_id);
+    if (i == calls_.end())
+        return;
+
+    // an answer after the setup timeout doesn't count any more
+    if (state == PJSIP_INV_STATE_CONFIRMED && i.value().confirmed_ < 0
+        && i.value().hangup_ < 0)
+    {
+        i.value().confirmed_ = time_.elapsed();
+        setup_times_ << i.value().confirmed_ - i.value().start_;
+    }
+    else if (state == PJSIP_INV_STATE_DISCONNECTED)
+    {
+        if (i.value().confirmed_ < 0)
+            ++failed_;
+        else
+            ++completed_;
+        calls_.erase(i);
+
+        if (completed_ + failed_ >= options_.calls_)
+            finish();
+    }
+}
+
+//----------------------------------------------------------------------
+void LoadTest::check()
+{
+    max_rss_ = qMax(max_rss_, ProcessStats::getResidentSize());
+
+    if (calls_start_ < 0)
+    {
+        if (time_.elapsed() > REGISTER_TIMEOUT * 1000)
+        {
+            LOG_WARNING("load_test", 0, "Not all accounts got registered");
+            startCalls();
+        }
+        return;
+    }
+
+    qint64 now = time_.elapsed();
+    if (options_.register_only_)
+    {
+        if (now - calls_start_ >= options_.duration_ * 1000)
+            finish();
+        return;
+    }
+
+    // every call gets hung up once, a call which doesn't end after
+    // that is given up, so the test always ends
+    QMap<int, CallEntry>::iterator i = calls_.begin();
+    QList<int> hang_up;
+    while (i != calls_.end())
+    {
+        CallEntry &entry = i.value();
+        if (entry.hangup_ >= 0)
+        {
+            if (now - entry.hangup_ >= HANGUP_TIMEOUT * 1000)
+            {
+                // a call without answer already timed out in the setup
+                if (entry.confirmed_ >= 0)
+                    ++timed_out_;
+                ++failed_;
+                i = calls_.erase(i);
+                continue;
+            }
+        }
+        else if (entry.confirmed_ >= 0)
+        {
+            if (now - entry.confirmed_ >= options_.talk_ * 1000)
+                hang_up << i.key();
+        }
+        else if (now - entry.start_ >= SETUP_TIMEOUT * 1000)
+        {
+            ++timed_out_;
+            hang_up << i.key();
+        }
+        ++i;
+    }
+    for (int j = 0; j < hang_up.size(); ++j)
+    {
+        calls_[hang_up[j]].hangup_ = now;
+        phone_api_->hangUp(hang_up[j]);
+    }
+
+    if (completed_ + failed_ >= options_.calls_)
+        finish();
+}
+
+//----------------------------------------------------------------------
+qint64 LoadTest::percentile(const QList<qint64> &values, const int &percent)
+{
+    if (values.isEmpty())
+        return 0;
+    return values[(values.size() - 1) * percent / 100];
+}
+
+//----------------------------------------------------------------------
+void LoadTest::getResults(QVariantMap &results) const
+{
+    QList<qint64> setup_times = setup_times_;
+    qSort(setup_times);
+
+    double seconds = (time_.elapsed() - calls_start_) / 1000.0;
+    qint64 cpu = ProcessStats::getCpuTime();
+
+    results.insert("transport", ConfigFileHandler::getInstance().getSipAccountTransport());
+    results.insert("calls", started_);
+    results.insert("completed", completed_);
+    results.insert("failed", failed_);
+    results.insert("timedOut", timed_out_);
+    results.insert("callsPerSecond", seconds > 0 ? completed_ / seconds : 0.0);
+    results.insert("setupP50", percentile(setup_times, 50));
+    results.insert("setupP90", percentile(setup_times, 90));
+    results.insert("setupP99", percentile(setup_times, 99));
+    results.insert("setupMax", percentile(setup_times, 100));
+    results.insert("cpuPercent", cpu >= 0 && seconds > 0
+                                 ? (cpu - cpu_start_) / (seconds * 10000.0) : -1.0);
+    results.insert("maxRss", max_rss_);
+
+    if (options_.register_only_)
+    {
+        results.insert("accounts", options_.accounts_);
+        results.insert("registered", registered_);
+        results.insert("refreshes", refreshes_);
+        results.insert("refreshFailures", refresh_failed_);
+        results.insert("cpuPerRefreshUs", cpu >= 0 && refreshes_ > 0
+                                          ? (double)(cpu - cpu_start_) / refreshes_ : -1.0);
+        results.insert("rssPerAccount", registered_ > 0
+                                        ? (max_rss_ - start_rss_) / registered_ : 0);
+    }
+}
+
+//----------------------------------------------------------------------
+void LoadTest::printRegistrationResults(const QVariantMap &results) const
+{
+    QTextStream out(stdout);
+    double seconds = (time_.elapsed() - calls_start_) / 1000.0;
+    int refreshes = results.value("refreshes").toInt();
+    out << "transport " << results.value("transport").toString() << "\n"
+        << "registered " << results.value("registered").toInt()
+        << " of " << results.value("accounts").toInt() << " accounts\n"
+        << "refreshes " << refreshes
+        << ", failed " << results.value("refreshFailures").toInt()
+        << ", per s " << QString::number(seconds > 0 ? refreshes / seconds : 0.0, 'f', 2) << "\n"
+        << "cpu " << QString::number(results.value("cpuPercent").toDouble(), 'f', 2) << " %"
+        << ", per refresh "
+        << QString::number(results.value("cpuPerRefreshUs").toDouble(), 'f', 0) << " us\n"
+        << "max rss " << results.value("maxRss").toLongLong() / 1024 << " kB"
+        << ", per account "
+        << QString::number(results.value("rssPerAccount").toLongLong() / 1024.0, 'f', 1) << " kB\n";
+}
+
+//----------------------------------------------------------------------
+void LoadTest::finish()
+{
+    if (finished_)
+        return;
+    finished_ = true;
+    call_timer_.stop();
+    check_timer_.stop();
+
+    QVariantMap r;
+    getResults(r);
+    if (options_.register_only_)
+    {
+        printRegistrationResults(r);
+        phone_api_->unregister();
+        QCoreApplication::exit(registration_failed_ + refresh_failed_ > 0 ? 1 : 0);
+        return;
+    }
+
+    QTextStream out(stdout);
+    out << "transport " << r.value("transport").toString() << "\n"
+        << "calls " << r.value("calls").toInt()
+        << ", completed " << r.value("completed").toInt()
+        << ", failed " << r.value("failed").toInt()
+        << ", timed out " << r.value("timedOut").toInt() << "\n"
+        << "calls/s " << QString::number(r.value("callsPerSecond").toDouble(), 'f', 2) << "\n"
+        << "setup ms p50 " << r.value("setupP50").toLongLong()
+        << ", p90 " << r.value("setupP90").toLongLong()
+        << ", p99 " << r.value("setupP99").toLongLong()
+        << ", max " << r.value("setupMax").toLongLong() << "\n"
+        << "cpu " << QString::number(r.value("cpuPercent").toDouble(), 'f', 1) << " %"
+        << ", max rss " << r.value("maxRss").toLongLong() / 1024 << " kB\n";
+
+    phone_api_->unregister();
+    QCoreApplication::exit(failed_ > 0 ? 1 : 0);
+}
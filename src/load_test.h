@@ -0,0 +1,219 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef LOAD_TEST_H
+#define LOAD_TEST_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QList>
+#include <QMap>
+#include <QVariantMap>
+
+class PhoneApi;
+
+/**
+ * Drives the phone through register, make call, talk and hang up with
+ * many accounts, at a fixed call rate and concurrency, and reports
+ * calls per second, setup latency, cpu and memory, over one transport
+ * per run. With register_only_ it measures the cpu of the REGISTER
+ * refreshes and the memory of the accounts instead. Without a target it
+ * starts a StandInRegistrar on loopback. greenjd runs it with --load-test.
+ */
+class LoadTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options
+    {
+        /**
+         * host:port of the registrar, empty to start a stand-in
+         */
+        QString target_;
+        int stand_in_port_;
+
+        /**
+         * "udp", "tcp" or "tls", empty for the account transport of the config
+         */
+        QString transport_;
+        int accounts_;
+        int concurrency_;
+
+        /**
+         * new calls per second
+         */
+        int rate_;
+        int calls_;
+
+        /**
+         * seconds a call stays up after it got answered
+         */
+        int talk_;
+
+        /**
+         * only register the accounts and keep them registered for
+         * duration_ seconds, no calls
+         */
+        bool register_only_;
+        int duration_;
+
+        /**
+         * expires of the registrations in seconds, 0 for the config's
+         */
+        int reg_expires_;
+    };
+
+private:
+    struct CallEntry
+    {
+        qint64 start_;
+        qint64 confirmed_;
+
+        /**
+         * time the hangup got sent, -1 before
+         */
+        qint64 hangup_;
+    };
+
+    Options options_;
+    PhoneApi *phone_api_;
+    QProcess stand_in_;
+    QString target_;
+
+    QList<int> accounts_;
+    int registered_;
+    int registration_failed_;
+    int refreshes_;
+    int refresh_failed_;
+
+    QMap<int, CallEntry> calls_;
+    int started_;
+    int completed_;
+    int failed_;
+
+    /**
+     * calls which didn't get set up or torn down in time, they count as
+     * failed too
+     */
+    int timed_out_;
+    QList<qint64> setup_times_;
+    bool finished_;
+
+    QElapsedTimer time_;
+
+    /**
+     * start of the calls, or of holding the registrations, -1 before
+     */
+    qint64 calls_start_;
+    qint64 cpu_start_;
+    qint64 start_rss_;
+    qint64 max_rss_;
+    QTimer call_timer_;
+    QTimer check_timer_;
+
+    /**
+     * Start the stand-in registrar as own process and wait until it listens
+     * @return bool false if it didn't start
+     */
+    bool startStandIn();
+
+    /**
+     * Start placing calls, or start holding the registrations, once all
+     * accounts got their registration result
+     */
+    void startCalls();
+
+    /**
+     * Print the results of holding the registrations
+     * @param results QVariantMap, see getResults()
+     */
+    void printRegistrationResults(const QVariantMap &results) const;
+
+    /**
+     * Print the results, shut the phone down and leave the event loop
+     */
+    void finish();
+
+    /**
+     * Get a percentile of sorted values
+     * @param values QList<qint64>, the sorted values
+     * @param percent int, the percentile
+     * @return qint64 the value, 0 without values
+     */
+    static qint64 percentile(const QList<qint64> &values, const int &percent);
+
+private slots:
+    void accountRegState(const int &acc_id, const int &state);
+    void callState(int call_id, int state, int last_status);
+
+    /**
+     * Place the next call if the concurrency allows it
+     */
+    void placeCall();
+
+    /**
+     * Hang up calls which talked long enough or didn't get answered
+     * within SETUP_TIMEOUT, give up on calls which didn't end within
+     * HANGUP_TIMEOUT after the hangup, sample the memory, give up on
+     * registration after REGISTER_TIMEOUT and end holding the
+     * registrations after the duration
+     */
+    void check();
+
+public:
+    /**
+     * Seconds to wait for the registration of all accounts
+     */
+    static const int REGISTER_TIMEOUT;
+
+    /**
+     * Seconds to wait for a call to get answered
+     */
+    static const int SETUP_TIMEOUT;
+
+    /**
+     * Seconds to wait for a call to end after it got hung up
+     */
+    static const int HANGUP_TIMEOUT;
+
+    /**
+     * Constructor
+     * @param options Options, what to run
+     */
+    LoadTest(const Options &options);
+
+    /**
+     * Destructor, stops the stand-in
+     */
+    ~LoadTest();
+
+    /**
+     * Start the test, it runs in the event loop and calls
+     * QCoreApplication::exit() when it's done
+     * @return bool false if the phone or the stand-in couldn't be started
+     */
+    bool start();
+
+    /**
+     * Get the results of the last run
+     * @param results QVariantMap, gets transport, calls, completed, failed,
+     *        timedOut, callsPerSecond, setupP50, setupP90, setupP99, setupMax (ms),
+     *        cpuPercent and maxRss (bytes); with register_only_ also
+     *        accounts, registered, refreshes, refreshFailures,
+     *        cpuPerRefreshUs and rssPerAccount (bytes)
+     */
+    void getResults(QVariantMap &results) const;
+};
+
+#endif // LOAD_TEST_H
@@ -0,0 +1,76 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "log_bench.h"
+
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include "config_file_handler.h"
+#include "log_handler.h"
+
+const QString LogBench::BENCH_DOMAIN = "bench";
+
+//----------------------------------------------------------------------
+LogBench::LogBench(const int &calls) :
+    calls_(calls > 0 ? calls : 1000000)
+{
+}
+
+//----------------------------------------------------------------------
+bool LogBench::run(QVariantMap &results)
+{
+    ConfigFileHandler &config = ConfigFileHandler::getInstance();
+    LogHandler &log_handler = LogHandler::getInstance();
+
+    // filter debug messages of the domain out, the config gets its
+    // level back afterwards
+    int old_level = config.getLogDomainLevels().value(BENCH_DOMAIN, -1);
+    config.setLogDomainLevel(BENCH_DOMAIN, LogInfo::STATUS_MESSAGE);
+    if (LogHandler::isLogged(LogInfo::STATUS_DEBUG, LogHandler::getDomainLevel(BENCH_DOMAIN)))
+    {
+        LOG_ERROR("bench", 0, "Debug messages of " + BENCH_DOMAIN + " don't get filtered out");
+        config.setLogDomainLevel(BENCH_DOMAIN, old_level);
+        return false;
+    }
+
+    // a typical statement, see SipPhone::callStateCb()
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < calls_; ++i)
+        LOG_DEBUG("bench", i, "Call-state from call " + QString::number(i % 32));
+    qint64 macro_ns = timer.nsecsElapsed();
+
+    timer.restart();
+    for (int i = 0; i < calls_; ++i)
+    {
+        LogInfo info(LogInfo::STATUS_DEBUG, BENCH_DOMAIN, i,
+                     "Call-state from call " + QString::number(i % 32));
+        log_handler.logData(info);
+    }
+    qint64 eager_ns = timer.nsecsElapsed();
+
+    config.setLogDomainLevel(BENCH_DOMAIN, old_level);
+
+    results.insert("calls", calls_);
+    results.insert("macroNs", (double)macro_ns / calls_);
+    results.insert("eagerNs", (double)eager_ns / calls_);
+
+    QTextStream out(stdout);
+    out << QString("way").leftJustified(28) << QString("ns").rightJustified(10) << "\n"
+        << QString("LOG_DEBUG").leftJustified(28)
+        << QString::number(results.value("macroNs").toDouble(), 'f', 1).rightJustified(10) << "\n"
+        << QString("LogInfo and logData()").leftJustified(28)
+        << QString::number(results.value("eagerNs").toDouble(), 'f', 1).rightJustified(10) << "\n"
+        << "time per filtered out debug statement, " << calls_ << " statements each;"
+        << " with GREENJ_LOG_MIN_LEVEL above 0 LOG_DEBUG compiles to nothing\n";
+    return true;
+}
@@ -0,0 +1,49 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef LOG_BENCH_H
+#define LOG_BENCH_H
+
+#include <QVariantMap>
+
+/**
+ * Measures the cost of a log statement whose level is filtered out: the
+ * LOG_DEBUG macro against building the LogInfo first and passing it to
+ * LogHandler::logData(), like the statements did before the macros.
+ * greenjd runs it with --log-bench [calls].
+ */
+class LogBench
+{
+    int calls_;
+
+public:
+    /**
+     * The domain logged to, its level gets raised during the benchmark
+     */
+    static const QString BENCH_DOMAIN;
+
+    /**
+     * Constructor
+     * @param calls int, log statements per way
+     */
+    LogBench(const int &calls);
+
+    /**
+     * Run the benchmark and print the results to stdout
+     * @param results QVariantMap, gets calls, macroNs and eagerNs
+     *        (time per statement)
+     * @return bool false if debug messages of the domain couldn't be
+     *         filtered out
+     */
+    bool run(QVariantMap &results);
+};
+
+#endif // LOG_BENCH_H
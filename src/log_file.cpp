@@ -0,0 +1,267 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "log_file.h"
+
+#include <QStringList>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QRegExp>
+
+#include <string.h>
+
+const int LogFile::LINE_INDEX_STEP = 256;
+const int LogFile::HEAD_SIZE = 256;
+const QString LogFile::COMPRESSED_SUFFIX = ".qz";
+
+//----------------------------------------------------------------------
+LogFile::LogFile(const QString &file_name) :
+    file_name_(file_name), data_(0), size_(0), indexed_lines_(0),
+    indexed_offset_(0)
+{
+}
+
+//----------------------------------------------------------------------
+LogFile::~LogFile()
+{
+    close();
+}
+
+//----------------------------------------------------------------------
+bool LogFile::isCompressed(const QString &file_name)
+{
+    return file_name.endsWith(COMPRESSED_SUFFIX);
+}
+
+//----------------------------------------------------------------------
+bool LogFile::open()
+{
+    close();
+
+    file_.setFileName(file_name_);
+    if (!file_.open(QIODevice::ReadOnly))
+        return false;
+
+    if (isCompressed(file_name_))
+    {
+        buffer_ = qUncompress(file_.readAll());
+        file_.close();
+        data_ = buffer_.constData();
+        size_ = buffer_.size();
+    }
+    else
+    {
+        size_ = file_.size();
+        if (size_ > 0)
+        {
+            data_ = (const char*)file_.map(0, size_);
+            if (!data_)
+            {
+                // mapping not supported, fall back to reading
+                buffer_ = file_.readAll();
+                data_ = buffer_.constData();
+                size_ = buffer_.size();
+            }
+        }
+    }
+
+    // the lines of a rotated file are elsewhere now
+    bool replaced = isReplaced();
+    if (replaced || size_ < indexed_offset_)
+    {
+        line_index_.clear();
+        indexed_lines_ = 0;
+        indexed_offset_ = 0;
+    }
+    if (replaced || size_ < index_.getIndexedSize() || index_.getIndexedSize() == 0)
+        index_.clear(getStartDate());
+    head_ = QByteArray(data_, (int)qMin(size_, (qint64)HEAD_SIZE));
+    return true;
+}
+
+//----------------------------------------------------------------------
+bool LogFile::isReplaced() const
+{
+    if (size_ < head_.size())
+        return true;
+    return head_.size() > 0 && memcmp(data_, head_.constData(), head_.size()) != 0;
+}
+
+//----------------------------------------------------------------------
+QDate LogFile::getStartDate() const
+{
+    QDate date = LogIndex::findStartDate(data_, size_);
+    if (date.isValid())
+        return date;
+
+    // a part of one session without session line, the name has the month
+    // ("log-MM-yyyy.log", rotated files get ".n.log" and ".qz"), the last
+    // change is the end of the session part, or its compression
+    QFileInfo info(file_name_);
+    QRegExp month("(\\d{2})-(\\d{4})");
+    if (month.indexIn(info.fileName()) < 0)
+        return QDate();
+    QDate first(month.cap(2).toInt(), month.cap(1).toInt(), 1);
+    QDate modified = info.lastModified().date();
+    if (modified.year() == first.year() && modified.month() == first.month())
+        return modified;
+    return first;
+}
+
+//----------------------------------------------------------------------
+void LogFile::close()
+{
+    if (file_.isOpen())
+    {
+        if (data_ && buffer_.isEmpty())
+            file_.unmap((uchar*)data_);
+        file_.close();
+    }
+    buffer_.clear();
+    data_ = 0;
+    size_ = 0;
+}
+
+//----------------------------------------------------------------------
+qint64 LogFile::getSize() const
+{
+    return size_;
+}
+
+//----------------------------------------------------------------------
+QString LogFile::getText(const qint64 &offset, const qint64 &length) const
+{
+    qint64 len = length;
+    // written in text mode on windows
+    if (len > 0 && data_[offset + len - 1] == '\r')
+        --len;
+    return QString::fromLocal8Bit(data_ + offset, (int)len);
+}
+
+//----------------------------------------------------------------------
+void LogFile::extendIndex(const qint64 &line)
+{
+    while (indexed_lines_ <= line && indexed_offset_ < size_)
+    {
+        if (indexed_lines_ % LINE_INDEX_STEP == 0
+            && line_index_.size() <= indexed_lines_ / LINE_INDEX_STEP)
+        {
+            line_index_.append(indexed_offset_);
+        }
+
+        const char *end = (const char*)memchr(data_ + indexed_offset_, '\n',
+                                              (size_t)(size_ - indexed_offset_));
+        // the last line is still being written
+        if (!end)
+            break;
+
+        indexed_offset_ = end - data_ + 1;
+        ++indexed_lines_;
+    }
+}
+
+//----------------------------------------------------------------------
+qint64 LogFile::findLineStart(const qint64 &offset) const
+{
+    qint64 pos = offset;
+    while (pos > 0 && data_[pos - 1] != '\n')
+        --pos;
+    return pos;
+}
+
+//----------------------------------------------------------------------
+void LogFile::read(const qint64 &offset, const qint64 &length, QVariantMap &result)
+{
+    qint64 start = qBound((qint64)0, offset, size_);
+    qint64 end = start + qBound((qint64)0, length, size_ - start);
+    if (end < size_)
+    {
+        qint64 line_end = end;
+        while (line_end > start && data_[line_end - 1] != '\n')
+            --line_end;
+        if (line_end > start)
+            end = line_end;
+    }
+
+    result.insert("data", QString::fromLocal8Bit(data_ + start, (int)(end - start)));
+    result.insert("offset", start);
+    result.insert("length", end - start);
+    result.insert("next", end);
+    result.insert("size", size_);
+}
+
+//----------------------------------------------------------------------
+void LogFile::readBackward(const qint64 &end_offset, const int &count,
+                           QVariantMap &result)
+{
+    QStringList lines;
+    qint64 end = (end_offset < 0 || end_offset > size_) ? size_ : end_offset;
+    while (lines.size() < count && end > 0)
+    {
+        qint64 text_end = end;
+        if (data_[text_end - 1] == '\n')
+            --text_end;
+        qint64 start = findLineStart(text_end);
+        lines.prepend(getText(start, text_end - start));
+        end = start;
+    }
+
+    result.insert("lines", lines);
+    result.insert("offset", end);
+    result.insert("size", size_);
+}
+
+//----------------------------------------------------------------------
+void LogFile::readLines(const qint64 &first_line, const int &count, QVariantMap &result)
+{
+    QStringList lines;
+    qint64 pos = size_;
+    if (first_line >= 0)
+    {
+        extendIndex(first_line);
+        if (first_line < indexed_lines_)
+        {
+            pos = line_index_[(int)(first_line / LINE_INDEX_STEP)];
+            for (qint64 i = first_line % LINE_INDEX_STEP; i > 0; --i)
+                pos = (const char*)memchr(data_ + pos, '\n', (size_t)(size_ - pos)) - data_ + 1;
+        }
+    }
+
+    result.insert("offset", pos);
+    while (lines.size() < count && pos < size_)
+    {
+        const char *end = (const char*)memchr(data_ + pos, '\n', (size_t)(size_ - pos));
+        if (!end)
+            break;
+        qint64 line_end = end - data_;
+        lines << getText(pos, line_end - pos);
+        pos = line_end + 1;
+    }
+
+    result.insert("lines", lines);
+    result.insert("firstLine", first_line);
+    result.insert("next", first_line + lines.size());
+    result.insert("size", size_);
+}
+
+//----------------------------------------------------------------------
+bool LogFile::mayMatch(const LogQuery &query) const
+{
+    return index_.mayMatch(query);
+}
+
+//----------------------------------------------------------------------
+void LogFile::query(const LogQuery &query, QVariantList &matches, QVariantMap &stats)
+{
+    // compressed files are rotated files, they don't grow anymore
+    index_.extend(data_, size_, isCompressed(file_name_));
+    index_.query(data_, size_, query, file_name_, matches, stats);
+}
@@ -0,0 +1,178 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef LOG_FILE_H
+#define LOG_FILE_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QVariantMap>
+
+#include "log_index.h"
+
+/**
+ * Read access to a log file without loading it as a whole.
+ * The file gets memory-mapped between open() and close(), compressed
+ * (rotated) files get uncompressed into memory instead.
+ * A sparse index of line offsets and a block index for searching get
+ * built lazily and are kept between open() calls as long as the file
+ * only grows. Rotation replaces the file by a new one, which is noticed
+ * by its first bytes.
+ */
+class LogFile
+{
+    QString file_name_;
+    QFile file_;
+    QByteArray buffer_;
+    const char *data_;
+    qint64 size_;
+
+    /**
+     * Offset of every LINE_INDEX_STEP-th line
+     */
+    QVector<qint64> line_index_;
+    qint64 indexed_lines_;
+    qint64 indexed_offset_;
+
+    /**
+     * First bytes of the file at the last open()
+     */
+    QByteArray head_;
+
+    LogIndex index_;
+
+    LogFile(const LogFile&);
+    LogFile &operator=(const LogFile&);
+
+    /**
+     * Check if the file got replaced since the last open(), log files
+     * only grow, so the new one is smaller or starts with other lines
+     * @return bool true if the file got replaced
+     */
+    bool isReplaced() const;
+
+    /**
+     * Get the day of the lines in front of the first session line
+     * @return QDate the day, invalid if unknown
+     */
+    QDate getStartDate() const;
+
+    /**
+     * Index the file up to the given line or the end of the file
+     * @param line qint64, the line to index
+     */
+    void extendIndex(const qint64 &line);
+
+    /**
+     * Find the start of the line containing the given offset
+     * @param offset qint64, offset in the file
+     * @return qint64 the offset of the start of the line
+     */
+    qint64 findLineStart(const qint64 &offset) const;
+
+    /**
+     * Decode a part of the file
+     * @param offset qint64, offset in the file
+     * @param length qint64, number of bytes
+     * @return QString the text
+     */
+    QString getText(const qint64 &offset, const qint64 &length) const;
+
+public:
+    /**
+     * Every LINE_INDEX_STEP-th line gets its offset indexed
+     */
+    static const int LINE_INDEX_STEP;
+
+    /**
+     * Number of bytes at the start of the file compared by isReplaced()
+     */
+    static const int HEAD_SIZE;
+
+    /**
+     * Suffix of compressed log files
+     */
+    static const QString COMPRESSED_SUFFIX;
+
+    explicit LogFile(const QString &file_name);
+    ~LogFile();
+
+    /**
+     * Check if a file is a compressed log file
+     * @param file_name QString, the name of the file
+     * @return bool true if the file is compressed
+     */
+    static bool isCompressed(const QString &file_name);
+
+    /**
+     * Map the file, has to be called before reading
+     * @return bool false if the file can't be read
+     */
+    bool open();
+
+    /**
+     * Unmap the file, so it can be renamed or deleted again
+     */
+    void close();
+
+    /**
+     * Get the size of the (uncompressed) file, valid after open()
+     * @return qint64 the size in bytes
+     */
+    qint64 getSize() const;
+
+    /**
+     * Read a part of the file. The end gets moved back to the end of the
+     * last complete line, unless the part doesn't contain a line end.
+     * @param offset qint64, the offset to start reading
+     * @param length qint64, the maximum number of bytes to read
+     * @param result QVariantMap, gets data, offset, length, next and size
+     */
+    void read(const qint64 &offset, const qint64 &length, QVariantMap &result);
+
+    /**
+     * Read the lines in front of an offset, for paging backwards
+     * @param end_offset qint64, read lines ending before this offset,
+     *        -1 to read the last lines of the file
+     * @param count int, the maximum number of lines
+     * @param result QVariantMap, gets lines (oldest first), offset (pass it
+     *        as end_offset to get the page before) and size
+     */
+    void readBackward(const qint64 &end_offset, const int &count, QVariantMap &result);
+
+    /**
+     * Read lines by line number
+     * @param first_line qint64, the number of the first line, starting at 0
+     * @param count int, the maximum number of lines
+     * @param result QVariantMap, gets lines, firstLine, next, offset and size
+     */
+    void readLines(const qint64 &first_line, const int &count, QVariantMap &result);
+
+    /**
+     * Check if the file may contain lines matching a query, works
+     * without opening the file once a compressed file has been searched
+     * @param query LogQuery, the filter
+     * @return bool false if the file can be skipped
+     */
+    bool mayMatch(const LogQuery &query) const;
+
+    /**
+     * Search the file, extends the block index first
+     * @param query LogQuery, the filter
+     * @param matches QVariantList, the matching lines get appended
+     * @param stats QVariantMap, counts blocks and skippedBlocks
+     */
+    void query(const LogQuery &query, QVariantList &matches, QVariantMap &stats);
+};
+
+#endif // LOG_FILE_H
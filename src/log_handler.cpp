@@ -12,19 +12,33 @@
 #include "log_handler.h"
 
 #include <QDateTime>
-#include <QTextStream>
+#include <QFile>
 #include <QDir>
+#include <QMutexLocker>
+#include <QtAlgorithms>
 
 #include "log_info.h"
+#include "log_file.h"
 #include "config_file_handler.h"
 
+int LogHandler::level_ = 0;
+QHash<QString, QAtomicInt*> LogHandler::domain_levels_;
+QMap<QString, int> LogHandler::domain_overrides_;
+QMutex LogHandler::domain_mutex_;
+
 //----------------------------------------------------------------------
-LogHandler::LogHandler() : file_("log-"+QDateTime::currentDateTime().toString("MM-yyyy")+".log")
+LogHandler::LogHandler()
 {
-    QDir current(".");
-    QStringList filters;
-    filters << "*.log";
-    log_list_ << current.entryList(filters);
+    ConfigFileHandler &config = ConfigFileHandler::getInstance();
+    logLevelChanged();
+    connect(&config, SIGNAL(signalLogLevelChanged()), this, SLOT(logLevelChanged()));
+
+    writer_.setup("log-", config.getLogQueueSize(), config.getLogFlushSize(),
+                  config.getLogFlushInterval(), config.getLogFsyncPolicy());
+    writer_.setRotation(config.getLogMaxSize(), config.getLogCompress());
+    writer_.start();
+
+    updateLogFileList();
 
     QString msg("========== ");
     msg.append(QDateTime::currentDateTime().toString("ddd dd.MM.yyyy hh:mm:ss"));
@@ -39,20 +53,16 @@ LogHandler::~LogHandler()
     msg.append(QDateTime::currentDateTime().toString("ddd dd.MM.yyyy hh:mm:ss"));
     msg.append(" - Session closed ==========\n");
     writeFile(msg);
+
+    writer_.stop();
+
+    qDeleteAll(log_files_);
 }
 
 //----------------------------------------------------------------------
 void LogHandler::writeFile(const QString &msg)
 {
-    lock_.lockForWrite();
-    if (!file_.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
-        return;
-
-    QTextStream out(&file_);
-    out << msg;
-
-    file_.close();
-    lock_.unlock();
+    writer_.enqueue(msg);
 }
 
 //----------------------------------------------------------------------
@@ -75,12 +85,16 @@ LogHandler &LogHandler::getInstance()
 //----------------------------------------------------------------------
 void LogHandler::logData(const LogInfo &info)
 {
-    if (info.status_ >= ConfigFileHandler::getInstance().getLogLevel())
-    {
-        writeFile(createString(info));
+    if ((int)info.status_ >= getLevel(info.domain_))
+        writeLog(info);
+}
 
-        signalLogMessage(info);
-    }
+//----------------------------------------------------------------------
+void LogHandler::writeLog(const LogInfo &info)
+{
+    writeFile(createString(info));
+
+    signalLogMessage(info);
 }
 
 //----------------------------------------------------------------------
@@ -92,7 +106,8 @@ void LogHandler::logDataSlot(const LogInfo &info)
 //----------------------------------------------------------------------
 void LogHandler::logFromJs(const LogInfo &info)
 {
-    if (info.status_ >= ConfigFileHandler::getInstance().getLogLevel())
+    // the page picks its domains freely, they don't get a level kept
+    if ((int)info.status_ >= getLevel(info.domain_))
     {
         writeFile(createString(info));
     }
@@ -105,37 +120,224 @@ void LogHandler::setLogLevel(const unsigned &log_level)
 }
 
 //----------------------------------------------------------------------
-const QStringList &LogHandler::getLogFileList() const
+void LogHandler::setLogDomainLevel(const QString &domain, const int &log_level)
+{
+    ConfigFileHandler::getInstance().setLogDomainLevel(domain, log_level);
+}
+
+//----------------------------------------------------------------------
+QVariantMap LogHandler::getLogDomainLevels() const
+{
+    QVariantMap result;
+    QMutexLocker locker(&domain_mutex_);
+    QMap<QString, int>::const_iterator i;
+    for (i = domain_overrides_.constBegin(); i != domain_overrides_.constEnd(); ++i)
+        result.insert(i.key(), i.value());
+    return result;
+}
+
+//----------------------------------------------------------------------
+const QAtomicInt *LogHandler::getDomainLevel(const QString &domain)
+{
+    QMutexLocker locker(&domain_mutex_);
+    QHash<QString, QAtomicInt*>::const_iterator i = domain_levels_.constFind(domain);
+    if (i != domain_levels_.constEnd())
+        return i.value();
+
+    QAtomicInt *level = new QAtomicInt(domain_overrides_.value(domain, level_));
+    domain_levels_.insert(domain, level);
+    return level;
+}
+
+//----------------------------------------------------------------------
+int LogHandler::getLevel(const QString &domain)
+{
+    QMutexLocker locker(&domain_mutex_);
+    QHash<QString, QAtomicInt*>::const_iterator i = domain_levels_.constFind(domain);
+    if (i != domain_levels_.constEnd())
+        return *i.value();
+    return domain_overrides_.value(domain, level_);
+}
+
+//----------------------------------------------------------------------
+void LogHandler::logLevelChanged()
+{
+    ConfigFileHandler &config = ConfigFileHandler::getInstance();
+
+    QMutexLocker locker(&domain_mutex_);
+    level_ = config.getLogLevel();
+    domain_overrides_ = config.getLogDomainLevels();
+
+    QHash<QString, QAtomicInt*>::iterator i;
+    for (i = domain_levels_.begin(); i != domain_levels_.end(); ++i)
+        *i.value() = domain_overrides_.value(i.key(), level_);
+}
+
+//----------------------------------------------------------------------
+void LogHandler::getStatistics(QVariantMap &stats)
+{
+    writer_.getStatistics(stats);
+}
+
+//----------------------------------------------------------------------
+void LogHandler::updateLogFileList()
 {
+    QDir current(".");
+    QStringList filters;
+    filters << "*.log" << "*.log" + LogFile::COMPRESSED_SUFFIX;
+    log_list_ = current.entryList(filters, QDir::Files, QDir::Name);
+}
+
+//----------------------------------------------------------------------
+const QStringList &LogHandler::getLogFileList()
+{
+    updateLogFileList();
     return log_list_;
 }
 
 //----------------------------------------------------------------------
-QString LogHandler::getLogFileContent(const QString &file_name) const
+LogFile *LogHandler::getLogFile(const QString &file_name)
 {
-    if (log_list_.contains(file_name))
+    // files come and go with rotation
+    if (!log_list_.contains(file_name))
+        updateLogFileList();
+    if (!log_list_.contains(file_name))
+        return 0;
+
+    LogFile *log_file = log_files_.value(file_name);
+    if (!log_file)
     {
-        QFile log_file(file_name);
-        if (!log_file.open(QIODevice::ReadOnly | QIODevice::Text))
-            return "";
-        QTextStream in(&log_file);
-        QString result;
-        while (!in.atEnd()) {
-            QString line = in.readLine();
-            result.append(line+"\n");
+        log_file = new LogFile(file_name);
+        log_files_.insert(file_name, log_file);
+    }
+    return log_file;
+}
+
+//----------------------------------------------------------------------
+LogFile *LogHandler::openLogFile(const QString &file_name)
+{
+    LogFile *log_file = getLogFile(file_name);
+    if (!log_file || !log_file->open())
+        return 0;
+    return log_file;
+}
+
+//----------------------------------------------------------------------
+QString LogHandler::getLogFileContent(const QString &file_name)
+{
+    LogFile *log_file = openLogFile(file_name);
+    if (!log_file)
+        return "";
+
+    QVariantMap result;
+    log_file->read(0, log_file->getSize(), result);
+    log_file->close();
+    return result.value("data").toString();
+}
+
+//----------------------------------------------------------------------
+void LogHandler::readLogFile(const QString &file_name, const qint64 &offset,
+                             const qint64 &length, QVariantMap &result)
+{
+    LogFile *log_file = openLogFile(file_name);
+    if (!log_file)
+        return;
+
+    log_file->read(offset, length, result);
+    log_file->close();
+}
+
+//----------------------------------------------------------------------
+void LogHandler::readLogFileBackward(const QString &file_name, const qint64 &end_offset,
+                                     const int &count, QVariantMap &result)
+{
+    LogFile *log_file = openLogFile(file_name);
+    if (!log_file)
+        return;
+
+    log_file->readBackward(end_offset, count, result);
+    log_file->close();
+}
+
+//----------------------------------------------------------------------
+void LogHandler::readLogLines(const QString &file_name, const qint64 &first_line,
+                              const int &count, QVariantMap &result)
+{
+    LogFile *log_file = openLogFile(file_name);
+    if (!log_file)
+        return;
+
+    log_file->readLines(first_line, count, result);
+    log_file->close();
+}
+
+//----------------------------------------------------------------------
+static bool earlierMatch(const QVariant &left, const QVariant &right)
+{
+    return left.toMap().value("time").toLongLong() < right.toMap().value("time").toLongLong();
+}
+
+//----------------------------------------------------------------------
+void LogHandler::queryLog(const QVariantMap &query, QVariantMap &result)
+{
+    LogQuery log_query;
+    log_query.set(query);
+
+    QStringList files = query.value("files").toStringList();
+    if (files.isEmpty())
+        files = getLogFileList();
+
+    QVariantList matches;
+    QVariantMap stats;
+    bool truncated = false;
+    int skipped_files = 0;
+    for (int i = 0; i < files.size(); ++i)
+    {
+        LogFile *log_file = getLogFile(files[i]);
+        if (!log_file)
+            continue;
+        if (!log_file->mayMatch(log_query))
+        {
+            ++skipped_files;
+            continue;
         }
-        return result;
+        if (!log_file->open())
+            continue;
+
+        // every file is limited on its own, the earliest matches of
+        // all files are among the earliest matches of each file
+        QVariantList file_matches;
+        log_file->query(log_query, file_matches, stats);
+        log_file->close();
+
+        if (file_matches.size() >= log_query.limit_)
+            truncated = true;
+        matches << file_matches;
     }
-    return "";
+
+    qStableSort(matches.begin(), matches.end(), earlierMatch);
+    while (matches.size() > log_query.limit_)
+        matches.removeLast();
+
+    result.insert("matches", matches);
+    result.insert("truncated", truncated);
+    result.insert("files", files.size());
+    result.insert("skippedFiles", skipped_files);
+    result.insert("blocks", stats.value("blocks", 0));
+    result.insert("skippedBlocks", stats.value("skippedBlocks", 0));
 }
 
 //----------------------------------------------------------------------
 void LogHandler::deleteLogFile(const QString &file_name)
 {
+    if (!log_list_.contains(file_name))
+        updateLogFileList();
+
     int idx = log_list_.indexOf(file_name);
     if (idx != -1)
     {
         log_list_.removeAt(idx);
+        delete log_files_.take(file_name);
         QFile::remove(file_name);
     }
 }
@@ -13,12 +13,73 @@
 #define LOG_HANDLER_H
 
 #include <QObject>
-#include <QFile>
 #include <QString>
-#include <QReadWriteLock>
 #include <QStringList>
+#include <QVariantMap>
+#include <QAtomicInt>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
 
-class LogInfo;
+#include "log_info.h"
+#include "log_writer.h"
+
+class LogFile;
+
+/**
+ * \name Logging Front End
+ * Use these macros to log. The message expression only gets evaluated
+ * (and the LogInfo only gets built) if the status passes the log level
+ * of the domain. Each statement looks up the level of its domain once and
+ * keeps it, so the domain has to be a constant. The level pointer is
+ * statically zero initialized and set atomically, a function-local static
+ * with a dynamic initializer isn't thread-safe before C++11.
+ * Levels below GREENJ_LOG_MIN_LEVEL are removed at compile time.
+ * \{
+ */
+#ifndef GREENJ_LOG_MIN_LEVEL
+#define GREENJ_LOG_MIN_LEVEL 0
+#endif
+
+#define GREENJ_LOG(status, domain, code, msg) \
+    do { \
+        static QBasicAtomicPointer<const QAtomicInt> log_domain_level = Q_BASIC_ATOMIC_INITIALIZER(0); \
+        if (!log_domain_level) \
+            log_domain_level.testAndSetOrdered(0, LogHandler::getDomainLevel(domain)); \
+        if (LogHandler::isLogged(status, log_domain_level)) \
+            LogHandler::getInstance().writeLog(LogInfo(status, domain, code, msg)); \
+    } while (0)
+
+#define GREENJ_LOG_NOTHING() do { } while (0)
+
+#if GREENJ_LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(domain, code, msg) GREENJ_LOG(LogInfo::STATUS_DEBUG, domain, code, msg)
+#else
+#define LOG_DEBUG(domain, code, msg) GREENJ_LOG_NOTHING()
+#endif
+
+#if GREENJ_LOG_MIN_LEVEL <= 1
+#define LOG_MESSAGE(domain, code, msg) GREENJ_LOG(LogInfo::STATUS_MESSAGE, domain, code, msg)
+#else
+#define LOG_MESSAGE(domain, code, msg) GREENJ_LOG_NOTHING()
+#endif
+
+#if GREENJ_LOG_MIN_LEVEL <= 2
+#define LOG_WARNING(domain, code, msg) GREENJ_LOG(LogInfo::STATUS_WARNING, domain, code, msg)
+#else
+#define LOG_WARNING(domain, code, msg) GREENJ_LOG_NOTHING()
+#endif
+
+#if GREENJ_LOG_MIN_LEVEL <= 3
+#define LOG_ERROR(domain, code, msg) GREENJ_LOG(LogInfo::STATUS_ERROR, domain, code, msg)
+#else
+#define LOG_ERROR(domain, code, msg) GREENJ_LOG_NOTHING()
+#endif
+
+#define LOG_FATAL_ERROR(domain, code, msg) GREENJ_LOG(LogInfo::STATUS_FATAL_ERROR, domain, code, msg)
+/**
+ * \}
+ */
 
 /**
  * Handles the log data. It writes log messages into the
@@ -29,17 +90,66 @@ class LogHandler : public QObject
     Q_OBJECT
 
 private:
-    QFile file_;
-    QReadWriteLock lock_;
+    LogWriter writer_;
     QStringList log_list_;
 
+    /**
+     * Opened log files, they keep their line index between reads
+     */
+    QHash<QString, LogFile*> log_files_;
+
+    /**
+     * Default log level
+     */
+    static int level_;
+
+    /**
+     * Effective log level of each domain of the LOG_* macros, readable
+     * from any thread without locking. The entries never get deleted,
+     * so other domains (e.g. of the web page) only get looked up.
+     */
+    static QHash<QString, QAtomicInt*> domain_levels_;
+
+    /**
+     * Log levels set for single domains
+     */
+    static QMap<QString, int> domain_overrides_;
+    static QMutex domain_mutex_;
+
     LogHandler();
     LogHandler(const LogHandler&);
     ~LogHandler();
 
+    /**
+     * Get the effective log level of a domain without keeping it
+     * @param domain QString, the log domain
+     * @return int the log level of the domain
+     */
+    static int getLevel(const QString &domain);
+
     QString createString(const LogInfo &info);
     void writeFile(const QString &msg);
 
+    /**
+     * Search the current directory for log files
+     */
+    void updateLogFileList();
+
+    /**
+     * Get a log file, it has to be in the log file list
+     * @param file_name QString, the name of the log file
+     * @return LogFile* the log file, 0 if it isn't a log file
+     */
+    LogFile *getLogFile(const QString &file_name);
+
+    /**
+     * Get a log file for reading, it has to be in the log file list
+     * @param file_name QString, the name of the log file
+     * @return LogFile* the opened log file, 0 if it isn't a log file or
+     *         can't be opened. Close it after reading.
+     */
+    LogFile *openLogFile(const QString &file_name);
+
 signals:
     /**
      * Signal to send message to webkit
@@ -54,6 +164,25 @@ public:
      */
     static LogHandler &getInstance();
 
+    /**
+     * Get the effective log level of a domain. The returned level stays
+     * valid and follows changes of the default and the domain log level.
+     * @param domain QString, the log domain
+     * @return const QAtomicInt* the log level of the domain
+     */
+    static const QAtomicInt *getDomainLevel(const QString &domain);
+
+    /**
+     * Check if messages of a status would be logged, before building them
+     * @param status unsigned, the status of the message
+     * @param domain_level QAtomicInt*, the log level of the domain
+     * @return bool true if the status passes the log level
+     */
+    static inline bool isLogged(const unsigned &status, const QAtomicInt *domain_level)
+    {
+        return (int)status >= (int)*domain_level;
+    }
+
     /**
      * Get Loginformation from webkit to write it into a file
      * @param info LogInfo, the log information class
@@ -66,6 +195,13 @@ public:
      */
     void logData(const LogInfo &info);
 
+    /**
+     * Write the log information into the file and send it to webkit
+     * without checking the log level again
+     * @param info LogInfo, the log information class
+     */
+    void writeLog(const LogInfo &info);
+
 public slots:
     /**
      * Get Loginformation to write it into a file and try to send it to webkit
@@ -78,8 +214,84 @@ public slots:
      */
     void setLogLevel(const unsigned &log_level);
 
-    const QStringList &getLogFileList() const;
-    QString getLogFileContent(const QString &file_name) const;
+    /**
+     * Set the log level of a single domain
+     * @param domain QString, the log domain
+     * @param log_level int, the log level, -1 to use the default log level
+     */
+    void setLogDomainLevel(const QString &domain, const int &log_level);
+
+    /**
+     * Get the log levels set for single domains
+     * @return QVariantMap the log level of each overridden domain
+     */
+    QVariantMap getLogDomainLevels() const;
+
+    /**
+     * Reload the default and the domain log levels from the config
+     */
+    void logLevelChanged();
+
+    /**
+     * Get the counters of the log writer
+     * @param stats QVariantMap, gets queueDepth, highWatermark, bytesWritten,
+     *        messagesWritten, flushes and dropped
+     */
+    void getStatistics(QVariantMap &stats);
+
+    /**
+     * Get the names of all log files, rotated and compressed ones included
+     * @return QStringList the file names
+     */
+    const QStringList &getLogFileList();
+
+    /**
+     * Get the whole content of a log file, prefer the paged methods
+     * @param file_name QString, the name of the log file
+     * @return QString the content
+     */
+    QString getLogFileContent(const QString &file_name);
+
+    /**
+     * Read a part of a log file, see LogFile::read()
+     * @param file_name QString, the name of the log file
+     * @param offset qint64, the offset to start reading
+     * @param length qint64, the maximum number of bytes to read
+     * @param result QVariantMap, gets data, offset, length, next and size
+     */
+    void readLogFile(const QString &file_name, const qint64 &offset,
+                     const qint64 &length, QVariantMap &result);
+
+    /**
+     * Read the lines in front of an offset, see LogFile::readBackward()
+     * @param file_name QString, the name of the log file
+     * @param end_offset qint64, -1 to read the last lines of the file
+     * @param count int, the maximum number of lines
+     * @param result QVariantMap, gets lines, offset and size
+     */
+    void readLogFileBackward(const QString &file_name, const qint64 &end_offset,
+                             const int &count, QVariantMap &result);
+
+    /**
+     * Read lines by line number, see LogFile::readLines()
+     * @param file_name QString, the name of the log file
+     * @param first_line qint64, the number of the first line
+     * @param count int, the maximum number of lines
+     * @param result QVariantMap, gets lines, firstLine, next, offset and size
+     */
+    void readLogLines(const QString &file_name, const qint64 &first_line,
+                      const int &count, QVariantMap &result);
+
+    /**
+     * Search the log files
+     * @param query QVariantMap, the filter (see LogQuery::set()), files may
+     *        contain the log files to search, default is all log files
+     * @param result QVariantMap, gets matches (sorted by time, see
+     *        LogIndex::query()), truncated (true if the limit got reached),
+     *        files, skippedFiles, blocks and skippedBlocks
+     */
+    void queryLog(const QVariantMap &query, QVariantMap &result);
+
     void deleteLogFile(const QString &file_name);
 };
 
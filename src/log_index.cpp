@@ -0,0 +1,445 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "log_index.h"
+
+#include <QByteArrayMatcher>
+#include <QDateTime>
+
+#include <limits>
+#include <string.h>
+
+#include "log_info.h"
+
+const int LogIndex::BLOCK_SIZE = 65536;
+
+/**
+ * a time of day can't jump back more than this, unless it's a new day
+ */
+static const int DAY_ROLLOVER = 12 * 3600 * 1000;
+
+//----------------------------------------------------------------------
+static inline int parseDigits(const char *p, const int &count)
+{
+    int result = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        if (p[i] < '0' || p[i] > '9')
+            return -1;
+        result = result * 10 + (p[i] - '0');
+    }
+    return result;
+}
+
+//----------------------------------------------------------------------
+LogQuery::LogQuery() :
+    status_mask_(0xffffffff), from_(0), to_(0), limit_(1000)
+{
+}
+
+//----------------------------------------------------------------------
+void LogQuery::set(const QVariantMap &query)
+{
+    if (query.contains("status"))
+    {
+        QVariantList status_list;
+        if (query.value("status").type() == QVariant::List)
+            status_list = query.value("status").toList();
+        else
+            status_list << query.value("status");
+
+        status_mask_ = 0;
+        for (int i = 0; i < status_list.size(); ++i)
+        {
+            int status = status_list[i].toInt();
+            if (status >= 0 && status < 32)
+                status_mask_ |= 1u << status;
+        }
+    }
+    if (query.contains("minStatus"))
+    {
+        int min_status = qBound(0, query.value("minStatus").toInt(), 31);
+        status_mask_ &= ~((1u << min_status) - 1);
+    }
+
+    domain_ = query.value("domain").toString().toLocal8Bit();
+    from_ = query.value("from").toLongLong();
+    to_ = query.value("to").toLongLong();
+    text_ = query.value("text").toString().toLocal8Bit();
+    limit_ = query.value("limit", 1000).toInt();
+    if (limit_ <= 0)
+        limit_ = 1000;
+}
+
+//----------------------------------------------------------------------
+LogIndex::LogIndex()
+{
+    for (unsigned i = LogInfo::STATUS_DEBUG; i <= LogInfo::STATUS_FATAL_ERROR; ++i)
+        status_names_ << LogInfo::STATUS_STRING[i].toLatin1();
+    clear(QDate::currentDate());
+}
+
+//----------------------------------------------------------------------
+void LogIndex::clear(const QDate &start_date)
+{
+    blocks_.clear();
+    domain_bits_.clear();
+    setDay(context_, start_date.isValid() ? start_date : QDate::currentDate());
+    context_.last_time_ = 0;
+    indexed_size_ = 0;
+    complete_ = false;
+    initBlock(summary_, 0, context_);
+}
+
+//----------------------------------------------------------------------
+qint64 LogIndex::getIndexedSize() const
+{
+    return indexed_size_;
+}
+
+//----------------------------------------------------------------------
+void LogIndex::setDay(Context &context, const QDate &date)
+{
+    context.day_ = date.toJulianDay();
+    context.day_start_ = QDateTime(date, QTime(0, 0)).toMSecsSinceEpoch();
+}
+
+//----------------------------------------------------------------------
+void LogIndex::initBlock(Block &block, const qint64 &start, const Context &context)
+{
+    block.start_ = start;
+    block.end_ = start;
+    block.min_time_ = std::numeric_limits<qint64>::max();
+    block.max_time_ = std::numeric_limits<qint64>::min();
+    block.status_mask_ = 0;
+    block.domain_mask_ = 0;
+    block.context_ = context;
+}
+
+//----------------------------------------------------------------------
+void LogIndex::addToBlock(Block &block, const Entry &entry, const int &domain_bit)
+{
+    block.min_time_ = qMin(block.min_time_, entry.time_);
+    block.max_time_ = qMax(block.max_time_, entry.time_);
+    block.status_mask_ |= 1u << entry.status_;
+    block.domain_mask_ |= 1u << domain_bit;
+}
+
+//----------------------------------------------------------------------
+void LogIndex::appendBlock(const Block &block)
+{
+    blocks_.append(block);
+    summary_.end_ = block.end_;
+    summary_.min_time_ = qMin(summary_.min_time_, block.min_time_);
+    summary_.max_time_ = qMax(summary_.max_time_, block.max_time_);
+    summary_.status_mask_ |= block.status_mask_;
+    summary_.domain_mask_ |= block.domain_mask_;
+}
+
+//----------------------------------------------------------------------
+bool LogIndex::parseSessionLine(const char *line, const int &size, QDate &date, int &time)
+{
+    // "========== ddd dd.MM.yyyy hh:mm:ss - Session started =========="
+    const char *p = (const char*)memchr(line + 11, ' ', size - 11);
+    if (!p || line + size - p <= 19)
+        return false;
+
+    ++p;
+    date = QDate(parseDigits(p + 6, 4), parseDigits(p + 3, 2), parseDigits(p, 2));
+    int hour = parseDigits(p + 11, 2);
+    int minute = parseDigits(p + 14, 2);
+    int second = parseDigits(p + 17, 2);
+    if (!date.isValid() || hour < 0 || minute < 0 || second < 0)
+        return false;
+    time = ((hour * 60 + minute) * 60 + second) * 1000;
+    return true;
+}
+
+//----------------------------------------------------------------------
+QDate LogIndex::findStartDate(const char *data, const qint64 &size)
+{
+    int midnights = 0;
+    int last_time = -1;
+    qint64 pos = 0;
+    while (pos < size)
+    {
+        const char *line_end = (const char*)memchr(data + pos, '\n', (size_t)(size - pos));
+        qint64 next = line_end ? line_end - data + 1 : size;
+        const char *line = data + pos;
+        int line_size = (int)(next - pos);
+        pos = next;
+
+        int time = -1;
+        QDate date;
+        if (line_size >= 11 && memcmp(line, "========== ", 11) == 0)
+        {
+            if (!parseSessionLine(line, line_size, date, time))
+                continue;
+            if (last_time >= 0 && last_time - time > DAY_ROLLOVER)
+                ++midnights;
+            return date.addDays(-midnights);
+        }
+
+        // "hh:mm:ss [STATUS] ..."
+        if (line_size < 10 || line[2] != ':' || line[5] != ':' || line[9] != '[')
+            continue;
+        int hour = parseDigits(line, 2);
+        int minute = parseDigits(line + 3, 2);
+        int second = parseDigits(line + 6, 2);
+        if (hour < 0 || minute < 0 || second < 0)
+            continue;
+        time = ((hour * 60 + minute) * 60 + second) * 1000;
+        if (last_time >= 0 && last_time - time > DAY_ROLLOVER)
+            ++midnights;
+        last_time = time;
+    }
+    return QDate();
+}
+
+//----------------------------------------------------------------------
+bool LogIndex::parseLine(const char *line, const int &size, Context &context,
+                         Entry &entry) const
+{
+    if (size >= 11 && memcmp(line, "========== ", 11) == 0)
+    {
+        QDate date;
+        int time;
+        if (parseSessionLine(line, size, date, time))
+        {
+            setDay(context, date);
+            context.last_time_ = time;
+        }
+        return false;
+    }
+
+    // "hh:mm:ss [STATUS] domain: [code] message"
+    if (size < 12 || line[2] != ':' || line[5] != ':' || line[8] != ' ' || line[9] != '[')
+        return false;
+
+    int hour = parseDigits(line, 2);
+    int minute = parseDigits(line + 3, 2);
+    int second = parseDigits(line + 6, 2);
+    if (hour < 0 || minute < 0 || second < 0)
+        return false;
+
+    int time = ((hour * 60 + minute) * 60 + second) * 1000;
+    if (context.last_time_ - time > DAY_ROLLOVER)
+        setDay(context, QDate::fromJulianDay(context.day_ + 1));
+    context.last_time_ = time;
+    entry.time_ = context.day_start_ + time;
+
+    const char *end = line + size;
+    const char *p = line + 10;
+    const char *q = (const char*)memchr(p, ']', end - p);
+    if (!q)
+        return false;
+
+    entry.status_ = -1;
+    for (int i = 0; i < status_names_.size(); ++i)
+    {
+        const QByteArray &name = status_names_[i];
+        if (name.size() == q - p && memcmp(name.constData(), p, name.size()) == 0)
+        {
+            entry.status_ = i;
+            break;
+        }
+    }
+    if (entry.status_ < 0)
+        return false;
+
+    p = q + 2;
+    if (p >= end || (q = (const char*)memchr(p, ':', end - p)) == 0)
+        return false;
+    entry.domain_ = p;
+    entry.domain_size_ = q - p;
+
+    p = q + 3;
+    if (p >= end || (q = (const char*)memchr(p, ']', end - p)) == 0)
+        return false;
+    bool negative = *p == '-';
+    entry.code_ = 0;
+    for (const char *c = negative ? p + 1 : p; c < q; ++c)
+        entry.code_ = entry.code_ * 10 + (*c - '0');
+    if (negative)
+        entry.code_ = -entry.code_;
+
+    p = q + 1;
+    if (p < end && *p == ' ')
+        ++p;
+    entry.msg_ = p;
+    entry.msg_size_ = end - p;
+    return true;
+}
+
+//----------------------------------------------------------------------
+void LogIndex::extend(const char *data, const qint64 &size, const bool &complete)
+{
+    if (complete_)
+        return;
+
+    Context context = context_;
+    Block block;
+    initBlock(block, indexed_size_, context);
+
+    qint64 pos = indexed_size_;
+    while (pos < size)
+    {
+        const char *line_end = (const char*)memchr(data + pos, '\n', (size_t)(size - pos));
+        // the last line is still being written
+        if (!line_end && !complete)
+            break;
+
+        qint64 next = line_end ? line_end - data + 1 : size;
+        int line_size = (int)((line_end ? line_end - data : size) - pos);
+        if (line_size > 0 && data[pos + line_size - 1] == '\r')
+            --line_size;
+
+        Entry entry;
+        if (parseLine(data + pos, line_size, context, entry))
+        {
+            QByteArray domain = QByteArray::fromRawData(entry.domain_, entry.domain_size_);
+            int bit = domain_bits_.value(domain, -1);
+            if (bit < 0)
+            {
+                // more than 32 domains share the last bit
+                bit = qMin(domain_bits_.size(), 31);
+                domain_bits_.insert(QByteArray(entry.domain_, entry.domain_size_), bit);
+            }
+            addToBlock(block, entry, bit);
+        }
+
+        pos = next;
+        if (pos - block.start_ >= BLOCK_SIZE)
+        {
+            block.end_ = pos;
+            appendBlock(block);
+            indexed_size_ = pos;
+            context_ = context;
+            initBlock(block, pos, context);
+        }
+    }
+
+    if (complete)
+    {
+        if (pos > block.start_)
+        {
+            block.end_ = pos;
+            appendBlock(block);
+        }
+        indexed_size_ = pos;
+        context_ = context;
+        complete_ = true;
+    }
+}
+
+//----------------------------------------------------------------------
+bool LogIndex::mayMatch(const Block &block, const LogQuery &query) const
+{
+    if (!(block.status_mask_ & query.status_mask_))
+        return false;
+    if (query.from_ > 0 && block.max_time_ < query.from_)
+        return false;
+    if (query.to_ > 0 && block.min_time_ > query.to_)
+        return false;
+    if (!query.domain_.isEmpty())
+    {
+        int bit = domain_bits_.value(query.domain_, -1);
+        if (bit < 0 || !(block.domain_mask_ & (1u << bit)))
+            return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+bool LogIndex::mayMatch(const LogQuery &query) const
+{
+    if (!complete_)
+        return true;
+    return mayMatch(summary_, query);
+}
+
+//----------------------------------------------------------------------
+bool LogIndex::scan(const char *data, const qint64 &start, const qint64 &end,
+                    Context context, const LogQuery &query,
+                    const QString &file_name, QVariantList &matches) const
+{
+    QByteArrayMatcher matcher(query.text_);
+    qint64 pos = start;
+    while (pos < end)
+    {
+        const char *line_end = (const char*)memchr(data + pos, '\n', (size_t)(end - pos));
+        qint64 next = line_end ? line_end - data + 1 : end;
+        int line_size = (int)((line_end ? line_end - data : end) - pos);
+        if (line_size > 0 && data[pos + line_size - 1] == '\r')
+            --line_size;
+
+        Entry entry;
+        qint64 offset = pos;
+        pos = next;
+        if (!parseLine(data + offset, line_size, context, entry))
+            continue;
+
+        if (!(query.status_mask_ & (1u << entry.status_))
+            || (query.from_ > 0 && entry.time_ < query.from_)
+            || (query.to_ > 0 && entry.time_ > query.to_))
+        {
+            continue;
+        }
+        if (!query.domain_.isEmpty()
+            && (entry.domain_size_ != query.domain_.size()
+                || memcmp(entry.domain_, query.domain_.constData(), entry.domain_size_) != 0))
+        {
+            continue;
+        }
+        if (!query.text_.isEmpty() && matcher.indexIn(entry.msg_, entry.msg_size_) < 0)
+            continue;
+
+        QVariantMap match;
+        match.insert("file", file_name);
+        match.insert("offset", offset);
+        match.insert("time", entry.time_);
+        match.insert("status", entry.status_);
+        match.insert("domain", QString::fromLocal8Bit(entry.domain_, entry.domain_size_));
+        match.insert("code", entry.code_);
+        match.insert("message", QString::fromLocal8Bit(entry.msg_, entry.msg_size_));
+        matches << match;
+        if (matches.size() >= query.limit_)
+            return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+void LogIndex::query(const char *data, const qint64 &size, const LogQuery &query,
+                     const QString &file_name, QVariantList &matches,
+                     QVariantMap &stats) const
+{
+    int skipped = 0;
+    bool more = true;
+    for (int i = 0; i < blocks_.size() && more; ++i)
+    {
+        const Block &block = blocks_[i];
+        if (!mayMatch(block, query))
+        {
+            ++skipped;
+            continue;
+        }
+        more = scan(data, block.start_, block.end_, block.context_, query,
+                    file_name, matches);
+    }
+
+    // the tail which doesn't fill a block yet
+    if (more && indexed_size_ < size)
+        scan(data, indexed_size_, size, context_, query, file_name, matches);
+
+    stats.insert("blocks", stats.value("blocks").toInt() + blocks_.size());
+    stats.insert("skippedBlocks", stats.value("skippedBlocks").toInt() + skipped);
+}
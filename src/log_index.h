@@ -0,0 +1,248 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef LOG_INDEX_H
+#define LOG_INDEX_H
+
+#include <QByteArray>
+#include <QDate>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include <QVariantMap>
+
+/**
+ * Filter for searching log files
+ */
+struct LogQuery
+{
+    /**
+     * bit (1 << status) is set for every status to find
+     */
+    quint32 status_mask_;
+
+    /**
+     * the domain to find, empty for all domains
+     */
+    QByteArray domain_;
+
+    /**
+     * time range in ms since epoch, 0 for an open end
+     */
+    qint64 from_;
+    qint64 to_;
+
+    /**
+     * the message has to contain this text, empty for all messages
+     */
+    QByteArray text_;
+
+    /**
+     * maximum number of matches
+     */
+    int limit_;
+
+    LogQuery();
+
+    /**
+     * Set the filter from a JS query object
+     * @param query QVariantMap, may contain status (int or list of ints),
+     *        minStatus, domain, from, to, text and limit
+     */
+    void set(const QVariantMap &query);
+};
+
+/**
+ * Block index of a log file. The file gets split into blocks of about
+ * BLOCK_SIZE bytes, each block knows the time range, the status codes
+ * and the domains of its lines. Searches skip the blocks which can't
+ * contain a match.
+ */
+class LogIndex
+{
+    /**
+     * Where the parser is in time: the day of the current session and
+     * the time of the last line, which is needed to notice midnight
+     */
+    struct Context
+    {
+        int day_;
+        qint64 day_start_;
+        int last_time_;
+    };
+
+    struct Block
+    {
+        qint64 start_;
+        qint64 end_;
+        qint64 min_time_;
+        qint64 max_time_;
+        quint32 status_mask_;
+        quint32 domain_mask_;
+        Context context_;
+    };
+
+    /**
+     * A parsed log line, points into the log data
+     */
+    struct Entry
+    {
+        qint64 time_;
+        int status_;
+        const char *domain_;
+        int domain_size_;
+        int code_;
+        const char *msg_;
+        int msg_size_;
+    };
+
+    QVector<Block> blocks_;
+    QHash<QByteArray, int> domain_bits_;
+    QList<QByteArray> status_names_;
+    Context context_;
+    qint64 indexed_size_;
+    bool complete_;
+
+    /**
+     * Summary of all blocks
+     */
+    Block summary_;
+
+    /**
+     * Set a context to the start of a day
+     * @param context Context, the context to set
+     * @param date QDate, the day
+     */
+    static void setDay(Context &context, const QDate &date);
+
+    /**
+     * Start an empty block
+     * @param block Block, the block to reset
+     * @param start qint64, the offset where the block starts
+     * @param context Context, the context at the start of the block
+     */
+    static void initBlock(Block &block, const qint64 &start, const Context &context);
+
+    /**
+     * Add an entry to the time range and masks of a block
+     * @param block Block, the block
+     * @param entry Entry, the entry
+     * @param domain_bit int, the bit of the domain of the entry
+     */
+    static void addToBlock(Block &block, const Entry &entry, const int &domain_bit);
+
+    /**
+     * Add a block to the index
+     * @param block Block, the finished block
+     */
+    void appendBlock(const Block &block);
+
+    /**
+     * Parse a session start or end line
+     * @param line char*, the line, starting with "========== "
+     * @param size int, the length of the line
+     * @param date QDate, gets the day of the line
+     * @param time int, gets the time of day in ms
+     * @return bool false if it is no session line with a valid time
+     */
+    static bool parseSessionLine(const char *line, const int &size, QDate &date, int &time);
+
+    /**
+     * Parse a line of the log file. Session start lines only update
+     * the context and don't count as entry.
+     * @param line char*, the line without the line end
+     * @param size int, the length of the line
+     * @param context Context, gets updated
+     * @param entry Entry, gets filled
+     * @return bool true if the line is a log entry
+     */
+    bool parseLine(const char *line, const int &size, Context &context, Entry &entry) const;
+
+    /**
+     * Check if a block may contain lines matching a query
+     * @param block Block, the block
+     * @param query LogQuery, the filter
+     * @return bool false if the block can be skipped
+     */
+    bool mayMatch(const Block &block, const LogQuery &query) const;
+
+    /**
+     * Search a part of the log data line by line
+     * @return bool false if the limit got reached
+     */
+    bool scan(const char *data, const qint64 &start, const qint64 &end,
+              Context context, const LogQuery &query, const QString &file_name,
+              QVariantList &matches) const;
+
+public:
+    /**
+     * the size of a block in bytes
+     */
+    static const int BLOCK_SIZE;
+
+    LogIndex();
+
+    /**
+     * Find the day of the lines in front of the first session line, the
+     * day of the session less the midnights passed before it
+     * @param data char*, the log data
+     * @param size qint64, the size of the log data
+     * @return QDate the day, invalid if there is no session line
+     */
+    static QDate findStartDate(const char *data, const qint64 &size);
+
+    /**
+     * Drop the index
+     * @param start_date QDate, the day of lines in front of the first
+     *        session start line
+     */
+    void clear(const QDate &start_date);
+
+    /**
+     * Get the number of indexed bytes
+     * @return qint64 the size of the indexed part of the log data
+     */
+    qint64 getIndexedSize() const;
+
+    /**
+     * Index the complete lines added to the log data since the last call
+     * @param data char*, the log data
+     * @param size qint64, the size of the log data
+     * @param complete bool, true if the data won't grow anymore, so the
+     *        last block can be closed
+     */
+    void extend(const char *data, const qint64 &size, const bool &complete);
+
+    /**
+     * Check if the log data may contain lines matching a query, without
+     * touching the data. Only gives an answer for complete indexes.
+     * @param query LogQuery, the filter
+     * @return bool false if the data can be skipped
+     */
+    bool mayMatch(const LogQuery &query) const;
+
+    /**
+     * Search the log data, it has to be indexed up to getIndexedSize()
+     * @param data char*, the log data
+     * @param size qint64, the size of the log data
+     * @param query LogQuery, the filter
+     * @param file_name QString, added to each match
+     * @param matches QVariantList, the matching lines get appended, as
+     *        map with file, offset, time, status, domain, code and message
+     * @param stats QVariantMap, counts blocks and skippedBlocks
+     */
+    void query(const char *data, const qint64 &size, const LogQuery &query,
+               const QString &file_name, QVariantList &matches,
+               QVariantMap &stats) const;
+};
+
+#endif // LOG_INDEX_H
@@ -0,0 +1,308 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "log_query_bench.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QList>
+#include <QTextStream>
+
+#include "log_file.h"
+#include "log_handler.h"
+#include "log_info.h"
+
+const qint64 LogQueryBench::FILE_SIZE = 64 * 1024 * 1024;
+const int LogQueryBench::SESSION_LINES = 500000;
+const int LogQueryBench::INCIDENT_LINES = 100000;
+
+//----------------------------------------------------------------------
+LogQueryBench::LogQueryBench(const int &megabytes) :
+    megabytes_(megabytes > 0 ? megabytes : 300), end_time_(0)
+{
+    dir_ = QDir(QDir::tempPath() + "/greenj_log_bench_"
+                + QString::number(QCoreApplication::applicationPid()));
+}
+
+//----------------------------------------------------------------------
+bool LogQueryBench::generate()
+{
+    static const char *domains[] = {
+        "pjsip", "phone", "call", "sound", "js", "config", "rpc", "event"
+    };
+    static const int domain_count = sizeof(domains) / sizeof(domains[0]);
+
+    if (!dir_.mkpath(dir_.absolutePath()))
+        return false;
+
+    // the same logs on every run, three days back, so midnights get passed
+    qsrand(1);
+    QDate day = QDate::currentDate().addDays(-3);
+    int second = 0;
+    qint64 total = (qint64)megabytes_ * 1024 * 1024;
+    qint64 written = 0;
+    qint64 file_size = 0;
+    qint64 line = 0;
+
+    QFile file;
+    QByteArray buffer;
+    QByteArray clock = QTime(0, 0).toString("hh:mm:ss").toLatin1();
+    char text[256];
+    while (written < total)
+    {
+        if (!file.isOpen() || file_size >= FILE_SIZE)
+        {
+            if (file.isOpen() && file.write(buffer) != buffer.size())
+                return false;
+            buffer.clear();
+            file.close();
+
+            file.setFileName(dir_.filePath("log_" + QString::number(files_.size()) + ".log"));
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+                return false;
+            files_ << file.fileName();
+            file_size = 0;
+        }
+
+        int length;
+        if (line % SESSION_LINES == 0)
+        {
+            QDateTime time(day, QTime(0, 0).addSecs(second));
+            length = qsnprintf(text, sizeof(text), "========== %s - Session started ==========\n",
+                               time.toString("ddd dd.MM.yyyy hh:mm:ss").toLatin1().constData());
+        }
+        else
+        {
+            int call = (int)(line / 200 % 10000);
+            if (line % INCIDENT_LINES < 20)
+            {
+                // an outage: errors of a domain which logs nothing else
+                length = qsnprintf(text, sizeof(text), "%s [ERROR] registrar: [408] registration"
+                                   " at sip:backup.example.org failed, timeout\n", clock.constData());
+            }
+            else
+            {
+                int r = qrand() % 100;
+                const char *domain = domains[qrand() % domain_count];
+                if (r < 70)
+                    length = qsnprintf(text, sizeof(text), "%s [DEBUG] %s: [0] call %d rtp rx %d tx %d packets\n",
+                                       clock.constData(), domain, call, qrand() % 100000, qrand() % 100000);
+                else if (r < 98)
+                    length = qsnprintf(text, sizeof(text), "%s [MESSAGE] %s: [0] call %d state changed to %d\n",
+                                       clock.constData(), domain, call, qrand() % 7);
+                else
+                    length = qsnprintf(text, sizeof(text), "%s [WARNING] %s: [0] call %d jitter %d ms above threshold\n",
+                                       clock.constData(), domain, call, 40 + qrand() % 200);
+            }
+        }
+        buffer.append(text, length);
+        written += length;
+        file_size += length;
+        ++line;
+
+        // 16 lines per second
+        if (line % 16 == 0)
+        {
+            if (++second >= 24 * 3600)
+            {
+                second = 0;
+                day = day.addDays(1);
+            }
+            clock = QTime(0, 0).addSecs(second).toString("hh:mm:ss").toLatin1();
+        }
+        if (buffer.size() >= 1024 * 1024)
+        {
+            if (file.write(buffer) != buffer.size())
+                return false;
+            buffer.clear();
+        }
+    }
+    if (file.write(buffer) != buffer.size())
+        return false;
+    file.close();
+
+    end_time_ = QDateTime(day, QTime(0, 0).addSecs(second)).toMSecsSinceEpoch();
+    return true;
+}
+
+//----------------------------------------------------------------------
+void LogQueryBench::cleanUp()
+{
+    for (int i = 0; i < files_.size(); ++i)
+        QFile::remove(files_[i]);
+    files_.clear();
+    dir_.rmdir(dir_.absolutePath());
+}
+
+//----------------------------------------------------------------------
+bool LogQueryBench::linearScan(const LogQuery &query, QVariantList &matches) const
+{
+    for (int i = 0; i < files_.size(); ++i)
+    {
+        QFile file(files_[i]);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+        const char *data = (const char*)file.map(0, file.size());
+        if (!data)
+            return false;
+
+        // an index without blocks scans everything as its tail
+        LogIndex index;
+        index.clear(LogIndex::findStartDate(data, file.size()));
+        QVariantMap stats;
+        index.query(data, file.size(), query, files_[i], matches, stats);
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+bool LogQueryBench::benchQuery(const QString &name, const LogQuery &query,
+                               QVariantMap &result) const
+{
+    QElapsedTimer timer;
+    QVariantList linear_matches;
+    timer.start();
+    if (!linearScan(query, linear_matches))
+        return false;
+    qint64 linear_ms = timer.elapsed();
+
+    // like LogHandler::queryLog(), the files keep their index between queries
+    QList<LogFile*> log_files;
+    for (int i = 0; i < files_.size(); ++i)
+        log_files << new LogFile(files_[i]);
+
+    qint64 indexed_ms[2];
+    QVariantList indexed_matches;
+    QVariantMap stats;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        indexed_matches.clear();
+        stats.clear();
+        timer.restart();
+        for (int i = 0; i < log_files.size(); ++i)
+        {
+            if (!log_files[i]->mayMatch(query) || !log_files[i]->open())
+                continue;
+            log_files[i]->query(query, indexed_matches, stats);
+            log_files[i]->close();
+        }
+        indexed_ms[pass] = timer.elapsed();
+    }
+    qDeleteAll(log_files);
+
+    int blocks = stats.value("blocks").toInt();
+    result.insert("name", name);
+    result.insert("matches", indexed_matches.size());
+    result.insert("linearMs", linear_ms);
+    result.insert("indexedMs", indexed_ms[0]);
+    result.insert("repeatedMs", indexed_ms[1]);
+    result.insert("skippedBlocks", blocks > 0
+                                   ? stats.value("skippedBlocks").toInt() * 100.0 / blocks : 0.0);
+
+    if (indexed_matches.size() != linear_matches.size())
+    {
+        LOG_ERROR("bench", 0, "Query " + name + " found " + QString::number(indexed_matches.size())
+                  + " lines with index and " + QString::number(linear_matches.size())
+                  + " without");
+        return false;
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+void LogQueryBench::printResults(const QVariantList &results) const
+{
+    QTextStream out(stdout);
+    out << QString("query").leftJustified(12)
+        << QString("matches").rightJustified(9)
+        << QString("linear ms").rightJustified(11)
+        << QString("index ms").rightJustified(10)
+        << QString("again ms").rightJustified(10)
+        << QString("skipped %").rightJustified(11) << "\n";
+
+    for (int i = 0; i < results.size(); ++i)
+    {
+        QVariantMap r = results[i].toMap();
+        out << r.value("name").toString().leftJustified(12)
+            << QString::number(r.value("matches").toInt()).rightJustified(9)
+            << QString::number(r.value("linearMs").toLongLong()).rightJustified(11)
+            << QString::number(r.value("indexedMs").toLongLong()).rightJustified(10)
+            << QString::number(r.value("repeatedMs").toLongLong()).rightJustified(10)
+            << QString::number(r.value("skippedBlocks").toDouble(), 'f', 1).rightJustified(11)
+            << "\n";
+    }
+    out << "index ms includes building the index, again ms reuses it;"
+        << " the files are in the page cache\n";
+}
+
+//----------------------------------------------------------------------
+bool LogQueryBench::run(QVariantList &results)
+{
+    QTextStream out(stdout);
+    QElapsedTimer timer;
+    timer.start();
+    if (!generate())
+    {
+        LOG_FATAL_ERROR("bench", 0, "Error writing the log files to " + dir_.absolutePath());
+        cleanUp();
+        return false;
+    }
+    out << "wrote " << megabytes_ << " MB in " << files_.size() << " files in "
+        << timer.elapsed() << " ms\n";
+    out.flush();
+
+    QList<QString> names;
+    QList<LogQuery> queries;
+
+    LogQuery errors;
+    errors.status_mask_ = (1u << LogInfo::STATUS_ERROR) | (1u << LogInfo::STATUS_FATAL_ERROR);
+    names << "errors";
+    queries << errors;
+
+    LogQuery domain;
+    domain.domain_ = "registrar";
+    names << "domain";
+    queries << domain;
+
+    LogQuery last_hour;
+    last_hour.from_ = end_time_ - 3600 * 1000;
+    names << "last hour";
+    queries << last_hour;
+
+    LogQuery warnings;
+    warnings.status_mask_ = 1u << LogInfo::STATUS_WARNING;
+    warnings.from_ = end_time_ - 24 * 3600 * 1000;
+    warnings.text_ = "call 1234 ";
+    names << "call warn";
+    queries << warnings;
+
+    // only the message, the index can't help
+    LogQuery text;
+    text.text_ = "call 1234 state";
+    names << "text";
+    queries << text;
+
+    bool ok = true;
+    for (int i = 0; i < queries.size(); ++i)
+    {
+        // every match counts, so both ways read the same lines
+        queries[i].limit_ = 10000000;
+        QVariantMap result;
+        ok = benchQuery(names[i], queries[i], result) && ok;
+        results << QVariant(result);
+    }
+    cleanUp();
+
+    printResults(results);
+    return ok;
+}
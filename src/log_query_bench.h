@@ -0,0 +1,105 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef LOG_QUERY_BENCH_H
+#define LOG_QUERY_BENCH_H
+
+#include <QDir>
+#include <QStringList>
+#include <QVariantList>
+
+#include "log_index.h"
+
+/**
+ * Writes log files in the format of LogHandler into a temporary
+ * directory and runs some queries on them, once with the block index of
+ * LogFile and once as linear scan over every line. greenjd runs it with
+ * --log-query-bench [megabytes].
+ */
+class LogQueryBench
+{
+    int megabytes_;
+    QDir dir_;
+    QStringList files_;
+
+    /**
+     * time of the last line in ms since epoch
+     */
+    qint64 end_time_;
+
+    /**
+     * Write the log files
+     * @return bool false if a file couldn't be written
+     */
+    bool generate();
+
+    /**
+     * Delete the log files and the directory
+     */
+    void cleanUp();
+
+    /**
+     * Search every line of every file, without index
+     * @param query LogQuery, the filter
+     * @param matches QVariantList, gets the matching lines
+     * @return bool false if a file couldn't be read
+     */
+    bool linearScan(const LogQuery &query, QVariantList &matches) const;
+
+    /**
+     * Run one query both ways
+     * @param name QString, the name of the query
+     * @param query LogQuery, the filter
+     * @param result QVariantMap, gets name, matches, linearMs, indexedMs
+     *        (first query, including building the index), repeatedMs
+     *        (index already built) and skippedBlocks (%)
+     * @return bool false if the results differ
+     */
+    bool benchQuery(const QString &name, const LogQuery &query, QVariantMap &result) const;
+
+    /**
+     * Print the results as table
+     * @param results QVariantList, a map per query
+     */
+    void printResults(const QVariantList &results) const;
+
+public:
+    /**
+     * Size of a log file in bytes, bigger logs get split into several
+     */
+    static const qint64 FILE_SIZE;
+
+    /**
+     * Lines between two session starts
+     */
+    static const int SESSION_LINES;
+
+    /**
+     * Lines between two bursts of errors
+     */
+    static const int INCIDENT_LINES;
+
+    /**
+     * Constructor
+     * @param megabytes int, size of all log files together
+     */
+    LogQueryBench(const int &megabytes);
+
+    /**
+     * Run the benchmark and print the results to stdout
+     * @param results QVariantList, gets a map per query (see benchQuery())
+     * @return bool false if the files couldn't be written or the index
+     *         found other lines than the linear scan
+     */
+    bool run(QVariantList &results);
+};
+
+#endif // LOG_QUERY_BENCH_H
@@ -0,0 +1,284 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "log_writer.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDate>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QThreadPool>
+
+#include "log_file.h"
+
+#include <limits.h>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+const int LogWriter::FSYNC_NONE = 0x00;
+const int LogWriter::FSYNC_FLUSH = 0x01;
+
+/**
+ * Compresses a rotated log file and removes the original
+ */
+class LogCompressTask : public QRunnable
+{
+    QString file_name_;
+
+public:
+    LogCompressTask(const QString &file_name) : file_name_(file_name) {}
+
+    void run()
+    {
+        QFile src(file_name_);
+        if (!src.open(QIODevice::ReadOnly))
+            return;
+        QByteArray data = qCompress(src.readAll());
+        src.close();
+
+        QString dst_name = file_name_ + LogFile::COMPRESSED_SUFFIX;
+        QFile dst(dst_name + ".tmp");
+        if (!dst.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return;
+        bool ok = dst.write(data) == data.size();
+        dst.close();
+
+        if (ok && QFile::rename(dst.fileName(), dst_name))
+            QFile::remove(file_name_);
+        else
+            dst.remove();
+    }
+};
+
+//----------------------------------------------------------------------
+LogWriter::LogWriter() :
+    stop_(false), max_queue_(10000), flush_size_(4096), flush_interval_(1000),
+    fsync_policy_(FSYNC_NONE), max_size_(0), compress_(false),
+    bytes_written_(0), messages_written_(0), dropped_(0), flushes_(0),
+    high_watermark_(0), rotations_(0)
+{
+}
+
+//----------------------------------------------------------------------
+LogWriter::~LogWriter()
+{
+    stop();
+}
+
+//----------------------------------------------------------------------
+void LogWriter::setup(const QString &prefix, const int &max_queue,
+                      const int &flush_size, const int &flush_interval,
+                      const int &fsync_policy)
+{
+    QMutexLocker locker(&mutex_);
+    prefix_ = prefix;
+    max_queue_ = max_queue;
+    flush_size_ = flush_size;
+    flush_interval_ = flush_interval;
+    fsync_policy_ = fsync_policy;
+}
+
+//----------------------------------------------------------------------
+void LogWriter::setRotation(const qint64 &max_size, const bool &compress)
+{
+    QMutexLocker locker(&mutex_);
+    max_size_ = max_size;
+    compress_ = compress;
+}
+
+//----------------------------------------------------------------------
+QString LogWriter::getFileName() const
+{
+    return prefix_ + QDate::currentDate().toString("MM-yyyy") + ".log";
+}
+
+//----------------------------------------------------------------------
+bool LogWriter::enqueue(const QString &msg)
+{
+    QMutexLocker locker(&mutex_);
+    if (queue_.size() >= max_queue_)
+    {
+        ++dropped_;
+        return false;
+    }
+
+    queue_.append(msg);
+    if (queue_.size() > high_watermark_)
+        high_watermark_ = queue_.size();
+
+    // only the first message of a batch needs to wake up the writer
+    if (queue_.size() == 1)
+        wait_.wakeOne();
+    return true;
+}
+
+//----------------------------------------------------------------------
+void LogWriter::stop()
+{
+    mutex_.lock();
+    stop_ = true;
+    wait_.wakeOne();
+    mutex_.unlock();
+
+    wait();
+}
+
+//----------------------------------------------------------------------
+void LogWriter::run()
+{
+    QFile file;
+    QByteArray buffer;
+    int buffered_messages = 0;
+    QElapsedTimer since_flush;
+    since_flush.start();
+
+    for (;;)
+    {
+        QStringList batch;
+        bool stopping;
+        int flush_size;
+
+        mutex_.lock();
+        while (queue_.isEmpty() && !stop_)
+        {
+            unsigned long timeout = ULONG_MAX;
+            if (!buffer.isEmpty())
+            {
+                qint64 remaining = flush_interval_ - since_flush.elapsed();
+                if (remaining <= 0)
+                    break;
+                timeout = (unsigned long)remaining;
+            }
+            if (!wait_.wait(&mutex_, timeout))
+                break;
+        }
+        batch = queue_;
+        queue_.clear();
+        stopping = stop_;
+        flush_size = flush_size_;
+        mutex_.unlock();
+
+        for (int i = 0; i < batch.size(); ++i)
+            buffer.append(batch[i].toLocal8Bit());
+        buffered_messages += batch.size();
+
+        if (!buffer.isEmpty()
+            && (stopping || buffer.size() >= flush_size
+                || since_flush.elapsed() >= flush_interval_))
+        {
+            flushBuffer(file, buffer, buffered_messages);
+            buffered_messages = 0;
+            since_flush.restart();
+        }
+
+        if (stopping)
+            break;
+    }
+    file.close();
+}
+
+//----------------------------------------------------------------------
+void LogWriter::rotate(QFile &file, const int &size)
+{
+    QString file_name = getFileName();
+    if (file.fileName() != file_name)
+    {
+        // new month
+        QString old_name = file.fileName();
+        file.close();
+        file.setFileName(file_name);
+        if (!old_name.isEmpty() && QFile::exists(old_name))
+            compress(old_name);
+        return;
+    }
+
+    if (max_size_ <= 0)
+        return;
+
+    qint64 current = file.isOpen() ? file.size() : QFileInfo(file_name).size();
+    if (current == 0 || current + size <= max_size_)
+        return;
+
+    file.close();
+    QString rotated;
+    int n = 1;
+    do
+    {
+        rotated = file_name;
+        rotated.insert(rotated.size() - 4, "." + QString::number(n++));
+    } while (QFile::exists(rotated) || QFile::exists(rotated + LogFile::COMPRESSED_SUFFIX));
+
+    if (QFile::rename(file_name, rotated))
+    {
+        compress(rotated);
+        QMutexLocker locker(&mutex_);
+        ++rotations_;
+    }
+}
+
+//----------------------------------------------------------------------
+void LogWriter::compress(const QString &file_name)
+{
+    if (compress_)
+        QThreadPool::globalInstance()->start(new LogCompressTask(file_name));
+}
+
+//----------------------------------------------------------------------
+void LogWriter::flushBuffer(QFile &file, QByteArray &buffer, const int &messages)
+{
+    rotate(file, buffer.size());
+
+    if (!file.isOpen()
+        && !file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+    {
+        QMutexLocker locker(&mutex_);
+        dropped_ += messages;
+        buffer.clear();
+        return;
+    }
+
+    qint64 written = file.write(buffer);
+    file.flush();
+    if (fsync_policy_ == FSYNC_FLUSH)
+    {
+#ifdef Q_OS_WIN
+        _commit(file.handle());
+#else
+        fsync(file.handle());
+#endif
+    }
+    buffer.clear();
+
+    QMutexLocker locker(&mutex_);
+    if (written > 0)
+        bytes_written_ += written;
+    messages_written_ += messages;
+    ++flushes_;
+}
+
+//----------------------------------------------------------------------
+void LogWriter::getStatistics(QVariantMap &stats)
+{
+    QMutexLocker locker(&mutex_);
+    stats.insert("queueDepth", queue_.size());
+    stats.insert("highWatermark", high_watermark_);
+    stats.insert("bytesWritten", bytes_written_);
+    stats.insert("messagesWritten", messages_written_);
+    stats.insert("flushes", flushes_);
+    stats.insert("dropped", dropped_);
+    stats.insert("rotations", rotations_);
+}
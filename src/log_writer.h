@@ -0,0 +1,149 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef LOG_WRITER_H
+#define LOG_WRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QStringList>
+#include <QVariantMap>
+
+class QFile;
+
+/**
+ * Writes log messages into the log file on its own thread.
+ * Any thread can enqueue messages, the writer keeps the file open,
+ * collects the messages and writes them in batches.
+ * There is one log file per month, it gets rotated when it grows too
+ * big. Rotated files get compressed in the background.
+ */
+class LogWriter : public QThread
+{
+    Q_OBJECT
+
+    QMutex mutex_;
+    QWaitCondition wait_;
+    QStringList queue_;
+    bool stop_;
+
+    QString prefix_;
+    int max_queue_;
+    int flush_size_;
+    int flush_interval_;
+    int fsync_policy_;
+    qint64 max_size_;
+    bool compress_;
+
+    qint64 bytes_written_;
+    qint64 messages_written_;
+    int dropped_;
+    int flushes_;
+    int high_watermark_;
+    int rotations_;
+
+    /**
+     * Get the name of the current log file
+     * @return QString the file name
+     */
+    QString getFileName() const;
+
+    /**
+     * Switch to the log file of the current month and rotate the
+     * log file if the data doesn't fit into it anymore
+     * @param file QFile, the log file, gets closed if it changes
+     * @param size int, the number of bytes about to be written
+     */
+    void rotate(QFile &file, const int &size);
+
+    /**
+     * Compress a rotated log file in the background
+     * @param file_name QString, the rotated log file
+     */
+    void compress(const QString &file_name);
+
+    /**
+     * Write the buffered data to the file
+     * @param file QFile, the log file, gets (re)opened if necessary
+     * @param buffer QByteArray, the data, gets cleared on success
+     * @param messages int, number of messages in buffer
+     */
+    void flushBuffer(QFile &file, QByteArray &buffer, const int &messages);
+
+protected:
+    /**
+     * The writer loop
+     */
+    void run();
+
+public:
+    /**
+     * \name Fsync Policy
+     * \{
+     */
+    /**
+     * never fsync, leave it to the operating system
+     */
+    static const int FSYNC_NONE;
+
+    /**
+     * fsync after every flush
+     */
+    static const int FSYNC_FLUSH;
+    /**
+     * \}
+     */
+
+    LogWriter();
+    ~LogWriter();
+
+    /**
+     * Set the log file and the thresholds, call before start()
+     * @param prefix QString, the log file names start with it
+     * @param max_queue int, messages waiting at most, further messages get dropped
+     * @param flush_size int, write to the file when this many bytes are collected
+     * @param flush_interval int, write to the file after this many ms at the latest
+     * @param fsync_policy int, FSYNC_NONE or FSYNC_FLUSH
+     */
+    void setup(const QString &prefix, const int &max_queue,
+               const int &flush_size, const int &flush_interval,
+               const int &fsync_policy);
+
+    /**
+     * Set when to rotate the log file, call before start()
+     * @param max_size qint64, rotate when the file would grow beyond this
+     *        size, 0 to only rotate monthly
+     * @param compress bool, compress rotated files
+     */
+    void setRotation(const qint64 &max_size, const bool &compress);
+
+    /**
+     * Add a message to the queue. Safe to call from any thread.
+     * @param msg QString, the formatted message
+     * @return bool false if the queue is full and the message got dropped
+     */
+    bool enqueue(const QString &msg);
+
+    /**
+     * Write all pending messages and stop the writer thread
+     */
+    void stop();
+
+    /**
+     * Get the writer counters
+     * @param stats QVariantMap, gets queueDepth, highWatermark, bytesWritten,
+     *        messagesWritten, flushes, dropped and rotations
+     */
+    void getStatistics(QVariantMap &stats);
+};
+
+#endif // LOG_WRITER_H
@@ -10,19 +10,43 @@
 ****************************************************************************/
 
 #include <QtGui/QApplication>
+#include <QStringList>
 #include "gui.h"
+#include "bridge_bench.h"
 #include "config_file_handler.h"
+#include "startup_timeline.h"
+#include "startup_report.h"
 
 int main(int argc, char *argv[])
 {
+    // the startup phases are counted from here
+    StartupTimeline &timeline = StartupTimeline::getInstance();
+
     QApplication a(argc, argv);
     a.setWindowIcon(QIcon(":images/icon.xpm"));
 
     ConfigFileHandler &instance = ConfigFileHandler::getInstance();
     instance.init();
+    timeline.mark("config");
+
+    // --bridge-bench [seconds] only measures the ways of events to the page
+    int index = a.arguments().indexOf("--bridge-bench");
+    if (index > 0)
+    {
+        BridgeBench bench(a.arguments().value(index + 1).toInt());
+        QVariantList results;
+        return bench.run(results) ? 0 : 1;
+    }
 
     Gui w;
     w.show();
+    timeline.mark("window");
+
+    // --startup-report prints the startup phases and the peak memory once
+    // the phone is ready and the page is loaded, then quits
+    StartupReport report(QStringList() << "window" << "page_loaded" << "ready");
+    if (a.arguments().contains("--startup-report"))
+        report.start();
 
     return a.exec();
 }
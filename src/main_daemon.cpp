@@ -0,0 +1,155 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include <QCoreApplication>
+#include <QStringList>
+#include "daemon.h"
+#include "codec_bench.h"
+#include "call_table_bench.h"
+#include "log_bench.h"
+#include "log_query_bench.h"
+#include "stand_in_registrar.h"
+#include "load_test.h"
+#include "config_file_handler.h"
+#include "log_handler.h"
+#include "startup_timeline.h"
+#include "startup_report.h"
+#include "signal_handler.h"
+
+/**
+ * Get the number after an argument
+ * @param args QStringList, the arguments
+ * @param name QString, the argument, e.g. "--rate"
+ * @param default_value int, used if the argument isn't there
+ * @return int the number
+ */
+static int intArgument(const QStringList &args, const QString &name, const int &default_value)
+{
+    int index = args.indexOf(name);
+    if (index < 0 || index + 1 >= args.size())
+        return default_value;
+    return args[index + 1].toInt();
+}
+
+int main(int argc, char *argv[])
+{
+    // the startup phases are counted from here
+    StartupTimeline &timeline = StartupTimeline::getInstance();
+
+    QCoreApplication a(argc, argv);
+
+    ConfigFileHandler &instance = ConfigFileHandler::getInstance();
+    instance.init();
+    timeline.mark("config");
+
+    // SIGINT and SIGTERM leave the event loop, everything gets shut down
+    SignalHandler signal_handler;
+    signal_handler.install();
+
+    QStringList args = a.arguments();
+
+    // --codec-bench [seconds] only measures the codecs
+    int index = args.indexOf("--codec-bench");
+    if (index > 0)
+    {
+        CodecBench bench(args.value(index + 1).toInt());
+        QVariantList results;
+        return bench.run(results) ? 0 : 1;
+    }
+
+    // --call-table-bench [lookups] compares call lookups to the old call list
+    index = args.indexOf("--call-table-bench");
+    if (index > 0)
+    {
+        CallTableBench bench(args.value(index + 1).toInt());
+        QVariantList results;
+        return bench.run(results) ? 0 : 1;
+    }
+
+    // --log-bench [calls] measures filtered out log statements
+    index = args.indexOf("--log-bench");
+    if (index > 0)
+    {
+        LogBench bench(args.value(index + 1).toInt());
+        QVariantMap results;
+        return bench.run(results) ? 0 : 1;
+    }
+
+    // --log-query-bench [megabytes] compares indexed log queries to a linear scan
+    index = args.indexOf("--log-query-bench");
+    if (index > 0)
+    {
+        LogQueryBench bench(args.value(index + 1).toInt());
+        QVariantList results;
+        return bench.run(results) ? 0 : 1;
+    }
+
+    // --stand-in [port] is the registrar of the load test
+    index = args.indexOf("--stand-in");
+    if (index > 0)
+    {
+        int port = args.value(index + 1).toInt();
+        StandInRegistrar registrar(port > 0 ? port : 5070);
+        if (!registrar.start())
+            return 1;
+        return a.exec();
+    }
+
+    // --load-test drives the phone with many accounts and calls
+    if (args.contains("--load-test"))
+    {
+        LoadTest::Options options;
+        index = args.indexOf("--target");
+        options.target_ = index > 0 ? args.value(index + 1) : QString();
+        options.stand_in_port_ = intArgument(args, "--stand-in-port", 5070);
+        index = args.indexOf("--transport");
+        options.transport_ = index > 0 ? args.value(index + 1).toLower() : QString();
+        if (!options.transport_.isEmpty() && options.transport_ != "udp"
+            && options.transport_ != "tcp" && options.transport_ != "tls")
+        {
+            LOG_FATAL_ERROR("load_test", 0, "Unknown transport " + options.transport_);
+            return 1;
+        }
+        options.accounts_ = intArgument(args, "--accounts", 10);
+        options.concurrency_ = intArgument(args, "--concurrency", 10);
+        options.rate_ = intArgument(args, "--rate", 5);
+        options.calls_ = intArgument(args, "--calls", 100);
+        options.talk_ = intArgument(args, "--talk", 5);
+        options.register_only_ = args.contains("--register-only");
+        options.duration_ = intArgument(args, "--duration", 120);
+        options.reg_expires_ = intArgument(args, "--reg-expires",
+                                           options.register_only_ ? 30 : 0);
+
+        LoadTest test(options);
+        if (!test.start())
+            return 1;
+        return a.exec();
+    }
+
+    // --socket <name> overrides the socket name of the config file
+    QString socket_name = instance.getRpcSocketName();
+    index = args.indexOf("--socket");
+    if (index > 0 && index + 1 < args.size())
+        socket_name = args[index + 1];
+
+    Daemon d;
+    if (!d.listen(socket_name))
+        return 1;
+    timeline.mark("listening");
+
+    // --startup-report prints the startup phases and the peak memory once
+    // the phone is ready, then quits
+    StartupReport report(QStringList() << "listening" << "ready");
+    if (args.contains("--startup-report"))
+        report.start();
+
+    return a.exec();
+}
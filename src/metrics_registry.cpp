@@ -0,0 +1,222 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "metrics_registry.h"
+
+#include <QMutexLocker>
+
+const double MetricsRegistry::BUCKET_BOUNDS[] = {
+    0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60
+};
+const int MetricsRegistry::BUCKET_BOUND_COUNT =
+    sizeof(MetricsRegistry::BUCKET_BOUNDS) / sizeof(MetricsRegistry::BUCKET_BOUNDS[0]);
+
+//----------------------------------------------------------------------
+MetricsRegistry::Counter::Counter() :
+    value_(0)
+{
+}
+
+//----------------------------------------------------------------------
+void MetricsRegistry::Counter::increment(const int &n)
+{
+    value_.fetchAndAddRelaxed(n);
+}
+
+//----------------------------------------------------------------------
+int MetricsRegistry::Counter::getValue() const
+{
+    return value_;
+}
+
+//----------------------------------------------------------------------
+MetricsRegistry::Gauge::Gauge() :
+    value_(0)
+{
+}
+
+//----------------------------------------------------------------------
+void MetricsRegistry::Gauge::set(const double &value)
+{
+    QMutexLocker locker(&mutex_);
+    value_ = value;
+}
+
+//----------------------------------------------------------------------
+double MetricsRegistry::Gauge::getValue() const
+{
+    QMutexLocker locker(&mutex_);
+    return value_;
+}
+
+//----------------------------------------------------------------------
+void MetricsRegistry::Histogram::observe(const qint64 &us)
+{
+    QMutexLocker locker(&mutex_);
+    histogram_.add(us);
+}
+
+//----------------------------------------------------------------------
+void MetricsRegistry::Histogram::set(const LatencyHistogram &histogram)
+{
+    QMutexLocker locker(&mutex_);
+    histogram_ = histogram;
+}
+
+//----------------------------------------------------------------------
+LatencyHistogram MetricsRegistry::Histogram::get() const
+{
+    QMutexLocker locker(&mutex_);
+    return histogram_;
+}
+
+//----------------------------------------------------------------------
+MetricsRegistry::MetricsRegistry()
+{
+}
+
+//----------------------------------------------------------------------
+MetricsRegistry &MetricsRegistry::getInstance()
+{
+    static MetricsRegistry instance;
+    return instance;
+}
+
+//----------------------------------------------------------------------
+MetricsRegistry::Metric &MetricsRegistry::find(const QString &name, const QString &help,
+                                               const Type &type, const QString &labels)
+{
+    int f = 0;
+    while (f < families_.size() && families_[f].name_ != name)
+        ++f;
+    if (f == families_.size())
+    {
+        Family family;
+        family.name_ = name;
+        family.help_ = help;
+        family.type_ = type;
+        families_ << family;
+    }
+
+    QList<Metric> &metrics = families_[f].metrics_;
+    for (int i = 0; i < metrics.size(); ++i)
+    {
+        if (metrics[i].labels_ == labels)
+            return metrics[i];
+    }
+
+    // a name keeps the type of its first lookup
+    Type family_type = families_[f].type_;
+    Metric metric;
+    metric.labels_ = labels;
+    metric.counter_ = family_type == TYPE_COUNTER ? new Counter : 0;
+    metric.gauge_ = family_type == TYPE_TOTAL || family_type == TYPE_GAUGE ? new Gauge : 0;
+    metric.histogram_ = family_type == TYPE_HISTOGRAM ? new Histogram : 0;
+    metrics << metric;
+    return metrics.last();
+}
+
+//----------------------------------------------------------------------
+MetricsRegistry::Counter *MetricsRegistry::counter(const QString &name, const QString &help,
+                                                   const QString &labels)
+{
+    QMutexLocker locker(&mutex_);
+    return find(name, help, TYPE_COUNTER, labels).counter_;
+}
+
+//----------------------------------------------------------------------
+MetricsRegistry::Gauge *MetricsRegistry::total(const QString &name, const QString &help,
+                                               const QString &labels)
+{
+    QMutexLocker locker(&mutex_);
+    return find(name, help, TYPE_TOTAL, labels).gauge_;
+}
+
+//----------------------------------------------------------------------
+MetricsRegistry::Gauge *MetricsRegistry::gauge(const QString &name, const QString &help,
+                                               const QString &labels)
+{
+    QMutexLocker locker(&mutex_);
+    return find(name, help, TYPE_GAUGE, labels).gauge_;
+}
+
+//----------------------------------------------------------------------
+MetricsRegistry::Histogram *MetricsRegistry::histogram(const QString &name, const QString &help,
+                                                       const QString &labels)
+{
+    QMutexLocker locker(&mutex_);
+    return find(name, help, TYPE_HISTOGRAM, labels).histogram_;
+}
+
+//----------------------------------------------------------------------
+void MetricsRegistry::writeSample(QTextStream &out, const QString &name,
+                                  const QString &labels, const QString &extra,
+                                  const double &value)
+{
+    out << name;
+    if (!labels.isEmpty() || !extra.isEmpty())
+    {
+        out << '{' << labels;
+        if (!labels.isEmpty() && !extra.isEmpty())
+            out << ',';
+        out << extra << '}';
+    }
+    out << ' ' << QString::number(value, 'g', 15) << '\n';
+}
+
+//----------------------------------------------------------------------
+QString MetricsRegistry::exportText() const
+{
+    static const char *TYPE_NAMES[] = { "counter", "counter", "gauge", "histogram" };
+
+    QString text;
+    QTextStream out(&text);
+    QMutexLocker locker(&mutex_);
+    for (int f = 0; f < families_.size(); ++f)
+    {
+        const Family &family = families_[f];
+        out << "# HELP " << family.name_ << ' ' << family.help_ << '\n';
+        out << "# TYPE " << family.name_ << ' ' << TYPE_NAMES[family.type_] << '\n';
+
+        for (int i = 0; i < family.metrics_.size(); ++i)
+        {
+            const Metric &metric = family.metrics_[i];
+            if (metric.counter_)
+            {
+                writeSample(out, family.name_, metric.labels_, QString(),
+                            metric.counter_->getValue());
+                continue;
+            }
+            if (metric.gauge_)
+            {
+                writeSample(out, family.name_, metric.labels_, QString(),
+                            metric.gauge_->getValue());
+                continue;
+            }
+
+            LatencyHistogram histogram = metric.histogram_->get();
+            for (int b = 0; b < BUCKET_BOUND_COUNT; ++b)
+            {
+                writeSample(out, family.name_ + "_bucket", metric.labels_,
+                            "le=\"" + QString::number(BUCKET_BOUNDS[b]) + "\"",
+                            histogram.countAtMost(BUCKET_BOUNDS[b] * 1000000));
+            }
+            writeSample(out, family.name_ + "_bucket", metric.labels_, "le=\"+Inf\"",
+                        histogram.getCount());
+            writeSample(out, family.name_ + "_sum", metric.labels_, QString(),
+                        histogram.getSum() / 1000000.0);
+            writeSample(out, family.name_ + "_count", metric.labels_, QString(),
+                        histogram.getCount());
+        }
+    }
+    out.flush();
+    return text;
+}
@@ -0,0 +1,217 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef METRICS_REGISTRY_H
+#define METRICS_REGISTRY_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QList>
+#include <QString>
+#include <QTextStream>
+#include "latency_histogram.h"
+
+/**
+ * This class is implemented as singleton.
+ * Counters, gauges and histograms of the whole process, written out in
+ * the Prometheus text exposition format. A metric is created by its first
+ * lookup and is never deleted, so the returned pointer can be kept.
+ * Counting never locks, setting a gauge or adding to a histogram locks
+ * the metric only.
+ */
+class MetricsRegistry
+{
+public:
+    /**
+     * Counter which only goes up, from any thread
+     */
+    class Counter
+    {
+        QAtomicInt value_;
+
+    public:
+        Counter();
+
+        /**
+         * Add to the counter
+         * @param n int, the amount
+         */
+        void increment(const int &n = 1);
+
+        /**
+         * Get the value
+         * @return int the value
+         */
+        int getValue() const;
+    };
+
+    /**
+     * Value which is set as a whole, usually when the metrics are collected
+     */
+    class Gauge
+    {
+        mutable QMutex mutex_;
+        double value_;
+
+    public:
+        Gauge();
+
+        /**
+         * Set the value
+         * @param value double, the value
+         */
+        void set(const double &value);
+
+        /**
+         * Get the value
+         * @return double the value
+         */
+        double getValue() const;
+    };
+
+    /**
+     * Durations, exported in seconds
+     */
+    class Histogram
+    {
+        mutable QMutex mutex_;
+        LatencyHistogram histogram_;
+
+    public:
+        /**
+         * Add a duration
+         * @param us qint64, the duration in us
+         */
+        void observe(const qint64 &us);
+
+        /**
+         * Replace all durations, for histograms kept elsewhere
+         * @param histogram LatencyHistogram, the durations
+         */
+        void set(const LatencyHistogram &histogram);
+
+        /**
+         * Get the durations
+         * @return LatencyHistogram a copy
+         */
+        LatencyHistogram get() const;
+    };
+
+private:
+    enum Type
+    {
+        TYPE_COUNTER,
+        TYPE_TOTAL,
+        TYPE_GAUGE,
+        TYPE_HISTOGRAM
+    };
+
+    struct Metric
+    {
+        QString labels_;
+        Counter *counter_;
+        Gauge *gauge_;
+        Histogram *histogram_;
+    };
+
+    /**
+     * Metrics of the same name, they differ by their labels
+     */
+    struct Family
+    {
+        QString name_;
+        QString help_;
+        Type type_;
+        QList<Metric> metrics_;
+    };
+
+    mutable QMutex mutex_;
+    QList<Family> families_;
+
+    /**
+     * Upper bounds of the exported histogram buckets in seconds
+     */
+    static const double BUCKET_BOUNDS[];
+    static const int BUCKET_BOUND_COUNT;
+
+    MetricsRegistry();
+    MetricsRegistry(const MetricsRegistry&);
+
+    /**
+     * Find or create a metric, the mutex has to be locked
+     * @param name QString, the name of the metric
+     * @param help QString, the description, taken from the first lookup
+     * @param type Type, the type of the metric
+     * @param labels QString, e.g. outcome="busy", may be empty
+     * @return Metric the metric
+     */
+    Metric &find(const QString &name, const QString &help, const Type &type,
+                 const QString &labels);
+
+    /**
+     * Write one line of the exposition format
+     * @param out QTextStream, gets the line
+     * @param name QString, the name of the sample
+     * @param labels QString, the labels of the metric
+     * @param extra QString, more labels, e.g. le="0.5"
+     * @param value double, the value
+     */
+    static void writeSample(QTextStream &out, const QString &name,
+                            const QString &labels, const QString &extra,
+                            const double &value);
+
+public:
+    /**
+     * Get instance of Singelton class
+     * @return MetricsRegistry the instance to this class
+     */
+    static MetricsRegistry &getInstance();
+
+    /**
+     * Get a counter, see find()
+     * @return Counter* the counter
+     */
+    Counter *counter(const QString &name, const QString &help,
+                     const QString &labels = QString());
+
+    /**
+     * Get a counter which is kept elsewhere and copied when the metrics are
+     * collected, see find()
+     * @return Gauge* the value, exported as counter
+     */
+    Gauge *total(const QString &name, const QString &help,
+                 const QString &labels = QString());
+
+    /**
+     * Get a gauge, see find()
+     * @return Gauge* the gauge
+     */
+    Gauge *gauge(const QString &name, const QString &help,
+                 const QString &labels = QString());
+
+    /**
+     * Get a histogram, see find()
+     * @return Histogram* the histogram
+     */
+    Histogram *histogram(const QString &name, const QString &help,
+                         const QString &labels = QString());
+
+    /**
+     * Write all metrics in the Prometheus text exposition format 0.0.4.
+     * Histogram buckets are made from the logarithmic buckets of
+     * LatencyHistogram. A duration only counts for the bounds its whole
+     * bucket fits below, so one up to 19% below a bound may be missed.
+     * @return QString the text
+     */
+    QString exportText() const;
+};
+
+#endif // METRICS_REGISTRY_H
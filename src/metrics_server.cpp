@@ -0,0 +1,127 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "metrics_server.h"
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QList>
+
+#include "phone.h"
+#include "log_handler.h"
+
+const int MetricsServer::MAX_REQUEST_SIZE = 8192;
+
+//----------------------------------------------------------------------
+MetricsServer::MetricsServer(Phone &phone, QObject *parent) :
+    QObject(parent), phone_(phone)
+{
+    server_ = new QTcpServer(this);
+    connect(server_, SIGNAL(newConnection()), this, SLOT(newConnection()));
+}
+
+//----------------------------------------------------------------------
+MetricsServer::~MetricsServer()
+{
+    server_->close();
+}
+
+//----------------------------------------------------------------------
+bool MetricsServer::listen(const int &port)
+{
+    if (!server_->listen(QHostAddress::LocalHost, port))
+    {
+        LOG_ERROR("metrics", 0, "Can't listen on port " + QString::number(port)
+                  + ": " + server_->errorString());
+        return false;
+    }
+    LOG_MESSAGE("metrics", 0, "Serving metrics on http://127.0.0.1:"
+                + QString::number(server_->serverPort()) + "/metrics");
+    return true;
+}
+
+//----------------------------------------------------------------------
+void MetricsServer::newConnection()
+{
+    while (server_->hasPendingConnections())
+    {
+        QTcpSocket *client = server_->nextPendingConnection();
+        clients_.insert(client, QByteArray());
+        connect(client, SIGNAL(readyRead()), this, SLOT(readClient()));
+        connect(client, SIGNAL(disconnected()), this, SLOT(clientDisconnected()));
+    }
+}
+
+//----------------------------------------------------------------------
+void MetricsServer::clientDisconnected()
+{
+    QTcpSocket *client = qobject_cast<QTcpSocket*>(sender());
+    if (!client)
+        return;
+
+    clients_.remove(client);
+    client->deleteLater();
+}
+
+//----------------------------------------------------------------------
+void MetricsServer::readClient()
+{
+    QTcpSocket *client = qobject_cast<QTcpSocket*>(sender());
+    if (!client || !clients_.contains(client))
+        return;
+
+    QByteArray &request = clients_[client];
+    request.append(client->readAll());
+
+    // the request line is enough, the headers are only waited for
+    int end = request.indexOf("\r\n\r\n");
+    if (end < 0)
+        end = request.indexOf("\n\n");
+    if (end < 0)
+    {
+        if (request.size() > MAX_REQUEST_SIZE)
+            respond(client, "413 Request Entity Too Large", "Request too large\n");
+        return;
+    }
+
+    QList<QByteArray> words = request.left(request.indexOf('\n')).trimmed().split(' ');
+    if (words.size() < 2 || words[0] != "GET")
+    {
+        respond(client, "405 Method Not Allowed", "Only GET is supported\n");
+        return;
+    }
+    QByteArray path = words[1];
+    if (path.contains('?'))
+        path.truncate(path.indexOf('?'));
+    if (path != "/metrics")
+    {
+        respond(client, "404 Not Found", "Metrics are at /metrics\n");
+        return;
+    }
+
+    respond(client, "200 OK", phone_.getMetrics().toUtf8());
+}
+
+//----------------------------------------------------------------------
+void MetricsServer::respond(QTcpSocket *client, const QByteArray &status,
+                            const QByteArray &body)
+{
+    clients_.remove(client);
+
+    QByteArray header = "HTTP/1.0 " + status + "\r\n"
+        "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+        "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+        "Connection: close\r\n\r\n";
+    client->write(header + body);
+    // sends what is left in the buffer before closing
+    client->disconnectFromHost();
+}
@@ -0,0 +1,86 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <QObject>
+#include <QHash>
+#include <QByteArray>
+
+class QTcpServer;
+class QTcpSocket;
+class Phone;
+
+/**
+ * Minimal HTTP server on localhost for a Prometheus scraper. GET /metrics
+ * answers with the metrics of the phone, everything else with an error.
+ * Each connection takes one request.
+ */
+class MetricsServer : public QObject
+{
+    Q_OBJECT
+
+    Phone &phone_;
+    QTcpServer *server_;
+
+    /**
+     * Connected clients and the part of the request received so far
+     */
+    QHash<QTcpSocket*, QByteArray> clients_;
+
+    /**
+     * Maximum length of a request header, longer ones close the connection
+     */
+    static const int MAX_REQUEST_SIZE;
+
+    /**
+     * Send a response and close the connection
+     * @param client QTcpSocket*, the client
+     * @param status QByteArray, e.g. "200 OK"
+     * @param body QByteArray, the content
+     */
+    void respond(QTcpSocket *client, const QByteArray &status, const QByteArray &body);
+
+public:
+    /**
+     * Constructor
+     * @param phone Phone, collects the metrics
+     * @param parent QObject*, the parent
+     */
+    MetricsServer(Phone &phone, QObject *parent = 0);
+    ~MetricsServer();
+
+    /**
+     * Start listening on the loopback interface
+     * @param port int, the tcp port
+     * @return bool false if the port can't be used
+     */
+    bool listen(const int &port);
+
+private slots:
+    /**
+     * A client connected
+     */
+    void newConnection();
+
+    /**
+     * A client sent data
+     */
+    void readClient();
+
+    /**
+     * A client disconnected
+     */
+    void clientDisconnected();
+};
+
+#endif // METRICS_SERVER_H
@@ -11,31 +11,54 @@
 
 #include "phone.h"
 
-#include <QApplication>
-#include <QTextDocument>
 #include <QFile>
 #include <QDataStream>
+#include <QThread>
 
 #include "call.h"
 #include "log_handler.h"
 
 #include "javascript_handler.h"
 #include "account.h"
+#include "config_file_handler.h"
+#include "startup_timeline.h"
+#include "call_timeline.h"
+#include "metrics_registry.h"
+#include "metrics_server.h"
+#include "process_stats.h"
+
+/**
+ * Initializes the voip-api, off the gui thread
+ */
+class PhoneInitThread : public QThread
+{
+    PhoneApi *api_;
+    bool ok_;
+
+public:
+    PhoneInitThread(PhoneApi *api) : api_(api), ok_(false) {}
+
+    bool isOk() const { return ok_; }
+
+    void run()
+    {
+        ok_ = api_->init();
+    }
+};
 
 //----------------------------------------------------------------------
 Phone::Phone(PhoneApi *api) :
-    phone_api_(api)
+    phone_api_(api), js_handler_(0), init_thread_(0), metrics_server_(0),
+    init_done_(false), ready_(false)
 {
-    phone_api_->init();
-
     connect(phone_api_,
-            SIGNAL(signalAccountRegState(const int&)),
+            SIGNAL(signalAccountRegState(const int&, const int&)),
             this,
-            SLOT(accountRegState(const int&)));
+            SLOT(accountRegState(const int&, const int&)));
     connect(phone_api_,
-            SIGNAL(signalIncomingCall(Call*)),
+            SIGNAL(signalIncomingCall(const int&, const QString&, const QString&, const int&)),
             this,
-            SLOT(incomingCallSlot(Call*)));
+            SLOT(incomingCallSlot(const int&, const QString&, const QString&, const int&)));
     connect(phone_api_,
             SIGNAL(signalCallState(int,int,int)),
             this,
@@ -49,6 +72,10 @@ Phone::Phone(PhoneApi *api) :
             SIGNAL(signalMicrophoneLevel(int)),
             this,
             SLOT(microphoneLevelSlot(int)));
+    connect(phone_api_,
+            SIGNAL(signalCallQuality(const int&, const QVariantMap&)),
+            this,
+            SLOT(callQualitySlot(const int&, const QVariantMap&)));
     connect(phone_api_,
             SIGNAL(signalLogData(const LogInfo&)),
             &LogHandler::getInstance(),
@@ -61,15 +88,17 @@ Phone::~Phone(void)
     QFile file("error.log");
     file.open(QIODevice::WriteOnly | QIODevice::Append);
     QDataStream out(&file);
-    for (int i=0; i< call_list_.size(); i++)
+    for (int i = 0; i < call_table_.getIdLimit(); i++)
     {
-        Call *temp = call_list_[i];
-        if (temp->isActive())
+        Call *temp = call_table_.find(i);
+        if (temp && temp->isActive())
             out << *temp;
-
-        delete temp;
     }
-    call_list_.clear();
+    if (init_thread_)
+    {
+        init_thread_->wait();
+        delete init_thread_;
+    }
     delete phone_api_;
 }
 
@@ -77,18 +106,113 @@ Phone::~Phone(void)
 void Phone::init(JavascriptHandler *js_handler)
 {
     js_handler_ = js_handler;
+
+    ConfigFileHandler &config = ConfigFileHandler::getInstance();
+    call_history_.setLimits(config.getHistoryMaxCount(), config.getHistoryMaxBytes());
+    connect(&config,
+            SIGNAL(signalHistoryLimitsChanged()),
+            this,
+            SLOT(historyLimitsChanged()));
+
+    if (config.getMetricsPort() > 0)
+    {
+        metrics_server_ = new MetricsServer(*this, this);
+        metrics_server_->listen(config.getMetricsPort());
+    }
+
+    init_thread_ = new PhoneInitThread(phone_api_);
+    connect(init_thread_, SIGNAL(finished()), this, SLOT(initFinished()));
+    init_thread_->start();
 }
 
 //----------------------------------------------------------------------
-bool Phone::checkAccountStatus()
+void Phone::initFinished()
 {
-    return phone_api_->checkAccountStatus();
+    if (init_done_ || !init_thread_)
+        return;
+    init_done_ = true;
+
+    ready_ = init_thread_->isOk();
+    if (ready_)
+        phone_api_->start();
+
+    StartupTimeline &timeline = StartupTimeline::getInstance();
+    timeline.mark(ready_ ? "ready" : "failed");
+    js_handler_->phoneReady(ready_);
 }
 
 //----------------------------------------------------------------------
-bool Phone::registerUser(const Account &acc)
+bool Phone::checkInit()
+{
+    // waiting for the init thread would freeze the event loop
+    if (!init_done_ && init_thread_)
+        LOG_WARNING("phone", 0, "Call refused, the phone isn't initialized yet");
+    return ready_;
+}
+
+//----------------------------------------------------------------------
+bool Phone::isReady() const
+{
+    return ready_;
+}
+
+//----------------------------------------------------------------------
+bool Phone::insertCall(Call *call)
 {
+    if (call_table_.find(call->getCallId()))
+    {
+        // pjsip reused the id, so we must have missed the end of the old call
+        finishCall(call->getCallId());
+    }
+    if (call_table_.insert(call))
+        return true;
+
+    call_table_.release(call);
+    return false;
+}
 
+//----------------------------------------------------------------------
+void Phone::finishCall(const int &call_id)
+{
+    Call *call = call_table_.remove(call_id);
+    if (!call)
+        return;
+
+    call_snapshot_.remove(call_id);
+
+    call_history_.add(*call);
+    call_table_.release(call);
+}
+
+//----------------------------------------------------------------------
+void Phone::updateSnapshot(const int &call_id)
+{
+    Call *call = call_table_.find(call_id);
+    if (!call || !call->isActive())
+    {
+        call_snapshot_.remove(call_id);
+        return;
+    }
+
+    QVariantMap info;
+    info.insert("id", call_id);
+    call->getCallInfo(info);
+    call_snapshot_.update(call_id, info, call->getAcceptTime());
+}
+
+//----------------------------------------------------------------------
+bool Phone::checkAccountStatus(const int &acc_id)
+{
+    if (!checkInit())
+        return false;
+    return phone_api_->checkAccountStatus(acc_id);
+}
+
+//----------------------------------------------------------------------
+bool Phone::registerUser(const Account &acc)
+{
+    if (!checkInit())
+        return false;
     int acc_id = phone_api_->registerUser(acc);
 
     if (acc_id == -1)
@@ -97,52 +221,62 @@ bool Phone::registerUser(const Account &acc)
 }
 
 //----------------------------------------------------------------------
-void Phone::getAccountInfo(QVariantMap &account_info)
+int Phone::registerAccount(const Account &acc)
 {
-    phone_api_->getAccountInfo(account_info);
+    if (!checkInit())
+        return -1;
+    return phone_api_->registerUser(acc);
 }
 
 //----------------------------------------------------------------------
-bool Phone::addToCallList(Call *call)
+bool Phone::unregisterAccount(const int &acc_id)
 {
-    for (int i=0; i< call_list_.size(); i++)
-    {
-        if (call_list_[i] == call)
-            return true;
-        if (call_list_[i]->getCallId() == call->getCallId())
-            return false;
-    }
+    if (!checkInit())
+        return false;
+    return phone_api_->unregisterAccount(acc_id);
+}
 
-    call_list_.push_back(call);
-    return true;
+//----------------------------------------------------------------------
+bool Phone::setDefaultAccount(const int &acc_id)
+{
+    if (!checkInit())
+        return false;
+    return phone_api_->setDefaultAccount(acc_id);
 }
 
 //----------------------------------------------------------------------
-Call *Phone::getCallFromList(const int &call_id)
+void Phone::getAccountInfo(QVariantMap &account_info, const int &acc_id)
 {
-    for (int i=0; i< call_list_.size(); i++)
-    {
-        if (call_list_[i]->getCallId() == call_id)
-            return call_list_[i];
-    }
-    return 0;
+    if (!checkInit())
+        return;
+    phone_api_->getAccountInfo(account_info, acc_id);
 }
 
 //----------------------------------------------------------------------
-int Phone::makeCall(const QString &url)
+void Phone::getAccountList(QVariantList &accounts)
 {
-    Call *call = new Call(phone_api_, Call::TYPE_OUTGOING);
+    if (!checkInit())
+        return;
+    phone_api_->getAccountList(accounts);
+}
+
+//----------------------------------------------------------------------
+int Phone::makeCall(const QString &url, const int &acc_id)
+{
+    if (!checkInit())
+        return -1;
+    StartupTimeline::getInstance().mark("first_call");
+
+    Call *call = call_table_.acquire(phone_api_, Call::TYPE_OUTGOING);
 
     call->setUrl(url);
+    call->setAccountId(acc_id);
 
     int call_id = call->makeCall();
-    if (call_id != -1)
-    {
-        if (!addToCallList(call))
-            delete call;
-    }
-    else
-        delete call;
+    if (call_id == -1)
+        call_table_.release(call);
+    else if (insertCall(call))
+        updateSnapshot(call_id);
 
     return call_id;
 }
@@ -150,93 +284,190 @@ int Phone::makeCall(const QString &url)
 //----------------------------------------------------------------------
 void Phone::answerCall(const int &call_id)
 {
-    Call *call = getCallFromList(call_id);
+    Call *call = call_table_.find(call_id);
 
     if (call)
         call->answerCall();
     else
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "phone", 0, "Call to answer doesn't exist!");
-        LogHandler::getInstance().logDataSlot(info);
+        LOG_ERROR("phone", 0, "Call to answer doesn't exist!");
     }
 }
 
 //----------------------------------------------------------------------
 void Phone::hangUp(const int &call_id)
 {
-    Call *call = getCallFromList(call_id);
+    Call *call = call_table_.find(call_id);
 
     if (call)
+    {
         call->hangUp();
+        updateSnapshot(call_id);
+    }
 }
 
 
 //----------------------------------------------------------------------
 void Phone::hangUpAll()
 {
+    if (!checkInit())
+        return;
     phone_api_->hangUpAll();
-    for (int i=0; i< call_list_.size(); i++)
+    for (int i = 0; i < call_table_.getIdLimit(); i++)
     {
-        call_list_[i]->setCallInactive();
+        Call *call = call_table_.find(i);
+        if (call)
+        {
+            call->setCallInactive();
+            updateSnapshot(i);
+        }
     }
 }
 
 //----------------------------------------------------------------------
 QString Phone::getCallUserData(const int &call_id)
 {
-    Call *call = getCallFromList(call_id);
+    return Call::userDataToString(getCallUserDataMap(call_id));
+}
+
+//----------------------------------------------------------------------
+void Phone::setCallUserData(const int &call_id, const QString &data)
+{
+    setCallUserDataMap(call_id, Call::userDataFromString(data));
+}
+
+//----------------------------------------------------------------------
+void Phone::clearCallUserData(const int &call_id)
+{
+    setCallUserDataMap(call_id, QVariantMap());
+}
+
+//----------------------------------------------------------------------
+QVariantMap Phone::getCallUserDataMap(const int &call_id)
+{
+    Call *call = call_table_.find(call_id);
     if (call)
         return call->getUserData();
-    return "";
+
+    CallRecord *record = call_history_.findLatest(call_id);
+    if (record)
+        return record->user_data_;
+    return QVariantMap();
 }
 
 //----------------------------------------------------------------------
-void Phone::setCallUserData(const int &call_id, const QString &data)
+void Phone::setCallUserDataMap(const int &call_id, const QVariantMap &data)
 {
-    Call *call = getCallFromList(call_id);
+    Call *call = call_table_.find(call_id);
     if (call)
+    {
+        if (call->getUserData() == data)
+            return;
         call->setUserData(data);
+        callUserDataChanged(call_id, data);
+        return;
+    }
+
+    CallRecord *record = call_history_.findLatest(call_id);
+    if (record && record->user_data_ != data)
+    {
+        call_history_.setUserData(record, data);
+        callUserDataChanged(call_id, data);
+    }
 }
 
 //----------------------------------------------------------------------
-void Phone::clearCallUserData(const int &call_id)
+QVariant Phone::getCallUserDataField(const int &call_id, const QString &key)
 {
-    Call *call = getCallFromList(call_id);
+    Call *call = call_table_.find(call_id);
     if (call)
-        call->clearUserData();
+        return call->getUserDataField(key);
+
+    CallRecord *record = call_history_.findLatest(call_id);
+    if (record)
+        return record->user_data_.value(key);
+    return QVariant();
+}
+
+//----------------------------------------------------------------------
+void Phone::setCallUserDataField(const int &call_id, const QString &key,
+                                 const QVariant &value)
+{
+    Call *call = call_table_.find(call_id);
+    if (call)
+    {
+        if (call->setUserDataField(key, value))
+            callUserDataChanged(call_id, call->getUserData());
+        return;
+    }
+
+    CallRecord *record = call_history_.findLatest(call_id);
+    if (!record)
+        return;
+    QVariantMap data = record->user_data_;
+    if (value.isValid())
+        data.insert(key, value);
+    else
+        data.remove(key);
+    setCallUserDataMap(call_id, data);
+}
+
+//----------------------------------------------------------------------
+void Phone::getCallsUserData(const QVariantList &call_ids, QVariantMap &result)
+{
+    if (call_ids.isEmpty())
+    {
+        for (int i = 0; i < call_table_.getIdLimit(); i++)
+        {
+            Call *call = call_table_.find(i);
+            if (call && call->isActive())
+                result.insert(QString::number(i), call->getUserData());
+        }
+        return;
+    }
+
+    for (int i = 0; i < call_ids.size(); i++)
+    {
+        int call_id = call_ids[i].toInt();
+        result.insert(QString::number(call_id), getCallUserDataMap(call_id));
+    }
+}
+
+//----------------------------------------------------------------------
+void Phone::callUserDataChanged(const int &call_id, const QVariantMap &data)
+{
+    if (call_table_.find(call_id))
+        updateSnapshot(call_id);
+    js_handler_->callUserDataChanged(call_id, data);
 }
 
 //----------------------------------------------------------------------
 bool Phone::addCallToConference(const int &call_src, const int &call_dest)
 {
-    Call *call = getCallFromList(call_src);
-    Call *dest_call = getCallFromList(call_dest);
+    Call *call = call_table_.find(call_src);
+    Call *dest_call = call_table_.find(call_dest);
     if (!call || !dest_call)
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "phone", 0, "Error: one of the selected calls does NOT exist!");
-        LogHandler::getInstance().logDataSlot(info);
+        LOG_ERROR("phone", 0, "Error: one of the selected calls does NOT exist!");
 
         return false;
     }
 
     if (!call->isActive() || !dest_call->isActive())
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "phone", 0, "Error: one of the selected calls just ended!");
-        LogHandler::getInstance().logDataSlot(info);
+        LOG_ERROR("phone", 0, "Error: one of the selected calls just ended!");
 
         return false;
     }
 
     if(!call->addCallToConference(*dest_call))
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "phone", 0, "Error: failed to connect to source!");
-        LogHandler::getInstance().logDataSlot(info);
+        LOG_ERROR("phone", 0, "Error: failed to connect to source!");
         return false;
     }
     if(!dest_call->addCallToConference(*call))
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "phone", 0, "Error: failed to connect to destination!");
-        LogHandler::getInstance().logDataSlot(info);
+        LOG_ERROR("phone", 0, "Error: failed to connect to destination!");
         return false;
     }
 
@@ -246,33 +477,29 @@ bool Phone::addCallToConference(const int &call_src, const int &call_dest)
 //----------------------------------------------------------------------
 bool Phone::removeCallFromConference(const int &call_src, const int &call_dest)
 {
-    Call *call = getCallFromList(call_src);
-    Call *dest_call = getCallFromList(call_dest);
+    Call *call = call_table_.find(call_src);
+    Call *dest_call = call_table_.find(call_dest);
     if (!call || !dest_call)
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "phone", 0, "Error: one of the selected calls does NOT exist!");
-        LogHandler::getInstance().logDataSlot(info);
+        LOG_ERROR("phone", 0, "Error: one of the selected calls does NOT exist!");
 
         return false;
     }
     if (!call->isActive() || !dest_call->isActive())
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "phone", 0, "Error: one of the selected calls just ended!");
-        LogHandler::getInstance().logDataSlot(info);
+        LOG_ERROR("phone", 0, "Error: one of the selected calls just ended!");
 
         return false;
     }
 
     if(call->removeCallFromConference(*dest_call))
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "phone", 0, "Error: failed to remove from source!");
-        LogHandler::getInstance().logDataSlot(info);
+        LOG_ERROR("phone", 0, "Error: failed to remove from source!");
         return false;
     }
     if(dest_call->removeCallFromConference(*call))
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "phone", 0, "Error: failed to remove from destination!");
-        LogHandler::getInstance().logDataSlot(info);
+        LOG_ERROR("phone", 0, "Error: failed to remove from destination!");
         return false;
     }
     return true;
@@ -281,7 +508,7 @@ bool Phone::removeCallFromConference(const int &call_src, const int &call_dest)
 //----------------------------------------------------------------------
 int Phone::redirectCall(const int &call_id, const QString &dest_uri)
 {
-    Call *call = getCallFromList(call_id);
+    Call *call = call_table_.find(call_id);
     if (call)
         return call->redirectCall(dest_uri);
     return -1;
@@ -290,7 +517,7 @@ int Phone::redirectCall(const int &call_id, const QString &dest_uri)
 //----------------------------------------------------------------------
 QString Phone::getCallUrl(const int &call_id)
 {
-    Call *call = getCallFromList(call_id);
+    Call *call = call_table_.find(call_id);
     if (call)
         return call->getCallUrl();
 
@@ -300,37 +527,46 @@ QString Phone::getCallUrl(const int &call_id)
 //----------------------------------------------------------------------
 void Phone::getCallInfo(const int &call_id, QVariantMap &call_info)
 {
-    Call *call = getCallFromList(call_id);
+    Call *call = call_table_.find(call_id);
     if (call)
+    {
         call->getCallInfo(call_info);
+        return;
+    }
+
+    // a call which just ended is in the history already
+    CallRecord *record = call_history_.findLatest(call_id);
+    if (record)
+    {
+        CallHistory::toVariantMap(*record, call_info);
+        call_info.insert("number", record->url_);
+    }
 }
 
 //----------------------------------------------------------------------
 void Phone::getActiveCallList(QVariantList &call_list)
 {
-    for (int i=0; i<call_list_.size();++i)
-    {
-        int id = call_list_[i]->getCallId();
-        if (call_list_[i]->isActive())
-        {
-            QVariantMap current;
-            current.insert("id",id);
-            getCallInfo(id, current);
-            call_list << current;
-        }
-    }
+    call_snapshot_.getCalls(call_list);
+}
+
+//----------------------------------------------------------------------
+void Phone::getCallListChanges(const qint64 &since, QVariantMap &result)
+{
+    call_snapshot_.getChanges(since, result);
 }
 
 //----------------------------------------------------------------------
 void Phone::muteSound(const bool &mute, const int &call_id)
 {
+    if (!checkInit())
+        return;
     if(call_id == -1)
     {
         phone_api_->muteSound(mute);
     }
     else
     {
-        Call *call = getCallFromList(call_id);
+        Call *call = call_table_.find(call_id);
         if(call)
         {
             call->muteSound(mute);
@@ -341,13 +577,15 @@ void Phone::muteSound(const bool &mute, const int &call_id)
 //----------------------------------------------------------------------
 void Phone::muteMicrophone(const bool &mute, const int &call_id)
 {
+    if (!checkInit())
+        return;
     if(call_id == -1)
     {
         phone_api_->muteMicrophone(mute);
     }
     else
     {
-        Call *call = getCallFromList(call_id);
+        Call *call = call_table_.find(call_id);
         if(call)
         {
             call->muteMicrophone(mute);
@@ -358,23 +596,173 @@ void Phone::muteMicrophone(const bool &mute, const int &call_id)
 //----------------------------------------------------------------------
 void Phone::getSignalInformation(QVariantMap &signal_info)
 {
+    if (!checkInit())
+        return;
     phone_api_->getSignalInformation(signal_info);
 }
 
 //----------------------------------------------------------------------
-void Phone::unregister()
+void Phone::getCallHistory(const int &offset, const int &limit, const int &type,
+                           const int &status, QVariantMap &result)
 {
-    phone_api_->unregister();
+    call_history_.query(offset, limit, type, status, result);
+}
+
+//----------------------------------------------------------------------
+void Phone::getCallHistoryStatistics(QVariantMap &stats)
+{
+    call_history_.getStatistics(stats);
 }
 
 //----------------------------------------------------------------------
-void Phone::incomingCallSlot(Call *call)
+void Phone::getEventStatistics(QVariantMap &stats)
 {
-    if (!addToCallList(call))
+    phone_api_->getEventStatistics(stats);
+}
+
+//----------------------------------------------------------------------
+QString Phone::getMetrics()
+{
+    MetricsRegistry &metrics = MetricsRegistry::getInstance();
+
+    QVariantMap stats;
+    phone_api_->getEventStatistics(stats);
+    metrics.gauge("greenj_event_queue_depth",
+                  "Events of the sip threads waiting for the gui thread")
+        ->set(stats.value("depth").toInt());
+    metrics.gauge("greenj_event_queue_high_watermark",
+                  "Highest depth of the event queue")
+        ->set(stats.value("highWatermark").toInt());
+    metrics.total("greenj_events_dropped_total",
+                  "Events dropped because the event queue was full")
+        ->set(stats.value("dropped").toInt());
+
+    stats.clear();
+    LogHandler::getInstance().getStatistics(stats);
+    metrics.total("greenj_log_messages_total", "Log messages written to the log file")
+        ->set(stats.value("messagesWritten").toLongLong());
+    metrics.total("greenj_log_bytes_total", "Bytes written to the log file")
+        ->set(stats.value("bytesWritten").toLongLong());
+    metrics.total("greenj_log_dropped_total", "Log messages dropped by a full log queue")
+        ->set(stats.value("dropped").toLongLong());
+    metrics.gauge("greenj_log_queue_depth", "Log messages waiting for the log writer")
+        ->set(stats.value("queueDepth").toInt());
+
+    // the starts and the end of a call have no setup time
+    CallTimeline &timeline = CallTimeline::getInstance();
+    for (int i = 0; i < CallTimeline::STAGE_COUNT; ++i)
+    {
+        CallTimeline::Stage stage = (CallTimeline::Stage)i;
+        if (stage == CallTimeline::STAGE_MAKE_CALL
+            || stage == CallTimeline::STAGE_INVITE_RECEIVED
+            || stage == CallTimeline::STAGE_DISCONNECTED)
+        {
+            continue;
+        }
+        metrics.histogram("greenj_call_setup_seconds",
+                          "Time from the start of a call to a stage of its setup",
+                          QString("stage=\"") + CallTimeline::STAGE_NAMES[i] + "\"")
+            ->set(timeline.getHistogram(stage));
+    }
+
+    qint64 cpu_time = ProcessStats::getCpuTime();
+    if (cpu_time >= 0)
+    {
+        metrics.total("process_cpu_seconds_total", "User and system cpu time")
+            ->set(cpu_time / 1000000.0);
+    }
+    qint64 resident_size = ProcessStats::getResidentSize();
+    if (resident_size >= 0)
     {
-        delete call;
+        metrics.gauge("process_resident_memory_bytes", "Resident memory size")
+            ->set(resident_size);
+    }
+
+    return metrics.exportText();
+}
+
+//----------------------------------------------------------------------
+void Phone::getCodecList(QVariantList &codecs)
+{
+    if (!checkInit())
+        return;
+    phone_api_->getCodecList(codecs);
+}
+
+//----------------------------------------------------------------------
+void Phone::getMediaInformation(QVariantMap &info)
+{
+    if (!checkInit())
         return;
+    phone_api_->getMediaInformation(info);
+}
+
+//----------------------------------------------------------------------
+void Phone::getCallQuality(const int &call_id, QVariantMap &quality)
+{
+    if (call_table_.find(call_id))
+        phone_api_->getCallQuality(call_id, quality);
+}
+
+//----------------------------------------------------------------------
+bool Phone::playFile(const int &call_id, const QString &file)
+{
+    Call *call = call_table_.find(call_id);
+    if (!call || !call->isActive())
+    {
+        LOG_ERROR("phone", 0, "Error: the selected call does NOT exist!");
+        return false;
+    }
+    return phone_api_->playFile(call_id, file);
+}
+
+//----------------------------------------------------------------------
+void Phone::stopPlayFile(const int &call_id)
+{
+    if (call_table_.find(call_id))
+        phone_api_->stopPlayFile(call_id);
+}
+
+//----------------------------------------------------------------------
+bool Phone::recordCall(const int &call_id, const QString &file)
+{
+    Call *call = call_table_.find(call_id);
+    if (!call || !call->isActive())
+    {
+        LOG_ERROR("phone", 0, "Error: the selected call does NOT exist!");
+        return false;
     }
+    return phone_api_->recordCall(call_id, file);
+}
+
+//----------------------------------------------------------------------
+void Phone::stopRecordCall(const int &call_id)
+{
+    if (call_table_.find(call_id))
+        phone_api_->stopRecordCall(call_id);
+}
+
+//----------------------------------------------------------------------
+void Phone::unregister()
+{
+    if (!checkInit())
+        return;
+    phone_api_->unregister();
+}
+
+//----------------------------------------------------------------------
+void Phone::incomingCallSlot(const int &call_id, const QString &url, const QString &name,
+                             const int &acc_id)
+{
+    Call *call = call_table_.acquire(phone_api_, Call::TYPE_INCOMING);
+    call->setCallId(call_id);
+    call->setAccountId(acc_id);
+    call->setUrl(url);
+    call->setName(name);
+
+    if (!insertCall(call))
+        return;
+    updateSnapshot(call_id);
     js_handler_->incomingCallSlot(*call);
 
     signalIncomingCall(call->getCallUrl());
@@ -383,14 +771,26 @@ void Phone::incomingCallSlot(Call *call)
 //----------------------------------------------------------------------
 void Phone::callStateSlot(int call_id, int call_state, int last_status)
 {
-    Call *call = getCallFromList(call_id);
+    Call *call = call_table_.find(call_id);
 
     if (call)
+    {
         call->setCallState(call_state);
+        updateSnapshot(call_id);
+        if (call->getStatus() == Call::STATUS_CLOSED)
+            finishCall(call_id);
+    }
 
     js_handler_->callState(call_id, call_state, last_status);
 }
 
+//----------------------------------------------------------------------
+void Phone::historyLimitsChanged()
+{
+    ConfigFileHandler &config = ConfigFileHandler::getInstance();
+    call_history_.setLimits(config.getHistoryMaxCount(), config.getHistoryMaxBytes());
+}
+
 //----------------------------------------------------------------------
 void Phone::soundLevelSlot(int level)
 {
@@ -404,8 +804,14 @@ void Phone::microphoneLevelSlot(int level)
 }
 
 //----------------------------------------------------------------------
-void Phone::accountRegState(const int &state)
+void Phone::callQualitySlot(const int &call_id, const QVariantMap &quality)
+{
+    js_handler_->callQualityChanged(call_id, quality);
+}
+
+//----------------------------------------------------------------------
+void Phone::accountRegState(const int &acc_id, const int &state)
 {
-    js_handler_->accountState(state);
+    js_handler_->accountState(acc_id, state);
 
 }
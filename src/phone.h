@@ -17,11 +17,16 @@
 
 #include "phone_api.h"
 #include "log_info.h"
+#include "call_table.h"
+#include "call_history.h"
+#include "call_snapshot.h"
 
 class Account;
 class Gui;
 class Call;
 class JavascriptHandler;
+class PhoneInitThread;
+class MetricsServer;
 
 /**
  * This is a wrapper class provide the communication between an
@@ -34,14 +39,66 @@ class Phone : public QObject
     PhoneApi *phone_api_;
     JavascriptHandler *js_handler_;
 
-    bool addToCallList(Call *call);
-    Call *getCallFromList(const int &call_id);
+    /**
+     * Runs the initialization of the voip-api, it mustn't be used
+     * before init_done_
+     */
+    PhoneInitThread *init_thread_;
+    MetricsServer *metrics_server_;
+    bool init_done_;
+    bool ready_;
+
+    /**
+     * Check if the voip-api is initialized. Calls arriving early (e.g.
+     * from the web page) get refused, the page has to wait for
+     * phoneReady (see whenReady in phone-lib.js)
+     * @return bool true if the voip-api is ready to use
+     */
+    bool checkInit();
+
+    /**
+     * All calls, live ones indexed by call_id
+     */
+    CallTable call_table_;
+
+    /**
+     * Records of finished calls
+     */
+    CallHistory call_history_;
+
+    /**
+     * Information about the active calls for the web page
+     */
+    CallSnapshot call_snapshot_;
 
     /**
-     * AccountID we got from our registration
+     * Refresh the information about a call in the snapshot,
+     * calls which aren't active anymore get removed
+     * @param call_id int, the id of the call
+     */
+    void updateSnapshot(const int &call_id);
+
+    /**
+     * Insert a new call into the call table, a stale call with the
+     * same id gets finished first
+     * @param call Call*, the new call, gets released if it can't be inserted
+     * @return bool true if the call got inserted
+     */
+    bool insertCall(Call *call);
+
+    /**
+     * Move a call from the call table to the call history
+     * @param call_id int, the id of the call
      */
+    void finishCall(const int &call_id);
 
-    QVector<Call*> call_list_;
+    /**
+     * The user data of a call changed, update the snapshot
+     * and tell the web page
+     * @param call_id int, the id of the call
+     * @param data QVariantMap, the new user data
+     */
+    void callUserDataChanged(const int &call_id, const QVariantMap &data);
 
 public:
     /**
@@ -52,15 +109,25 @@ public:
     ~Phone(void);
 
     /**
-     * Initializing the SIP-API
+     * Start initializing the SIP-API in the background, the
+     * JavascriptHandler gets told when it's ready
+     * @param js_handler JavascriptHandler*, gets the events of the phone
      */
     void init(JavascriptHandler *js_handler);
 
+    /**
+     * Check if the SIP-API is initialized
+     * @return bool true if it's ready, false while it's starting or
+     *         if it failed
+     */
+    bool isReady() const;
+
     /**
      * checks if acc_id is valid or not
+     * @param acc_id int, the id of the account, -1 for the default account
      * @return bool true if acc_id is valid
      */
-    bool checkAccountStatus();
+    bool checkAccountStatus(const int &acc_id = -1);
 
     /**
      * Registers the user at the given Asterisk server
@@ -70,18 +137,47 @@ public:
      */
     bool registerUser(const Account &acc);
 
+    /**
+     * Registers an additional account
+     * @param acc Account, the data needed to login
+     * @return int the id of the account, -1 if registering failed
+     */
+    int registerAccount(const Account &acc);
+
+    /**
+     * Hang up the calls of an account and unregister it
+     * @param acc_id int, the id of the account
+     * @return bool false if there is no such account
+     */
+    bool unregisterAccount(const int &acc_id);
+
+    /**
+     * Set the account used when no account is given
+     * @param acc_id int, the id of the account
+     * @return bool false if there is no such account
+     */
+    bool setDefaultAccount(const int &acc_id);
+
     /**
      * Get some information about account
      * @param &account_info QVariantMap, which holds account information
+     * @param acc_id int, the id of the account, -1 for the default account
      */
-    void getAccountInfo(QVariantMap &account_info);
+    void getAccountInfo(QVariantMap &account_info, const int &acc_id = -1);
+
+    /**
+     * Get information about all registered accounts
+     * @param accounts QVariantList, gets the information of each account
+     */
+    void getAccountList(QVariantList &accounts);
 
     /**
      * Starting a SIP-Call to the given adress
      * @param url string, The SIP-Adress. E.g. "SIP:user@domain"
+     * @param acc_id int, the account to call from, -1 for the default account
      * @return The CallId of the started call
      */
-    int makeCall(const QString &url);
+    int makeCall(const QString &url, const int &acc_id = -1);
 
     /**
      * Answering an incoming call
@@ -101,16 +197,18 @@ public:
     void hangUpAll();
 
     /**
-     * Get user data by callid
+     * Get user data by callid as string
      * @param call_id int, the id of the call
-     * @return QString the stored data
+     * @return QString the string set, the stored data as JSON object
+     *         otherwise, empty if there is none
      */
     QString getCallUserData(const int &call_id);
 
     /**
-     * Set user data for call by callid
+     * Set user data for call by callid from a string
      * @param call_id int, the id of the call
-     * @param data QString, the data to store
+     * @param data QString, the data to store, a JSON object is stored as
+     *        map, any other string as it is (see Call::userDataFromString())
      */
     void setCallUserData(const int &call_id, const QString &data);
 
@@ -120,6 +218,45 @@ public:
      */
     void clearCallUserData(const int &call_id);
 
+    /**
+     * Get user data by callid
+     * @param call_id int, the id of the call
+     * @return QVariantMap the stored data
+     */
+    QVariantMap getCallUserDataMap(const int &call_id);
+
+    /**
+     * Set user data for call by callid, replacing the current one
+     * @param call_id int, the id of the call
+     * @param data QVariantMap, the data to store
+     */
+    void setCallUserDataMap(const int &call_id, const QVariantMap &data);
+
+    /**
+     * Get one field of the user data of a call
+     * @param call_id int, the id of the call
+     * @param key QString, the name of the field
+     * @return QVariant the value, invalid if the field isn't set
+     */
+    QVariant getCallUserDataField(const int &call_id, const QString &key);
+
+    /**
+     * Set one field of the user data of a call
+     * @param call_id int, the id of the call
+     * @param key QString, the name of the field
+     * @param value QVariant, the value, an invalid value removes the field
+     */
+    void setCallUserDataField(const int &call_id, const QString &key,
+                              const QVariant &value);
+
+    /**
+     * Get the user data of many calls at once
+     * @param call_ids QVariantList, the ids of the calls, empty for all
+     *        active calls
+     * @param result QVariantMap, gets the user data of each call by call_id
+     */
+    void getCallsUserData(const QVariantList &call_ids, QVariantMap &result);
+
     /**
      * Combining the callee of one specific call to an other.
      * It gets linked to it and hears and can speak to it
@@ -154,7 +291,8 @@ public:
     QString getCallUrl(const int &call_id);
 
     /**
-     * Get information about call like sip-adress, state
+     * Get information about call like sip-adress, state; for a call which
+     * ended the info kept in the call history
      * @param call_id int, the id of the call
      * @param call_info QVariantMap, the object with the info to be written
      */
@@ -166,6 +304,31 @@ public:
      */
     void getActiveCallList(QVariantList &call_list);
 
+    /**
+     * Get the active calls which changed since a version of the call list
+     * @param since qint64, the version seen last, -1 for all active calls
+     * @param result QVariantMap, gets version, full, calls and removed
+     *        (see CallSnapshot::getChanges())
+     */
+    void getCallListChanges(const qint64 &since, QVariantMap &result);
+
+    /**
+     * Get a page of finished calls, newest first
+     * @param offset int, number of matching calls to skip
+     * @param limit int, maximum number of calls to return
+     * @param type int, only calls of this type, -1 for all
+     * @param status int, only calls with this status, -1 for all
+     * @param result QVariantMap, the object with total, offset and calls
+     */
+    void getCallHistory(const int &offset, const int &limit, const int &type,
+                        const int &status, QVariantMap &result);
+
+    /**
+     * Get size, memory use and limits of the call history
+     * @param stats QVariantMap, the object to write to
+     */
+    void getCallHistoryStatistics(QVariantMap &stats);
+
     /**
      * Switch sound on/off
      * @param mute bool, true if callee should be muted
@@ -186,19 +349,82 @@ public:
      */
     void getSignalInformation(QVariantMap &signal_info);
 
+    /**
+     * Get counters of the event queue between api threads and gui thread
+     * @param stats QVariantMap, a map to save the counters
+     */
+    void getEventStatistics(QVariantMap &stats);
+
+    /**
+     * Collect the metrics of the process, see MetricsRegistry
+     * @return QString the metrics in the Prometheus text exposition format
+     */
+    QString getMetrics();
+
+    /**
+     * Get the available codecs with their settings
+     * @param codecs QVariantList, gets a map per codec, best first
+     */
+    void getCodecList(QVariantList &codecs);
+
+    /**
+     * Get the effective media settings and the latency of the sound device
+     * @param info QVariantMap, a map to save the information
+     */
+    void getMediaInformation(QVariantMap &info);
+
+    /**
+     * Get the audio quality of a call
+     * @param call_id int, the id of the call
+     * @param quality QVariantMap, gets poor, last and history (see
+     *        CallQuality::getQuality()), empty if there is no sample yet
+     */
+    void getCallQuality(const int &call_id, QVariantMap &quality);
+
+    /**
+     * Play a wav file to a call in a loop, mixed in with the microphone
+     * @param call_id int, the id of the call
+     * @param file QString, the wav file
+     * @return bool false if the file couldn't be played
+     */
+    bool playFile(const int &call_id, const QString &file);
+
+    /**
+     * Stop playing a file to a call
+     * @param call_id int, the id of the call
+     */
+    void stopPlayFile(const int &call_id);
+
+    /**
+     * Record the received audio of a call to a wav file
+     * @param call_id int, the id of the call
+     * @param file QString, the wav file, it gets overwritten
+     * @return bool false if the file couldn't be created
+     */
+    bool recordCall(const int &call_id, const QString &file);
+
+    /**
+     * Stop recording a call, the file gets completed
+     * @param call_id int, the id of the call
+     */
+    void stopRecordCall(const int &call_id);
+
     /**
      * Hanging up all active calls,
-     * Unregistering the user
-     * and destroying the pjsip instance
+     * Unregistering all accounts
      */
     void unregister();
 
 public slots:
     /**
      * This slot get called when call arrived
-     * @param call Call*, the call handler class
+     * @param call_id int, the id of the new call
+     * @param url QString, the sip-address of the caller
+     * @param name QString, the name of the caller
+     * @param acc_id int, the account which got called
      */
-    void incomingCallSlot(Call *call);
+    void incomingCallSlot(const int &call_id, const QString &url, const QString &name,
+                          const int &acc_id);
 
     /**
      * This slot get called when state of call changed
@@ -220,11 +446,31 @@ public slots:
      */
     void microphoneLevelSlot(int level);
 
+    /**
+     * This slot get called when the quality of a call crossed the threshold
+     * @param call_id int, the id of the call
+     * @param quality QVariantMap, the last sample
+     */
+    void callQualitySlot(const int &call_id, const QVariantMap &quality);
+
     /**
      * This slot get called when account registration state get changed
+     * @param acc_id int, the id of the account
      * @param state int, the new state of account
      */
-    void accountRegState(const int &state);
+    void accountRegState(const int &acc_id, const int &state);
+
+    /**
+     * This slot get called when the history limits in the config changed
+     */
+    void historyLimitsChanged();
+
+private slots:
+    /**
+     * The voip-api finished initializing, start using it and tell
+     * the web page
+     */
+    void initFinished();
 
 signals:
     void signalIncomingCall(const QString &call);
@@ -33,35 +33,67 @@ public:
     virtual ~PhoneApi(){}
 
     /**
-     * Initializing the the api
+     * Initializing the the api, runs on a thread of its own so the
+     * gui can start meanwhile
+     * @return bool false if the api can't be used
      */
-    virtual void init() = 0;
+    virtual bool init() = 0;
+
+    /**
+     * Called on the gui thread after init() succeeded, from then on the
+     * api gets used by the gui thread
+     */
+    virtual void start() = 0;
 
     /**
      * checks if acc_id is valid or not
+     * @param acc_id int, the id of the account, -1 for the default account
      * @return bool true if acc_id is valid
      */
-    virtual bool checkAccountStatus() = 0;
+    virtual bool checkAccountStatus(const int &acc_id = -1) = 0;
 
     /**
-     * Registers the user at the given Asterisk server
+     * Registers the user at the given Asterisk server, an additional
+     * account is added for every user
      * @param acc Account, the data needed to login
-     * @return bool true if registering was successful false if registering failed
+     * @return int the id of the account, -1 if registering failed
      */
     virtual int registerUser(const Account &acc) = 0;
 
+    /**
+     * Hang up the calls of an account and unregister it
+     * @param acc_id int, the id of the account
+     * @return bool false if there is no such account
+     */
+    virtual bool unregisterAccount(const int &acc_id) = 0;
+
+    /**
+     * Set the account used when no account is given
+     * @param acc_id int, the id of the account
+     * @return bool false if there is no such account
+     */
+    virtual bool setDefaultAccount(const int &acc_id) = 0;
+
     /**
      * Get some information about account
      * @param &account_info QVariantMap, which holds account information
+     * @param acc_id int, the id of the account, -1 for the default account
+     */
+    virtual void getAccountInfo(QVariantMap &account_info, const int &acc_id = -1) = 0;
+
+    /**
+     * Get information about all registered accounts
+     * @param accounts QVariantList, gets the information of each account
      */
-    virtual void getAccountInfo(QVariantMap &account_info) = 0;
+    virtual void getAccountList(QVariantList &accounts) = 0;
 
     /**
      * Starting a SIP-Call to the given adress
      * @param url string, The SIP-Adress. E.g. "SIP:user@domain"
+     * @param acc_id int, the account to call from, -1 for the default account
      * @return int The CallId of the started call
      */
-    virtual int makeCall(const QString &url) = 0;
+    virtual int makeCall(const QString &url, const int &acc_id = -1) = 0;
 
     /**
      * Answering an incoming call
@@ -145,9 +177,64 @@ public:
      */
     virtual void getSignalInformation(QVariantMap &signal_info) = 0;
 
+    /**
+     * Get counters of the queue between api threads and gui thread,
+     * like depth, dropped and merged events
+     * @param stats QVariantMap, a map to save the counters
+     */
+    virtual void getEventStatistics(QVariantMap &stats) = 0;
+
+    /**
+     * Get the available codecs with their settings
+     * @param codecs QVariantList, gets a map per codec, best first
+     */
+    virtual void getCodecList(QVariantList &codecs) = 0;
+
+    /**
+     * Get the effective media settings and the latency of the sound device
+     * @param info QVariantMap, a map to save the information
+     */
+    virtual void getMediaInformation(QVariantMap &info) = 0;
+
+    /**
+     * Get the audio quality of a call
+     * @param call_id int, the id of the call
+     * @param quality QVariantMap, gets poor, last and history (see
+     *        CallQuality::getQuality()), empty if there is no sample yet
+     */
+    virtual void getCallQuality(const int &call_id, QVariantMap &quality) = 0;
+
+    /**
+     * Play a wav file to a call in a loop, mixed in with the microphone
+     * @param call_id int, the id of the call
+     * @param file QString, the wav file
+     * @return bool false if the file couldn't be played
+     */
+    virtual bool playFile(const int &call_id, const QString &file) = 0;
+
+    /**
+     * Stop playing a file to a call
+     * @param call_id int, the id of the call
+     */
+    virtual void stopPlayFile(const int &call_id) = 0;
+
+    /**
+     * Record the received audio of a call to a wav file
+     * @param call_id int, the id of the call
+     * @param file QString, the wav file, it gets overwritten
+     * @return bool false if the file couldn't be created
+     */
+    virtual bool recordCall(const int &call_id, const QString &file) = 0;
+
+    /**
+     * Stop recording a call, the file gets completed
+     * @param call_id int, the id of the call
+     */
+    virtual void stopRecordCall(const int &call_id) = 0;
+
     /**
      * Hanging up all active calls,
-     * Unregistering the user
+     * Unregistering all accounts
      */
     virtual void unregister() = 0;
 
@@ -155,15 +242,19 @@ signals:
 
     /**
      * Send signal when account status changed
+     * @param acc_id int, the id of the account
      * @param state int, the new state of the account
      */
-    void signalAccountRegState(const int &state);
+    void signalAccountRegState(const int &acc_id, const int &state);
     /**
      * Send a signal when someone tries to call
      * @param call_id int, id of incoming call
-     * @param callUrl QString, the name of caller
+     * @param url QString, the sip-address of the caller
+     * @param name QString, the name of caller
+     * @param acc_id int, the account which got called
      */
-    void signalIncomingCall(Call *call);
+    void signalIncomingCall(const int &call_id, const QString &url, const QString &name,
+                            const int &acc_id);
 
     /**
      * Send signal on changing call state
@@ -190,6 +281,14 @@ signals:
      */
     void signalMicrophoneLevel(int level);
 
+    /**
+     * Send a signal when the quality of a call gets poor or good again
+     * @param call_id int, the id of the call
+     * @param quality QVariantMap, the last sample with poor (see
+     *        CallQuality::getLast())
+     */
+    void signalCallQuality(const int &call_id, const QVariantMap &quality);
+
 };
 
 #endif // PHONE_API_H
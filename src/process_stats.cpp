@@ -0,0 +1,77 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "process_stats.h"
+
+#ifdef Q_OS_UNIX
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <QFile>
+#include <QStringList>
+#endif
+
+//----------------------------------------------------------------------
+qint64 ProcessStats::getCpuTime()
+{
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+    return (qint64)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+           + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#else
+    return -1;
+#endif
+}
+
+//----------------------------------------------------------------------
+qint64 ProcessStats::getResidentSize()
+{
+#ifdef Q_OS_LINUX
+    // size and resident pages
+    QFile file("/proc/self/statm");
+    if (!file.open(QIODevice::ReadOnly))
+        return -1;
+    QStringList fields = QString(file.readLine()).split(' ');
+    if (fields.size() < 2)
+        return -1;
+    return fields[1].toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return -1;
+#endif
+}
+
+//----------------------------------------------------------------------
+qint64 ProcessStats::getPeakResidentSize()
+{
+#ifdef Q_OS_LINUX
+    // e.g. "VmHWM:     12345 kB"
+    QFile file("/proc/self/status");
+    if (!file.open(QIODevice::ReadOnly))
+        return -1;
+    while (!file.atEnd())
+    {
+        QString line = file.readLine();
+        if (line.startsWith("VmHWM:"))
+            return line.mid(6).trimmed().section(' ', 0, 0).toLongLong() * 1024;
+    }
+    return -1;
+#elif defined(Q_OS_MAC)
+    // in bytes on mac, in kB elsewhere
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+    return usage.ru_maxrss;
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,43 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef PROCESS_STATS_H
+#define PROCESS_STATS_H
+
+#include <QtGlobal>
+
+/**
+ * Resource usage of the own process. Values the platform doesn't
+ * offer are -1.
+ */
+class ProcessStats
+{
+public:
+    /**
+     * Get the cpu time used so far
+     * @return qint64 user and system time in microseconds
+     */
+    static qint64 getCpuTime();
+
+    /**
+     * Get the memory the process has in RAM
+     * @return qint64 the resident set size in bytes
+     */
+    static qint64 getResidentSize();
+
+    /**
+     * Get the most memory the process had in RAM so far
+     * @return qint64 the peak resident set size in bytes
+     */
+    static qint64 getPeakResidentSize();
+};
+
+#endif // PROCESS_STATS_H
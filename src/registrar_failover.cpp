@@ -0,0 +1,217 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "registrar_failover.h"
+
+#include <QDateTime>
+
+#include "log_handler.h"
+
+const int RegistrarFailover::NO_ANSWER_TIMEOUT = 40;
+
+//----------------------------------------------------------------------
+RegistrarFailover::RegistrarFailover(const int &capacity) :
+    entries_(capacity), failover_timeout_(4), retry_interval_(2), retry_max_(60)
+{
+    for (int i = 0; i < entries_.size(); ++i)
+        entries_[i].used_ = false;
+    clock_.start();
+}
+
+//----------------------------------------------------------------------
+void RegistrarFailover::setup(const QStringList &registrars, const int &failover_timeout,
+                              const int &retry_interval, const int &retry_max)
+{
+    registrars_ = registrars;
+    failover_timeout_ = qMax(failover_timeout, 1);
+    retry_interval_ = qMax(retry_interval, 1);
+    retry_max_ = qMax(retry_max, retry_interval_);
+}
+
+//----------------------------------------------------------------------
+RegistrarFailover::Entry *RegistrarFailover::find(const int &acc_id)
+{
+    if (acc_id < 0 || acc_id >= entries_.size() || !entries_[acc_id].used_)
+        return 0;
+    return &entries_[acc_id];
+}
+
+//----------------------------------------------------------------------
+const RegistrarFailover::Entry *RegistrarFailover::find(const int &acc_id) const
+{
+    if (acc_id < 0 || acc_id >= entries_.size() || !entries_[acc_id].used_)
+        return 0;
+    return &entries_[acc_id];
+}
+
+//----------------------------------------------------------------------
+int RegistrarFailover::getRegistrarCount() const
+{
+    return qMax(registrars_.size(), 1);
+}
+
+//----------------------------------------------------------------------
+QString RegistrarFailover::getRegistrar(const int &acc_id, const QString &host) const
+{
+    const Entry *entry = find(acc_id);
+    if (registrars_.isEmpty())
+        return host;
+    return registrars_.value(entry ? entry->registrar_ : 0);
+}
+
+//----------------------------------------------------------------------
+bool RegistrarFailover::apply(const int &acc_id)
+{
+    Entry *entry = find(acc_id);
+    if (!entry || entry->applied_ == entry->registrar_)
+        return false;
+    entry->applied_ = entry->registrar_;
+    return true;
+}
+
+//----------------------------------------------------------------------
+void RegistrarFailover::add(const int &acc_id)
+{
+    if (acc_id < 0 || acc_id >= entries_.size())
+        return;
+
+    Entry &entry = entries_[acc_id];
+    entry.used_ = true;
+    entry.registrar_ = 0;
+    entry.applied_ = -1;
+    entry.failed_ = 0;
+    entry.pending_since_ = -1;
+    entry.down_since_ = -1;
+    entry.retry_at_ = -1;
+    entry.retry_delay_ = retry_interval_;
+}
+
+//----------------------------------------------------------------------
+void RegistrarFailover::remove(const int &acc_id)
+{
+    if (find(acc_id))
+        entries_[acc_id].used_ = false;
+}
+
+//----------------------------------------------------------------------
+void RegistrarFailover::started(const int &acc_id)
+{
+    Entry *entry = find(acc_id);
+    if (entry && entry->pending_since_ < 0)
+        entry->pending_since_ = clock_.elapsed();
+}
+
+//----------------------------------------------------------------------
+qint64 RegistrarFailover::succeeded(const int &acc_id)
+{
+    Entry *entry = find(acc_id);
+    if (!entry)
+        return -1;
+
+    entry->pending_since_ = -1;
+    entry->failed_ = 0;
+    entry->retry_at_ = -1;
+    entry->retry_delay_ = retry_interval_;
+    if (entry->down_since_ < 0)
+        return -1;
+
+    qint64 down = clock_.elapsed() - entry->down_since_;
+    entry->down_since_ = -1;
+    return down;
+}
+
+//----------------------------------------------------------------------
+RegistrarFailover::Action RegistrarFailover::failed(const int &acc_id)
+{
+    // the answer of a registrar given up before: the next one isn't set
+    // up yet, or the round is over and waits
+    Entry *entry = find(acc_id);
+    if (!entry || entry->applied_ != entry->registrar_ || entry->retry_at_ >= 0)
+        return ACTION_NONE;
+
+    qint64 now = clock_.elapsed();
+    entry->pending_since_ = -1;
+    if (entry->down_since_ < 0)
+        entry->down_since_ = now;
+
+    entry->registrar_ = (entry->registrar_ + 1) % getRegistrarCount();
+    if (++entry->failed_ < getRegistrarCount())
+        return ACTION_REGISTER;
+
+    // every registrar failed, wait before the next round
+    entry->failed_ = 0;
+    entry->retry_at_ = now + entry->retry_delay_ * 1000;
+    LOG_WARNING("account", 0, "No registrar took account " + QString::number(acc_id)
+                + ", retrying in " + QString::number(entry->retry_delay_) + " s");
+    entry->retry_delay_ = qMin(entry->retry_delay_ * 2, retry_max_);
+    return ACTION_NONE;
+}
+
+//----------------------------------------------------------------------
+QList<int> RegistrarFailover::check()
+{
+    QList<int> due;
+    qint64 now = clock_.elapsed();
+    for (int i = 0; i < entries_.size(); ++i)
+    {
+        Entry &entry = entries_[i];
+        if (!entry.used_)
+            continue;
+
+        // with one registrar there is nothing to switch to, pjsip reports
+        // the timeout of a sent transaction itself, an attempt unanswered
+        // for longer never went out
+        int timeout = getRegistrarCount() > 1 ? failover_timeout_ : NO_ANSWER_TIMEOUT;
+        if (entry.pending_since_ >= 0 && now - entry.pending_since_ >= timeout * 1000)
+        {
+            LOG_WARNING("account", 0, "Registrar " + getRegistrar(i, QString())
+                        + " didn't answer for account " + QString::number(i));
+            if (failed(i) == ACTION_REGISTER)
+                due << i;
+        }
+        else if (entry.retry_at_ >= 0 && now >= entry.retry_at_)
+        {
+            entry.retry_at_ = -1;
+            due << i;
+        }
+    }
+    return due;
+}
+
+//----------------------------------------------------------------------
+int RegistrarFailover::getUnregisteredCount() const
+{
+    int count = 0;
+    for (int i = 0; i < entries_.size(); ++i)
+    {
+        if (entries_[i].used_ && entries_[i].down_since_ >= 0)
+            ++count;
+    }
+    return count;
+}
+
+//----------------------------------------------------------------------
+void RegistrarFailover::getInfo(const int &acc_id, const QString &host,
+                                QVariantMap &info) const
+{
+    const Entry *entry = find(acc_id);
+    if (!entry)
+        return;
+
+    info.insert("registrar", getRegistrar(acc_id, host));
+    qint64 since = 0;
+    if (entry->down_since_ >= 0)
+    {
+        since = QDateTime::currentDateTime().toMSecsSinceEpoch()
+                - (clock_.elapsed() - entry->down_since_);
+    }
+    info.insert("unregisteredSince", since);
+}
@@ -0,0 +1,192 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef REGISTRAR_FAILOVER_H
+#define REGISTRAR_FAILOVER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+
+/**
+ * Chooses the registrar of each account from an ordered list. A registrar
+ * which rejects a registration, or doesn't answer within the failover
+ * timeout, gets replaced by the next one at once. After every registrar
+ * failed, the next round waits, twice as long each time up to a maximum.
+ * An account stays with the registrar which took it. Without a list the
+ * host of the account is the only registrar.
+ * Everything belongs to the gui thread.
+ */
+class RegistrarFailover
+{
+    struct Entry
+    {
+        bool used_;
+        int registrar_;
+
+        /**
+         * Registrar the voip-api was set up with, -1 if none yet
+         */
+        int applied_;
+
+        /**
+         * Registrars failed in the current round
+         */
+        int failed_;
+
+        /**
+         * Times by clock_ in ms, -1 if not set
+         */
+        qint64 pending_since_;
+        qint64 down_since_;
+        qint64 retry_at_;
+
+        /**
+         * Wait in s before the next round
+         */
+        int retry_delay_;
+    };
+
+    QVector<Entry> entries_;
+    QStringList registrars_;
+    int failover_timeout_;
+    int retry_interval_;
+    int retry_max_;
+    QElapsedTimer clock_;
+
+    /**
+     * s after which a registration with a single registrar counts as
+     * failed, longer than pjsip waits for an answer (Timer F, 32 s)
+     */
+    static const int NO_ANSWER_TIMEOUT;
+
+    /**
+     * Get the entry of an account
+     * @param acc_id int, the id of the account
+     * @return Entry* the entry, 0 if the account isn't added
+     */
+    Entry *find(const int &acc_id);
+    const Entry *find(const int &acc_id) const;
+
+public:
+    /**
+     * \name What to do after a failed registration
+     * \{
+     */
+    enum Action
+    {
+        ACTION_NONE,        // nothing, a retry is scheduled or it was stale
+        ACTION_REGISTER     // register at the next registrar now
+    };
+    /**
+     * \}
+     */
+
+    /**
+     * Constructor
+     * @param capacity int, the number of account ids of the voip-api
+     */
+    RegistrarFailover(const int &capacity);
+
+    /**
+     * Set the registrars and timers
+     * @param registrars QStringList, host[:port] of each registrar in
+     *        order, empty to use the host of the account
+     * @param failover_timeout int, s a registration may stay unanswered
+     *        before the next registrar is tried, if there are several
+     * @param retry_interval int, s to wait after every registrar failed
+     * @param retry_max int, maximum s to wait, the wait doubles up to it
+     */
+    void setup(const QStringList &registrars, const int &failover_timeout,
+               const int &retry_interval, const int &retry_max);
+
+    /**
+     * Get the number of registrars
+     * @return int the number, at least 1
+     */
+    int getRegistrarCount() const;
+
+    /**
+     * Get the current registrar of an account
+     * @param acc_id int, the id of the account
+     * @param host QString, the host of the account
+     * @return QString host[:port] of the registrar
+     */
+    QString getRegistrar(const int &acc_id, const QString &host) const;
+
+    /**
+     * Check if the registrar changed since the voip-api was last set up
+     * and remember it as set up
+     * @param acc_id int, the id of the account
+     * @return bool true if the registrar changed
+     */
+    bool apply(const int &acc_id);
+
+    /**
+     * Start choosing the registrar of an account, with the first one
+     * @param acc_id int, the id of the account
+     */
+    void add(const int &acc_id);
+
+    /**
+     * Stop choosing the registrar of an account
+     * @param acc_id int, the id of the account
+     */
+    void remove(const int &acc_id);
+
+    /**
+     * A registration of an account was started, by the phone or by a
+     * refresh of the voip-api
+     * @param acc_id int, the id of the account
+     */
+    void started(const int &acc_id);
+
+    /**
+     * A registrar took an account
+     * @param acc_id int, the id of the account
+     * @return qint64 the ms the account was unregistered, -1 if it wasn't
+     */
+    qint64 succeeded(const int &acc_id);
+
+    /**
+     * A registration of an account failed, it needn't have been started,
+     * a late answer of a registrar given up before is ignored
+     * @param acc_id int, the id of the account
+     * @return Action what to do now
+     */
+    Action failed(const int &acc_id);
+
+    /**
+     * Fail the registrars which don't answer in time, and end the waits
+     * before a new round
+     * @return QList<int> the accounts to register now
+     */
+    QList<int> check();
+
+    /**
+     * Get the number of accounts which lost their registration
+     * @return int the number of accounts
+     */
+    int getUnregisteredCount() const;
+
+    /**
+     * Get the failover state of an account
+     * @param acc_id int, the id of the account
+     * @param host QString, the host of the account
+     * @param info QVariantMap, gets registrar and unregisteredSince (ms
+     *        since epoch, 0 while registered)
+     */
+    void getInfo(const int &acc_id, const QString &host, QVariantMap &info) const;
+};
+
+#endif // REGISTRAR_FAILOVER_H
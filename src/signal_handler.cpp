@@ -0,0 +1,109 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "signal_handler.h"
+
+#include <QCoreApplication>
+#include <QSocketNotifier>
+
+#include <signal.h>
+#include <string.h>
+#ifdef Q_OS_UNIX
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "log_handler.h"
+
+int SignalHandler::fds_[2] = { -1, -1 };
+
+//----------------------------------------------------------------------
+SignalHandler::SignalHandler(QObject *parent) :
+    QObject(parent), notifier_(0)
+{
+}
+
+//----------------------------------------------------------------------
+SignalHandler::~SignalHandler()
+{
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+#ifdef Q_OS_UNIX
+    delete notifier_;
+    if (fds_[0] >= 0)
+    {
+        ::close(fds_[0]);
+        ::close(fds_[1]);
+        fds_[0] = fds_[1] = -1;
+    }
+#endif
+}
+
+//----------------------------------------------------------------------
+void SignalHandler::handleSignal(int sig)
+{
+#ifdef Q_OS_UNIX
+    // only async-signal-safe calls here
+    char c = (char)sig;
+    ssize_t written = ::write(fds_[1], &c, 1);
+    (void)written;
+#else
+    // runs on a thread of its own on windows
+    Q_UNUSED(sig);
+    QMetaObject::invokeMethod(QCoreApplication::instance(), "quit", Qt::QueuedConnection);
+#endif
+}
+
+//----------------------------------------------------------------------
+bool SignalHandler::install()
+{
+#ifdef Q_OS_UNIX
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds_) != 0)
+    {
+        LOG_ERROR("daemon", 0, "Can't create the socket pair for signals");
+        return false;
+    }
+    notifier_ = new QSocketNotifier(fds_[0], QSocketNotifier::Read, this);
+    connect(notifier_, SIGNAL(activated(int)), this, SLOT(readSignal()));
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &SignalHandler::handleSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (sigaction(SIGINT, &action, 0) != 0 || sigaction(SIGTERM, &action, 0) != 0)
+    {
+        LOG_ERROR("daemon", 0, "Can't install the signal handler");
+        return false;
+    }
+#else
+    signal(SIGINT, &SignalHandler::handleSignal);
+    signal(SIGTERM, &SignalHandler::handleSignal);
+#endif
+    return true;
+}
+
+//----------------------------------------------------------------------
+void SignalHandler::readSignal()
+{
+#ifdef Q_OS_UNIX
+    char sig = 0;
+    ssize_t count = ::read(fds_[0], &sig, 1);
+    (void)count;
+
+    // a shutdown that hangs can still be ended
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+
+    LOG_MESSAGE("daemon", 0, "Got signal " + QString::number((int)sig) + ", shutting down");
+    QCoreApplication::quit();
+#endif
+}
@@ -0,0 +1,64 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef SIGNAL_HANDLER_H
+#define SIGNAL_HANDLER_H
+
+#include <QObject>
+
+class QSocketNotifier;
+
+/**
+ * Quits the application on SIGINT and SIGTERM, so greenjd shuts down the
+ * way it does on a regular exit: accounts get unregistered, open calls
+ * written to the error log and the log queue flushed.
+ * On unix the signal handler only writes to a socket pair, the event
+ * loop reads it. A second signal ends the process at once.
+ */
+class SignalHandler : public QObject
+{
+    Q_OBJECT
+
+    QSocketNotifier *notifier_;
+
+    /**
+     * Socket pair, the signal handler writes to [1]
+     */
+    static int fds_[2];
+
+    /**
+     * Handler of the signals
+     * @param sig int, the signal
+     */
+    static void handleSignal(int sig);
+
+private slots:
+    /**
+     * Quit the application after a signal
+     */
+    void readSignal();
+
+public:
+    /**
+     * Constructor
+     * @param parent QObject*
+     */
+    SignalHandler(QObject *parent = 0);
+    ~SignalHandler();
+
+    /**
+     * Install the handler for SIGINT and SIGTERM
+     * @return bool false if it can't be installed
+     */
+    bool install();
+};
+
+#endif // SIGNAL_HANDLER_H
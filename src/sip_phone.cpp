@@ -11,37 +11,70 @@
 
 #include "sip_phone.h"
 
-#include <QApplication>
-#include <QTextDocument>
-
 #include "phone.h"
-#include "gui.h"
 #include "call.h"
 #include "log_handler.h"
 #include "account.h"
 #include "config_file_handler.h"
+#include "startup_timeline.h"
+#include "call_timeline.h"
+#include "metrics_registry.h"
+
+#include <QDir>
+#include <QDateTime>
 
 SipPhone *SipPhone::self_;
 
+const int SipPhone::EVENT_INTERVAL = 10;
+const int SipPhone::MAX_CODECS = 32;
+const int SipPhone::FAILOVER_INTERVAL = 500;
+
+pjsip_module SipPhone::reg_module_ = {
+    NULL, NULL,                             // prev, next
+    { (char*)"mod-greenj-register", 19 },   // name
+    -1,                                     // id
+    PJSIP_MOD_PRIORITY_APPLICATION,         // priority
+    NULL, NULL, NULL, NULL,                 // load, start, stop, unload
+    NULL, NULL,                             // on_rx_request, on_rx_response
+    &SipPhone::txRequestCb,                 // on_tx_request
+    NULL, NULL                              // on_tx_response, on_tsx_state
+};
+
 //----------------------------------------------------------------------
-SipPhone::SipPhone()
+SipPhone::SipPhone() :
+    account_transport_id_(PJSUA_INVALID_ID), accounts_(PJSUA_MAX_ACC, PJSUA_MAX_CALLS),
+    failover_(PJSUA_MAX_ACC)
 {
     self_ = this;
+    event_batch_ = new PhoneEvent[event_queue_.capacity()];
+    event_merged_ = new bool[event_queue_.capacity()];
+    pjsua_media_config_default(&media_cfg_);
+    for (int i = 0; i < PJSUA_MAX_CALLS; ++i)
+    {
+        players_[i] = PJSUA_INVALID_ID;
+        recorders_[i] = PJSUA_INVALID_ID;
+        quality_generations_[i] = 0;
+    }
+
+    connect(&event_timer_, SIGNAL(timeout()), this, SLOT(processEvents()));
+    connect(&quality_timer_, SIGNAL(timeout()), this, SLOT(sampleQuality()));
+    connect(&failover_timer_, SIGNAL(timeout()), this, SLOT(checkRegistrations()));
 }
 
 //----------------------------------------------------------------------
-void SipPhone::init()
+bool SipPhone::init()
 {
+    StartupTimeline &timeline = StartupTimeline::getInstance();
     pj_status_t status;
     /* Create pjsua first! */
     status = pjsua_create();
 
     if (status != PJ_SUCCESS)
     {
-        LogInfo info(LogInfo::STATUS_FATAL_ERROR, "pjsip", status, "Error in pjsua_create()");
-        signalLogData(info);
-        return;
+        LOG_FATAL_ERROR("pjsip", status, "Error in pjsua_create()");
+        return false;
     }
+    timeline.mark("sip_create");
 
     /* Init pjsua */
     {
@@ -50,15 +83,15 @@ void SipPhone::init()
         ConfigFileHandler &config = ConfigFileHandler::getInstance();
         QString stun = config.getStunServer();
         pjsua_config_default(&cfg);
+        account_transport_ = config.getSipAccountTransport();
 
         if (stun.size())
         {
             char ch_stun[100];
             if (stun.size() > 99)
             {
-                LogInfo info(LogInfo::STATUS_ERROR, "pjsip", 0, "Error init pjsip, stun-server too long");
-                signalLogData(info);
-                return;
+                LOG_ERROR("pjsip", 0, "Error init pjsip, stun-server too long");
+                return false;
             }
 
             strcpy(ch_stun, stun.toLocal8Bit().data());
@@ -66,172 +99,772 @@ void SipPhone::init()
 
             cfg.stun_srv[cfg.stun_srv_cnt++] = pj_str(ch_stun);
         }
+
+        // pjsua_init copies the config, the string only has to live until then
+        QByteArray ch_proxy;
+        QString proxy = config.getSipOutboundProxy();
+        if (proxy.size())
+        {
+            if (!proxy.startsWith("sip:") && !proxy.startsWith("sips:"))
+                proxy = "sip:" + proxy + ";lr";
+            ch_proxy = addTransportParam(proxy).toLocal8Bit();
+            cfg.outbound_proxy[cfg.outbound_proxy_cnt++] = pj_str(ch_proxy.data());
+        }
         cfg.enable_unsolicited_mwi = PJ_FALSE;
+        // the accounts limit their calls themselves (see AccountTable)
+        cfg.max_calls = PJSUA_MAX_CALLS;
         cfg.cb.on_incoming_call = &incomingCallCb;
         cfg.cb.on_call_state = &callStateCb;
         cfg.cb.on_call_media_state = &callMediaStateCb;
+        cfg.cb.on_call_tsx_state = &callTsxStateCb;
         cfg.cb.on_reg_state = &regStateCb;
 
         pjsua_logging_config_default(&log_cfg);
         log_cfg.console_level = 4;
 
-        status = pjsua_init(&cfg, &log_cfg, NULL);
+        // settings of the media profile, the others keep the defaults
+        const QMap<QString, int> &media = config.getMediaSettings();
+        pjsua_media_config_default(&media_cfg_);
+        media_cfg_.no_vad = config.getVad() ? PJ_FALSE : PJ_TRUE;
+        // sound device, and each call with player and recorder
+        media_cfg_.max_media_ports = PJSUA_MAX_CALLS * 3 + 1;
+        media_cfg_.clock_rate = media.value("clock_rate", media_cfg_.clock_rate);
+        media_cfg_.audio_frame_ptime = media.value("audio_frame_ptime", media_cfg_.audio_frame_ptime);
+        media_cfg_.snd_rec_latency = media.value("snd_rec_latency", media_cfg_.snd_rec_latency);
+        media_cfg_.snd_play_latency = media.value("snd_play_latency", media_cfg_.snd_play_latency);
+        media_cfg_.jb_init = media.value("jb_init", media_cfg_.jb_init);
+        media_cfg_.jb_min_pre = media.value("jb_min_pre", media_cfg_.jb_min_pre);
+        media_cfg_.jb_max_pre = media.value("jb_max_pre", media_cfg_.jb_max_pre);
+        media_cfg_.jb_max = media.value("jb_max", media_cfg_.jb_max);
+        media_cfg_.quality = media.value("quality", media_cfg_.quality);
+        media_cfg_.ec_tail_len = media.value("ec_tail_len", media_cfg_.ec_tail_len);
+
+        status = pjsua_init(&cfg, &log_cfg, &media_cfg_);
         printf("init successfull\n");
         if (status != PJ_SUCCESS)
         {
-            LogInfo info(LogInfo::STATUS_FATAL_ERROR, "pjsip", status, "Error in pjsua_init()");
-            signalLogData(info);
-            return;
+            LOG_FATAL_ERROR("pjsip", status, "Error in pjsua_init()");
+            return false;
+        }
+
+        // no sound card needed, the conference bridge gets its own clock
+        if (config.getNullAudio())
+        {
+            status = pjsua_set_null_snd_dev();
+            if (status != PJ_SUCCESS)
+                LOG_ERROR("pjsip", status, "Error setting the null sound device");
         }
+
+        status = pjsip_endpt_register_module(pjsua_get_pjsip_endpt(), &reg_module_);
+        if (status != PJ_SUCCESS)
+            LOG_ERROR("pjsip", status, "Error registering the register module");
+        failover_.setup(config.getSipRegistrars(), config.getSipRegFailoverTimeout(),
+                        config.getSipRegRetryInterval(), config.getSipRegRetryMax());
+        timeline.mark("sip_init");
     }
+    applyCodecSettings();
 
-    /* Add UDP transport. */
+    /* Add the transports */
     {
-        pjsua_transport_config cfg;
+        QStringList transports = ConfigFileHandler::getInstance().getSipTransports();
+        for (int i = 0; i < transports.size(); ++i)
+        {
+            pjsua_transport_id transport_id;
+            if (!createTransport(transports[i], transport_id))
+                continue;
+            if (transports[i] == account_transport_)
+                account_transport_id_ = transport_id;
+        }
+        if (account_transport_id_ == PJSUA_INVALID_ID)
+        {
+            LOG_FATAL_ERROR("pjsip", 0, "Error creating " + account_transport_ + " transport");
+            return false;
+        }
+
+        /* Add local account */
         pjsua_acc_id aid;
-        pjsua_transport_id transport_id = -1;
-        pjsua_transport_config tcp_cfg;
+        pjsua_acc_add_local(account_transport_id_, PJ_TRUE, &aid);
+        pjsua_acc_set_online_status(aid, PJ_TRUE);
+        timeline.mark("sip_transport");
+    }
+    /* Initialization is done, now start pjsua */
+    status = pjsua_start();
+
+    if (status != PJ_SUCCESS)
+    {
+        LOG_FATAL_ERROR("pjsip", status, "Error starting PJSUA");
+        return false;
+    }
+    pjsua_conf_adjust_rx_level(0, 1.f);
+    pjsua_conf_adjust_tx_level(0, 1.f);
+    speaker_level_ = 1.f;
+    mic_level_ = 1.f;
+    timeline.mark("sip_start");
+
+    return true;
+}
+
+//----------------------------------------------------------------------
+void SipPhone::registerThread()
+{
+    if (pj_thread_is_registered())
+        return;
+
+    pj_thread_t *thread;
+    pj_bzero(thread_desc_, sizeof(thread_desc_));
+    pj_status_t status = pj_thread_register("gui", thread_desc_, &thread);
+    if (status != PJ_SUCCESS)
+        LOG_ERROR("pjsip", status, "Error registering the gui thread");
+}
+
+//----------------------------------------------------------------------
+void SipPhone::start()
+{
+    registerThread();
+
+    connect(&ConfigFileHandler::getInstance(),
+            SIGNAL(signalCodecsChanged()),
+            this,
+            SLOT(applyCodecSettings()));
+
+    updateMediaFiles();
+    connect(&ConfigFileHandler::getInstance(),
+            SIGNAL(signalMediaFilesChanged()),
+            this,
+            SLOT(updateMediaFiles()));
+
+    updateQualityInterval();
+    connect(&ConfigFileHandler::getInstance(),
+            SIGNAL(signalQualitySettingsChanged()),
+            this,
+            SLOT(updateQualityInterval()));
+
+    // events pushed during the startup get handled now
+    event_timer_.start(EVENT_INTERVAL);
+    failover_timer_.start(FAILOVER_INTERVAL);
+}
+
+//----------------------------------------------------------------------
+bool SipPhone::createTransport(const QString &name, pjsua_transport_id &transport_id)
+{
+    ConfigFileHandler &config = ConfigFileHandler::getInstance();
+    pjsua_transport_config cfg;
+    pjsua_transport_config_default(&cfg);
+
+    // the strings only have to live until the transport is created
+    QByteArray bind_address = config.getSipBindAddress().toLocal8Bit();
+    if (bind_address.size())
+        cfg.bound_addr = pj_str(bind_address.data());
+
+    pjsip_transport_type_e type;
+    QByteArray ca_file = config.getSipTlsCaFile().toLocal8Bit();
+    QByteArray cert_file = config.getSipTlsCertFile().toLocal8Bit();
+    QByteArray key_file = config.getSipTlsKeyFile().toLocal8Bit();
+    if (name == "tls")
+    {
+#if defined(PJSIP_HAS_TLS_TRANSPORT) && PJSIP_HAS_TLS_TRANSPORT != 0
+        type = PJSIP_TRANSPORT_TLS;
+        cfg.port = config.getSipTlsPort();
+        if (ca_file.size())
+        {
+            cfg.tls_setting.ca_list_file = pj_str(ca_file.data());
+            cfg.tls_setting.verify_server = PJ_TRUE;
+        }
+        if (cert_file.size())
+            cfg.tls_setting.cert_file = pj_str(cert_file.data());
+        if (key_file.size())
+            cfg.tls_setting.privkey_file = pj_str(key_file.data());
+#else
+        LOG_ERROR("pjsip", 0, "Error creating transport, pjsip is built without TLS");
+        return false;
+#endif
+    }
+    else
+    {
+        type = name == "tcp" ? PJSIP_TRANSPORT_TCP : PJSIP_TRANSPORT_UDP;
+        cfg.port = config.getSipPort();
+    }
+    cfg.port_range = config.getSipPortRange();
 
-        pjsua_transport_config_default(&cfg);
-        cfg.port = 5060;
+    pj_status_t status = pjsua_transport_create(type, &cfg, &transport_id);
+    if (status != PJ_SUCCESS)
+    {
+        LOG_ERROR("pjsip", status, "Error creating " + name + " transport");
+        return false;
+    }
 
-        status = pjsua_transport_create(PJSIP_TRANSPORT_UDP, &cfg, &transport_id);
+    pjsua_transport_info info;
+    if (pjsua_transport_get_info(transport_id, &info) == PJ_SUCCESS)
+    {
+        LOG_MESSAGE("pjsip", 0, "Listening on "
+                    + QString::fromLocal8Bit(info.local_name.host.ptr, info.local_name.host.slen)
+                    + ":" + QString::number(info.local_name.port) + " (" + name + ")");
+    }
+    return true;
+}
+
+//----------------------------------------------------------------------
+QString SipPhone::addTransportParam(const QString &uri) const
+{
+    if (account_transport_ == "udp" || uri.contains("transport=", Qt::CaseInsensitive))
+        return uri;
+    return uri + ";transport=" + account_transport_;
+}
+
+//----------------------------------------------------------------------
+int SipPhone::matchCodec(const QStringList &names, const QString &codec_id)
+{
+    for (int i = 0; i < names.size(); ++i)
+    {
+        // whole parts only, "G722" isn't "G7221/16000/1"
+        const QString &name = names[i];
+        if (codec_id.startsWith(name, Qt::CaseInsensitive)
+            && (codec_id.size() == name.size() || codec_id[name.size()] == '/'
+                || name.endsWith('/')))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
 
+//----------------------------------------------------------------------
+void SipPhone::applyCodecSettings()
+{
+    ConfigFileHandler &config = ConfigFileHandler::getInstance();
+    const QStringList &priority = config.getCodecPriority();
+    QStringList ptime_names = config.getCodecPtimes().keys();
+    QList<int> ptimes = config.getCodecPtimes().values();
+
+    pjsua_codec_info codecs[MAX_CODECS];
+    unsigned count = MAX_CODECS;
+    pj_status_t status = pjsua_enum_codecs(codecs, &count);
+    if (status != PJ_SUCCESS)
+    {
+        LOG_ERROR("pjsip", status, "Error enumerating codecs");
+        return;
+    }
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        QString id = QString::fromLatin1(codecs[i].codec_id.ptr, codecs[i].codec_id.slen);
+
+        // the listed codecs come first in their order, the others
+        // after them or not at all
+        if (!priority.isEmpty())
+        {
+            int index = matchCodec(priority, id);
+            int prio;
+            if (index >= 0)
+                prio = qMax(PJMEDIA_CODEC_PRIO_HIGHEST - 1 - index, PJMEDIA_CODEC_PRIO_LOWEST + 1);
+            else if (config.getCodecsExclusive())
+                prio = PJMEDIA_CODEC_PRIO_DISABLED;
+            else
+                prio = PJMEDIA_CODEC_PRIO_LOWEST;
+            pjsua_codec_set_priority(&codecs[i].codec_id, (pj_uint8_t)prio);
+        }
+
+        pjmedia_codec_param param;
+        if (pjsua_codec_get_param(&codecs[i].codec_id, &param) != PJ_SUCCESS)
+            continue;
+
+        param.setting.vad = config.getVad() ? 1 : 0;
+        param.setting.cng = config.getCng() ? 1 : 0;
+        if (config.getMediaSettings().contains("plc"))
+            param.setting.plc = config.getMediaSettings().value("plc") ? 1 : 0;
+        int index = matchCodec(ptime_names, id);
+        if (index >= 0 && param.info.frm_ptime > 0)
+            param.setting.frm_per_pkt = (pj_uint8_t)qMax(ptimes[index] / param.info.frm_ptime, 1);
+
+        status = pjsua_codec_set_param(&codecs[i].codec_id, &param);
         if (status != PJ_SUCCESS)
+            LOG_WARNING("pjsip", status, "Error setting parameters of codec " + id);
+    }
+}
+
+//----------------------------------------------------------------------
+void SipPhone::getCodecList(QVariantList &codecs)
+{
+    pjsua_codec_info info[MAX_CODECS];
+    unsigned count = MAX_CODECS;
+    if (pjsua_enum_codecs(info, &count) != PJ_SUCCESS)
+        return;
+
+    for (unsigned i = 0; i < count; ++i)
+    {
+        QVariantMap codec;
+        codec.insert("id", QString::fromLatin1(info[i].codec_id.ptr, info[i].codec_id.slen));
+        codec.insert("priority", info[i].priority);
+
+        pjmedia_codec_param param;
+        if (pjsua_codec_get_param(&info[i].codec_id, &param) == PJ_SUCCESS)
         {
-            LogInfo info(LogInfo::STATUS_FATAL_ERROR, "pjsip", status, "Error creating transport");
-            signalLogData(info);
-            return;
+            codec.insert("clockRate", param.info.clock_rate);
+            codec.insert("channels", param.info.channel_cnt);
+            codec.insert("ptime", param.info.frm_ptime * param.setting.frm_per_pkt);
+            codec.insert("bitrate", param.info.avg_bps);
+            codec.insert("vad", param.setting.vad != 0);
+            codec.insert("cng", param.setting.cng != 0);
         }
 
-        /* Add local account */
-        pjsua_acc_add_local(transport_id, PJ_TRUE, &aid);
-        pjsua_acc_set_online_status(aid, PJ_TRUE);
+        // pjsua lists them by priority already, keep that order
+        codecs << QVariant(codec);
+    }
+}
+
+//----------------------------------------------------------------------
+void SipPhone::getMediaInformation(QVariantMap &info)
+{
+    info.insert("profile", ConfigFileHandler::getInstance().getMediaProfile());
+    info.insert("clockRate", media_cfg_.clock_rate);
+    info.insert("audioFramePtime", media_cfg_.audio_frame_ptime);
+    info.insert("sndRecLatency", media_cfg_.snd_rec_latency);
+    info.insert("sndPlayLatency", media_cfg_.snd_play_latency);
+    info.insert("jbInit", media_cfg_.jb_init);
+    info.insert("jbMinPre", media_cfg_.jb_min_pre);
+    info.insert("jbMaxPre", media_cfg_.jb_max_pre);
+    info.insert("jbMax", media_cfg_.jb_max);
+    info.insert("quality", media_cfg_.quality);
+    info.insert("ecTailLen", media_cfg_.ec_tail_len);
+
+    // plc is a codec setting, all codecs get the same
+    pjsua_codec_info codecs[MAX_CODECS];
+    unsigned count = MAX_CODECS;
+    pjmedia_codec_param param;
+    if (pjsua_enum_codecs(codecs, &count) == PJ_SUCCESS && count > 0
+        && pjsua_codec_get_param(&codecs[0].codec_id, &param) == PJ_SUCCESS)
+    {
+        info.insert("plc", param.setting.plc != 0);
+    }
+
+    info.insert("nullAudio", ConfigFileHandler::getInstance().getNullAudio());
 
-        if (cfg.port == 0)
+    // the device knows its latency only while it's open
+    unsigned latency;
+    if (pjsua_snd_get_setting(PJMEDIA_AUD_DEV_CAP_INPUT_LATENCY, &latency) == PJ_SUCCESS)
+        info.insert("inputLatency", latency);
+    if (pjsua_snd_get_setting(PJMEDIA_AUD_DEV_CAP_OUTPUT_LATENCY, &latency) == PJ_SUCCESS)
+        info.insert("outputLatency", latency);
+}
+
+//----------------------------------------------------------------------
+void SipPhone::updateMediaFiles()
+{
+    ConfigFileHandler &config = ConfigFileHandler::getInstance();
+    QMutexLocker locker(&media_mutex_);
+    play_file_ = config.getPlayFile();
+    record_dir_ = config.getRecordDir();
+}
+
+//----------------------------------------------------------------------
+void SipPhone::startMediaFiles(const int &call_id)
+{
+    QString play_file;
+    QString record_file;
+    {
+        QMutexLocker locker(&media_mutex_);
+        if (players_[call_id] == PJSUA_INVALID_ID)
+            play_file = play_file_;
+        if (recorders_[call_id] == PJSUA_INVALID_ID && !record_dir_.isEmpty())
         {
-            pjsua_transport_info ti;
-            pj_sockaddr_in *a;
+            record_file = QDir(record_dir_).filePath(QString("call-%1-%2.wav")
+                .arg(call_id)
+                .arg(QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss-zzz")));
+        }
+    }
+    // the page may have started its own meanwhile, which stays
+    if (!play_file.isEmpty())
+        startPlayer(call_id, play_file, false);
+    if (!record_file.isEmpty())
+        startRecorder(call_id, record_file, false);
+}
 
-            pjsua_transport_get_info(transport_id, &ti);
-            a = (pj_sockaddr_in*)&ti.local_addr;
+//----------------------------------------------------------------------
+bool SipPhone::playFile(const int &call_id, const QString &file)
+{
+    return startPlayer(call_id, file, true);
+}
+
+//----------------------------------------------------------------------
+bool SipPhone::startPlayer(const int &call_id, const QString &file, const bool &replace)
+{
+    if (call_id < 0 || call_id >= PJSUA_MAX_CALLS)
+        return false;
 
-            tcp_cfg.port = pj_ntohs(a->sin_port);
+    pjsua_call_info ci;
+    if (pjsua_call_get_info(call_id, &ci) != PJ_SUCCESS)
+        return false;
+
+    if (replace)
+        stopPlayFile(call_id);
+
+    QByteArray file_name = file.toLocal8Bit();
+    pj_str_t name = pj_str(file_name.data());
+    pjsua_player_id player_id;
+    pj_status_t status = pjsua_player_create(&name, 0, &player_id);
+    if (status != PJ_SUCCESS)
+    {
+        LOG_ERROR("pjsip", status, "Error playing " + file);
+        return false;
+    }
+
+    // the microphone stays connected, with the null sound device it's silent
+    status = pjsua_conf_connect(pjsua_player_get_conf_port(player_id), ci.conf_slot);
+    if (status != PJ_SUCCESS)
+    {
+        LOG_ERROR("pjsip", status, "Error connecting the player to the call");
+        pjsua_player_destroy(player_id);
+        return false;
+    }
+
+    // another player may have been stored since the check, one of them
+    // has to go
+    pjsua_player_id displaced = player_id;
+    {
+        QMutexLocker locker(&media_mutex_);
+        if (replace || players_[call_id] == PJSUA_INVALID_ID)
+        {
+            displaced = players_[call_id];
+            players_[call_id] = player_id;
         }
+    }
+    if (displaced != PJSUA_INVALID_ID)
+        pjsua_player_destroy(displaced);
+    return displaced != player_id;
+}
 
+//----------------------------------------------------------------------
+void SipPhone::stopPlayFile(const int &call_id)
+{
+    if (call_id < 0 || call_id >= PJSUA_MAX_CALLS)
+        return;
+
+    pjsua_player_id player_id;
+    {
+        QMutexLocker locker(&media_mutex_);
+        player_id = players_[call_id];
+        players_[call_id] = PJSUA_INVALID_ID;
     }
-    /* Initialization is done, now start pjsua */
-    status = pjsua_start();
+    if (player_id != PJSUA_INVALID_ID)
+        pjsua_player_destroy(player_id);
+}
 
+//----------------------------------------------------------------------
+bool SipPhone::recordCall(const int &call_id, const QString &file)
+{
+    return startRecorder(call_id, file, true);
+}
+
+//----------------------------------------------------------------------
+bool SipPhone::startRecorder(const int &call_id, const QString &file, const bool &replace)
+{
+    if (call_id < 0 || call_id >= PJSUA_MAX_CALLS)
+        return false;
+
+    pjsua_call_info ci;
+    if (pjsua_call_get_info(call_id, &ci) != PJ_SUCCESS)
+        return false;
+
+    if (replace)
+        stopRecordCall(call_id);
+
+    QByteArray file_name = file.toLocal8Bit();
+    pj_str_t name = pj_str(file_name.data());
+    pjsua_recorder_id recorder_id;
+    pj_status_t status = pjsua_recorder_create(&name, 0, NULL, 0, 0, &recorder_id);
+    if (status != PJ_SUCCESS)
+    {
+        LOG_ERROR("pjsip", status, "Error recording to " + file);
+        return false;
+    }
+
+    status = pjsua_conf_connect(ci.conf_slot, pjsua_recorder_get_conf_port(recorder_id));
     if (status != PJ_SUCCESS)
     {
-        LogInfo info(LogInfo::STATUS_FATAL_ERROR, "pjsip", status, "Error starting PJSUA");
-        signalLogData(info);
+        LOG_ERROR("pjsip", status, "Error connecting the call to the recorder");
+        pjsua_recorder_destroy(recorder_id);
+        return false;
+    }
+
+    pjsua_recorder_id displaced = recorder_id;
+    {
+        QMutexLocker locker(&media_mutex_);
+        if (replace || recorders_[call_id] == PJSUA_INVALID_ID)
+        {
+            displaced = recorders_[call_id];
+            recorders_[call_id] = recorder_id;
+        }
+    }
+    if (displaced != PJSUA_INVALID_ID)
+        pjsua_recorder_destroy(displaced);
+    return displaced != recorder_id;
+}
+
+//----------------------------------------------------------------------
+void SipPhone::stopRecordCall(const int &call_id)
+{
+    if (call_id < 0 || call_id >= PJSUA_MAX_CALLS)
         return;
+
+    pjsua_recorder_id recorder_id;
+    {
+        QMutexLocker locker(&media_mutex_);
+        recorder_id = recorders_[call_id];
+        recorders_[call_id] = PJSUA_INVALID_ID;
     }
-    pjsua_conf_adjust_rx_level(0, 1.f);
-    pjsua_conf_adjust_tx_level(0, 1.f);
-    speaker_level_ = 1.f;
-    mic_level_ = 1.f;
+    if (recorder_id != PJSUA_INVALID_ID)
+        pjsua_recorder_destroy(recorder_id);
+}
+
+//----------------------------------------------------------------------
+QString SipPhone::escape(const char *text)
+{
+    // same as Qt::escape, which needs QtGui
+    QString result(text);
+    result.replace('&', "&amp;");
+    result.replace('<', "&lt;");
+    result.replace('>', "&gt;");
+    result.replace('"', "&quot;");
+    return result;
+}
+
+//----------------------------------------------------------------------
+pjsua_acc_id SipPhone::getAccountId(const int &acc_id) const
+{
+    if (acc_id < 0)
+        return accounts_.getDefault() < 0 ? PJSUA_INVALID_ID : accounts_.getDefault();
+    if (!accounts_.contains(acc_id))
+        return PJSUA_INVALID_ID;
+    return acc_id;
 }
 
 //----------------------------------------------------------------------
-bool SipPhone::checkAccountStatus()
+bool SipPhone::checkAccountStatus(const int &acc_id)
 {
-    return pjsua_acc_is_valid(acc_id_);
+    pjsua_acc_id id = getAccountId(acc_id);
+    return id != PJSUA_INVALID_ID && pjsua_acc_is_valid(id);
+}
+
+//----------------------------------------------------------------------
+void SipPhone::fillAccountConfig(const Account &acc, const QString &registrar,
+                                 pjsua_acc_config &cfg, AccountConfigData &data) const
+{
+    ConfigFileHandler &config = ConfigFileHandler::getInstance();
+    pjsua_acc_config_default(&cfg);
+
+    data.id_ = ("sip:" + acc.getUserName() + "@" + acc.getHost()).toLocal8Bit();
+    data.reg_uri_ = addTransportParam("sip:" + registrar).toLocal8Bit();
+    data.user_ = acc.getUserName().toLocal8Bit();
+    data.password_ = acc.getPassword().toLocal8Bit();
+
+    cfg.id = pj_str(data.id_.data());
+    cfg.reg_uri = pj_str(data.reg_uri_.data());
+    cfg.cred_count = 1;
+    cfg.cred_info[0].realm = pj_str((char*)"*");
+    cfg.cred_info[0].scheme = pj_str((char*)"digest");
+    cfg.cred_info[0].username = pj_str(data.user_.data());
+    cfg.cred_info[0].data_type = 0;
+    cfg.cred_info[0].data = pj_str(data.password_.data());
+
+    // with a list of registrars the calls follow the registration
+    if (!config.getSipRegistrars().isEmpty())
+    {
+        data.proxy_ = addTransportParam("sip:" + registrar + ";lr").toLocal8Bit();
+        cfg.proxy[cfg.proxy_cnt++] = pj_str(data.proxy_.data());
+    }
+
+    // registration and calls of the account use the connection of its
+    // transport, pjsip keeps tcp and tls connections open and reuses
+    // them (keep-alive by PJSIP_TCP/TLS_KEEP_ALIVE_INTERVAL), for udp
+    // the account sends the keep-alive packets itself
+    cfg.transport_id = account_transport_id_;
+    cfg.ka_interval = config.getSipKeepAlive();
+    cfg.reg_timeout = config.getSipRegExpires();
+    // failed registrations get retried by the RegistrarFailover
+    cfg.reg_retry_interval = 0;
 }
 
 //----------------------------------------------------------------------
 int SipPhone::registerUser(const Account &acc)
 {
-    QString user = acc.getUserName();
-    QString password = acc.getPassword();
-    QString domain = acc.getHost();
-    if (pjsua_acc_is_valid(acc_id_))
+    if (accounts_.findId(acc) >= 0)
     {
-        LogInfo info(LogInfo::STATUS_WARNING, "pjsip", 0, "Account already exists");
-        signalLogData(info);
+        LOG_WARNING("pjsip", 0, "Account already exists");
         return -1;
     }
 
     /* Register to SIP server by creating SIP account. */
     pjsua_acc_config cfg;
+    AccountConfigData data;
+    fillAccountConfig(acc, failover_.getRegistrar(-1, acc.getHost()), cfg, data);
 
-    pjsua_acc_config_default(&cfg);
+    // the first account is the default one of pjsip too, it gets the
+    // requests which don't match any account
+    pjsua_acc_id acc_id;
+    pj_bool_t is_default = accounts_.getDefault() < 0 ? PJ_TRUE : PJ_FALSE;
+    pj_status_t status = pjsua_acc_add(&cfg, is_default, &acc_id);
 
-    QString id = "sip:";
-    id.append(user);
-    id.append("@");
-    id.append(domain);
+    if (status != PJ_SUCCESS)
+    {
+        LOG_ERROR("pjsip", status, "Error adding account");
+        return -1;
+    }
+    if (!accounts_.insert(acc_id, acc))
+    {
+        LOG_ERROR("pjsip", 0, "Error adding account, invalid account-id "
+                  + QString::number(acc_id));
+        pjsua_acc_del(acc_id);
+        return -1;
+    }
+    failover_.add(acc_id);
+    failover_.apply(acc_id);
+    // pjsua_acc_add doesn't tell if its registration went out, a missing
+    // answer gets noticed by the timeout
+    failover_.started(acc_id);
+    LOG_MESSAGE("pjsip", 0, "Registered user with account-id "
+                + QString::number(acc_id));
+
+    return acc_id;
+}
 
-    QString reg_uri = "sip:";
-    reg_uri.append(domain);
+//----------------------------------------------------------------------
+void SipPhone::registerAt(const int &acc_id)
+{
+    Account acc;
+    if (!accounts_.getAccount(acc_id, acc) || !pjsua_acc_is_valid(acc_id))
+        return;
 
-    char ch_id[150];
-    char ch_reg_uri[100];
-    char ch_user[100];
-    char ch_password[100];
+    pj_status_t status;
+    if (failover_.apply(acc_id))
+    {
+        QString registrar = failover_.getRegistrar(acc_id, acc.getHost());
+        LOG_MESSAGE("account", 0, "Account " + QString::number(acc_id)
+                    + " switches to registrar " + registrar);
+        MetricsRegistry::getInstance()
+            .counter("greenj_registrar_failovers_total", "Switches to an other registrar")
+            ->increment();
+
+        pjsua_acc_config cfg;
+        AccountConfigData data;
+        fillAccountConfig(acc, registrar, cfg, data);
+        // a new registrar uri makes pjsua register there, the registration
+        // of the old one is dropped with its answers
+        status = pjsua_acc_modify(acc_id, &cfg);
+#if PJ_VERSION_NUM_MAJOR < 2
+        if (status == PJ_SUCCESS)
+            status = pjsua_acc_set_registration(acc_id, PJ_TRUE);
+#endif
+    }
+    else
+    {
+        status = pjsua_acc_set_registration(acc_id, PJ_TRUE);
+    }
 
-    if (id.size() > 149 ||
-        reg_uri.size() > 99 ||
-        user.size() > 99 ||
-        password.size() > 99)
+    if (status == PJ_SUCCESS)
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "pjsip", 0, "Error adding account, data too long");
-        signalLogData(info);
-        return -1;
+        failover_.started(acc_id);
+        return;
     }
 
-    strcpy(ch_id, id.toLocal8Bit().data());
-    ch_id[id.size()] = 0;
+    // nothing went out, no answer will come
+    LOG_ERROR("account", status, "Error registering account " + QString::number(acc_id));
+    if (failover_.failed(acc_id) == RegistrarFailover::ACTION_REGISTER)
+        registerAt(acc_id);
+}
 
-    strcpy(ch_reg_uri, reg_uri.toLocal8Bit().data());
-    ch_reg_uri[reg_uri.size()] = 0;
+//----------------------------------------------------------------------
+void SipPhone::checkRegistrations()
+{
+    QList<int> due = failover_.check();
+    for (int i = 0; i < due.size(); ++i)
+        registerAt(due[i]);
 
-    strcpy(ch_user, user.toLocal8Bit().data());
-    ch_user[user.size()] = 0;
-    strcpy(ch_password, password.toLocal8Bit().data());
-    ch_password[password.size()] = 0;
+    MetricsRegistry::getInstance()
+        .gauge("greenj_accounts_unregistered", "Accounts which lost their registration")
+        ->set(failover_.getUnregisteredCount());
+}
 
-    cfg.id = pj_str(ch_id);
-    cfg.reg_uri = pj_str(ch_reg_uri);
-    cfg.cred_count = 1;
-    cfg.cred_info[0].realm = pj_str((char*)"*");
-    cfg.cred_info[0].scheme = pj_str((char*)"digest");
-    cfg.cred_info[0].username = pj_str(ch_user);
-    cfg.cred_info[0].data_type = 0;
-    cfg.cred_info[0].data = pj_str(ch_password);
+//----------------------------------------------------------------------
+bool SipPhone::unregisterAccount(const int &acc_id)
+{
+    if (!accounts_.contains(acc_id))
+    {
+        LOG_WARNING("pjsip", 0, "There is no account " + QString::number(acc_id));
+        return false;
+    }
 
-    pj_status_t status = pjsua_acc_add(&cfg, PJ_TRUE, &acc_id_);
+    LOG_MESSAGE("pjsip", 0, "Unregister account " + QString::number(acc_id));
 
-    if (status != PJ_SUCCESS)
+    pjsua_call_id call_ids[PJSUA_MAX_CALLS];
+    unsigned count = PJSUA_MAX_CALLS;
+    if (accounts_.getCallCount(acc_id) > 0
+        && pjsua_enum_calls(call_ids, &count) == PJ_SUCCESS)
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "pjsip", status, "Error adding account");
-        signalLogData(info);
-        return -1;
+        for (unsigned i = 0; i < count; ++i)
+        {
+            pjsua_call_info ci;
+            if (pjsua_call_get_info(call_ids[i], &ci) == PJ_SUCCESS
+                && ci.acc_id == acc_id)
+            {
+                pjsua_call_hangup(call_ids[i], 0, 0, 0);
+            }
+        }
+        finishIncoming();
     }
-    LogInfo info(LogInfo::STATUS_MESSAGE, "pjsip", 0, "Registered user with account-id "
-                 + QString::number(acc_id_));
-    signalLogData(info);
 
-    return acc_id_;
+    accounts_.remove(acc_id);
+    failover_.remove(acc_id);
+    if (pjsua_acc_is_valid(acc_id))
+        pjsua_acc_del(acc_id);
+    if (accounts_.getDefault() >= 0)
+        pjsua_acc_set_default(accounts_.getDefault());
+    return true;
 }
 
 //----------------------------------------------------------------------
-void SipPhone::getAccountInfo(QVariantMap &account_info)
+bool SipPhone::setDefaultAccount(const int &acc_id)
 {
-    if (!pjsua_acc_is_valid(acc_id_))
+    if (!accounts_.setDefault(acc_id))
+        return false;
+    pjsua_acc_set_default(acc_id);
+    return true;
+}
+
+//----------------------------------------------------------------------
+void SipPhone::getAccountInfo(QVariantMap &account_info, const int &acc_id)
+{
+    pjsua_acc_id id = getAccountId(acc_id);
+    if (id == PJSUA_INVALID_ID || !pjsua_acc_is_valid(id))
     {
-        LogInfo info(LogInfo::STATUS_WARNING, "pjsip", 0, "There is no active account");
-        signalLogData(info);
+        LOG_WARNING("pjsip", 0, "There is no active account");
         return;
     }
     pjsua_acc_info ai;
-    pjsua_acc_get_info(acc_id_, &ai);
+    pjsua_acc_get_info(id, &ai);
+
+    account_info.insert("address", escape(ai.acc_uri.ptr));
+    account_info.insert("status", escape(ai.status_text.ptr));
+    account_info.insert("online_status", escape(ai.online_status_text.ptr));
+    account_info.insert("registered", ai.has_registration && ai.status / 100 == 2
+                                      && ai.expires > 0);
+    account_info.insert("expires", ai.expires);
+    accounts_.getInfo(id, account_info);
+
+    Account acc;
+    if (accounts_.getAccount(id, acc))
+        failover_.getInfo(id, acc.getHost(), account_info);
+}
 
-    account_info.insert("address", Qt::escape(ai.acc_uri.ptr));
-    account_info.insert("status", Qt::escape(ai.status_text.ptr));
-    account_info.insert("online_status", Qt::escape(ai.online_status_text.ptr));
+//----------------------------------------------------------------------
+void SipPhone::getAccountList(QVariantList &accounts)
+{
+    QList<int> ids = accounts_.getIds();
+    for (int i = 0; i < ids.size(); ++i)
+    {
+        QVariantMap info;
+        getAccountInfo(info, ids[i]);
+        accounts << info;
+    }
 }
 
 //----------------------------------------------------------------------
@@ -240,25 +873,33 @@ void SipPhone::incomingCallCb(pjsua_acc_id acc_id, pjsua_call_id call_id,
 {
     pjsua_call_info ci;
 
-    PJ_UNUSED_ARG(acc_id);
     PJ_UNUSED_ARG(rdata);
+    CallTimeline &timeline = CallTimeline::getInstance();
+    timeline.begin(call_id, CallTimeline::STAGE_INVITE_RECEIVED, timeline.now());
 
-    pjsua_call_get_info(call_id, &ci);
-
-    if (pjsua_call_get_count() <= 1)
-        Sound::getInstance().startRing();
+    // route the call to its account, reject it if the account is busy
+    if (!self_->accounts_.addCall(acc_id, call_id, true))
+    {
+        pjsua_call_answer(call_id, PJSIP_SC_BUSY_HERE, NULL, NULL);
+        return;
+    }
 
-    Call *call = new Call(self_, Call::TYPE_INCOMING);
-    call->setCallId(call_id);
-    call->setUrl(ci.remote_contact.ptr);
-    call->setName(ci.remote_info.ptr);
-    LogInfo info(LogInfo::STATUS_MESSAGE, "pjsip", 0, "Incoming Call");
-    self_->signalLogData(info);
+    pjsua_call_get_info(call_id, &ci);
 
-    self_->signalIncomingCall(call);
+    PhoneEvent event;
+    event.type_ = PhoneEvent::TYPE_INCOMING_CALL;
+    event.acc_id_ = acc_id;
+    event.call_id_ = call_id;
+    event.state_ = ci.state;
+    event.status_ = ci.last_status;
+    event.media_status_ = ci.media_status;
+    PhoneEvent::copyText(event.url_, ci.remote_contact.ptr, ci.remote_contact.slen);
+    PhoneEvent::copyText(event.name_, ci.remote_info.ptr, ci.remote_info.slen);
+    event.text_[0] = 0;
+
+    self_->event_queue_.push(event);
 }
 
-
 //----------------------------------------------------------------------
 void SipPhone::callStateCb(pjsua_call_id call_id, pjsip_event *e)
 {
@@ -267,21 +908,58 @@ void SipPhone::callStateCb(pjsua_call_id call_id, pjsip_event *e)
     PJ_UNUSED_ARG(e);
 
     pjsua_call_get_info(call_id, &ci);
-    
-    if (ci.state == PJSIP_INV_STATE_CONFIRMED || ci.state == PJSIP_INV_STATE_DISCONNECTED) 
+    if (ci.state == PJSIP_INV_STATE_CALLING && ci.role == PJSIP_ROLE_UAC)
     {
-        Sound::getInstance().stopRing();
+        // counted here and not after pjsua_call_make_call returns, a fast
+        // failure may disconnect the call before
+        self_->accounts_.addCall(ci.acc_id, call_id, false);
     }
-
-    if (ci.state == PJSIP_INV_STATE_DISCONNECTED)
+    else if (ci.state == PJSIP_INV_STATE_DISCONNECTED)
     {
-        self_->hangUp(call_id);
+        CallTimeline::getInstance().mark(call_id, CallTimeline::STAGE_DISCONNECTED);
+        countCall(ci);
+        self_->dropCallQuality(call_id);
+        self_->accounts_.removeCall(call_id);
+        self_->stopPlayFile(call_id);
+        self_->stopRecordCall(call_id);
     }
 
-    LogInfo info(LogInfo::STATUS_DEBUG, "pjsip", 0, "Call-state from call "+QString::number(call_id)+" changed to "+QString::number(ci.state));
-    self_->signalLogData(info);
+    PhoneEvent event;
+    event.type_ = PhoneEvent::TYPE_CALL_STATE;
+    event.acc_id_ = ci.acc_id;
+    event.call_id_ = call_id;
+    event.state_ = ci.state;
+    event.status_ = ci.last_status;
+    event.media_status_ = ci.media_status;
+    event.url_[0] = 0;
+    event.name_[0] = 0;
+    event.text_[0] = 0;
+
+    self_->event_queue_.push(event);
+}
 
-    self_->signalCallState(call_id, ci.state, ci.last_status);
+//----------------------------------------------------------------------
+void SipPhone::countCall(const pjsua_call_info &ci)
+{
+    // a call which got answered ends with the 200 of the INVITE or the BYE
+    QString outcome;
+    if (ci.last_status / 100 == 2)
+        outcome = "answered";
+    else if (ci.last_status == PJSIP_SC_BUSY_HERE || ci.last_status == PJSIP_SC_BUSY_EVERYWHERE)
+        outcome = "busy";
+    else if (ci.last_status == PJSIP_SC_REQUEST_TERMINATED)
+        outcome = "cancelled";
+    else if (ci.last_status == PJSIP_SC_REQUEST_TIMEOUT
+             || ci.last_status == PJSIP_SC_TEMPORARILY_UNAVAILABLE)
+        outcome = "no_answer";
+    else
+        outcome = "failed";
+
+    QString direction = ci.role == PJSIP_ROLE_UAC ? "outgoing" : "incoming";
+    MetricsRegistry::getInstance()
+        .counter("greenj_calls_total", "Finished calls by direction and outcome",
+                 "direction=\"" + direction + "\",outcome=\"" + outcome + "\"")
+        ->increment();
 }
 
 //----------------------------------------------------------------------
@@ -295,63 +973,446 @@ void SipPhone::callMediaStateCb(pjsua_call_id call_id)
         // When media is active, connect call to sound device.
         pjsua_conf_connect(ci.conf_slot, 0);
         pjsua_conf_connect(0, ci.conf_slot);
+        self_->startMediaFiles(call_id);
+        CallTimeline::getInstance().mark(call_id, CallTimeline::STAGE_MEDIA_ACTIVE);
     }
-    LogInfo info(LogInfo::STATUS_DEBUG, "pjsip", 0, "Call-media-state changed to "+QString::number(ci.state));
-    self_->signalLogData(info);
+
+    PhoneEvent event;
+    event.type_ = PhoneEvent::TYPE_CALL_MEDIA_STATE;
+    event.acc_id_ = ci.acc_id;
+    event.call_id_ = call_id;
+    event.state_ = ci.state;
+    event.status_ = ci.last_status;
+    event.media_status_ = ci.media_status;
+    event.url_[0] = 0;
+    event.name_[0] = 0;
+    event.text_[0] = 0;
+
+    self_->event_queue_.push(event);
+}
+
+//----------------------------------------------------------------------
+void SipPhone::callTsxStateCb(pjsua_call_id call_id, pjsip_transaction *tsx,
+                              pjsip_event *e)
+{
+    // only the INVITE of our outgoing calls, re-INVITEs find their
+    // stages marked already
+    if (tsx->role != PJSIP_ROLE_UAC || tsx->method.id != PJSIP_INVITE_METHOD
+        || e->type != PJSIP_EVENT_TSX_STATE)
+    {
+        return;
+    }
+
+    CallTimeline &timeline = CallTimeline::getInstance();
+    if (e->body.tsx_state.type == PJSIP_EVENT_TX_MSG && tsx->state == PJSIP_TSX_STATE_CALLING)
+    {
+        timeline.mark(call_id, CallTimeline::STAGE_INVITE_SENT);
+    }
+    else if (e->body.tsx_state.type == PJSIP_EVENT_RX_MSG)
+    {
+        int code = e->body.tsx_state.src.rdata->msg_info.msg->line.status.code;
+        if (code == 100)
+            timeline.mark(call_id, CallTimeline::STAGE_TRYING);
+        else if (code == 180)
+            timeline.mark(call_id, CallTimeline::STAGE_RINGING);
+        else if (code > 100 && code < 200)
+            timeline.mark(call_id, CallTimeline::STAGE_PROGRESS);
+        else if (code >= 200 && code < 300)
+            timeline.mark(call_id, CallTimeline::STAGE_ANSWERED);
+    }
+}
+
+//----------------------------------------------------------------------
+bool SipPhone::getRtcpStat(const int &call_id, pjmedia_rtcp_stat &stat)
+{
+#if PJ_VERSION_NUM_MAJOR >= 2
+    pjsua_stream_stat stream_stat;
+    if (pjsua_call_get_stream_stat(call_id, 0, &stream_stat) != PJ_SUCCESS)
+        return false;
+    stat = stream_stat.rtcp;
+#else
+    pjmedia_session *session = pjsua_call_get_media_session(call_id);
+    if (!session || pjmedia_session_get_stream_stat(session, 0, &stat) != PJ_SUCCESS)
+        return false;
+#endif
+    return true;
+}
+
+//----------------------------------------------------------------------
+void SipPhone::checkFirstRtp()
+{
+    // there is no callback for it, so it's as exact as EVENT_INTERVAL
+    CallTimeline &timeline = CallTimeline::getInstance();
+    QList<int> call_ids;
+    timeline.getCallsWaitingForRtp(call_ids);
+    for (int i = 0; i < call_ids.size(); ++i)
+    {
+        pjmedia_rtcp_stat stat;
+        if (getRtcpStat(call_ids[i], stat) && stat.rx.pkt > 0)
+            timeline.mark(call_ids[i], CallTimeline::STAGE_FIRST_RTP);
+    }
+}
+
+//----------------------------------------------------------------------
+void SipPhone::updateQualityInterval()
+{
+    int interval = ConfigFileHandler::getInstance().getQualityInterval();
+    if (interval > 0)
+        quality_timer_.start(interval * 1000);
+    else
+        quality_timer_.stop();
+}
+
+//----------------------------------------------------------------------
+void SipPhone::sampleQuality()
+{
+    double threshold = ConfigFileHandler::getInstance().getMosThreshold();
+    pjsua_call_id call_ids[PJSUA_MAX_CALLS];
+    unsigned count = PJSUA_MAX_CALLS;
+    if (pjsua_enum_calls(call_ids, &count) != PJ_SUCCESS)
+        return;
+
+    QMap<int, CallQuality> previous;
+    int generations[PJSUA_MAX_CALLS];
+    {
+        QMutexLocker locker(&quality_mutex_);
+        previous = qualities_;
+        memcpy(generations, quality_generations_, sizeof(generations));
+    }
+
+    QMap<int, CallQuality> qualities;
+    QList<int> changed;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        pjmedia_rtcp_stat stat;
+        if (!getRtcpStat(call_ids[i], stat))
+            continue;
+
+        // the calls which ended get dropped
+        CallQuality &quality = qualities[call_ids[i]];
+        quality = previous.value(call_ids[i]);
+        if (quality.update(stat, threshold))
+            changed << call_ids[i];
+    }
+
+    {
+        // a call which ended meanwhile may have a successor already
+        QMutexLocker locker(&quality_mutex_);
+        QMap<int, CallQuality>::iterator i = qualities.begin();
+        while (i != qualities.end())
+        {
+            if (generations[i.key()] != quality_generations_[i.key()])
+                i = qualities.erase(i);
+            else
+                ++i;
+        }
+        qualities_ = qualities;
+    }
+
+    for (int i = 0; i < changed.size(); ++i)
+    {
+        QMap<int, CallQuality>::const_iterator quality = qualities.find(changed[i]);
+        if (quality == qualities.constEnd())
+            continue;
+        QVariantMap sample;
+        quality.value().getLast(sample);
+        signalCallQuality(changed[i], sample);
+    }
+}
+
+//----------------------------------------------------------------------
+void SipPhone::dropCallQuality(const int &call_id)
+{
+    QMutexLocker locker(&quality_mutex_);
+    qualities_.remove(call_id);
+    ++quality_generations_[call_id];
+}
+
+//----------------------------------------------------------------------
+void SipPhone::getCallQuality(const int &call_id, QVariantMap &quality)
+{
+    QMutexLocker locker(&quality_mutex_);
+    QMap<int, CallQuality>::const_iterator i = qualities_.find(call_id);
+    if (i != qualities_.constEnd())
+        i.value().getQuality(quality);
 }
 
 //----------------------------------------------------------------------
 void SipPhone::regStateCb(pjsua_acc_id acc)
 {
-    PJ_UNUSED_ARG(acc);
     pjsua_acc_info acc_info;
 
-    pjsua_acc_get_info(self_->acc_id_, &acc_info);
+    pjsua_acc_get_info(acc, &acc_info);
 
-    QString msg("\t");
-    msg.append(acc_info.status_text.ptr);
-    if (acc_info.status < 300)
+    // an unregistration leaves no registration behind
+    MetricsRegistry &metrics = MetricsRegistry::getInstance();
+    if (acc_info.status >= 300)
     {
-        LogInfo info(LogInfo::STATUS_MESSAGE, "account", acc_info.status, msg);
-        self_->signalLogData(info);
+        metrics.counter("greenj_registration_failures_total", "Failed registrations")
+            ->increment();
+    }
+    else if (acc_info.status / 100 == 2 && acc_info.expires > 0)
+    {
+        metrics.counter("greenj_registrations_total", "Successful registrations")
+            ->increment();
+    }
+
+    PhoneEvent event;
+    event.type_ = PhoneEvent::TYPE_REG_STATE;
+    event.acc_id_ = acc;
+    event.call_id_ = -1;
+    event.state_ = 0;
+    event.status_ = acc_info.status;
+    event.media_status_ = 0;
+    event.url_[0] = 0;
+    event.name_[0] = 0;
+    PhoneEvent::copyText(event.text_, acc_info.status_text.ptr, acc_info.status_text.slen);
+
+    self_->event_queue_.push(event);
+}
+
+//----------------------------------------------------------------------
+pj_status_t SipPhone::txRequestCb(pjsip_tx_data *tdata)
+{
+    if (tdata->msg->line.req.method.id != PJSIP_REGISTER_METHOD)
+        return PJ_SUCCESS;
+
+    // unregistrations ask for no time
+    pjsip_expires_hdr *expires = (pjsip_expires_hdr*)
+        pjsip_msg_find_hdr(tdata->msg, PJSIP_H_EXPIRES, NULL);
+    if (expires && expires->ivalue == 0)
+        return PJ_SUCCESS;
+
+    pjsip_to_hdr *to = PJSIP_MSG_TO_HDR(tdata->msg);
+    pjsip_uri *uri = to ? (pjsip_uri*)pjsip_uri_get_uri(to->uri) : NULL;
+    if (!uri || (!PJSIP_URI_SCHEME_IS_SIP(uri) && !PJSIP_URI_SCHEME_IS_SIPS(uri)))
+        return PJ_SUCCESS;
+    pjsip_sip_uri *sip_uri = (pjsip_sip_uri*)uri;
+
+    // the account gets looked up by user and host on the gui thread
+    PhoneEvent event;
+    event.type_ = PhoneEvent::TYPE_REG_STARTED;
+    event.acc_id_ = -1;
+    event.call_id_ = -1;
+    event.state_ = 0;
+    event.status_ = 0;
+    event.media_status_ = 0;
+    if (sip_uri->port)
+    {
+        pj_ansi_snprintf(event.url_, PhoneEvent::TEXT_SIZE, "%.*s@%.*s:%d",
+                         (int)sip_uri->user.slen, sip_uri->user.ptr,
+                         (int)sip_uri->host.slen, sip_uri->host.ptr, sip_uri->port);
     }
     else
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "account", acc_info.status, msg);
-        self_->signalLogData(info);
+        pj_ansi_snprintf(event.url_, PhoneEvent::TEXT_SIZE, "%.*s@%.*s",
+                         (int)sip_uri->user.slen, sip_uri->user.ptr,
+                         (int)sip_uri->host.slen, sip_uri->host.ptr);
+    }
+    event.name_[0] = 0;
+    event.text_[0] = 0;
+
+    self_->event_queue_.push(event);
+    return PJ_SUCCESS;
+}
+
+//----------------------------------------------------------------------
+void SipPhone::processEvents()
+{
+    checkFirstRtp();
+
+    int count = 0;
+    while (count < event_queue_.capacity() && event_queue_.pop(event_batch_[count]))
+        ++count;
+
+    if (count == 0)
+        return;
+
+    event_queue_.addMerged(mergeEvents(event_merged_, count));
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (!event_merged_[i])
+            handleEvent(event_batch_[i]);
     }
-    self_->signalAccountRegState(acc_info.status);
 }
 
 //----------------------------------------------------------------------
-int SipPhone::makeCall(const QString &url)
+int SipPhone::mergeEvents(bool *merged, const int &count)
 {
-    if (url.size() > 149)
+    // Walk the batch backwards. An event is redundant if a later event of
+    // the same kind exists for the same call (or account). Transitions to
+    // CONFIRMED and DISCONNECTED are never dropped, and an incoming call
+    // separates two calls which reuse the same call id.
+    bool later_state[PJSUA_MAX_CALLS];
+    bool later_media[PJSUA_MAX_CALLS];
+    bool later_reg[PJSUA_MAX_ACC];
+    memset(later_state, 0, sizeof(later_state));
+    memset(later_media, 0, sizeof(later_media));
+    memset(later_reg, 0, sizeof(later_reg));
+
+    int merged_count = 0;
+    for (int i = count - 1; i >= 0; --i)
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "pjsip", 0, "Error making call, phoneurl too long");
-        signalLogData(info);
+        const PhoneEvent &event = event_batch_[i];
+        merged[i] = false;
+
+        if (event.type_ == PhoneEvent::TYPE_REG_STATE)
+        {
+            if (event.acc_id_ < 0 || event.acc_id_ >= PJSUA_MAX_ACC)
+                continue;
+            merged[i] = later_reg[event.acc_id_];
+            later_reg[event.acc_id_] = true;
+        }
+        else
+        {
+            int call_id = event.call_id_;
+            if (call_id < 0 || call_id >= PJSUA_MAX_CALLS)
+                continue;
+
+            if (event.type_ == PhoneEvent::TYPE_INCOMING_CALL)
+            {
+                later_state[call_id] = false;
+                later_media[call_id] = false;
+            }
+            else if (event.type_ == PhoneEvent::TYPE_CALL_STATE)
+            {
+                merged[i] = later_state[call_id]
+                            && event.state_ < PJSIP_INV_STATE_CONFIRMED;
+                later_state[call_id] = true;
+            }
+            else if (event.type_ == PhoneEvent::TYPE_CALL_MEDIA_STATE)
+            {
+                merged[i] = later_media[call_id];
+                later_media[call_id] = true;
+            }
+        }
+
+        if (merged[i])
+            ++merged_count;
+    }
+    return merged_count;
+}
+
+//----------------------------------------------------------------------
+void SipPhone::handleEvent(const PhoneEvent &event)
+{
+    if (event.type_ == PhoneEvent::TYPE_INCOMING_CALL)
+    {
+        if (pjsua_call_get_count() <= 1)
+            Sound::getInstance().startRing();
+
+        LOG_MESSAGE("pjsip", 0, "Incoming Call");
+
+        signalIncomingCall(event.call_id_, QString(event.url_), QString(event.name_),
+                           event.acc_id_);
+    }
+    else if (event.type_ == PhoneEvent::TYPE_CALL_STATE)
+    {
+        if (event.state_ == PJSIP_INV_STATE_CONFIRMED
+            || event.state_ == PJSIP_INV_STATE_DISCONNECTED)
+        {
+            Sound::getInstance().stopRing();
+        }
+
+        if (event.state_ == PJSIP_INV_STATE_DISCONNECTED)
+        {
+            hangUp(event.call_id_);
+        }
+
+        LOG_DEBUG("pjsip", 0, "Call-state from call "
+                  + QString::number(event.call_id_) + " changed to "
+                  + QString::number(event.state_));
+
+        signalCallState(event.call_id_, event.state_, event.status_);
+    }
+    else if (event.type_ == PhoneEvent::TYPE_CALL_MEDIA_STATE)
+    {
+        LOG_DEBUG("pjsip", 0, "Call-media-state changed to "
+                  + QString::number(event.state_));
+    }
+    else if (event.type_ == PhoneEvent::TYPE_REG_STATE)
+    {
+        if (event.status_ < 300)
+            LOG_MESSAGE("account", event.status_, "\t" + QString(event.text_));
+        else
+            LOG_ERROR("account", event.status_, "\t" + QString(event.text_));
+
+        accounts_.setRegState(event.acc_id_, event.status_);
+
+        MetricsRegistry &metrics = MetricsRegistry::getInstance();
+        if (event.status_ / 100 == 2)
+        {
+            qint64 down = failover_.succeeded(event.acc_id_);
+            if (down >= 0)
+            {
+                LOG_MESSAGE("account", 0, "Account " + QString::number(event.acc_id_)
+                            + " registered again after " + QString::number(down) + " ms");
+                metrics.histogram("greenj_unregistered_seconds",
+                                  "Time accounts were unregistered until a registrar took them")
+                    ->observe(down * 1000);
+            }
+        }
+        else if (event.status_ >= 300
+                 && failover_.failed(event.acc_id_) == RegistrarFailover::ACTION_REGISTER)
+        {
+            registerAt(event.acc_id_);
+        }
+        metrics.gauge("greenj_accounts_unregistered", "Accounts which lost their registration")
+            ->set(failover_.getUnregisteredCount());
+
+        signalAccountRegState(event.acc_id_, event.status_);
+    }
+    else if (event.type_ == PhoneEvent::TYPE_REG_STARTED)
+    {
+        QString user_host(event.url_);
+        int at = user_host.lastIndexOf('@');
+        Account acc;
+        acc.setUserName(user_host.left(at));
+        acc.setHost(user_host.mid(at + 1));
+        failover_.started(accounts_.findId(acc));
+    }
+}
+
+//----------------------------------------------------------------------
+int SipPhone::makeCall(const QString &url, const int &acc_id)
+{
+    CallTimeline &timeline = CallTimeline::getInstance();
+    qint64 start = timeline.now();
+
+    pjsua_acc_id id = getAccountId(acc_id);
+    if (id == PJSUA_INVALID_ID)
+    {
+        LOG_ERROR("pjsip", 0, "Error making call, no account "
+                  + QString::number(acc_id));
+        return -1;
+    }
+
+    QString target = addTransportParam(url);
+    if (target.size() > 149)
+    {
+        LOG_ERROR("pjsip", 0, "Error making call, phoneurl too long");
         return -1;
     }
 
     char ch_url[150];
 
-    strcpy(ch_url, url.toLocal8Bit().data());
-    ch_url[url.size()] = 0;
+    strcpy(ch_url, target.toLocal8Bit().data());
+    ch_url[target.size()] = 0;
 
     pj_str_t uri = pj_str(ch_url);
     pjsua_call_id call_id;
 
-    LogInfo info(LogInfo::STATUS_MESSAGE, "pjsip", 0, "Make call");
-    signalLogData(info);
+    LOG_MESSAGE("pjsip", 0, "Make call");
 
-    pj_status_t status = pjsua_call_make_call(acc_id_, &uri, 0, NULL, NULL, &call_id);
+    pj_status_t status = pjsua_call_make_call(id, &uri, 0, NULL, NULL, &call_id);
 
     if (status != PJ_SUCCESS)
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "pjsip", status, "Error making call");
-        signalLogData(info);
+        LOG_ERROR("pjsip", status, "Error making call");
         return -1;
     }
+    timeline.begin(call_id, CallTimeline::STAGE_MAKE_CALL, start);
     return (int)call_id;
 }
 
@@ -364,13 +1425,11 @@ void SipPhone::answerCall(int call_id)
     if (call_info.state == PJSIP_INV_STATE_INCOMING)
     {
         pjsua_call_answer((pjsua_call_id)call_id, 200, NULL, NULL);
-        LogInfo info(LogInfo::STATUS_DEBUG, "pjsip", call_info.state, "Call answered");
-        signalLogData(info);
+        LOG_DEBUG("pjsip", call_info.state, "Call answered");
     }
     else
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "pjsip", call_info.state, "Call not incoming");
-        signalLogData(info);
+        LOG_ERROR("pjsip", call_info.state, "Call not incoming");
     }
     finishIncoming();
 }
@@ -378,8 +1437,7 @@ void SipPhone::answerCall(int call_id)
 //----------------------------------------------------------------------
 void SipPhone::hangUp(const int &call_id)
 {
-    LogInfo info(LogInfo::STATUS_DEBUG, "psjip", 0, "hangup");
-    LogHandler::getInstance().logData(info);
+    LOG_DEBUG("pjsip", 0, "hangup");
 
     pjsua_call_info ci;
     pjsua_call_get_info(call_id,&ci);
@@ -399,8 +1457,7 @@ void SipPhone::hangUpAll()
 //----------------------------------------------------------------------
 void SipPhone::finishIncoming()
 {
-    LogInfo info(LogInfo::STATUS_DEBUG, "psjip", 0, "stop the sound");
-    LogHandler::getInstance().logData(info);
+    LOG_DEBUG("pjsip", 0, "stop the sound");
 
     Sound::getInstance().stopRing();
 }
@@ -414,8 +1471,7 @@ bool SipPhone::addCallToConference(const int &call_src, const int &call_dest)
 
     if (src == -1 || dest == -1)
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "pjsip", 0, "Error: one of the selected calls does NOT exist!");
-        signalLogData(info);
+        LOG_ERROR("pjsip", 0, "Error: one of the selected calls does NOT exist!");
         return false;
     }
 
@@ -427,8 +1483,7 @@ bool SipPhone::addCallToConference(const int &call_src, const int &call_dest)
     pj_status_t status =  pjsua_conf_connect(src_ci.conf_slot,dest_ci.conf_slot);
     if (status != PJ_SUCCESS)
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "pjsip", status, "Error connecting conference!");
-        signalLogData(info);
+        LOG_ERROR("pjsip", status, "Error connecting conference!");
         return false;
     }
 
@@ -443,8 +1498,7 @@ bool SipPhone::removeCallFromConference(const int &call_src, const int &call_des
 
     if (src == -1 || dest == -1)
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "pjsip", 0, "Error: one of the selected calls does NOT exist!");
-        signalLogData(info);
+        LOG_ERROR("pjsip", 0, "Error: one of the selected calls does NOT exist!");
         return false;
     }
 
@@ -456,8 +1510,7 @@ bool SipPhone::removeCallFromConference(const int &call_src, const int &call_des
     pj_status_t status =  pjsua_conf_disconnect(src_ci.conf_slot,dest_ci.conf_slot);
     if (status != PJ_SUCCESS)
     {
-        LogInfo info(LogInfo::STATUS_ERROR, "pjsip", status, "Error connecting conference (1/2)!");
-        signalLogData(info);
+        LOG_ERROR("pjsip", status, "Error connecting conference (1/2)!");
         return false;
     }
     return true;
@@ -487,12 +1540,17 @@ void SipPhone::getCallInfo(const int &call_id, QVariantMap &call_info)
     pjsua_call_info ci;
     pjsua_call_get_info(call_id,&ci);
 
-    call_info.insert("address", Qt::escape(ci.remote_contact.ptr));
-    call_info.insert("number", Qt::escape(ci.remote_info.ptr));
-    call_info.insert("stateText", Qt::escape(ci.state_text.ptr));
+    call_info.insert("address", escape(ci.remote_contact.ptr));
+    call_info.insert("number", escape(ci.remote_info.ptr));
+    call_info.insert("stateText", escape(ci.state_text.ptr));
     call_info.insert("state", (int)ci.state);
-    call_info.insert("lastStatus", Qt::escape(ci.last_status_text.ptr));
+    call_info.insert("lastStatus", escape(ci.last_status_text.ptr));
     call_info.insert("duration", (int)ci.connect_duration.sec);
+    call_info.insert("accountId", (int)ci.acc_id);
+
+    QVariantMap timeline;
+    CallTimeline::getInstance().getCall(call_id, timeline);
+    call_info.insert("timeline", timeline);
 }
 
 //----------------------------------------------------------------------
@@ -501,14 +1559,12 @@ void SipPhone::muteSound(const bool &mute)
     float level = 0.f;
     if (mute)
     {
-        LogInfo info(LogInfo::STATUS_MESSAGE, "phone", 0, "muteSound: true");
-        signalLogData(info);
+        LOG_MESSAGE("phone", 0, "muteSound: true");
         level = 0.f;
     }
     else
     {
-        LogInfo info(LogInfo::STATUS_MESSAGE, "phone", 0, "muteSound: false");
-        signalLogData(info);
+        LOG_MESSAGE("phone", 0, "muteSound: false");
         level = 1.f;
     }
     speaker_level_ = level;
@@ -533,14 +1589,12 @@ void SipPhone::muteMicrophone(const bool &mute)
     float level = 0.f;
     if (mute)
     {
-        LogInfo info(LogInfo::STATUS_MESSAGE, "phone", 0, "muteMicrophone: true");
-        signalLogData(info);
+        LOG_MESSAGE("phone", 0, "muteMicrophone: true");
         level = 0.f;
     }
     else
     {
-        LogInfo info(LogInfo::STATUS_MESSAGE, "phone", 0, "muteMicrophone: false");
-        signalLogData(info);
+        LOG_MESSAGE("phone", 0, "muteMicrophone: false");
         level = 1.f;
     }
     mic_level_ = level;
@@ -565,20 +1619,37 @@ void SipPhone::getSignalInformation(QVariantMap &signal_info)
     signal_info.insert("micro", mic_level_);
 }
 
+//----------------------------------------------------------------------
+void SipPhone::getEventStatistics(QVariantMap &stats)
+{
+    event_queue_.getStatistics(stats);
+}
+
 //----------------------------------------------------------------------
 void SipPhone::unregister()
 {
-    LogInfo info(LogInfo::STATUS_MESSAGE, "pjsip", 0, "Unregister account");
-    signalLogData(info);
-    if (pjsua_acc_is_valid(acc_id_))
+    LOG_MESSAGE("pjsip", 0, "Unregister all accounts");
+    QList<int> ids = accounts_.getIds();
+    if (ids.isEmpty())
+        return;
+
+    hangUpAll();
+    for (int i = 0; i < ids.size(); ++i)
     {
-        hangUpAll();
-        pjsua_acc_del(acc_id_);
+        accounts_.remove(ids[i]);
+        failover_.remove(ids[i]);
+        if (pjsua_acc_is_valid(ids[i]))
+            pjsua_acc_del(ids[i]);
     }
 }
 
 //----------------------------------------------------------------------
 SipPhone::~SipPhone(void)
 {
+    event_timer_.stop();
+    // start() isn't called if init() failed on the init thread
+    registerThread();
     pjsua_destroy();
+    delete[] event_batch_;
+    delete[] event_merged_;
 }
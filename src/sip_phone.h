@@ -17,8 +17,14 @@
 #include <pjsua-lib/pjsua.h>
 
 #include <QVector>
+#include <QTimer>
+#include <QMutex>
 
 #include "sound.h"
+#include "event_queue.h"
+#include "account_table.h"
+#include "call_quality.h"
+#include "registrar_failover.h"
 
 class Gui;
 class Phone;
@@ -40,9 +46,210 @@ class SipPhone : public PhoneApi
     float mic_level_;
 
     /**
-     * AccountID we got from our registration
+     * pjlib needs to know the gui thread, as pjsua gets initialized
+     * on an other one
      */
-    pjsua_acc_id acc_id_;
+    pj_thread_desc thread_desc_;
+
+    /**
+     * Media config pjsua got initialized with
+     */
+    pjsua_media_config media_cfg_;
+
+    /**
+     * Transport used by the accounts, and its name ("udp", "tcp" or "tls")
+     */
+    pjsua_transport_id account_transport_id_;
+    QString account_transport_;
+
+    /**
+     * Wav player and recorder of each call, PJSUA_INVALID_ID if there is
+     * none, and the files of the config started with every call. The
+     * pjsip callbacks use them too, media_mutex_ guards them.
+     */
+    pjsua_player_id players_[PJSUA_MAX_CALLS];
+    pjsua_recorder_id recorders_[PJSUA_MAX_CALLS];
+    QString play_file_;
+    QString record_dir_;
+    QMutex media_mutex_;
+
+    /**
+     * Start the player and recorder of the config for a call with active
+     * media, if it doesn't have them yet
+     * @param call_id int, the id of the call
+     */
+    void startMediaFiles(const int &call_id);
+
+    /**
+     * Play a wav file to a call, see playFile()
+     * @param call_id int, the id of the call
+     * @param file QString, the wav file
+     * @param replace bool, true to replace a player the call has, false
+     *        to keep it and drop the new one
+     * @return bool false if the new player isn't used
+     */
+    bool startPlayer(const int &call_id, const QString &file, const bool &replace);
+
+    /**
+     * Record a call to a wav file, see recordCall()
+     * @param call_id int, the id of the call
+     * @param file QString, the wav file
+     * @param replace bool, true to replace a recorder the call has, false
+     *        to keep it and drop the new one
+     * @return bool false if the new recorder isn't used
+     */
+    bool startRecorder(const int &call_id, const QString &file, const bool &replace);
+
+    /**
+     * Forget the quality of a call which ended, thread-safe
+     * @param call_id int, the id of the call
+     */
+    void dropCallQuality(const int &call_id);
+
+    /**
+     * Register the calling thread with pjlib, if it isn't yet
+     */
+    void registerThread();
+
+    /**
+     * Create a transport as configured (see ConfigFileHandler::getSipTransports())
+     * @param name QString, "udp", "tcp" or "tls"
+     * @param transport_id pjsua_transport_id, gets the id of the transport
+     * @return bool false if the transport couldn't be created
+     */
+    bool createTransport(const QString &name, pjsua_transport_id &transport_id);
+
+    /**
+     * Add the transport of the accounts to an uri, so pjsip doesn't
+     * pick udp for it
+     * @param uri QString, the sip uri
+     * @return QString the uri, unchanged for udp or if it names a transport
+     */
+    QString addTransportParam(const QString &uri) const;
+
+    /**
+     * Maximum number of codecs handled
+     */
+    static const int MAX_CODECS;
+
+    /**
+     * Accounts we got from our registrations, by account id.
+     * pjsip limits them to PJSUA_MAX_ACC, which has to be raised in
+     * config_site.h to hold hundreds of extensions.
+     */
+    AccountTable accounts_;
+
+    /**
+     * Resolve an account id given by the application
+     * @param acc_id int, the id of the account, -1 for the default account
+     * @return pjsua_acc_id the account or PJSUA_INVALID_ID
+     */
+    pjsua_acc_id getAccountId(const int &acc_id) const;
+
+    /**
+     * Registrar of each account, switched when one fails
+     */
+    RegistrarFailover failover_;
+    QTimer failover_timer_;
+
+    /**
+     * Interval in ms between two checks for unanswered registrations
+     */
+    static const int FAILOVER_INTERVAL;
+
+    /**
+     * Sees the REGISTER requests going out, for the failover timeout
+     */
+    static pjsip_module reg_module_;
+
+    /**
+     * Strings of an account config, they have to live until pjsua
+     * copied the config
+     */
+    struct AccountConfigData
+    {
+        QByteArray id_;
+        QByteArray reg_uri_;
+        QByteArray proxy_;
+        QByteArray user_;
+        QByteArray password_;
+    };
+
+    /**
+     * Fill the config of an account
+     * @param acc Account, the login data
+     * @param registrar QString, host[:port] of the registrar
+     * @param cfg pjsua_acc_config, gets the config
+     * @param data AccountConfigData, gets the strings of the config
+     */
+    void fillAccountConfig(const Account &acc, const QString &registrar,
+                           pjsua_acc_config &cfg, AccountConfigData &data) const;
+
+    /**
+     * Register an account again, at its current registrar
+     * (see RegistrarFailover)
+     * @param acc_id int, the id of the account
+     */
+    void registerAt(const int &acc_id);
+
+    /**
+     * Escape a pjsip string for html
+     * @param text char*, the null-terminated string
+     * @return QString the escaped string
+     */
+    static QString escape(const char *text);
+
+    /**
+     * Events pushed by the pjsip callbacks, drained by the gui thread
+     */
+    EventQueue event_queue_;
+
+    /**
+     * Scratch buffer for one drain pass, sized to the queue capacity
+     */
+    PhoneEvent *event_batch_;
+
+    /**
+     * Merge flags for the events in event_batch_
+     */
+    bool *event_merged_;
+
+    /**
+     * Periodically drains event_queue_ on the gui thread
+     */
+    QTimer event_timer_;
+
+    /**
+     * Interval in ms between two drain passes
+     */
+    static const int EVENT_INTERVAL;
+
+    /**
+     * Quality of the calls with an audio stream, sampled by quality_timer_.
+     * callStateCb drops ended calls, so a call reusing the id starts from
+     * scratch, and counts the drops in quality_generations_ for samples
+     * taken meanwhile. quality_mutex_ guards both, pjsua isn't called
+     * while it is held.
+     */
+    QMap<int, CallQuality> qualities_;
+    int quality_generations_[PJSUA_MAX_CALLS];
+    QMutex quality_mutex_;
+    QTimer quality_timer_;
+
+    /**
+     * Mark events of a drained batch which are superseded by a later
+     * event of the same call or account
+     * @param merged bool*, one flag per event in event_batch_
+     * @param count int, number of events in event_batch_
+     * @return int number of merged events
+     */
+    int mergeEvents(bool *merged, const int &count);
+
+    /**
+     * Handle one drained event on the gui thread
+     * @param event PhoneEvent, the event to handle
+     */
+    void handleEvent(const PhoneEvent &event);
 
     /**
      * Stop ringing
@@ -66,48 +273,150 @@ class SipPhone : public PhoneApi
      */
     static void callMediaStateCb(pjsua_call_id call_id);
 
+    /**
+     * PJSIP-Callback, called for each transaction of a call, records
+     * the INVITE and its responses in the CallTimeline
+     */
+    static void callTsxStateCb(pjsua_call_id call_id, pjsip_transaction *tsx,
+                               pjsip_event *e);
+
+    /**
+     * Get the rtp/rtcp statistics of the audio stream of a call
+     * @param call_id int, the id of the call
+     * @param stat pjmedia_rtcp_stat, gets the statistics
+     * @return bool false if the call has no audio stream
+     */
+    static bool getRtcpStat(const int &call_id, pjmedia_rtcp_stat &stat);
+
+    /**
+     * Count a finished call in the metrics, by direction and outcome
+     * @param ci pjsua_call_info, the info of the disconnected call
+     */
+    static void countCall(const pjsua_call_info &ci);
+
+    /**
+     * Mark the calls in the CallTimeline which got their first rtp packet
+     */
+    void checkFirstRtp();
+
     /**
      * PJSIP-Callback, called when reg_state changes
      * @param acc pjsua_acc_id, the id of account which changes
      */
     static void regStateCb(pjsua_acc_id acc);
 
+    /**
+     * PJSIP-Module-Callback, called for each request sent, pushes an
+     * event for each REGISTER which isn't an unregistration
+     * @param tdata pjsip_tx_data, the request
+     * @return pj_status_t always PJ_SUCCESS, the request gets sent
+     */
+    static pj_status_t txRequestCb(pjsip_tx_data *tdata);
+
+private slots:
+    /**
+     * Apply priority, ptime, vad and cng of the config to the codecs
+     */
+    void applyCodecSettings();
+
+    /**
+     * Take play_file and record_dir of the config for the next calls
+     */
+    void updateMediaFiles();
+
+    /**
+     * Drain all pending events of the pjsip callbacks in one pass
+     */
+    void processEvents();
+
+    /**
+     * Take a quality sample of all calls with an audio stream
+     */
+    void sampleQuality();
+
+    /**
+     * Restart quality_timer_ with the interval of the config
+     */
+    void updateQualityInterval();
+
+    /**
+     * Switch the accounts whose registrar didn't answer in time, and
+     * register those whose wait for the next round is over
+     */
+    void checkRegistrations();
 
 public:
     SipPhone();
     ~SipPhone(void);
 
+    /**
+     * Find the first codec setting matching a codec
+     * @param names QStringList, codec ids or their first parts, e.g.
+     *        "speex" or "speex/16000"
+     * @param codec_id QString, the full codec id, e.g. "speex/16000/1"
+     * @return int index of the setting, -1 if none matches
+     */
+    static int matchCodec(const QStringList &names, const QString &codec_id);
+
     /**
      * Initializing the SIP-API
+     * @return bool false if pjsua couldn't be started
      */
-    void init();
+    bool init();
+
+    /**
+     * Register the gui thread with pjlib and start handling the events
+     */
+    void start();
 
     /**
      * checks if acc_id is valid or not
+     * @param acc_id int, the id of the account, -1 for the default account
      * @return bool true if acc_id is valid
      */
-    bool checkAccountStatus();
+    bool checkAccountStatus(const int &acc_id = -1);
 
     /**
      * Registers the user at the given Asterisk server
      * @param acc Account, the object with user data
-     * @return bool true if registering was successful
-     *         false if registering failed
+     * @return int the id of the account, -1 if registering failed
      */
     int registerUser(const Account &acc);
 
+    /**
+     * Hang up the calls of an account and unregister it
+     * @param acc_id int, the id of the account
+     * @return bool false if there is no such account
+     */
+    bool unregisterAccount(const int &acc_id);
+
+    /**
+     * Set the account used when no account is given
+     * @param acc_id int, the id of the account
+     * @return bool false if there is no such account
+     */
+    bool setDefaultAccount(const int &acc_id);
+
     /**
      * Get some information about account
      * @param &account_info QVariantMap, which holds account information
+     * @param acc_id int, the id of the account, -1 for the default account
      */
-    void getAccountInfo(QVariantMap &account_info);
+    void getAccountInfo(QVariantMap &account_info, const int &acc_id = -1);
+
+    /**
+     * Get information about all registered accounts
+     * @param accounts QVariantList, gets the information of each account
+     */
+    void getAccountList(QVariantList &accounts);
 
     /**
      * Starting a SIP-Call to the given address
      * @param url string, The SIP-Adress. E.g. "SIP:user@domain"
+     * @param acc_id int, the account to call from, -1 for the default account
      * @return int The CallId of the started call
      */
-    int makeCall(const QString &url);
+    int makeCall(const QString &url, const int &acc_id = -1);
 
     /**
      * Answering an incoming call
@@ -162,7 +471,8 @@ public:
     QString getCallUrl(const int &call_id);
 
     /**
-     * Get information about call like sip-adress, state
+     * Get information about call like sip-adress, state and the timeline
+     * of its setup (see CallTimeline::getCall())
      * @param call_id int, the id of the call
      * @param call_info QVariantMap, the object with the info to be written
      */
@@ -200,10 +510,67 @@ public:
      */
     void getSignalInformation(QVariantMap &signal_info);
 
+    /**
+     * Get counters of the callback event queue
+     * @param stats QVariantMap, a map to save the counters
+     */
+    void getEventStatistics(QVariantMap &stats);
+
+    /**
+     * Get the available codecs with their settings
+     * @param codecs QVariantList, gets a map per codec with id, priority,
+     *        clockRate, channels, ptime, bitrate, vad and cng, best first
+     */
+    void getCodecList(QVariantList &codecs);
+
+    /**
+     * Get the effective media settings and the latency of the sound device
+     * @param info QVariantMap, gets profile, clockRate, audioFramePtime,
+     *        sndRecLatency, sndPlayLatency, jbInit, jbMinPre, jbMaxPre,
+     *        jbMax, quality, ecTailLen, plc, and if the sound device is
+     *        open inputLatency and outputLatency as measured by the device
+     */
+    void getMediaInformation(QVariantMap &info);
+
+    /**
+     * Get the audio quality of a call
+     * @param call_id int, the id of the call
+     * @param quality QVariantMap, gets poor, last and history (see
+     *        CallQuality::getQuality()), empty if there is no sample yet
+     */
+    void getCallQuality(const int &call_id, QVariantMap &quality);
+
+    /**
+     * Play a wav file to a call in a loop, mixed in with the microphone
+     * @param call_id int, the id of the call
+     * @param file QString, the wav file
+     * @return bool false if the file couldn't be played
+     */
+    bool playFile(const int &call_id, const QString &file);
+
+    /**
+     * Stop playing a file to a call
+     * @param call_id int, the id of the call
+     */
+    void stopPlayFile(const int &call_id);
+
+    /**
+     * Record the received audio of a call to a wav file
+     * @param call_id int, the id of the call
+     * @param file QString, the wav file, it gets overwritten
+     * @return bool false if the file couldn't be created
+     */
+    bool recordCall(const int &call_id, const QString &file);
+
+    /**
+     * Stop recording a call, the file gets completed
+     * @param call_id int, the id of the call
+     */
+    void stopRecordCall(const int &call_id);
+
     /**
      * Hanging up all active calls,
-     * Unregistering the user
-     * and destroying the pjsip instance
+     * Unregistering all accounts
      */
     void unregister();
 };
@@ -12,6 +12,9 @@
 #include "sound.h"
 
 #include <QFile>
+#ifndef GREENJ_HEADLESS
+#include <QSound>
+#endif
 
 #include "config_file_handler.h"
 
@@ -19,7 +22,7 @@
 Sound::Sound(void) :
     ring_(0), dial_(0)
 {
-
+#ifndef GREENJ_HEADLESS
     if (QFile::exists(ConfigFileHandler::getInstance().getSoundFilename()))
     {
         ring_ = new QSound(ConfigFileHandler::getInstance().getSoundFilename());
@@ -30,15 +33,18 @@ Sound::Sound(void) :
         dial_ = new QSound(ConfigFileHandler::getInstance().getSoundDialFilename());
         dial_->setLoops(-1);
     }
+#endif
 }
 
 //----------------------------------------------------------------------
 Sound::~Sound(void)
 {
+#ifndef GREENJ_HEADLESS
     if (ring_)
         delete ring_;
     if (dial_)
         delete dial_;
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -51,24 +57,30 @@ Sound &Sound::getInstance()
 //----------------------------------------------------------------------
 void Sound::startRing()
 {
+#ifndef GREENJ_HEADLESS
     if (ring_)
         ring_->play();
+#endif
 }
 
 
 //----------------------------------------------------------------------
 void Sound::startDialRing()
 {
+#ifndef GREENJ_HEADLESS
     if (dial_)
         dial_->play();
+#endif
 }
 
 
 //----------------------------------------------------------------------
 void Sound::stopRing()
 {
+#ifndef GREENJ_HEADLESS
     if (ring_)
         ring_->stop();
     if (dial_)
         dial_->stop();
+#endif
 }
@@ -13,10 +13,12 @@
 #define SOUND_H
 
 #include <QObject>
-#include <QSound>
+
+class QSound;
 
 /**
- * This class handles sounds
+ * This class handles sounds, the headless build (GREENJ_HEADLESS)
+ * has no sound device, there the methods do nothing
  */
 class Sound : QObject
 {
@@ -0,0 +1,221 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "stand_in_registrar.h"
+
+#include <QTextStream>
+#include "config_file_handler.h"
+#include "log_handler.h"
+#include "process_stats.h"
+
+StandInRegistrar *StandInRegistrar::self_;
+
+pjsip_module StandInRegistrar::module_ = {
+    NULL, NULL,                             // prev, next
+    { (char*)"mod-stand-in-registrar", 22 },// name
+    -1,                                     // id
+    PJSIP_MOD_PRIORITY_APPLICATION,         // priority
+    NULL, NULL, NULL, NULL,                 // load, start, stop, unload
+    &StandInRegistrar::rxRequestCb,         // on_rx_request
+    NULL, NULL, NULL, NULL                  // on_rx_response, on_tx_request,
+                                            // on_tx_response, on_tsx_state
+};
+
+const int StandInRegistrar::DEFAULT_EXPIRES = 300;
+const int StandInRegistrar::REPORT_INTERVAL = 10;
+
+//----------------------------------------------------------------------
+StandInRegistrar::StandInRegistrar(const int &port) :
+    port_(port), registrations_(0), calls_(0), active_calls_(0)
+{
+    self_ = this;
+    connect(&report_timer_, SIGNAL(timeout()), this, SLOT(report()));
+}
+
+//----------------------------------------------------------------------
+StandInRegistrar::~StandInRegistrar()
+{
+    pjsua_call_hangup_all();
+    pjsua_destroy();
+}
+
+//----------------------------------------------------------------------
+bool StandInRegistrar::start()
+{
+    pj_status_t status = pjsua_create();
+    if (status != PJ_SUCCESS)
+    {
+        LOG_FATAL_ERROR("stand_in", status, "Error in pjsua_create()");
+        return false;
+    }
+
+    pjsua_config cfg;
+    pjsua_logging_config log_cfg;
+    pjsua_media_config media_cfg;
+    pjsua_config_default(&cfg);
+    cfg.max_calls = PJSUA_MAX_CALLS;
+    cfg.cb.on_incoming_call = &incomingCallCb;
+    cfg.cb.on_call_state = &callStateCb;
+    cfg.cb.on_call_media_state = &callMediaStateCb;
+    pjsua_logging_config_default(&log_cfg);
+    log_cfg.console_level = 1;
+    pjsua_media_config_default(&media_cfg);
+    media_cfg.max_media_ports = PJSUA_MAX_CALLS + 1;
+    status = pjsua_init(&cfg, &log_cfg, &media_cfg);
+    if (status != PJ_SUCCESS)
+    {
+        LOG_FATAL_ERROR("stand_in", status, "Error in pjsua_init()");
+        return false;
+    }
+    pjsua_set_null_snd_dev();
+
+    status = pjsip_endpt_register_module(pjsua_get_pjsip_endpt(), &module_);
+    if (status != PJ_SUCCESS)
+    {
+        LOG_FATAL_ERROR("stand_in", status, "Error registering the registrar module");
+        return false;
+    }
+
+    pjsua_transport_config transport_cfg;
+    pjsua_transport_config_default(&transport_cfg);
+    transport_cfg.port = port_;
+    if (!addTransport(PJSIP_TRANSPORT_UDP, transport_cfg, "udp")
+        || !addTransport(PJSIP_TRANSPORT_TCP, transport_cfg, "tcp"))
+    {
+        return false;
+    }
+
+    // the certificate of the phone's own tls transport serves here too
+    QString tls = "no tls, tls_cert_file and tls_key_file aren't set";
+#if defined(PJSIP_HAS_TLS_TRANSPORT) && PJSIP_HAS_TLS_TRANSPORT != 0
+    ConfigFileHandler &config = ConfigFileHandler::getInstance();
+    QByteArray cert_file = config.getSipTlsCertFile().toLocal8Bit();
+    QByteArray key_file = config.getSipTlsKeyFile().toLocal8Bit();
+    if (cert_file.size() && key_file.size())
+    {
+        transport_cfg.port = port_ + 1;
+        transport_cfg.tls_setting.cert_file = pj_str(cert_file.data());
+        transport_cfg.tls_setting.privkey_file = pj_str(key_file.data());
+        if (!addTransport(PJSIP_TRANSPORT_TLS, transport_cfg, "tls"))
+            return false;
+        tls = "tls port " + QString::number(port_ + 1);
+    }
+#else
+    tls = "no tls, pjsip is built without TLS";
+#endif
+
+    status = pjsua_start();
+    if (status != PJ_SUCCESS)
+    {
+        LOG_FATAL_ERROR("stand_in", status, "Error starting PJSUA");
+        return false;
+    }
+
+    // the load test waits for this line
+    QTextStream(stdout) << "stand-in registrar listening on udp and tcp port " << port_
+                        << ", " << tls << "\n";
+    report_timer_.start(REPORT_INTERVAL * 1000);
+    return true;
+}
+
+//----------------------------------------------------------------------
+bool StandInRegistrar::addTransport(const pjsip_transport_type_e &type,
+                                    const pjsua_transport_config &cfg, const QString &name)
+{
+    pjsua_transport_id transport_id;
+    pj_status_t status = pjsua_transport_create(type, &cfg, &transport_id);
+    if (status != PJ_SUCCESS)
+    {
+        LOG_FATAL_ERROR("stand_in", status, "Error listening on " + name + " port "
+                        + QString::number(cfg.port));
+        return false;
+    }
+
+    // calls to any user end up at the local account
+    pjsua_acc_id acc_id;
+    pjsua_acc_add_local(transport_id, PJ_FALSE, &acc_id);
+    return true;
+}
+
+//----------------------------------------------------------------------
+pj_bool_t StandInRegistrar::rxRequestCb(pjsip_rx_data *rdata)
+{
+    pjsip_msg *msg = rdata->msg_info.msg;
+    if (msg->line.req.method.id != PJSIP_REGISTER_METHOD)
+        return PJ_FALSE;
+
+    int expires = DEFAULT_EXPIRES;
+    pjsip_expires_hdr *expires_hdr =
+        (pjsip_expires_hdr*)pjsip_msg_find_hdr(msg, PJSIP_H_EXPIRES, NULL);
+    if (expires_hdr)
+        expires = expires_hdr->ivalue;
+
+    pjsip_hdr hdr_list;
+    pj_list_init(&hdr_list);
+    pjsip_contact_hdr *contact =
+        (pjsip_contact_hdr*)pjsip_msg_find_hdr(msg, PJSIP_H_CONTACT, NULL);
+    if (contact)
+    {
+        contact = (pjsip_contact_hdr*)pjsip_hdr_clone(rdata->tp_info.pool, contact);
+        if (contact->expires >= 0)
+            expires = contact->expires;
+        contact->expires = expires;
+        pj_list_push_back(&hdr_list, contact);
+    }
+    pj_list_push_back(&hdr_list, pjsip_expires_hdr_create(rdata->tp_info.pool, expires));
+
+    pjsip_endpt_respond_stateless(pjsua_get_pjsip_endpt(), rdata, 200, NULL,
+                                  &hdr_list, NULL);
+    self_->registrations_.ref();
+    return PJ_TRUE;
+}
+
+//----------------------------------------------------------------------
+void StandInRegistrar::incomingCallCb(pjsua_acc_id acc_id, pjsua_call_id call_id,
+                                      pjsip_rx_data *rdata)
+{
+    PJ_UNUSED_ARG(acc_id);
+    PJ_UNUSED_ARG(rdata);
+
+    self_->calls_.ref();
+    self_->active_calls_.ref();
+    pjsua_call_answer(call_id, 200, NULL, NULL);
+}
+
+//----------------------------------------------------------------------
+void StandInRegistrar::callStateCb(pjsua_call_id call_id, pjsip_event *e)
+{
+    PJ_UNUSED_ARG(e);
+
+    pjsua_call_info ci;
+    pjsua_call_get_info(call_id, &ci);
+    if (ci.state == PJSIP_INV_STATE_DISCONNECTED)
+        self_->active_calls_.deref();
+}
+
+//----------------------------------------------------------------------
+void StandInRegistrar::callMediaStateCb(pjsua_call_id call_id)
+{
+    pjsua_call_info ci;
+    pjsua_call_get_info(call_id, &ci);
+    if (ci.media_status == PJSUA_CALL_MEDIA_ACTIVE)
+        pjsua_conf_connect(ci.conf_slot, ci.conf_slot);
+}
+
+//----------------------------------------------------------------------
+void StandInRegistrar::report()
+{
+    QTextStream(stdout) << "registrations " << (int)registrations_
+                        << ", calls " << (int)calls_
+                        << ", active " << (int)active_calls_
+                        << ", cpu " << ProcessStats::getCpuTime() / 1000 << " ms"
+                        << ", rss " << ProcessStats::getResidentSize() / 1024 << " kB\n";
+}
@@ -0,0 +1,109 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef STAND_IN_REGISTRAR_H
+#define STAND_IN_REGISTRAR_H
+
+#include <pjsua-lib/pjsua.h>
+
+#include <QObject>
+#include <QTimer>
+#include <QAtomicInt>
+
+/**
+ * Minimal SIP server for load tests on one machine: accepts every
+ * REGISTER without authentication, answers every INVITE and sends the
+ * received audio back. It listens on udp and tcp, and on tls one port
+ * above if the config has a tls certificate. It has its own pjsua, so it
+ * runs in a process of its own, greenjd starts it with --stand-in [port].
+ */
+class StandInRegistrar : public QObject
+{
+    Q_OBJECT
+
+    static StandInRegistrar *self_;
+    static pjsip_module module_;
+
+    int port_;
+    QTimer report_timer_;
+
+    QAtomicInt registrations_;
+    QAtomicInt calls_;
+    QAtomicInt active_calls_;
+
+    /**
+     * Create a transport and a local account on it, so calls over it
+     * get answered over the same transport
+     * @param type pjsip_transport_type_e, the type of the transport
+     * @param cfg pjsua_transport_config, the port and tls settings
+     * @param name QString, the name of the transport for the messages
+     * @return bool false if the transport couldn't be created
+     */
+    static bool addTransport(const pjsip_transport_type_e &type,
+                             const pjsua_transport_config &cfg, const QString &name);
+
+    /**
+     * Answer REGISTER requests with the contact and expires of the request
+     */
+    static pj_bool_t rxRequestCb(pjsip_rx_data *rdata);
+
+    /**
+     * Answer all incoming calls
+     */
+    static void incomingCallCb(pjsua_acc_id acc_id, pjsua_call_id call_id,
+                               pjsip_rx_data *rdata);
+
+    /**
+     * Count the calls which ended
+     */
+    static void callStateCb(pjsua_call_id call_id, pjsip_event *e);
+
+    /**
+     * Connect the call to itself as echo
+     */
+    static void callMediaStateCb(pjsua_call_id call_id);
+
+private slots:
+    /**
+     * Print the counters
+     */
+    void report();
+
+public:
+    /**
+     * Registrations are granted for this long if the request has no expires
+     */
+    static const int DEFAULT_EXPIRES;
+
+    /**
+     * Seconds between two reports
+     */
+    static const int REPORT_INTERVAL;
+
+    /**
+     * Constructor
+     * @param port int, the udp and tcp port to listen on, tls uses the next one
+     */
+    StandInRegistrar(const int &port);
+
+    /**
+     * Destructor, shuts pjsua down
+     */
+    ~StandInRegistrar();
+
+    /**
+     * Start listening, pjsua handles the requests on its own thread
+     * @return bool false if pjsua couldn't be started
+     */
+    bool start();
+};
+
+#endif // STAND_IN_REGISTRAR_H
@@ -0,0 +1,80 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "startup_report.h"
+
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QVariantMap>
+
+#include "startup_timeline.h"
+#include "process_stats.h"
+
+const int StartupReport::TIMEOUT = 60;
+
+//----------------------------------------------------------------------
+StartupReport::StartupReport(const QStringList &phases) :
+    phases_(phases)
+{
+    connect(&timer_, SIGNAL(timeout()), this, SLOT(check()));
+}
+
+//----------------------------------------------------------------------
+void StartupReport::start()
+{
+    time_.start();
+    timer_.start(50);
+}
+
+//----------------------------------------------------------------------
+void StartupReport::check()
+{
+    StartupTimeline &timeline = StartupTimeline::getInstance();
+    bool failed = timeline.getTime("failed") >= 0;
+    bool reached = true;
+    for (int i = 0; i < phases_.size() && reached; ++i)
+        reached = timeline.getTime(phases_[i]) >= 0;
+
+    if (!failed && !reached && time_.elapsed() < TIMEOUT * 1000)
+        return;
+
+    timer_.stop();
+    print();
+    if (!failed && !reached)
+    {
+        QTextStream(stdout) << "gave up waiting for " << phases_.join(", ")
+                            << " after " << TIMEOUT << " s\n";
+    }
+    QCoreApplication::exit(reached && !failed ? 0 : 1);
+}
+
+//----------------------------------------------------------------------
+void StartupReport::print() const
+{
+    QVariantList phases;
+    StartupTimeline::getInstance().getPhases(phases);
+
+    QTextStream out(stdout);
+    out << QString("phase").leftJustified(16)
+        << QString("at ms").rightJustified(8)
+        << QString("took ms").rightJustified(9) << "\n";
+    for (int i = 0; i < phases.size(); ++i)
+    {
+        QVariantMap p = phases[i].toMap();
+        out << p.value("phase").toString().leftJustified(16)
+            << QString::number(p.value("time").toLongLong()).rightJustified(8)
+            << QString::number(p.value("duration").toLongLong()).rightJustified(9) << "\n";
+    }
+
+    qint64 peak = ProcessStats::getPeakResidentSize();
+    out << "peak rss " << (peak >= 0 ? QString::number(peak / 1024) + " kB" : QString("unknown"))
+        << ", rss " << ProcessStats::getResidentSize() / 1024 << " kB\n";
+}
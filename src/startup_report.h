@@ -0,0 +1,67 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef STARTUP_REPORT_H
+#define STARTUP_REPORT_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QStringList>
+
+/**
+ * Waits until the startup reached some phases of the StartupTimeline,
+ * then prints the timeline and the peak memory to stdout and leaves the
+ * event loop. Both binaries run it with --startup-report.
+ */
+class StartupReport : public QObject
+{
+    Q_OBJECT
+
+    /**
+     * Phases to wait for
+     */
+    QStringList phases_;
+    QTimer timer_;
+    QElapsedTimer time_;
+
+    /**
+     * Print the reached phases and the peak memory
+     */
+    void print() const;
+
+private slots:
+    /**
+     * Leave the event loop once all phases or "failed" are reached,
+     * or after TIMEOUT
+     */
+    void check();
+
+public:
+    /**
+     * Seconds to wait for the phases
+     */
+    static const int TIMEOUT;
+
+    /**
+     * Constructor
+     * @param phases QStringList, the phases to wait for
+     */
+    StartupReport(const QStringList &phases);
+
+    /**
+     * Start waiting, QCoreApplication::exit() gets called with 0 if all
+     * phases got reached and 1 otherwise
+     */
+    void start();
+};
+
+#endif // STARTUP_REPORT_H
@@ -0,0 +1,77 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#include "startup_timeline.h"
+
+#include <QMutexLocker>
+#include <QVariantMap>
+
+#include "log_handler.h"
+
+//----------------------------------------------------------------------
+StartupTimeline::StartupTimeline()
+{
+    timer_.start();
+}
+
+//----------------------------------------------------------------------
+StartupTimeline &StartupTimeline::getInstance()
+{
+    static StartupTimeline instance;
+    return instance;
+}
+
+//----------------------------------------------------------------------
+bool StartupTimeline::mark(const QString &phase)
+{
+    qint64 time;
+    {
+        QMutexLocker locker(&mutex_);
+        for (int i = 0; i < phases_.size(); ++i)
+        {
+            if (phases_[i].first == phase)
+                return false;
+        }
+        time = timer_.elapsed();
+        phases_.append(qMakePair(phase, time));
+    }
+
+    LOG_MESSAGE("startup", 0, phase + " after " + QString::number(time) + " ms");
+    return true;
+}
+
+//----------------------------------------------------------------------
+qint64 StartupTimeline::getTime(const QString &phase) const
+{
+    QMutexLocker locker(&mutex_);
+    for (int i = 0; i < phases_.size(); ++i)
+    {
+        if (phases_[i].first == phase)
+            return phases_[i].second;
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+void StartupTimeline::getPhases(QVariantList &phases) const
+{
+    QMutexLocker locker(&mutex_);
+    qint64 last = 0;
+    for (int i = 0; i < phases_.size(); ++i)
+    {
+        QVariantMap phase;
+        phase.insert("phase", phases_[i].first);
+        phase.insert("time", phases_[i].second);
+        phase.insert("duration", phases_[i].second - last);
+        phases << QVariant(phase);
+        last = phases_[i].second;
+    }
+}
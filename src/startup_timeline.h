@@ -0,0 +1,70 @@
+/****************************************************************************
+**
+** Copyright (C) 2011 Lorem Ipsum Mediengesellschaft m.b.H.
+**
+** GNU General Public License
+** This file may be used under the terms of the GNU General Public License
+** version 3 as published by the Free Software Foundation and
+** appearing in the file LICENSE.GPL included in the packaging of this file.
+**
+****************************************************************************/
+
+#ifndef STARTUP_TIMELINE_H
+#define STARTUP_TIMELINE_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QVariantList>
+
+/**
+ * This class is implemented as singleton.
+ * It records when the phases of the startup are reached, counted from
+ * the first call of getInstance(), which main() does first thing.
+ * Phases can be marked from any thread.
+ */
+class StartupTimeline
+{
+    mutable QMutex mutex_;
+    QElapsedTimer timer_;
+
+    /**
+     * Reached phases with the elapsed ms, in the order they got reached
+     */
+    QList<QPair<QString, qint64> > phases_;
+
+    StartupTimeline();
+    StartupTimeline(const StartupTimeline&);
+
+public:
+    /**
+     * Get instance of Singelton class
+     * @return StartupTimeline the instance to this class
+     */
+    static StartupTimeline &getInstance();
+
+    /**
+     * Record that a phase is reached, only the first time counts
+     * @param phase QString, name of the phase
+     * @return bool false if the phase was reached before
+     */
+    bool mark(const QString &phase);
+
+    /**
+     * Get when a phase was reached
+     * @param phase QString, name of the phase
+     * @return qint64 ms since the start, -1 if the phase isn't reached yet
+     */
+    qint64 getTime(const QString &phase) const;
+
+    /**
+     * Get the reached phases
+     * @param phases QVariantList, gets a map per phase with phase, time
+     *        (ms since start) and duration (ms since the phase before)
+     */
+    void getPhases(QVariantList &phases) const;
+};
+
+#endif // STARTUP_TIMELINE_H